@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <completion.hxx>
+#include <histogram.hxx>
+#include <jsonscan.hxx>
+#include <parser.hxx>
+#include <rope.hxx>
+#include <transport.hxx>
+#include <workspace.hxx>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+static double elapsedNs(Clock::time_point start)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+static std::string genDocument(size_t lines)
+{
+    std::string s;
+    for (size_t i = 0; i < lines; ++i)
+        s += "    var value" + std::to_string(i) + " : int64 = " + std::to_string(i) + " * 2\n";
+    return s;
+}
+
+/**
+ * Typing into a large document: single-character edits at random positions,
+ * applied to the rope and, for comparison, to a flat string.
+ */
+static json benchDocumentSync(size_t lines, int edits)
+{
+    std::string source = genDocument(lines);
+
+    auto start = Clock::now();
+    Rope rope(source);
+    double openNs = elapsedNs(start);
+
+    std::mt19937 rng(1);
+    std::vector<std::pair<size_t, size_t>> positions;
+    for (int i = 0; i < edits; ++i)
+        positions.emplace_back(rng() % lines, rng() % 30);
+
+    start = Clock::now();
+    for (int i = 0; i < edits; ++i)
+    {
+        size_t offset = rope.offsetAt(positions[i].first, positions[i].second);
+        if (i % 2)
+            rope.insert(offset, "x");
+        else
+            rope.erase(offset, 1);
+    }
+    double ropeNs = elapsedNs(start) / edits;
+
+    std::string flat = source;
+    start = Clock::now();
+    for (int i = 0; i < edits; ++i)
+    {
+        size_t offset = std::min(flat.size(), positions[i].first * 40 + positions[i].second);
+        if (i % 2)
+            flat.insert(offset, "x");
+        else
+            flat.erase(offset, 1);
+    }
+    double flatNs = elapsedNs(start) / edits;
+
+    start = Clock::now();
+    size_t bytes = rope.text().size();
+    double snapshotNs = elapsedNs(start);
+
+    json j;
+    j["lines"] = lines;
+    j["bytes"] = bytes;
+    j["edits"] = edits;
+    j["open_ns"] = openNs;
+    j["rope_edit_ns"] = ropeNs;
+    j["string_edit_ns"] = flatNs;
+    j["snapshot_ns"] = snapshotNs;
+    return j;
+}
+
+/**
+ * Completion in a program with many declarations: building the index once
+ * per version, then answering queries with short and empty prefixes.
+ */
+static json benchCompletion(size_t functions, int queries)
+{
+    std::string source;
+    for (size_t i = 0; i < functions; ++i)
+        source += "fn" + std::to_string(i) + "(int64[a, b]) int64 {\n    var sum" + std::to_string(i) + ": int64 = a + b\n    return sum" + std::to_string(i) + "\n}\n";
+    source += "var result: int64 = 0";
+
+    auto start = Clock::now();
+    Lexer lexer(source, "bench.vs");
+    Parser parser(lexer);
+    ASTNodePtr root = parser.parserProgram();
+    double parseNs = elapsedNs(start);
+
+    start = Clock::now();
+    SymbolIndex index(root.get());
+    double indexNs = elapsedNs(start);
+
+    auto offset = static_cast<uint32_t>(source.size() - 1);
+    const std::string_view prefixes[] = {"fn12", "fn", "re", ""};
+    json byPrefix = json::object();
+    for (std::string_view prefix : prefixes)
+    {
+        CompletionQuery query;
+        query.prefix = prefix;
+        query.offset = offset;
+        size_t items = 0;
+        bool incomplete = false;
+        start = Clock::now();
+        for (int i = 0; i < queries; ++i)
+        {
+            Completions completions = index.complete(query);
+            items = completions.items.size();
+            incomplete = completions.incomplete;
+        }
+        byPrefix[prefix.empty() ? "(empty)" : std::string(prefix)] = {{"query_ns", elapsedNs(start) / queries}, {"items", items}, {"incomplete", incomplete}};
+    }
+
+    json j;
+    j["functions"] = functions;
+    j["symbols"] = index.symbols().size();
+    j["parse_ns"] = parseNs;
+    j["index_ns"] = indexNs;
+    j["queries"] = byPrefix;
+    return j;
+}
+
+/**
+ * Bytes of a string handed out in pipe-sized reads.
+ */
+class MemorySource : public ByteSource
+{
+public:
+    explicit MemorySource(const std::string &data) : data(data) {}
+
+    size_t read(char *out, size_t size) override
+    {
+        size_t n = std::min({size, size_t{65536}, data.size() - at});
+        std::copy_n(data.data() + at, n, out);
+        at += n;
+        return n;
+    }
+
+private:
+    const std::string &data;
+    size_t at = 0;
+};
+
+class NullSink : public ByteSink
+{
+public:
+    bool write(const std::string_view *pieces, size_t count) override
+    {
+        for (size_t i = 0; i < count; ++i)
+            bytes += pieces[i].size();
+        return true;
+    }
+
+    size_t bytes = 0;
+};
+
+/**
+ * Framing alone: splitting a stream of typical requests into bodies, and
+ * framing responses, against the getline and ostream code it replaced.
+ */
+static json benchFraming(size_t messages)
+{
+    std::string body = R"({"jsonrpc":"2.0","id":12345,"method":"textDocument/completion","params":{"textDocument":{"uri":"file:///workspace/src/main.vs"},"position":{"line":120,"character":17}}})";
+    std::string input;
+    for (size_t i = 0; i < messages; ++i)
+        input += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    auto start = Clock::now();
+    MemorySource source(input);
+    MessageReader reader(source);
+    std::string_view next;
+    size_t read = 0;
+    while (reader.next(next))
+        read += next.size();
+    double readNs = elapsedNs(start) / messages;
+
+    start = Clock::now();
+    std::istringstream in(input);
+    size_t streamRead = 0;
+    while (true)
+    {
+        std::string line;
+        int length = 0;
+        while (std::getline(in, line) && line != "\r" && !line.empty())
+            if (line.substr(0, 15) == "Content-Length:")
+                length = std::stoi(line.substr(15));
+        if (!in)
+            break;
+        std::string msg(length, '\0');
+        in.read(&msg[0], length);
+        streamRead += msg.size();
+    }
+    double streamReadNs = elapsedNs(start) / messages;
+
+    std::deque<std::string> batch(64, body);
+    NullSink sink;
+    MessageWriter writer(sink);
+    start = Clock::now();
+    for (size_t i = 0; i < messages; i += batch.size())
+        writer.write(batch);
+    double writeNs = elapsedNs(start) / messages;
+
+    std::ostringstream out;
+    start = Clock::now();
+    for (size_t i = 0; i < messages; ++i)
+        out << "Content-Length: " << body.size() << "\r\n\r\n"
+            << body << std::flush;
+    double streamWriteNs = elapsedNs(start) / messages;
+
+    json j;
+    j["messages"] = messages;
+    j["body_bytes"] = body.size();
+    j["read_ns"] = readNs;
+    j["stream_read_ns"] = streamReadNs;
+    j["write_ns"] = writeNs;
+    j["stream_write_ns"] = streamWriteNs;
+    j["checked"] = read == streamRead && read == messages * body.size();
+    return j;
+}
+
+/**
+ * Decoding a message as the reader does (method, id and params, then the
+ * document text for didChange) against parsing it into a DOM.
+ */
+static json benchDecode(size_t documentBytes, int rounds)
+{
+    std::string text = genDocument(documentBytes / 40);
+    json change = {{"jsonrpc", "2.0"},
+                   {"method", "textDocument/didChange"},
+                   {"params", {{"textDocument", {{"uri", "file:///a.vs"}, {"version", 2}}}, {"contentChanges", {{{"text", text}}}}}}};
+    json request = {{"jsonrpc", "2.0"},
+                    {"id", 7},
+                    {"method", "textDocument/completion"},
+                    {"params", {{"textDocument", {{"uri", "file:///a.vs"}}}, {"position", {{"line", 12}, {"character", 4}}}}}};
+
+    json j;
+    for (const auto &[name, message] : {std::pair<const char *, const json &>{"did_change", change}, {"request", request}})
+    {
+        std::string body = message.dump();
+        size_t checksum = 0;
+
+        auto start = Clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            json dom = json::parse(body);
+            const json &params = dom["params"];
+            if (params.contains("contentChanges"))
+                checksum += params["contentChanges"][0]["text"].get<std::string>().size();
+            checksum += dom["method"].get_ref<const std::string &>().size();
+        }
+        double domNs = elapsedNs(start) / rounds;
+
+        std::string method, changed;
+        start = Clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            std::string_view params;
+            JsonScanner scanner(body);
+            scanner.object([&](std::string_view key) {
+                if (key == "method")
+                    scanner.string(method);
+                else if (key == "params")
+                    params = scanner.raw();
+            });
+            JsonScanner inner(params);
+            inner.object([&](std::string_view key) {
+                if (key == "contentChanges")
+                    inner.array([&] {
+                        inner.object([&](std::string_view field) {
+                            if (field == "text")
+                            {
+                                inner.string(changed);
+                                checksum -= changed.size();
+                            }
+                        });
+                    });
+            });
+            checksum -= method.size();
+        }
+        double scanNs = elapsedNs(start) / rounds;
+
+        j[name] = {{"bytes", body.size()}, {"dom_ns", domNs}, {"scan_ns", scanNs}, {"checked", checksum == 0}};
+    }
+    return j;
+}
+
+/**
+ * Indexing a generated workspace cold, then again from the cache, and fuzzy
+ * queries against its symbols.
+ */
+static json benchWorkspaceSymbols(size_t files, int queries)
+{
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "vsharp_lsp_bench_workspace";
+    fs::remove_all(root);
+    // 100 symbols per file: a class, 49 fields and 50 methods.
+    for (size_t f = 0; f < files; ++f)
+    {
+        std::string id = std::to_string(f);
+        std::string source = "class Widget" + id + " {\n";
+        for (int i = 0; i < 49; ++i)
+            source += "    var fieldValue" + std::to_string(i) + "_" + id + " : int64 = 0\n";
+        for (int i = 0; i < 50; ++i)
+            source += "    computeTotal" + std::to_string(i) + "_" + id + "(int64[a]) int64 {\n        return a\n    }\n";
+        source += "}\n";
+        fs::create_directories(root / "src" / std::to_string(f % 16));
+        std::ofstream(root / "src" / std::to_string(f % 16) / ("widget" + id + ".vs")) << source;
+    }
+
+    ArtifactCache cache(root / "cache", uint64_t{1} << 30);
+    WorkspaceIndex index;
+    auto start = Clock::now();
+    index.build({root / "src"}, &cache);
+    double coldNs = elapsedNs(start);
+
+    start = Clock::now();
+    index.build({root / "src"}, &cache);
+    double warmNs = elapsedNs(start);
+    size_t reparsed = index.parsed;
+
+    const std::string_view patterns[] = {"Widget42", "ctl7", "fv", "zzz", ""};
+    json byPattern = json::object();
+    for (std::string_view pattern : patterns)
+    {
+        size_t results = 0;
+        start = Clock::now();
+        for (int i = 0; i < queries; ++i)
+            results = index.query(pattern).size();
+        byPattern[pattern.empty() ? "(empty)" : std::string(pattern)] = {{"query_ns", elapsedNs(start) / queries}, {"results", results}};
+    }
+    fs::remove_all(root);
+
+    json j;
+    j["files"] = files;
+    j["symbols"] = index.symbols.size();
+    j["cold_build_ns"] = coldNs;
+    j["cached_build_ns"] = warmNs;
+    j["cached_build_parsed"] = reparsed;
+    j["queries"] = byPattern;
+    return j;
+}
+
+/**
+ * What the server's instrumentation costs per message: recording a value into
+ * a histogram, alone and with threads recording into the same one, and
+ * reading the percentiles `vsharp/stats` reports.
+ */
+static json benchStats(size_t records)
+{
+    std::mt19937_64 random(5);
+    std::vector<uint64_t> values(4096);
+    for (auto &v : values)
+        v = random() % 10000000;
+
+    Histogram alone;
+    auto start = Clock::now();
+    for (size_t i = 0; i < records; ++i)
+        alone.record(values[i % values.size()]);
+    double recordNs = elapsedNs(start) / records;
+
+    Histogram shared;
+    const size_t threads = 4;
+    start = Clock::now();
+    std::vector<std::thread> recorders;
+    for (size_t t = 0; t < threads; ++t)
+        recorders.emplace_back([&, t] {
+            for (size_t i = t; i < records; i += threads)
+                shared.record(values[i % values.size()]);
+        });
+    for (auto &recorder : recorders)
+        recorder.join();
+    double sharedNs = elapsedNs(start) / records;
+
+    start = Clock::now();
+    uint64_t p99 = 0;
+    for (int i = 0; i < 1000; ++i)
+        p99 = std::max(p99, alone.percentile(99));
+    double percentileNs = elapsedNs(start) / 1000;
+
+    json j;
+    j["records"] = records;
+    j["record_ns"] = recordNs;
+    j["shared_record_ns"] = sharedNs;
+    j["percentile_ns"] = percentileNs;
+    j["checked"] = alone.count() == records && shared.count() == records && p99 <= alone.max();
+    return j;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t scale = 1;
+    int edits = 20000;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--scale=", 0) == 0)
+            scale = std::max<size_t>(1, std::stoul(arg.substr(8)));
+        else if (arg.rfind("--edits=", 0) == 0)
+            edits = std::max(1, std::stoi(arg.substr(8)));
+        else
+        {
+            std::cerr << "Usage: lsp_bench [--scale=N] [--edits=N]" << std::endl;
+            return 1;
+        }
+    }
+
+    json report;
+    report["benchmark"] = "lsp";
+    report["document_sync"] = benchDocumentSync(50000 * scale, edits);
+    report["completion"] = benchCompletion(5000 * scale, 200);
+    report["framing"] = benchFraming(200000 * scale);
+    report["decode"] = benchDecode((1 << 20) * scale, 50);
+    report["workspace_symbol"] = benchWorkspaceSymbols(1000 * scale, 20);
+    report["stats"] = benchStats(10000000 * scale);
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}
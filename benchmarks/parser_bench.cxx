@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <dce.hxx>
+#include <fold.hxx>
+#include <ir.hxx>
+#include <memstats.hxx>
+#include <parser.hxx>
+#include <resolver.hxx>
+#include <serialize.hxx>
+#include <structural.hxx>
+#include <types.hxx>
+#include <visitor.hxx>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct Workload
+{
+    std::string name;
+    std::string source;
+};
+
+struct PhaseSample
+{
+    uint64_t ns;
+    uint64_t allocations;
+    uint64_t bytes;
+    uint64_t peakBytes;
+};
+
+static std::string genWideClass(size_t members)
+{
+    std::string s = "class Wide {\n";
+    for (size_t i = 0; i < members; ++i)
+    {
+        std::string n = std::to_string(i);
+        if (i % 2 == 0)
+            s += "    public var field" + n + " : int64 = " + n + "\n";
+        else
+            s += "    public method" + n + "(int64[a, b]) int64 {\n        return a + b * " + n + "\n    }\n";
+    }
+    s += "}\n";
+    return s;
+}
+
+// Methods that read fields declared both before and after them, so every lookup
+// probes the class scope of a class with thousands of members.
+static std::string genMemberLookup(size_t members)
+{
+    std::string s = "class Lookup {\n";
+    for (size_t i = 0; i < members; ++i)
+    {
+        std::string n = std::to_string(i);
+        std::string later = std::to_string((i * 7 + 3) % members);
+        s += "    static var field" + n + " : int64 = " + n + "\n";
+        s += "    public static get" + n + "(int64[a]) int64 {\n        return a + field" + n + " * field" + later + "\n    }\n";
+    }
+    s += "}\n";
+    return s;
+}
+
+static std::string genDeepIfChain(size_t depth)
+{
+    std::string s = "classify(int64 x) int64 {\n    if x == 0 {\n        return 0\n    }";
+    for (size_t i = 1; i < depth; ++i)
+    {
+        std::string n = std::to_string(i);
+        s += " else if x == " + n + " {\n        return " + n + " * 2\n    }";
+    }
+    s += " else {\n        return x\n    }\n}\n";
+    return s;
+}
+
+static std::string genLongExpression(size_t terms)
+{
+    static const char *ops[] = {" + ", " * ", " - ", " / ", " % "};
+    std::string s = "chain(int64[a, b, c]) int64 {\n    return a";
+    for (size_t i = 0; i < terms; ++i)
+    {
+        s += ops[i % 5];
+        s += (i % 3 == 0) ? "b" : (i % 3 == 1) ? "c" : std::to_string(i + 1);
+    }
+    s += "\n}\n";
+    return s;
+}
+
+static std::string genSmallFunctions(size_t count)
+{
+    std::string s;
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string n = std::to_string(i);
+        s += "fn" + n + "(int64 a, int64 b) int64 {\n    var t: int64 = a * " + n + "\n    return t + b\n}\n";
+    }
+    return s;
+}
+
+// Modeled on examples/main.vs: classes of overloaded arithmetic helpers and static state.
+static std::string genRealistic(size_t classes)
+{
+    std::string s;
+    for (size_t i = 0; i < classes; ++i)
+    {
+        std::string n = std::to_string(i);
+        s += "class test" + n + " {\n\n"
+             "    test(int64[c, d]) int64 {\n\n"
+             "        return c + d * 3\n"
+             "    }\n\n"
+             "    public static scale(int64[c, d]) int64 {\n\n"
+             "        return c + d * " + n + "\n"
+             "    }\n\n"
+             "    private pick(int64 c, boolean flag) int64 {\n"
+             "        if flag {\n"
+             "            return c\n"
+             "        } else {\n"
+             "            return c * 2 - 1\n"
+             "        }\n"
+             "    }\n\n"
+             "    static var f : int64 = " + n + "\n"
+             "    public const ratio : float64 = 3.14\n"
+             "}\n\n";
+    }
+    return s;
+}
+
+template <typename Fn>
+static PhaseSample measure(Fn &&fn)
+{
+    resetPeakBytes();
+    AllocStats before = allocStats();
+    auto start = Clock::now();
+    fn();
+    auto end = Clock::now();
+    AllocStats after = allocStats();
+    return PhaseSample{
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()),
+        after.allocations - before.allocations,
+        after.bytes - before.bytes,
+        after.peakBytes > before.liveBytes ? after.peakBytes - before.liveBytes : 0};
+}
+
+static PhaseSample median(std::vector<PhaseSample> samples)
+{
+    std::sort(samples.begin(), samples.end(), [](const PhaseSample &a, const PhaseSample &b)
+              { return a.ns < b.ns; });
+    return samples[samples.size() / 2];
+}
+
+static json phaseJson(const PhaseSample &s, size_t tokens, size_t nodes)
+{
+    json j;
+    j["ns"] = s.ns;
+    j["ns_per_token"] = tokens ? static_cast<double>(s.ns) / tokens : 0.0;
+    if (nodes)
+        j["nodes_per_sec"] = s.ns ? static_cast<double>(nodes) * 1e9 / s.ns : 0.0;
+    j["allocations"] = s.allocations;
+    j["allocated_bytes"] = s.bytes;
+    j["peak_bytes"] = s.peakBytes;
+    return j;
+}
+
+static json runWorkload(const Workload &w, int iterations)
+{
+    size_t tokens = 0;
+    size_t nodes = 0;
+    size_t astBytes = 0;
+    size_t exprClasses = 0, exprDuplicates = 0;
+    size_t bound = 0, unresolved = 0, typeErrors = 0, foldedNodes = 0, removedNodes = 0, irInstructions = 0;
+    std::vector<PhaseSample> lexSamples, parseSamples, destroySamples, serializeSamples, loadSamples, hashSamples, internSamples, resolveSamples, checkSamples, checkParallelSamples, foldSamples, dceSamples, lowerSamples;
+
+    for (int it = 0; it < iterations; ++it)
+    {
+        Lexer tokenizer(w.source, "bench.vs");
+        lexSamples.push_back(measure([&]
+                                     {
+            size_t n = 0;
+            while (tokenizer.next().Type != TokenType::EndOfFile)
+                ++n;
+            tokens = n; }));
+
+        // Parsing pulls tokens from the lexer on demand, so this phase includes lexing.
+        Lexer lexer(w.source, "bench.vs");
+        ASTNodePtr ast;
+        parseSamples.push_back(measure([&]
+                                       {
+            Parser parser(lexer);
+            ast = parser.parserProgram(); }));
+        nodes = countNodes(ast.get());
+
+        std::string encoded;
+        serializeSamples.push_back(measure([&]
+                                           { encoded = serializeAST(ast.get()); }));
+        astBytes = encoded.size();
+
+        ASTNodePtr loaded;
+        loadSamples.push_back(measure([&]
+                                      { loaded = deserializeAST(encoded); }));
+        loaded.reset();
+
+        StructuralHashes hashes;
+        hashSamples.push_back(measure([&]
+                                      { computeStructuralHashes(ast.get(), hashes); }));
+
+        ExprTable exprs;
+        internSamples.push_back(measure([&]
+                                        { exprs.internAll(ast.get()); }));
+        exprClasses = exprs.size();
+        exprDuplicates = exprs.duplicates();
+
+        std::vector<Diagnostic> diagnostics;
+        resolveSamples.push_back(measure([&]
+                                         { bound = resolveNames(ast.get(), diagnostics); }));
+        unresolved = diagnostics.size();
+
+        // Single-threaded first, so the parallel speedup can be read off the report.
+        std::vector<Diagnostic> typeDiagnostics;
+        checkSamples.push_back(measure([&]
+                                       {
+            TypeTable types;
+            checkTypes(ast.get(), types, typeDiagnostics, 1); }));
+        typeErrors = typeDiagnostics.size();
+        typeDiagnostics.clear();
+        TypeTable types;
+        checkParallelSamples.push_back(measure([&]
+                                               { checkTypes(ast.get(), types, typeDiagnostics); }));
+
+        foldSamples.push_back(measure([&]
+                                      { foldedNodes = foldConstants(ast, types, typeDiagnostics); }));
+
+        dceSamples.push_back(measure([&]
+                                     { removedNodes = eliminateDeadCode(ast); }));
+
+        IRModule ir;
+        lowerSamples.push_back(measure([&]
+                                       { ir = lowerToIR(ast.get(), types); }));
+        irInstructions = 0;
+        for (const auto &fn : ir.functions)
+            irInstructions += fn.instructions.size();
+
+        destroySamples.push_back(measure([&]
+                                         { ast.reset(); }));
+    }
+
+    json j;
+    j["name"] = w.name;
+    j["source_bytes"] = w.source.size();
+    j["tokens"] = tokens;
+    j["nodes"] = nodes;
+    j["phases"]["lex"] = phaseJson(median(lexSamples), tokens, 0);
+    j["phases"]["parse"] = phaseJson(median(parseSamples), tokens, nodes);
+    j["phases"]["destroy"] = phaseJson(median(destroySamples), tokens, nodes);
+    j["phases"]["serialize"] = phaseJson(median(serializeSamples), tokens, nodes);
+    j["phases"]["load"] = phaseJson(median(loadSamples), tokens, nodes);
+    j["phases"]["hash"] = phaseJson(median(hashSamples), tokens, nodes);
+    j["phases"]["intern"] = phaseJson(median(internSamples), tokens, nodes);
+    j["phases"]["resolve"] = phaseJson(median(resolveSamples), tokens, nodes);
+    j["phases"]["typecheck"] = phaseJson(median(checkSamples), tokens, nodes);
+    j["phases"]["typecheck_parallel"] = phaseJson(median(checkParallelSamples), tokens, nodes);
+    j["phases"]["fold"] = phaseJson(median(foldSamples), tokens, nodes);
+    j["phases"]["dce"] = phaseJson(median(dceSamples), tokens, nodes);
+    j["phases"]["lower"] = phaseJson(median(lowerSamples), tokens, nodes);
+    j["vsast_bytes"] = astBytes;
+    j["expr_classes"] = exprClasses;
+    j["expr_duplicates"] = exprDuplicates;
+    j["names_bound"] = bound;
+    j["resolve_errors"] = unresolved;
+    j["type_errors"] = typeErrors;
+    j["folded_nodes"] = foldedNodes;
+    j["removed_nodes"] = removedNodes;
+    j["ir_instructions"] = irInstructions;
+    return j;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = 5;
+    size_t scale = 1;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--iterations=", 0) == 0)
+            iterations = std::max(1, std::stoi(arg.substr(13)));
+        else if (arg.rfind("--scale=", 0) == 0)
+            scale = std::max<size_t>(1, std::stoul(arg.substr(8)));
+        else if (arg.rfind("--filter=", 0) == 0)
+            filter = arg.substr(9);
+        else
+        {
+            std::cerr << "Usage: parser_bench [--iterations=N] [--scale=N] [--filter=name]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Workload> workloads = {
+        {"wide_class", genWideClass(10000 * scale)},
+        {"member_lookup", genMemberLookup(5000 * scale)},
+        {"deep_if_chain", genDeepIfChain(2000 * scale)},
+        {"long_expression", genLongExpression(10000 * scale)},
+        {"small_functions", genSmallFunctions(5000 * scale)},
+        {"realistic", genRealistic(1000 * scale)},
+    };
+
+    json report;
+    report["benchmark"] = "parser";
+    report["iterations"] = iterations;
+    report["hardware_threads"] = std::thread::hardware_concurrency();
+    report["workloads"] = json::array();
+    for (const auto &w : workloads)
+    {
+        if (!filter.empty() && w.name.find(filter) == std::string::npos)
+            continue;
+        try
+        {
+            report["workloads"].push_back(runWorkload(w, iterations));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Workload " << w.name << " failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    report["peak_rss_bytes"] = peakRSS();
+
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}
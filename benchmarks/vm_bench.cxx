@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <dce.hxx>
+#include <fold.hxx>
+#include <ir.hxx>
+#include <parser.hxx>
+#include <resolver.hxx>
+#include <types.hxx>
+#include <vm.hxx>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct Kernel
+{
+    std::string name;
+    std::string source;
+    std::string entry;
+    std::vector<int64_t> args;
+    int64_t expected;
+    uint64_t calls; /**< Bytecode calls made by one run, for ns_per_call */
+};
+
+// The language has no loops, so the loop kernels split their range recursively.
+static const char *FibSource = R"(fib(int64[n]) int64 {
+    if n < 2 {
+        return n
+    }
+    return fib(n - 1) + fib(n - 2)
+}
+)";
+
+static const char *RangeSumSource = R"(sum(int64[lo, hi]) int64 {
+    if hi - lo == 1 {
+        return lo * lo % 7 + lo / 3
+    }
+    var mid : int64 = lo + (hi - lo) / 2
+    return sum(lo, mid) + sum(mid, hi)
+}
+)";
+
+static const char *CounterSource = R"(public class Counter {
+    public static var count : int32 = 0
+    public static var scale : float32 = 0.5
+    public static tick(int32[by]) int32 {
+        count = count * 3 + by
+        scale = scale * 1.0001
+        return count
+    }
+}
+drive(int64[n]) int64 {
+    if n <= 1 {
+        Counter.tick(7)
+        return 1
+    }
+    return drive(n / 2) + drive(n - n / 2)
+}
+)";
+
+static int64_t nativeFib(int64_t n) { return n < 2 ? n : nativeFib(n - 1) + nativeFib(n - 2); }
+
+static BytecodeProgram compile(const std::string &source)
+{
+    Lexer lexer(source, "bench.vs");
+    Parser parser(lexer);
+    ASTNodePtr ast = parser.parserProgram();
+    std::vector<Diagnostic> diagnostics;
+    TypeTable types;
+    resolveNames(ast.get(), diagnostics);
+    checkTypes(ast.get(), types, diagnostics, 1);
+    foldConstants(ast, types, diagnostics);
+    eliminateDeadCode(ast);
+    if (!diagnostics.empty())
+        throw std::runtime_error(diagnostics[0].message);
+    return compileBytecode(lowerToIR(ast.get(), types), types);
+}
+
+static uint64_t elapsed(Clock::time_point start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+static uint64_t median(std::vector<uint64_t> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static json runKernel(const Kernel &k, int iterations)
+{
+    std::vector<uint64_t> compileSamples, startupSamples, runSamples;
+    size_t instructions = 0;
+    for (int it = 0; it < iterations; ++it)
+    {
+        auto start = Clock::now();
+        BytecodeProgram program = compile(k.source);
+        compileSamples.push_back(elapsed(start));
+        instructions = program.code.size();
+
+        start = Clock::now();
+        VirtualMachine vm(program);
+        vm.initialize();
+        startupSamples.push_back(elapsed(start));
+
+        uint32_t entry = *program.find(k.entry);
+        std::vector<VMValue> args;
+        for (int64_t a : k.args)
+            args.push_back(VMValue{a});
+        start = Clock::now();
+        VMValue result = vm.call(entry, args);
+        runSamples.push_back(elapsed(start));
+        if (result.i != k.expected)
+            throw std::runtime_error("returned " + std::to_string(result.i) + ", expected " + std::to_string(k.expected));
+    }
+
+    uint64_t run = median(runSamples);
+    json j;
+    j["name"] = k.name;
+    j["bytecode_instructions"] = instructions;
+    j["calls"] = k.calls;
+    j["compile_ns"] = median(compileSamples);
+    j["startup_ns"] = median(startupSamples);
+    j["run_ns"] = run;
+    j["ns_per_call"] = static_cast<double>(run) / k.calls;
+    return j;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = 5;
+    int64_t scale = 1;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--iterations=", 0) == 0)
+            iterations = std::max(1, std::stoi(arg.substr(13)));
+        else if (arg.rfind("--scale=", 0) == 0)
+            scale = std::max<int64_t>(1, std::stoll(arg.substr(8)));
+        else if (arg.rfind("--filter=", 0) == 0)
+            filter = arg.substr(9);
+        else
+        {
+            std::cerr << "Usage: vm_bench [--iterations=N] [--scale=N] [--filter=name]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Each added scale step doubles the work of fib and adds a million leaves to the others.
+    int64_t fibN = 24 + scale;
+    int64_t leaves = 1000000 * scale;
+    int64_t rangeSum = 0;
+    for (int64_t i = 0; i < leaves; ++i)
+        rangeSum += i * i % 7 + i / 3;
+
+    std::vector<Kernel> kernels = {
+        {"fib", FibSource, "fib", {fibN}, nativeFib(fibN), static_cast<uint64_t>(2 * nativeFib(fibN + 1) - 1)},
+        {"range_sum", RangeSumSource, "sum", {0, leaves}, rangeSum, static_cast<uint64_t>(2 * leaves - 1)},
+        {"static_counter", CounterSource, "drive", {leaves}, leaves, static_cast<uint64_t>(3 * leaves - 1)},
+    };
+
+    json report;
+    report["benchmark"] = "vm";
+    report["iterations"] = iterations;
+    report["instruction_bytes"] = sizeof(VMInstruction);
+    report["kernels"] = json::array();
+    for (const auto &k : kernels)
+    {
+        if (!filter.empty() && k.name.find(filter) == std::string::npos)
+            continue;
+        try
+        {
+            report["kernels"].push_back(runKernel(k, iterations));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Kernel " << k.name << " failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}
@@ -5,9 +5,9 @@ class test {
         return c + d * 3
     }
 
-    public static test(int64[c, d]) int64 {
+    public static test(int64[c]) int64 {
 
-        return c + d * 3
+        return c * 3
     }
 
     static var f : int64 = 0
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include <cache.hxx>
+#include <config.hxx>
+#include <hash.hxx>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /**
+     * Whether a file is named like an entry, `<16 hex digits>.<kind>`. The
+     * directory may be shared with other files, which are never evicted;
+     * neither are temporary files of entries being written.
+     */
+    bool isEntry(const fs::path &path)
+    {
+        std::string name = path.filename().string();
+        if (name.size() < 18 || name[16] != '.')
+            return false;
+        for (size_t i = 0; i < name.size(); ++i)
+        {
+            auto c = static_cast<unsigned char>(name[i]);
+            bool ok = i < 16 ? std::isxdigit(c) && !std::isupper(c) : i == 16 || std::isalnum(c);
+            if (!ok)
+                return false;
+        }
+        return true;
+    }
+}
+
+ArtifactCache::ArtifactCache(fs::path dir, uint64_t maxBytes)
+    : dir(std::move(dir)), maxBytes(maxBytes)
+{
+    std::error_code ec;
+    fs::create_directories(this->dir, ec);
+    if (ec)
+        throw std::runtime_error("Cannot create cache directory: " + this->dir.string());
+}
+
+uint64_t ArtifactCache::key(std::string_view source, std::string_view kind, uint32_t formatVersion)
+{
+    uint64_t seed = hash::string(VSHARP_VERSION);
+    seed = hash::combine(seed, hash::string(kind));
+    seed = hash::combine(seed, formatVersion);
+    return hash::string(source, seed);
+}
+
+fs::path ArtifactCache::entryPath(uint64_t key, std::string_view kind) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return dir / (std::string(name) + "." + std::string(kind));
+}
+
+std::optional<fs::path> ArtifactCache::lookup(uint64_t key, std::string_view kind)
+{
+    fs::path path = entryPath(key, kind);
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec))
+        return std::nullopt;
+    // The modification time doubles as the LRU timestamp.
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return path;
+}
+
+void ArtifactCache::store(uint64_t key, std::string_view kind, std::string_view bytes, bool trim)
+{
+    fs::path path = entryPath(key, kind);
+    fs::path tmp = path;
+    tmp += ".tmp" + std::to_string(std::random_device{}());
+
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out)
+        {
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            throw std::runtime_error("Cannot write cache entry: " + tmp.string());
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec)
+    {
+        fs::remove(tmp, ec);
+        throw std::runtime_error("Cannot store cache entry: " + path.string());
+    }
+    if (trim)
+        evict();
+}
+
+void ArtifactCache::remove(uint64_t key, std::string_view kind)
+{
+    std::error_code ec;
+    fs::remove(entryPath(key, kind), ec);
+}
+
+void ArtifactCache::evict()
+{
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type lastUse;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const auto &item : fs::directory_iterator(dir, ec))
+    {
+        std::error_code itemEc;
+        if (!isEntry(item.path()) || !item.is_regular_file(itemEc))
+            continue;
+        uint64_t size = item.file_size(itemEc);
+        if (itemEc)
+            continue;
+        fs::file_time_type lastUse = item.last_write_time(itemEc);
+        if (itemEc)
+            continue;
+        entries.push_back({item.path(), lastUse, size});
+        total += size;
+    }
+    if (total <= maxBytes)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+              { return a.lastUse < b.lastUse; });
+    for (const auto &entry : entries)
+    {
+        if (total <= maxBytes)
+            break;
+        // Another compiler may have removed it already, which is just as good.
+        fs::remove(entry.path, ec);
+        total -= entry.size;
+    }
+}
@@ -2,9 +2,32 @@
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
+#include <optional>
+#include <cache.hxx>
 #include <cli.hxx>
 #include <config.hxx>
+#include <dce.hxx>
+#include <emitter.hxx>
+#include <fold.hxx>
+#include <ir.hxx>
 #include <parser.hxx>
+#include <passes.hxx>
+#include <resolver.hxx>
+#include <serialize.hxx>
+#include <source.hxx>
+#include <types.hxx>
+#include <vm.hxx>
+
+static std::optional<std::string> flagValue(const std::vector<std::string> &flags, const std::string &name)
+{
+    std::string prefix = name + "=";
+    for (const auto &flag : flags)
+    {
+        if (flag.rfind(prefix, 0) == 0)
+            return flag.substr(prefix.size());
+    }
+    return std::nullopt;
+}
 
 void printHelp()
 {
@@ -16,6 +39,102 @@ void printVersion()
     std::cout << "VSharp Compiler v" << VSHARP_VERSION << std::endl;
 }
 
+/**
+ * Add the pass that reads a file into a tree. The cache, if `--cache-dir`
+ * asks for one, and the sources must outlive the pipeline.
+ */
+static void addParse(PassManager &pipeline, const std::string &filename, const std::vector<std::string> &flags,
+                     SourceManager &sources, std::optional<ArtifactCache> &cache)
+{
+    if (auto dir = flagValue(flags, "--cache-dir")) {
+        uint64_t megabytes = 256;
+        if (auto size = flagValue(flags, "--cache-size"))
+            megabytes = std::stoull(*size);
+        cache.emplace(*dir, megabytes * 1024 * 1024);
+    }
+
+    pipeline.add("parse", [&sources, &cache, filename](CompileUnit &unit) -> size_t {
+        if (std::filesystem::path(filename).extension() == ".vsast") {
+            // The tree's spans point into a source that is not at hand.
+            sources.addFile(filename);
+            unit.ast = loadASTFile(filename);
+            return 1;
+        }
+
+        std::ifstream file(filename, std::ios::binary);
+        std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        uint16_t fileId = sources.addFile(filename, source);
+
+        uint64_t key = 0;
+        if (cache) {
+            key = ArtifactCache::key(source, "vsast", VSAST_VERSION);
+            if (auto hit = cache->lookup(key, "vsast")) {
+                try {
+                    unit.ast = loadASTFile(hit->string());
+                    return 1;
+                } catch (const std::exception &) {
+                    cache->remove(key, "vsast");
+                }
+            }
+        }
+
+        Lexer lexer(std::move(source), filename);
+        lexer.FileId = fileId;
+        Parser parser(lexer);
+        unit.ast = parser.parserProgram();
+
+        if (cache) {
+            try {
+                cache->store(key, "vsast", serializeAST(unit.ast.get()));
+            } catch (const std::exception &e) {
+                std::cerr << "Warning: " << e.what() << std::endl;
+            }
+        }
+        return 1;
+    }, false);
+}
+
+/**
+ * Add the passes from resolving names in the parsed tree to lowering it to IR.
+ */
+static void addAnalysis(PassManager &pipeline, const std::vector<std::string> &flags)
+{
+    pipeline.add("resolve", [](CompileUnit &unit) -> size_t {
+        resolveNames(unit.ast.get(), unit.diagnostics);
+        return 0;
+    });
+    pipeline.add("typecheck", [](CompileUnit &unit) -> size_t {
+        checkTypes(unit.ast.get(), unit.types, unit.diagnostics);
+        return 0;
+    });
+    pipeline.add("fold", [](CompileUnit &unit) {
+        return foldConstants(unit.ast, unit.types, unit.diagnostics);
+    });
+    bool reportDeadCode = std::find(flags.begin(), flags.end(), "--report-dead-code") != flags.end();
+    pipeline.add("dce", [reportDeadCode](CompileUnit &unit) {
+        return eliminateDeadCode(unit.ast, reportDeadCode ? &unit.diagnostics : nullptr);
+    });
+    pipeline.add("lower", [](CompileUnit &unit) -> size_t {
+        unit.ir = lowerToIR(unit.ast.get(), unit.types);
+        return 0;
+    });
+}
+
+/**
+ * Run the pipeline, then print its diagnostics and, for `--time-passes`, its report.
+ */
+static bool runPipeline(PassManager &pipeline, CompileUnit &unit, const SourceManager &sources, const std::vector<std::string> &flags)
+{
+    bool timePasses = std::find(flags.begin(), flags.end(), "--time-passes") != flags.end();
+    pipeline.countNodes(timePasses);
+    bool ok = pipeline.run(unit);
+    for (const auto &diagnostic : unit.diagnostics)
+        std::cerr << sources.format(diagnostic) << std::endl;
+    if (timePasses)
+        pipeline.printReport(std::cerr);
+    return ok;
+}
+
 void compileFile(const std::string &filename, const std::vector<std::string> &flags)
 {
     if (!std::filesystem::exists(filename))
@@ -23,20 +142,92 @@ void compileFile(const std::string &filename, const std::vector<std::string> &fl
         std::cerr << "File does not exist: " << filename << std::endl;
     }
 
-    std::ifstream file(filename, std::ios::binary);
-    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-
-    Lexer lexer(std::move(source), filename);
-    Parser parser(lexer);
+    // `--emit-ast` prints text; `--emit-ast=<format>` picks another format.
+    std::optional<EmitFormat> format;
+    if (std::find(flags.begin(), flags.end(), "--emit-ast") != flags.end()) {
+        format = EmitFormat::Text;
+    } else if (auto name = flagValue(flags, "--emit-ast")) {
+        format = parseEmitFormat(*name);
+        if (!format) {
+            std::cerr << "Unknown AST format: " << *name << std::endl;
+            exit(1);
+        }
+    }
+    std::optional<std::string> emitFile = flagValue(flags, "--emit-vsast");
+    bool emitIR = std::find(flags.begin(), flags.end(), "--emit-ir") != flags.end();
+    bool reportDeadCode = std::find(flags.begin(), flags.end(), "--report-dead-code") != flags.end();
 
     try {
-        ASTNodePtr ast = parser.parserProgram();
-        
-        if (std::find(flags.begin(), flags.end(), "--emit-ast") != flags.end()) {
-            printAST(ast.get());
+        std::optional<ArtifactCache> cache;
+        SourceManager sources;
+        CompileUnit unit;
+        PassManager pipeline;
+        addParse(pipeline, filename, flags, sources, cache);
+        // The tree as written: later passes resolve, fold and prune it.
+        if (format || emitFile) {
+            pipeline.add("emit-ast", [&format, &emitFile](CompileUnit &unit) -> size_t {
+                if (emitFile)
+                    writeASTFile(*emitFile, unit.ast.get());
+                if (format)
+                    emitAST(unit.ast.get(), *format, std::cout);
+                return 0;
+            }, false);
         }
+        // Emitting the tree alone does not need it to check; anything else does.
+        if (emitIR || reportDeadCode || !(format || emitFile))
+            addAnalysis(pipeline, flags);
+        if (!runPipeline(pipeline, unit, sources, flags))
+            exit(1);
+
+        if (emitIR)
+            printIR(unit.ir, unit.types, std::cout);
     } catch (const std::exception &e) {
         std::cerr << "Parser Error: " << e.what() << std::endl;
         exit(1);
     }
-}
\ No newline at end of file
+}
+
+int runFile(const std::string &filename, const std::vector<std::string> &flags)
+{
+    if (!std::filesystem::exists(filename))
+    {
+        std::cerr << "File does not exist: " << filename << std::endl;
+        return 1;
+    }
+
+    BytecodeProgram program;
+    try {
+        std::optional<ArtifactCache> cache;
+        SourceManager sources;
+        CompileUnit unit;
+        PassManager pipeline;
+        addParse(pipeline, filename, flags, sources, cache);
+        addAnalysis(pipeline, flags);
+        pipeline.add("bytecode", [&program](CompileUnit &unit) -> size_t {
+            program = compileBytecode(unit.ir, unit.types);
+            return 0;
+        });
+        if (!runPipeline(pipeline, unit, sources, flags))
+            return 1;
+    } catch (const std::exception &e) {
+        // Parsing, lowering and bytecode generation all report this way.
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    auto entry = program.find("main");
+    if (!entry || program.functions[*entry].paramCount != 0) {
+        std::cerr << "Error: " << filename << " has no function 'main()'" << std::endl;
+        return 1;
+    }
+
+    try {
+        VirtualMachine vm(program);
+        vm.initialize();
+        VMValue result = vm.call(*entry);
+        return program.functions[*entry].returnsValue ? static_cast<int>(result.i) : 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Runtime Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <completion.hxx>
+#include <token.hxx>
+#include <string.hxx>
+
+namespace
+{
+    char lower(char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+
+    bool sameKey(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return lower(x) == lower(y); });
+    }
+
+    bool isIdentifierChar(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    std::string signature(const FunctionDeclNode *fn)
+    {
+        std::string s = "(";
+        for (size_t i = 0; i < fn->params.size(); ++i)
+        {
+            if (i)
+                s += ", ";
+            s += typeToString(fn->params[i].first);
+            s += ' ';
+            s += fn->params[i].second;
+        }
+        s += ") ";
+        s += typeToString(fn->returnType);
+        return s;
+    }
+}
+
+uint32_t SymbolTrie::child(uint32_t node, char c) const
+{
+    const auto &children = nodes[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), c, [](const auto &edge, char key) { return edge.first < key; });
+    return it != children.end() && it->first == c ? it->second : 0;
+}
+
+void SymbolTrie::insert(std::string_view key, uint32_t value)
+{
+    uint32_t node = 0;
+    for (char c : key)
+    {
+        c = lower(c);
+        uint32_t next = child(node, c);
+        if (next == 0)
+        {
+            next = static_cast<uint32_t>(nodes.size());
+            auto &children = nodes[node].children;
+            auto it = std::lower_bound(children.begin(), children.end(), c, [](const auto &edge, char k) { return edge.first < k; });
+            children.insert(it, {c, next});
+            nodes.emplace_back();
+        }
+        node = next;
+    }
+    nodes[node].values.push_back(value);
+}
+
+void SymbolTrie::collect(std::string_view prefix, std::vector<uint32_t> &values) const
+{
+    uint32_t node = 0;
+    for (char c : prefix)
+        if ((node = child(node, lower(c))) == 0)
+            return;
+
+    // Depth first, visiting children in character order.
+    std::vector<uint32_t> stack{node};
+    while (!stack.empty())
+    {
+        const Node &n = nodes[stack.back()];
+        stack.pop_back();
+        values.insert(values.end(), n.values.begin(), n.values.end());
+        for (auto it = n.children.rbegin(); it != n.children.rend(); ++it)
+            stack.push_back(it->second);
+    }
+}
+
+SymbolIndex::SymbolIndex(const ASTNode *root)
+{
+    for (const auto &kv : keywords)
+    {
+        Symbol keyword{std::string(kv.first), "keyword", {}, SymbolKind::Keyword};
+        keyword.scopeEnd = std::numeric_limits<uint32_t>::max();
+        add(std::move(keyword));
+    }
+    if (root)
+        collect(root, Scope{0, 0, nullptr, 0});
+}
+
+void SymbolIndex::add(Symbol symbol)
+{
+    trie.insert(symbol.name, static_cast<uint32_t>(table.size()));
+    table.push_back(std::move(symbol));
+}
+
+void SymbolIndex::collect(const ASTNode *node, const Scope &scope)
+{
+    if (!node)
+        return;
+
+    switch (node->type)
+    {
+    case ASTNodeType::Block:
+    {
+        Scope inner{node->span.begin, node->span.end, nullptr, static_cast<uint8_t>(scope.depth + 1)};
+        for (const auto &child : static_cast<const BlockNode *>(node)->children)
+            collect(child.get(), inner);
+        break;
+    }
+    case ASTNodeType::VarDecl:
+    {
+        auto *var = static_cast<const VarDeclNode *>(node);
+        Symbol symbol{var->name, std::string(typeToString(var->varType)), {}, SymbolKind::Variable};
+        if (var->isConst)
+        {
+            symbol.kind = SymbolKind::Constant;
+            symbol.detail = "const " + symbol.detail;
+        }
+        // Fields are visible throughout their class, other variables after
+        // their declaration.
+        symbol.scopeBegin = scope.owner ? scope.begin : node->span.end;
+        symbol.scopeEnd = scope.end;
+        symbol.depth = scope.depth;
+        if (scope.owner)
+        {
+            symbol.kind = var->isConst ? SymbolKind::Constant : SymbolKind::Field;
+            symbol.container = scope.owner->name;
+            symbol.isPublic = var->access == AccessType::Public;
+        }
+        add(std::move(symbol));
+        break;
+    }
+    case ASTNodeType::FunctionDecl:
+    {
+        auto *fn = static_cast<const FunctionDeclNode *>(node);
+        Symbol symbol{fn->name, signature(fn), {}, scope.owner ? SymbolKind::Method : SymbolKind::Function};
+        symbol.scopeBegin = scope.begin;
+        symbol.scopeEnd = scope.end;
+        symbol.depth = scope.depth;
+        if (scope.owner)
+        {
+            symbol.container = scope.owner->name;
+            symbol.isPublic = fn->access == AccessType::Public;
+        }
+        add(std::move(symbol));
+
+        if (!fn->body)
+            break;
+        for (const auto &[type, name] : fn->params)
+        {
+            Symbol param{name, std::string(typeToString(type)), {}, SymbolKind::Variable};
+            param.scopeBegin = fn->body->span.begin;
+            param.scopeEnd = fn->body->span.end;
+            param.depth = static_cast<uint8_t>(scope.depth + 1);
+            add(std::move(param));
+        }
+        collect(fn->body.get(), scope);
+        break;
+    }
+    case ASTNodeType::ClassDecl:
+    {
+        auto *cls = static_cast<const ClassDeclNode *>(node);
+        Symbol symbol{cls->name, "class", {}, SymbolKind::Class};
+        symbol.scopeBegin = scope.begin;
+        symbol.scopeEnd = scope.end;
+        symbol.depth = scope.depth;
+        add(std::move(symbol));
+
+        if (!cls->body)
+            break;
+        Scope members{cls->body->span.begin, cls->body->span.end, cls, static_cast<uint8_t>(scope.depth + 1)};
+        for (const auto &child : static_cast<const BlockNode *>(cls->body.get())->children)
+            collect(child.get(), members);
+        break;
+    }
+    case ASTNodeType::IfExpr:
+    {
+        auto *ifExpr = static_cast<const IfExprNode *>(node);
+        collect(ifExpr->thenBranch.get(), scope);
+        collect(ifExpr->elseBranch.get(), scope);
+        break;
+    }
+    default:
+        // Other expressions declare nothing.
+        break;
+    }
+}
+
+Completions SymbolIndex::complete(const CompletionQuery &query) const
+{
+    std::vector<uint32_t> matches;
+    trie.collect(query.prefix, matches);
+
+    struct Candidate
+    {
+        const Symbol *symbol;
+        bool exactCase;
+    };
+    auto better = [](const Candidate &a, const Candidate &b) {
+        if (a.exactCase != b.exactCase)
+            return a.exactCase;
+        if (a.symbol->depth != b.symbol->depth)
+            return a.symbol->depth > b.symbol->depth;
+        if (a.symbol->name.size() != b.symbol->name.size())
+            return a.symbol->name.size() < b.symbol->name.size();
+        return a.symbol->name < b.symbol->name;
+    };
+
+    // Keep the best candidate for each name, so shadowed declarations and
+    // overloads are offered once. Equal names share a trie node, so their
+    // candidates are adjacent.
+    std::vector<Candidate> candidates;
+    for (uint32_t i : matches)
+    {
+        const Symbol &symbol = table[i];
+        bool visible = symbol.scopeBegin <= query.offset && query.offset <= symbol.scopeEnd;
+        if (query.qualifier.empty() ? !visible
+                                    : symbol.container != query.qualifier || (!symbol.isPublic && !visible))
+            continue;
+
+        Candidate candidate{&symbol, std::string_view(symbol.name).substr(0, query.prefix.size()) == query.prefix};
+        auto same = std::find_if(candidates.rbegin(), candidates.rend(), [&](const Candidate &c) {
+            return !sameKey(c.symbol->name, symbol.name) || c.symbol->name == symbol.name;
+        });
+        if (same == candidates.rend() || same->symbol->name != symbol.name)
+            candidates.push_back(candidate);
+        else if (better(candidate, *same))
+            *same = candidate;
+    }
+
+    Completions result;
+    result.incomplete = candidates.size() > query.limit;
+    size_t count = std::min(candidates.size(), query.limit);
+    std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(count), candidates.end(), better);
+    result.items.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        result.items.push_back(candidates[i].symbol);
+    return result;
+}
+
+CompletionQuery completionQuery(std::string_view before, uint32_t offset)
+{
+    CompletionQuery query;
+    query.offset = offset;
+
+    size_t start = before.size();
+    while (start > 0 && isIdentifierChar(before[start - 1]))
+        --start;
+    query.prefix = before.substr(start);
+
+    if (start > 0 && before[start - 1] == '.')
+    {
+        size_t end = start - 1;
+        size_t begin = end;
+        while (begin > 0 && isIdentifierChar(before[begin - 1]))
+            --begin;
+        query.qualifier = before.substr(begin, end - begin);
+    }
+    return query;
+}
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <dce.hxx>
+#include <visitor.hxx>
+
+namespace
+{
+    /**
+     * Whether control never continues past a statement.
+     */
+    bool terminates(const ASTNode *node)
+    {
+        if (!node)
+            return false;
+        switch (node->type)
+        {
+        case ASTNodeType::ReturnExpr:
+            return true;
+        case ASTNodeType::IfExpr:
+        {
+            const auto *ifn = static_cast<const IfExprNode *>(node);
+            return terminates(ifn->thenBranch.get()) && terminates(ifn->elseBranch.get());
+        }
+        case ASTNodeType::Block:
+        {
+            const auto &children = static_cast<const BlockNode *>(node)->children;
+            return !children.empty() && terminates(children.back().get());
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool declaresVariables(const BlockNode *block)
+    {
+        return std::any_of(block->children.begin(), block->children.end(), [](const ASTNodePtr &child)
+                           { return child && child->type == ASTNodeType::VarDecl; });
+    }
+
+    /**
+     * Whether evaluating an expression can do more than produce its value:
+     * calls and assignments may change state other code reads.
+     */
+    bool hasEffects(const ASTNode *node)
+    {
+        struct Effects : ASTVisitor<Effects>
+        {
+            bool found = false;
+            bool preVisit(const ASTNode *) { return !found; }
+            void visitFunctionCall(const FunctionCallNode *) { found = true; }
+            void visitAssignExpr(const AssignExprNode *) { found = true; }
+        } effects;
+        if (node)
+            effects.traverse(node);
+        return effects.found;
+    }
+
+    bool isClassMember(const ASTNode *node)
+    {
+        return node->parent && node->parent->type == ASTNodeType::ClassDecl;
+    }
+
+    /**
+     * Counts references to declarations, ignoring those a class member makes
+     * to itself, so recursion alone does not keep a member alive.
+     */
+    struct RefCounter : ASTVisitor<RefCounter>
+    {
+        std::unordered_map<const ASTNode *, size_t> &refs;
+        std::vector<const ASTNode *> released;
+        bool releasing = false;
+        const ASTNode *member = nullptr;
+
+        explicit RefCounter(std::unordered_map<const ASTNode *, size_t> &refs) : refs(refs) {}
+
+        void count(const Binding &binding)
+        {
+            if (!binding.decl || binding.param >= 0 || binding.decl == member)
+                return;
+            if (!releasing)
+                ++refs[binding.decl];
+            else if (--refs[binding.decl] == 0)
+                released.push_back(binding.decl);
+        }
+
+        template <typename Node>
+        void enterMember(const Node *node)
+        {
+            const ASTNode *saved = member;
+            if (isClassMember(node))
+                member = node;
+            traverseChildren(node);
+            member = saved;
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn) { enterMember(fn); }
+        void visitVarDecl(const VarDeclNode *var) { enterMember(var); }
+        void visitIdentifier(const IdentifierNode *id) { count(id->binding); }
+
+        void visitAssignExpr(const AssignExprNode *assign)
+        {
+            count(assign->binding);
+            traverseChildren(assign);
+        }
+
+        void visitFunctionCall(const FunctionCallNode *call)
+        {
+            count(call->binding);
+            traverseChildren(call);
+        }
+    };
+
+    struct Eliminator
+    {
+        std::vector<Diagnostic> *diagnostics;
+        size_t removed = 0;
+
+        void warn(SourceSpan span, std::string message)
+        {
+            if (diagnostics)
+                diagnostics->push_back(Diagnostic{Severity::Warning, span, std::move(message)});
+        }
+
+        void visit(ASTNode *node)
+        {
+            if (!node)
+                return;
+            switch (node->type)
+            {
+            case ASTNodeType::Block:
+                block(static_cast<BlockNode *>(node));
+                break;
+            case ASTNodeType::FunctionDecl:
+                visit(static_cast<FunctionDeclNode *>(node)->body.get());
+                break;
+            case ASTNodeType::ClassDecl:
+                visit(static_cast<ClassDeclNode *>(node)->body.get());
+                break;
+            case ASTNodeType::IfExpr:
+            {
+                auto *ifn = static_cast<IfExprNode *>(node);
+                visit(ifn->thenBranch.get());
+                visit(ifn->elseBranch.get());
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        void block(BlockNode *block)
+        {
+            ASTNodeList &children = block->children;
+            ASTNodeList kept;
+            kept.reserve(children.size());
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                if (!kept.empty() && terminates(kept.back().get()))
+                {
+                    warn(SourceSpan{children[i]->span.begin, children.back()->span.end, children[i]->span.file}, "unreachable code removed");
+                    for (size_t j = i; j < children.size(); ++j)
+                        removed += countNodes(children[j].get());
+                    break;
+                }
+                emit(std::move(children[i]), kept);
+            }
+            children = std::move(kept);
+        }
+
+        /**
+         * Append a statement to a block, replacing an `if` with a constant
+         * condition by the branch it always takes.
+         */
+        void emit(ASTNodePtr node, ASTNodeList &out)
+        {
+            auto *ifn = nodeAs<IfExprNode>(node.get());
+            const auto *cond = ifn ? nodeAs<LiteralNode>(ifn->condition.get()) : nullptr;
+            if (!cond || !std::holds_alternative<bool>(cond->value))
+            {
+                visit(node.get());
+                out.push_back(std::move(node));
+                return;
+            }
+
+            bool taken = std::get<bool>(cond->value);
+            warn(cond->span, taken ? "condition is always true" : "condition is always false");
+            ASTNodePtr branch = std::move(taken ? ifn->thenBranch : ifn->elseBranch);
+            removed += countNodes(node.get());
+            if (!branch)
+                return;
+            removed -= countNodes(branch.get());
+
+            auto *body = nodeAs<BlockNode>(branch.get());
+            if (!body)
+            {
+                // An else-if chain: the nested if may be constant too.
+                branch->parent = node->parent;
+                emit(std::move(branch), out);
+                return;
+            }
+
+            block(body);
+            if (declaresVariables(body))
+            {
+                branch->parent = node->parent;
+                out.push_back(std::move(branch));
+                return;
+            }
+            ++removed;
+            for (auto &child : body->children)
+            {
+                child->parent = node->parent;
+                out.push_back(std::move(child));
+            }
+        }
+
+        void unusedMembers(ASTNode *root)
+        {
+            struct Classes : ASTVisitor<Classes, true>
+            {
+                std::vector<ClassDeclNode *> found;
+                void visitClassDecl(ClassDeclNode *cls)
+                {
+                    found.push_back(cls);
+                    traverseChildren(cls);
+                }
+            } classes;
+            classes.traverse(root);
+            if (classes.found.empty())
+                return;
+
+            std::vector<const ASTNode *> candidates;
+            for (ClassDeclNode *cls : classes.found)
+            {
+                auto *body = nodeAs<BlockNode>(cls->body.get());
+                if (!body)
+                    continue;
+                for (const auto &child : body->children)
+                {
+                    // A function named after its class is a constructor, which is used implicitly.
+                    if (const auto *fn = nodeAs<FunctionDeclNode>(child.get()); fn && fn->access == AccessType::Private && fn->name != cls->name)
+                        candidates.push_back(fn);
+                    // Fields whose initializer has effects stay, or removing them would change what runs.
+                    else if (const auto *var = nodeAs<VarDeclNode>(child.get()); var && var->access == AccessType::Private && !hasEffects(var->value.get()))
+                        candidates.push_back(var);
+                }
+            }
+            if (candidates.empty())
+                return;
+
+            std::unordered_map<const ASTNode *, size_t> refs;
+            RefCounter counter(refs);
+            counter.traverse(root);
+
+            // Removing a member releases its references, which can leave other members unused.
+            std::unordered_set<const ASTNode *> isCandidate(candidates.begin(), candidates.end());
+            std::unordered_set<const ASTNode *> dead;
+            std::vector<const ASTNode *> worklist;
+            for (const ASTNode *c : candidates)
+                if (refs[c] == 0)
+                    worklist.push_back(c);
+            counter.releasing = true;
+            while (!worklist.empty())
+            {
+                const ASTNode *member = worklist.back();
+                worklist.pop_back();
+                if (!dead.insert(member).second)
+                    continue;
+                counter.released.clear();
+                counter.traverse(member);
+                for (const ASTNode *r : counter.released)
+                    if (isCandidate.count(r))
+                        worklist.push_back(r);
+            }
+
+            for (const ASTNode *c : candidates)
+            {
+                if (!dead.count(c))
+                    continue;
+                // Counted now: compacting the class body below destroys the member.
+                removed += countNodes(c);
+                if (const auto *fn = nodeAs<FunctionDeclNode>(c))
+                    warn(fn->span, "unused private function '" + fn->name + "' removed");
+                else
+                    warn(c->span, "unused private field '" + static_cast<const VarDeclNode *>(c)->name + "' removed");
+            }
+            for (ClassDeclNode *cls : classes.found)
+            {
+                auto *body = nodeAs<BlockNode>(cls->body.get());
+                if (!body)
+                    continue;
+                auto end = std::remove_if(body->children.begin(), body->children.end(), [&](const ASTNodePtr &child)
+                                          { return dead.count(child.get()) != 0; });
+                body->children.erase(end, body->children.end());
+            }
+        }
+    };
+}
+
+size_t eliminateDeadCode(ASTNodePtr &root, std::vector<Diagnostic> *diagnostics)
+{
+    Eliminator eliminator{diagnostics};
+    eliminator.visit(root.get());
+    eliminator.unusedMembers(root.get());
+    return eliminator.removed;
+}
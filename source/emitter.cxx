@@ -0,0 +1,701 @@
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <emitter.hxx>
+#include <token.hxx>
+#include <string.hxx>
+#include <visitor.hxx>
+
+std::optional<EmitFormat> parseEmitFormat(std::string_view name)
+{
+    if (name == "text")
+        return EmitFormat::Text;
+    if (name == "json")
+        return EmitFormat::Json;
+    if (name == "sexpr" || name == "sexp")
+        return EmitFormat::SExpr;
+    return std::nullopt;
+}
+
+OutputBuffer::OutputBuffer(std::ostream &out, size_t capacity)
+    : out(out), data(new char[capacity]), capacity(capacity)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    flush();
+}
+
+void OutputBuffer::flush()
+{
+    if (size)
+        out.rdbuf()->sputn(data.get(), static_cast<std::streamsize>(size));
+    size = 0;
+    out.flush();
+}
+
+void OutputBuffer::writeSlow(std::string_view s)
+{
+    if (size)
+        out.rdbuf()->sputn(data.get(), static_cast<std::streamsize>(size));
+    size = 0;
+    if (s.size() >= capacity)
+        out.rdbuf()->sputn(s.data(), static_cast<std::streamsize>(s.size()));
+    else
+    {
+        std::char_traits<char>::copy(data.get(), s.data(), s.size());
+        size = s.size();
+    }
+}
+
+namespace
+{
+    template <typename T>
+    void writeInteger(OutputBuffer &out, T value)
+    {
+        char buf[24];
+        auto result = std::to_chars(buf, buf + sizeof(buf), value);
+        out.write(std::string_view(buf, static_cast<size_t>(result.ptr - buf)));
+    }
+
+    // `exact` selects a round-trippable representation; otherwise this matches
+    // what `std::ostream << double` prints.
+    void writeFloat(OutputBuffer &out, double value, bool exact)
+    {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), exact ? "%.17g" : "%g", value);
+        out.write(std::string_view(buf, static_cast<size_t>(n)));
+    }
+
+    void writeNumber(OutputBuffer &out, const LiteralValue &value, bool exact)
+    {
+        std::visit([&](const auto &v)
+                   {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+                writeFloat(out, v, exact);
+            else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>)
+                writeInteger(out, v); },
+                   value);
+    }
+
+    void writeJsonString(OutputBuffer &out, std::string_view s)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out.put('"');
+        size_t runStart = 0;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            out.write(s.substr(runStart, i - runStart));
+            runStart = i + 1;
+            switch (c)
+            {
+            case '"':
+                out.write("\\\"");
+                break;
+            case '\\':
+                out.write("\\\\");
+                break;
+            case '\n':
+                out.write("\\n");
+                break;
+            case '\t':
+                out.write("\\t");
+                break;
+            case '\r':
+                out.write("\\r");
+                break;
+            default:
+                out.write("\\u00");
+                out.put(hex[c >> 4]);
+                out.put(hex[c & 0xf]);
+                break;
+            }
+        }
+        out.write(s.substr(runStart));
+        out.put('"');
+    }
+
+    void writeEscapedByte(OutputBuffer &out, char c)
+    {
+        switch (c)
+        {
+        case '\n':
+            out.write("\\n");
+            break;
+        case '\t':
+            out.write("\\t");
+            break;
+        case '\r':
+            out.write("\\r");
+            break;
+        case '\\':
+            out.write("\\\\");
+            break;
+        case '\'':
+            out.write("\\'");
+            break;
+        default:
+            out.put(c);
+            break;
+        }
+    }
+
+    struct TextEmitter : ASTVisitor<TextEmitter>
+    {
+        OutputBuffer &out;
+        int indent;
+
+        TextEmitter(OutputBuffer &out, int indent) : out(out), indent(indent) {}
+
+        void pad() { out.fill(' ', static_cast<size_t>(indent)); }
+
+        void child(const ASTNode *node, int childIndent)
+        {
+            int saved = indent;
+            indent = childIndent;
+            traverse(node);
+            indent = saved;
+        }
+
+        void visitBlock(const BlockNode *blk)
+        {
+            pad();
+            out.write("Block\n");
+            for (const auto &c : blk->children)
+                child(c.get(), indent + 2);
+        }
+
+        void visitLiteral(const LiteralNode *lit)
+        {
+            pad();
+            out.write("Literal(");
+            if (const auto *b = std::get_if<bool>(&lit->value))
+                out.write(*b ? "true" : "false");
+            else if (const auto *s = std::get_if<std::string>(&lit->value))
+                out.write(*s);
+            else if (const auto *c = std::get_if<char>(&lit->value))
+            {
+                out.put('\'');
+                writeEscapedByte(out, *c);
+                out.put('\'');
+            }
+            else
+                writeNumber(out, lit->value, false);
+            out.write(")\n");
+        }
+
+        void visitIdentifier(const IdentifierNode *id)
+        {
+            pad();
+            out.write("Identifier(");
+            out.write(id->name);
+            out.write(")\n");
+        }
+
+        void visitBinaryExpr(const BinaryExprNode *bin)
+        {
+            pad();
+            out.write("BinaryExpr(");
+            out.write(bin->op);
+            out.write(")\n");
+            child(bin->left.get(), indent + 2);
+            child(bin->right.get(), indent + 2);
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn)
+        {
+            pad();
+            out.write("FunctionDecl(");
+            out.write(toString_Access(fn->access));
+            out.put(' ');
+            out.write(fn->name);
+            out.write(") -> ");
+            out.write(typeToString(fn->returnType));
+            out.put('\n');
+            pad();
+            out.write("  Params:\n");
+            for (const auto &param : fn->params)
+            {
+                pad();
+                out.write("    ");
+                out.write(typeToString(param.first));
+                out.put(' ');
+                out.write(param.second);
+                out.put('\n');
+            }
+            pad();
+            out.write("  Body:\n");
+            child(fn->body.get(), indent + 4);
+        }
+
+        void visitReturnExpr(const ReturnExprNode *ret)
+        {
+            pad();
+            out.write("ReturnExpr\n");
+            child(ret->expr.get(), indent + 2);
+        }
+
+        void visitVarDecl(const VarDeclNode *var)
+        {
+            pad();
+            out.write(var->isConst ? "ConstDecl " : "VarDecl ");
+            out.write(typeToString(var->varType));
+            out.put(' ');
+            out.write(var->name);
+            if (var->value)
+            {
+                out.write(" = ");
+                child(var->value.get(), 0);
+            }
+            else
+                out.put('\n');
+        }
+
+        void visitIfExpr(const IfExprNode *ifn)
+        {
+            pad();
+            out.write("IfExpr\n");
+            pad();
+            out.write("  Condition:\n");
+            child(ifn->condition.get(), indent + 4);
+            pad();
+            out.write("  Then:\n");
+            child(ifn->thenBranch.get(), indent + 4);
+            if (ifn->elseBranch)
+            {
+                pad();
+                out.write("  Else:\n");
+                child(ifn->elseBranch.get(), indent + 4);
+            }
+        }
+
+        void visitAssignExpr(const AssignExprNode *as)
+        {
+            pad();
+            out.write("AssignExpr(");
+            out.write(as->name);
+            out.write(")\n");
+            child(as->value.get(), indent + 2);
+        }
+
+        void visitFunctionCall(const FunctionCallNode *call)
+        {
+            pad();
+            out.write("FunctionCall(");
+            out.write(call->callee);
+            out.write(")\n");
+            for (const auto &arg : call->args)
+                child(arg.get(), indent + 2);
+        }
+
+        void visitClassDecl(const ClassDeclNode *cls)
+        {
+            pad();
+            out.write("ClassDecl(");
+            out.write(cls->name);
+            out.write(") Access: ");
+            out.write(toString_Access(cls->access));
+            out.put('\n');
+            pad();
+            out.write("  Body:\n");
+            child(cls->body.get(), indent + 4);
+        }
+
+        void visitUnknown(const ASTNode *)
+        {
+            pad();
+            out.write("Unknown AST Node\n");
+        }
+    };
+
+    struct JsonEmitter : ASTVisitor<JsonEmitter>
+    {
+        OutputBuffer &out;
+        const ASTNode *current = nullptr;
+
+        explicit JsonEmitter(OutputBuffer &out) : out(out) {}
+
+        bool preVisit(const ASTNode *node)
+        {
+            current = node;
+            return true;
+        }
+
+        void open(std::string_view type)
+        {
+            out.write("{\"type\":\"");
+            out.write(type);
+            out.write("\",\"span\":[");
+            writeInteger(out, current->span.begin);
+            out.put(',');
+            writeInteger(out, current->span.end);
+            out.put(']');
+        }
+
+        void key(std::string_view name)
+        {
+            out.write(",\"");
+            out.write(name);
+            out.write("\":");
+        }
+
+        void field(std::string_view name, std::string_view value)
+        {
+            key(name);
+            writeJsonString(out, value);
+        }
+
+        void field(std::string_view name, const ASTNode *node)
+        {
+            key(name);
+            if (node)
+                traverse(node);
+            else
+                out.write("null");
+        }
+
+        void visitBlock(const BlockNode *blk)
+        {
+            open("Block");
+            key("children");
+            out.put('[');
+            bool first = true;
+            for (const auto &c : blk->children)
+            {
+                if (!first)
+                    out.put(',');
+                first = false;
+                if (c)
+                    traverse(c.get());
+                else
+                    out.write("null");
+            }
+            out.write("]}");
+        }
+
+        void visitLiteral(const LiteralNode *lit)
+        {
+            open("Literal");
+            field("literalType", typeToString(lit->literalType));
+            key("value");
+            if (const auto *b = std::get_if<bool>(&lit->value))
+                out.write(*b ? "true" : "false");
+            else if (const auto *s = std::get_if<std::string>(&lit->value))
+                writeJsonString(out, *s);
+            else if (const auto *c = std::get_if<char>(&lit->value))
+                writeJsonString(out, std::string_view(c, 1));
+            else if (const auto *d = std::get_if<double>(&lit->value); d && !std::isfinite(*d))
+                out.write("null");
+            else if (const auto *f = std::get_if<float>(&lit->value); f && !std::isfinite(*f))
+                out.write("null");
+            else
+                writeNumber(out, lit->value, true);
+            out.put('}');
+        }
+
+        void visitIdentifier(const IdentifierNode *id)
+        {
+            open("Identifier");
+            field("name", id->name);
+            out.put('}');
+        }
+
+        void visitBinaryExpr(const BinaryExprNode *bin)
+        {
+            open("BinaryExpr");
+            field("op", bin->op);
+            field("left", bin->left.get());
+            field("right", bin->right.get());
+            out.put('}');
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn)
+        {
+            open("FunctionDecl");
+            field("name", fn->name);
+            field("access", toString_Access(fn->access));
+            field("modifier", toString_Modifier(fn->modifier));
+            field("returnType", typeToString(fn->returnType));
+            key("params");
+            out.put('[');
+            for (size_t i = 0; i < fn->params.size(); ++i)
+            {
+                if (i)
+                    out.put(',');
+                out.write("{\"type\":\"");
+                out.write(typeToString(fn->params[i].first));
+                out.write("\",\"name\":");
+                writeJsonString(out, fn->params[i].second);
+                out.put('}');
+            }
+            out.put(']');
+            field("body", fn->body.get());
+            out.put('}');
+        }
+
+        void visitReturnExpr(const ReturnExprNode *ret)
+        {
+            open("ReturnExpr");
+            field("expr", ret->expr.get());
+            out.put('}');
+        }
+
+        void visitVarDecl(const VarDeclNode *var)
+        {
+            open(var->isConst ? "ConstDecl" : "VarDecl");
+            field("name", var->name);
+            field("varType", typeToString(var->varType));
+            field("modifier", toString_Modifier(var->modifier));
+            field("access", toString_Access(var->access));
+            field("value", var->value.get());
+            out.put('}');
+        }
+
+        void visitIfExpr(const IfExprNode *ifn)
+        {
+            open("IfExpr");
+            field("condition", ifn->condition.get());
+            field("then", ifn->thenBranch.get());
+            field("else", ifn->elseBranch.get());
+            out.put('}');
+        }
+
+        void visitAssignExpr(const AssignExprNode *as)
+        {
+            open("AssignExpr");
+            field("name", as->name);
+            field("value", as->value.get());
+            out.put('}');
+        }
+
+        void visitFunctionCall(const FunctionCallNode *call)
+        {
+            open("FunctionCall");
+            field("callee", call->callee);
+            key("args");
+            out.put('[');
+            for (size_t i = 0; i < call->args.size(); ++i)
+            {
+                if (i)
+                    out.put(',');
+                traverse(call->args[i].get());
+            }
+            out.write("]}");
+        }
+
+        void visitClassDecl(const ClassDeclNode *cls)
+        {
+            open("ClassDecl");
+            field("name", cls->name);
+            field("access", toString_Access(cls->access));
+            field("body", cls->body.get());
+            out.put('}');
+        }
+
+        void visitUnknown(const ASTNode *)
+        {
+            open("Unknown");
+            out.put('}');
+        }
+    };
+
+    struct SExprEmitter : ASTVisitor<SExprEmitter>
+    {
+        OutputBuffer &out;
+        size_t depth = 0;
+
+        explicit SExprEmitter(OutputBuffer &out) : out(out) {}
+
+        void open(std::string_view head)
+        {
+            if (depth)
+            {
+                out.put('\n');
+                out.fill(' ', depth * 2);
+            }
+            out.put('(');
+            out.write(head);
+            ++depth;
+        }
+
+        void close()
+        {
+            --depth;
+            out.put(')');
+        }
+
+        void atom(std::string_view s)
+        {
+            out.put(' ');
+            out.write(s);
+        }
+
+        void child(const ASTNode *node)
+        {
+            if (node)
+                traverse(node);
+            else
+                atom("nil");
+        }
+
+        void visitBlock(const BlockNode *blk)
+        {
+            open("block");
+            for (const auto &c : blk->children)
+                child(c.get());
+            close();
+        }
+
+        void visitLiteral(const LiteralNode *lit)
+        {
+            open("literal");
+            atom(typeToString(lit->literalType));
+            out.put(' ');
+            if (const auto *b = std::get_if<bool>(&lit->value))
+                out.write(*b ? "true" : "false");
+            else if (const auto *s = std::get_if<std::string>(&lit->value))
+                writeJsonString(out, *s);
+            else if (const auto *c = std::get_if<char>(&lit->value))
+            {
+                out.put('\'');
+                writeEscapedByte(out, *c);
+                out.put('\'');
+            }
+            else
+                writeNumber(out, lit->value, true);
+            close();
+        }
+
+        void visitIdentifier(const IdentifierNode *id)
+        {
+            open("identifier");
+            atom(id->name);
+            close();
+        }
+
+        void visitBinaryExpr(const BinaryExprNode *bin)
+        {
+            open("binary");
+            atom(bin->op);
+            child(bin->left.get());
+            child(bin->right.get());
+            close();
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn)
+        {
+            open("function");
+            atom(fn->name);
+            atom(":access");
+            atom(toString_Access(fn->access));
+            atom(":modifier");
+            atom(toString_Modifier(fn->modifier));
+            atom(":returns");
+            atom(typeToString(fn->returnType));
+            out.write(" (params");
+            for (const auto &param : fn->params)
+            {
+                out.write(" (");
+                out.write(typeToString(param.first));
+                out.put(' ');
+                out.write(param.second);
+                out.put(')');
+            }
+            out.put(')');
+            child(fn->body.get());
+            close();
+        }
+
+        void visitReturnExpr(const ReturnExprNode *ret)
+        {
+            open("return");
+            child(ret->expr.get());
+            close();
+        }
+
+        void visitVarDecl(const VarDeclNode *var)
+        {
+            open(var->isConst ? "const" : "var");
+            atom(var->name);
+            atom(typeToString(var->varType));
+            atom(":modifier");
+            atom(toString_Modifier(var->modifier));
+            atom(":access");
+            atom(toString_Access(var->access));
+            child(var->value.get());
+            close();
+        }
+
+        void visitIfExpr(const IfExprNode *ifn)
+        {
+            open("if");
+            child(ifn->condition.get());
+            child(ifn->thenBranch.get());
+            child(ifn->elseBranch.get());
+            close();
+        }
+
+        void visitAssignExpr(const AssignExprNode *as)
+        {
+            open("assign");
+            atom(as->name);
+            child(as->value.get());
+            close();
+        }
+
+        void visitFunctionCall(const FunctionCallNode *call)
+        {
+            open("call");
+            atom(call->callee);
+            for (const auto &arg : call->args)
+                child(arg.get());
+            close();
+        }
+
+        void visitClassDecl(const ClassDeclNode *cls)
+        {
+            open("class");
+            atom(cls->name);
+            atom(":access");
+            atom(toString_Access(cls->access));
+            child(cls->body.get());
+            close();
+        }
+
+        void visitUnknown(const ASTNode *)
+        {
+            open("unknown");
+            close();
+        }
+    };
+}
+
+void emitAST(const ASTNode *root, EmitFormat format, std::ostream &out, int indent)
+{
+    OutputBuffer buffer(out);
+    switch (format)
+    {
+    case EmitFormat::Text:
+        TextEmitter(buffer, indent).traverse(root);
+        break;
+    case EmitFormat::Json:
+        if (root)
+            JsonEmitter(buffer).traverse(root);
+        else
+            buffer.write("null");
+        buffer.put('\n');
+        break;
+    case EmitFormat::SExpr:
+        if (root)
+            SExprEmitter(buffer).traverse(root);
+        else
+            buffer.write("nil");
+        buffer.put('\n');
+        break;
+    }
+}
@@ -0,0 +1,744 @@
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <fold.hxx>
+#include <visitor.hxx>
+
+namespace
+{
+    enum class Outcome
+    {
+        Folded,
+        NotConstant,
+        Overflow,
+        DivisionByZero,
+    };
+
+    struct Evaluated
+    {
+        Outcome outcome;
+        LiteralValue value{};
+    };
+
+    Evaluated folded(LiteralValue value) { return Evaluated{Outcome::Folded, std::move(value)}; }
+
+    /**
+     * Read a numeric literal value as T. The checker has already made sure the
+     * value fits.
+     */
+    template <typename T>
+    T numericAs(const LiteralValue &value)
+    {
+        return std::visit([](const auto &v) -> T
+                          {
+            using V = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<V, std::string>)
+                return T{};
+            else
+                return static_cast<T>(v); },
+                          value);
+    }
+
+    /**
+     * Store a value in the variant alternative of its primitive type.
+     */
+    LiteralValue represent(const LiteralValue &value, Type type)
+    {
+        switch (type)
+        {
+        case Type::Int8:
+            return numericAs<int8_t>(value);
+        case Type::Int16:
+            return numericAs<int16_t>(value);
+        case Type::Int32:
+            return numericAs<int32_t>(value);
+        case Type::Int64:
+            return numericAs<int64_t>(value);
+        case Type::Uint8:
+            return numericAs<uint8_t>(value);
+        case Type::Uint16:
+            return numericAs<uint16_t>(value);
+        case Type::Uint32:
+            return numericAs<uint32_t>(value);
+        case Type::Uint64:
+            return numericAs<uint64_t>(value);
+        case Type::Float32:
+            return numericAs<float>(value);
+        case Type::Float64:
+            return numericAs<double>(value);
+        default:
+            return value;
+        }
+    }
+
+    template <typename T>
+    Evaluated compare(const std::string &op, const T &a, const T &b)
+    {
+        if (op == "==")
+            return folded(a == b);
+        if (op == "!=")
+            return folded(a != b);
+        if (op == "<")
+            return folded(a < b);
+        if (op == "<=")
+            return folded(a <= b);
+        if (op == ">")
+            return folded(a > b);
+        if (op == ">=")
+            return folded(a >= b);
+        return Evaluated{Outcome::NotConstant};
+    }
+
+    /**
+     * Integer arithmetic in exactly T, with every overflow detected before it
+     * can happen.
+     */
+    template <typename T>
+    Evaluated integer(const std::string &op, T a, T b)
+    {
+        constexpr T min = std::numeric_limits<T>::min();
+        constexpr T max = std::numeric_limits<T>::max();
+        constexpr bool isSigned = std::is_signed_v<T>;
+        const Evaluated overflow{Outcome::Overflow};
+
+        if (op == "+")
+        {
+            if (isSigned ? (b > 0 && a > max - b) || (b < 0 && a < min - b) : a > max - b)
+                return overflow;
+            return folded(static_cast<T>(a + b));
+        }
+        if (op == "-")
+        {
+            if (isSigned ? (b < 0 && a > max + b) || (b > 0 && a < min + b) : a < b)
+                return overflow;
+            return folded(static_cast<T>(a - b));
+        }
+        if (op == "*")
+        {
+            bool over;
+            if constexpr (isSigned)
+            {
+                if (a > 0)
+                    over = b > 0 ? a > max / b : b < min / a;
+                else
+                    over = b > 0 ? a < min / b : a != 0 && b < max / a;
+            }
+            else
+                over = b != 0 && a > max / b;
+            if (over)
+                return overflow;
+            return folded(static_cast<T>(a * b));
+        }
+        if (op == "/" || op == "%")
+        {
+            if (b == 0)
+                return Evaluated{Outcome::DivisionByZero};
+            if constexpr (isSigned)
+            {
+                // min / -1 is the one quotient that does not fit; its remainder is 0.
+                if (a == min && b == -1)
+                    return op == "/" ? overflow : folded(T{0});
+            }
+            return folded(static_cast<T>(op == "/" ? a / b : a % b));
+        }
+        if (op == "|")
+            return folded(static_cast<T>(a | b));
+        return compare(op, a, b);
+    }
+
+    /**
+     * IEEE arithmetic in the precision of T; no operation is an error.
+     */
+    template <typename T>
+    Evaluated floating(const std::string &op, T a, T b)
+    {
+        if (op == "+")
+            return folded(static_cast<T>(a + b));
+        if (op == "-")
+            return folded(static_cast<T>(a - b));
+        if (op == "*")
+            return folded(static_cast<T>(a * b));
+        if (op == "/")
+            return folded(static_cast<T>(a / b));
+        return compare(op, a, b);
+    }
+
+    Evaluated evaluate(const std::string &op, Type type, const LiteralValue &a, const LiteralValue &b)
+    {
+        switch (type)
+        {
+        case Type::Int8:
+            return integer(op, numericAs<int8_t>(a), numericAs<int8_t>(b));
+        case Type::Int16:
+            return integer(op, numericAs<int16_t>(a), numericAs<int16_t>(b));
+        case Type::Int32:
+            return integer(op, numericAs<int32_t>(a), numericAs<int32_t>(b));
+        case Type::Int64:
+            return integer(op, numericAs<int64_t>(a), numericAs<int64_t>(b));
+        case Type::Uint8:
+            return integer(op, numericAs<uint8_t>(a), numericAs<uint8_t>(b));
+        case Type::Uint16:
+            return integer(op, numericAs<uint16_t>(a), numericAs<uint16_t>(b));
+        case Type::Uint32:
+            return integer(op, numericAs<uint32_t>(a), numericAs<uint32_t>(b));
+        case Type::Uint64:
+            return integer(op, numericAs<uint64_t>(a), numericAs<uint64_t>(b));
+        case Type::Float32:
+            return floating(op, numericAs<float>(a), numericAs<float>(b));
+        case Type::Float64:
+            return floating(op, numericAs<double>(a), numericAs<double>(b));
+        case Type::Boolean:
+            if (op == "&&")
+                return folded(std::get<bool>(a) && std::get<bool>(b));
+            return compare(op, std::get<bool>(a), std::get<bool>(b));
+        case Type::Byte:
+            return compare(op, std::get<char>(a), std::get<char>(b));
+        case Type::String:
+            if (op == "+")
+                return folded(std::get<std::string>(a) + std::get<std::string>(b));
+            return compare(op, std::get<std::string>(a), std::get<std::string>(b));
+        default:
+            return Evaluated{Outcome::NotConstant};
+        }
+    }
+
+    /**
+     * Arguments of one call of a function, for memoization. Floats compare by
+     * their bits, so -0.0 and 0.0 are different keys and NaN finds itself.
+     */
+    struct CallKey
+    {
+        const FunctionDeclNode *fn;
+        std::vector<LiteralValue> args;
+
+        static bool same(const LiteralValue &a, const LiteralValue &b)
+        {
+            if (a.index() != b.index())
+                return false;
+            if (const auto *x = std::get_if<float>(&a))
+                return std::memcmp(x, &std::get<float>(b), sizeof(float)) == 0;
+            if (const auto *x = std::get_if<double>(&a))
+                return std::memcmp(x, &std::get<double>(b), sizeof(double)) == 0;
+            return a == b;
+        }
+
+        bool operator==(const CallKey &other) const
+        {
+            if (fn != other.fn || args.size() != other.args.size())
+                return false;
+            for (size_t i = 0; i < args.size(); ++i)
+                if (!same(args[i], other.args[i]))
+                    return false;
+            return true;
+        }
+    };
+
+    struct CallKeyHash
+    {
+        size_t operator()(const CallKey &key) const
+        {
+            size_t h = std::hash<const void *>{}(key.fn);
+            for (const auto &arg : key.args)
+                h = h * 31 + std::hash<LiteralValue>{}(arg);
+            return h;
+        }
+    };
+
+    LiteralValue zeroOf(Type type)
+    {
+        switch (type)
+        {
+        case Type::Boolean:
+            return false;
+        case Type::Byte:
+            return char{0};
+        case Type::String:
+            return std::string();
+        default:
+            return represent(int64_t{0}, type);
+        }
+    }
+
+    struct Folder
+    {
+        const TypeTable &types;
+        std::vector<Diagnostic> &diagnostics;
+        const EvalLimits &limits;
+        std::unordered_set<const VarDeclNode *> inProgress;
+        size_t replaced = 0;
+
+        // Initializers of constants and globals are where calls are evaluated.
+        size_t functionDepth = 0;
+        bool constantContext = false;
+        bool constInitializer = false;
+
+        // Compile-time calls.
+        std::unordered_map<const FunctionDeclNode *, bool> purity;
+        std::unordered_map<CallKey, std::optional<LiteralValue>, CallKeyHash> memo;
+        size_t steps = 0;
+        size_t depth = 0;
+        const char *exhausted = nullptr;
+        Outcome trapped = Outcome::Folded; /**< Overflow or division by zero that stopped a call */
+        TypeId trappedType = TypeTable::Error;
+
+        Folder(const TypeTable &types, std::vector<Diagnostic> &diagnostics, const EvalLimits &limits)
+            : types(types), diagnostics(diagnostics), limits(limits) {}
+
+        bool isPrimitive(TypeId id) const { return types.info(id).kind == TypeKind::Primitive; }
+
+        void replace(ASTNodePtr &slot, LiteralValue value, TypeId typeId)
+        {
+            Type type = types.info(typeId).primitive;
+            auto literal = std::make_unique<LiteralNode>(type, represent(value, type));
+            literal->span = slot->span;
+            literal->typeId = typeId;
+            literal->parent = slot->parent;
+            slot = std::move(literal);
+            ++replaced;
+        }
+
+        void fold(ASTNodePtr &slot)
+        {
+            if (!slot)
+                return;
+            ASTNode *node = slot.get();
+            switch (node->type)
+            {
+            case ASTNodeType::Block:
+                for (auto &child : static_cast<BlockNode *>(node)->children)
+                    fold(child);
+                break;
+            case ASTNodeType::Literal:
+            {
+                auto *lit = static_cast<LiteralNode *>(node);
+                if (isPrimitive(lit->typeId))
+                {
+                    lit->literalType = types.info(lit->typeId).primitive;
+                    lit->value = represent(lit->value, lit->literalType);
+                }
+                break;
+            }
+            case ASTNodeType::Identifier:
+                propagate(slot);
+                break;
+            case ASTNodeType::BinaryExpr:
+                foldBinary(slot);
+                break;
+            case ASTNodeType::FunctionDecl:
+                ++functionDepth;
+                fold(static_cast<FunctionDeclNode *>(node)->body);
+                --functionDepth;
+                break;
+            case ASTNodeType::ReturnExpr:
+                fold(static_cast<ReturnExprNode *>(node)->expr);
+                break;
+            case ASTNodeType::VarDecl:
+                foldDecl(static_cast<VarDeclNode *>(node));
+                break;
+            case ASTNodeType::IfExpr:
+            {
+                auto *ifn = static_cast<IfExprNode *>(node);
+                fold(ifn->condition);
+                fold(ifn->thenBranch);
+                fold(ifn->elseBranch);
+                break;
+            }
+            case ASTNodeType::AssignExpr:
+                fold(static_cast<AssignExprNode *>(node)->value);
+                break;
+            case ASTNodeType::FunctionCall:
+                for (auto &arg : static_cast<FunctionCallNode *>(node)->args)
+                    fold(arg);
+                if (constantContext)
+                    foldCall(slot);
+                break;
+            case ASTNodeType::ClassDecl:
+                fold(static_cast<ClassDeclNode *>(node)->body);
+                break;
+            default:
+                break;
+            }
+        }
+
+        void foldDecl(VarDeclNode *var)
+        {
+            // A constant can be folded early by a use that comes before it; the guard also stops cycles.
+            if (!inProgress.insert(var).second)
+                return;
+            bool saved = constantContext;
+            bool savedConst = constInitializer;
+            constantContext = var->isConst || functionDepth == 0;
+            constInitializer = var->isConst;
+            fold(var->value);
+            constantContext = saved;
+            constInitializer = savedConst;
+        }
+
+        void propagate(ASTNodePtr &slot)
+        {
+            auto *id = static_cast<IdentifierNode *>(slot.get());
+            if (id->binding.param >= 0 || !isPrimitive(id->typeId))
+                return;
+            const auto *decl = nodeAs<VarDeclNode>(id->binding.decl);
+            if (!decl || !decl->isConst)
+                return;
+
+            // The folder owns the whole tree, so it may fold the declaration where it stands.
+            foldDecl(const_cast<VarDeclNode *>(decl));
+            const auto *value = nodeAs<LiteralNode>(decl->value.get());
+            if (value && value->typeId == id->typeId)
+                replace(slot, value->value, id->typeId);
+        }
+
+        void foldBinary(ASTNodePtr &slot)
+        {
+            auto *bin = static_cast<BinaryExprNode *>(slot.get());
+            fold(bin->left);
+            fold(bin->right);
+
+            const auto *left = nodeAs<LiteralNode>(bin->left.get());
+            const auto *right = nodeAs<LiteralNode>(bin->right.get());
+            if (!left || !right || !isPrimitive(bin->typeId) || !isPrimitive(left->typeId) || left->typeId != right->typeId)
+                return;
+
+            Evaluated result = evaluate(bin->op, left->literalType, left->value, right->value);
+            switch (result.outcome)
+            {
+            case Outcome::Folded:
+                replace(slot, std::move(result.value), bin->typeId);
+                break;
+            case Outcome::Overflow:
+                diagnostics.push_back(Diagnostic{Severity::Error, bin->span, "constant expression overflows " + types.name(bin->typeId)});
+                break;
+            case Outcome::DivisionByZero:
+                diagnostics.push_back(Diagnostic{Severity::Error, bin->span, "division by zero in constant expression"});
+                break;
+            case Outcome::NotConstant:
+                break;
+            }
+        }
+        /**
+         * Replace a call whose arguments are literals by its result, if the
+         * callee is pure and the call finishes within its budget.
+         */
+        void foldCall(ASTNodePtr &slot)
+        {
+            auto *call = static_cast<FunctionCallNode *>(slot.get());
+            const auto *fn = nodeAs<FunctionDeclNode>(call->binding.decl);
+            if (!fn || !isPrimitive(call->typeId) || !isPure(fn))
+                return;
+            std::vector<LiteralValue> args;
+            for (const auto &arg : call->args)
+            {
+                const auto *literal = nodeAs<LiteralNode>(arg.get());
+                if (!literal)
+                    return;
+                args.push_back(literal->value);
+            }
+
+            // A constant read by a call being evaluated may itself hold a call;
+            // that one gets its own budget.
+            size_t savedSteps = steps;
+            const char *savedExhausted = exhausted;
+            Outcome savedTrapped = trapped;
+            steps = 0;
+            exhausted = nullptr;
+            trapped = Outcome::Folded;
+            if (auto result = invoke(fn, std::move(args)))
+                replace(slot, std::move(*result), call->typeId);
+            else if (exhausted)
+                diagnostics.push_back(Diagnostic{Severity::Warning, call->span,
+                                                 "call to '" + call->callee + "' exceeds the compile-time " + exhausted + " budget; it is evaluated at run time"});
+            // A constant's value must not depend on how run time wraps or traps.
+            else if (constInitializer && trapped == Outcome::Overflow)
+                diagnostics.push_back(Diagnostic{Severity::Error, call->span, "constant expression overflows " + types.name(trappedType)});
+            else if (constInitializer && trapped == Outcome::DivisionByZero)
+                diagnostics.push_back(Diagnostic{Severity::Error, call->span, "division by zero in constant expression"});
+            steps = savedSteps;
+            exhausted = savedExhausted;
+            trapped = savedTrapped;
+        }
+
+        static bool isMember(const FunctionDeclNode *fn)
+        {
+            return fn->parent && fn->parent->type == ASTNodeType::ClassDecl;
+        }
+
+        /**
+         * Whether a function only depends on its arguments. A function counts as
+         * pure while it is being checked, so recursion does not make it impure.
+         */
+        bool isPure(const FunctionDeclNode *fn)
+        {
+            if (auto known = purity.find(fn); known != purity.end())
+                return known->second;
+            if (fn->returnType == Type::Void || (isMember(fn) && fn->modifier != ModifierType::Static))
+                return purity[fn] = false;
+            purity[fn] = true;
+            std::unordered_set<const ASTNode *> locals;
+            bool pure = isPure(fn->body.get(), fn, locals);
+            return purity[fn] = pure;
+        }
+
+        bool isPure(const ASTNode *node, const FunctionDeclNode *fn, std::unordered_set<const ASTNode *> &locals)
+        {
+            if (!node)
+                return true;
+            auto isLocal = [&](const Binding &binding) {
+                return binding.param >= 0 ? binding.decl == fn : locals.count(binding.decl) > 0;
+            };
+            switch (node->type)
+            {
+            case ASTNodeType::Literal:
+                return true;
+            case ASTNodeType::Block:
+                for (const auto &child : static_cast<const BlockNode *>(node)->children)
+                    if (!isPure(child.get(), fn, locals))
+                        return false;
+                return true;
+            case ASTNodeType::Identifier:
+            {
+                const Binding &binding = static_cast<const IdentifierNode *>(node)->binding;
+                const auto *var = nodeAs<VarDeclNode>(binding.decl);
+                return isLocal(binding) || (var && var->isConst && binding.param < 0);
+            }
+            case ASTNodeType::BinaryExpr:
+            {
+                const auto *bin = static_cast<const BinaryExprNode *>(node);
+                return isPure(bin->left.get(), fn, locals) && isPure(bin->right.get(), fn, locals);
+            }
+            case ASTNodeType::VarDecl:
+                locals.insert(node);
+                return isPure(static_cast<const VarDeclNode *>(node)->value.get(), fn, locals);
+            case ASTNodeType::AssignExpr:
+            {
+                const auto *assign = static_cast<const AssignExprNode *>(node);
+                return isLocal(assign->binding) && isPure(assign->value.get(), fn, locals);
+            }
+            case ASTNodeType::ReturnExpr:
+                return isPure(static_cast<const ReturnExprNode *>(node)->expr.get(), fn, locals);
+            case ASTNodeType::IfExpr:
+            {
+                const auto *ifn = static_cast<const IfExprNode *>(node);
+                return isPure(ifn->condition.get(), fn, locals) && isPure(ifn->thenBranch.get(), fn, locals) &&
+                       isPure(ifn->elseBranch.get(), fn, locals);
+            }
+            case ASTNodeType::FunctionCall:
+            {
+                const auto *call = static_cast<const FunctionCallNode *>(node);
+                const auto *callee = nodeAs<FunctionDeclNode>(call->binding.decl);
+                if (!callee || !isPure(callee))
+                    return false;
+                for (const auto &arg : call->args)
+                    if (!isPure(arg.get(), fn, locals))
+                        return false;
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * Variables of one call being evaluated, keyed like Binding: a
+         * parameter by its entry in FunctionDeclNode::params, a local by its
+         * VarDeclNode.
+         */
+        struct Frame
+        {
+            const FunctionDeclNode *fn;
+            std::unordered_map<const void *, LiteralValue> vars;
+            std::optional<LiteralValue> result;
+        };
+
+        enum class Flow
+        {
+            Next,
+            Returned,
+            Failed,
+        };
+
+        static const void *variable(const Binding &binding)
+        {
+            if (binding.param >= 0)
+                return &static_cast<const FunctionDeclNode *>(binding.decl)->params[binding.param];
+            return binding.decl;
+        }
+
+        Type primitiveOf(TypeId id) const
+        {
+            const TypeInfo &info = types.info(id);
+            if (info.kind == TypeKind::UntypedInt)
+                return Type::Int64;
+            if (info.kind == TypeKind::UntypedFloat)
+                return Type::Float64;
+            return info.primitive;
+        }
+
+        bool step()
+        {
+            if (++steps <= limits.steps)
+                return true;
+            exhausted = "step";
+            return false;
+        }
+
+        std::optional<LiteralValue> invoke(const FunctionDeclNode *fn, std::vector<LiteralValue> args)
+        {
+            for (size_t i = 0; i < args.size(); ++i)
+                args[i] = represent(args[i], fn->params[i].first);
+            CallKey key{fn, args};
+            if (auto hit = memo.find(key); hit != memo.end())
+                return hit->second;
+            if (depth >= limits.depth)
+            {
+                exhausted = "recursion";
+                return std::nullopt;
+            }
+
+            Frame frame{fn, {}, std::nullopt};
+            for (size_t i = 0; i < args.size(); ++i)
+                frame.vars.emplace(&fn->params[i], std::move(args[i]));
+            ++depth;
+            Flow flow = execute(fn->body.get(), frame);
+            --depth;
+
+            std::optional<LiteralValue> result;
+            if (flow == Flow::Returned && frame.result)
+                result = represent(*frame.result, fn->returnType);
+            // A call cut short by the budget might still succeed with a fresh one;
+            // one that trapped is evaluated again so the trap is reported again.
+            if (!exhausted && trapped == Outcome::Folded)
+                memo.emplace(std::move(key), result);
+            return result;
+        }
+
+        Flow execute(const ASTNode *node, Frame &frame)
+        {
+            if (!node)
+                return Flow::Next;
+            if (!step())
+                return Flow::Failed;
+            switch (node->type)
+            {
+            case ASTNodeType::Block:
+                for (const auto &child : static_cast<const BlockNode *>(node)->children)
+                    if (Flow flow = execute(child.get(), frame); flow != Flow::Next)
+                        return flow;
+                return Flow::Next;
+            case ASTNodeType::VarDecl:
+            {
+                const auto *var = static_cast<const VarDeclNode *>(node);
+                std::optional<LiteralValue> value = var->value ? valueOf(var->value.get(), frame) : zeroOf(var->varType);
+                if (!value)
+                    return Flow::Failed;
+                frame.vars[var] = represent(*value, var->varType);
+                return Flow::Next;
+            }
+            case ASTNodeType::ReturnExpr:
+            {
+                const auto *ret = static_cast<const ReturnExprNode *>(node);
+                if (ret->expr && !(frame.result = valueOf(ret->expr.get(), frame)))
+                    return Flow::Failed;
+                return Flow::Returned;
+            }
+            case ASTNodeType::IfExpr:
+            {
+                const auto *ifn = static_cast<const IfExprNode *>(node);
+                std::optional<LiteralValue> condition = valueOf(ifn->condition.get(), frame);
+                if (!condition || !std::holds_alternative<bool>(*condition))
+                    return Flow::Failed;
+                return execute(std::get<bool>(*condition) ? ifn->thenBranch.get() : ifn->elseBranch.get(), frame);
+            }
+            default:
+                return valueOf(node, frame) ? Flow::Next : Flow::Failed;
+            }
+        }
+
+        std::optional<LiteralValue> valueOf(const ASTNode *node, Frame &frame)
+        {
+            if (!step())
+                return std::nullopt;
+            switch (node->type)
+            {
+            case ASTNodeType::Literal:
+                return represent(static_cast<const LiteralNode *>(node)->value, primitiveOf(node->typeId));
+            case ASTNodeType::Identifier:
+            {
+                const Binding &binding = static_cast<const IdentifierNode *>(node)->binding;
+                if (auto var = frame.vars.find(variable(binding)); var != frame.vars.end())
+                    return var->second;
+                const auto *decl = nodeAs<VarDeclNode>(binding.decl);
+                if (!decl || !decl->isConst || binding.param >= 0)
+                    return std::nullopt;
+                foldDecl(const_cast<VarDeclNode *>(decl));
+                if (const auto *value = nodeAs<LiteralNode>(decl->value.get()))
+                    return represent(value->value, decl->varType);
+                return std::nullopt;
+            }
+            case ASTNodeType::BinaryExpr:
+            {
+                const auto *bin = static_cast<const BinaryExprNode *>(node);
+                std::optional<LiteralValue> left = valueOf(bin->left.get(), frame);
+                std::optional<LiteralValue> right = left ? valueOf(bin->right.get(), frame) : std::nullopt;
+                if (!right)
+                    return std::nullopt;
+                // An untyped literal operand takes the type of the other one.
+                TypeId operand = types.info(bin->left->typeId).kind == TypeKind::Primitive ? bin->left->typeId : bin->right->typeId;
+                Type type = primitiveOf(operand);
+                Evaluated result = evaluate(bin->op, type, represent(*left, type), represent(*right, type));
+                if (result.outcome == Outcome::Overflow || result.outcome == Outcome::DivisionByZero)
+                {
+                    trapped = result.outcome;
+                    trappedType = operand;
+                }
+                if (result.outcome != Outcome::Folded)
+                    return std::nullopt;
+                return std::move(result.value);
+            }
+            case ASTNodeType::AssignExpr:
+            {
+                const auto *assign = static_cast<const AssignExprNode *>(node);
+                auto var = frame.vars.find(variable(assign->binding));
+                if (var == frame.vars.end())
+                    return std::nullopt;
+                std::optional<LiteralValue> value = valueOf(assign->value.get(), frame);
+                if (!value)
+                    return std::nullopt;
+                Type type = assign->binding.param >= 0 ? frame.fn->params[assign->binding.param].first
+                                                       : static_cast<const VarDeclNode *>(assign->binding.decl)->varType;
+                return var->second = represent(*value, type);
+            }
+            case ASTNodeType::FunctionCall:
+            {
+                const auto *call = static_cast<const FunctionCallNode *>(node);
+                const auto *callee = nodeAs<FunctionDeclNode>(call->binding.decl);
+                if (!callee || !isPure(callee))
+                    return std::nullopt;
+                std::vector<LiteralValue> args;
+                args.reserve(call->args.size());
+                for (const auto &arg : call->args)
+                {
+                    std::optional<LiteralValue> value = valueOf(arg.get(), frame);
+                    if (!value)
+                        return std::nullopt;
+                    args.push_back(std::move(*value));
+                }
+                return invoke(callee, std::move(args));
+            }
+            default:
+                return std::nullopt;
+            }
+        }
+    };
+}
+
+size_t foldConstants(ASTNodePtr &root, const TypeTable &types, std::vector<Diagnostic> &diagnostics, const EvalLimits &limits)
+{
+    Folder folder(types, diagnostics, limits);
+    folder.fold(root);
+    return folder.replaced;
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cmath>
+#include <histogram.hxx>
+
+namespace
+{
+    /** Index of the highest set bit; the value must not be 0. */
+    unsigned highestBit(uint64_t value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned bit = 0;
+        while (value >>= 1)
+            ++bit;
+        return bit;
+#endif
+    }
+}
+
+size_t Histogram::bucketOf(uint64_t value)
+{
+    if (value < 2 * SubBuckets)
+        return static_cast<size_t>(value);
+    // Keep the top SubBucketBits + 1 bits: the leading 1 picks the power of
+    // two, the rest the bucket within it.
+    unsigned shift = highestBit(value) - SubBucketBits;
+    size_t sub = static_cast<size_t>(value >> shift) - SubBuckets;
+    return 2 * SubBuckets + (shift - 1) * SubBuckets + sub;
+}
+
+uint64_t Histogram::highestIn(size_t bucket)
+{
+    if (bucket < 2 * SubBuckets)
+        return bucket;
+    unsigned shift = static_cast<unsigned>((bucket - 2 * SubBuckets) / SubBuckets) + 1;
+    uint64_t sub = (bucket - 2 * SubBuckets) % SubBuckets + SubBuckets;
+    // The last bucket ends at the largest 64-bit value.
+    return sub + 1 == 2 * SubBuckets && shift + SubBucketBits + 1 == 64 ? UINT64_MAX : ((sub + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = largest.load(std::memory_order_relaxed);
+    while (value > seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+double Histogram::mean() const
+{
+    uint64_t n = count();
+    return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / static_cast<double>(n) : 0.0;
+}
+
+uint64_t Histogram::percentile(double percentile) const
+{
+    uint64_t n = count();
+    if (n == 0)
+        return 0;
+    double clamped = std::min(100.0, std::max(0.0, percentile));
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(n))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < Buckets; ++i)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(highestIn(i), max());
+    }
+    return max();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bump allocator with stack-like rewinding.
+ *
+ * Memory is carved out of large chunks that are kept for the lifetime of the
+ * arena. `mark()` records the current position and `rewind()` releases every
+ * allocation made after it in O(1), which makes the arena a good fit for data
+ * whose lifetime follows a stack, such as lexical scopes. Destructors are never
+ * run, so only trivially destructible types may be allocated.
+ */
+struct Arena
+{
+    /**
+     * @brief Position in the arena, returned by mark().
+     */
+    struct Marker
+    {
+        size_t chunk;
+        size_t used;
+    };
+
+    explicit Arena(size_t chunkSize = 64 * 1024) : chunkSize(chunkSize) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Allocate uninitialized, suitably aligned memory.
+     */
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        while (true)
+        {
+            if (current < chunks.size())
+            {
+                Chunk &c = chunks[current];
+                size_t offset = (used + align - 1) & ~(align - 1);
+                if (offset + size <= c.size)
+                {
+                    used = offset + size;
+                    return c.data.get() + offset;
+                }
+                if (current + 1 < chunks.size() && size + align <= chunks[current + 1].size)
+                {
+                    ++current;
+                    used = 0;
+                    continue;
+                }
+            }
+            addChunk(size + align);
+        }
+    }
+
+    /**
+     * @brief Allocate an array of value-initialized objects.
+     */
+    template <typename T>
+    T *allocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        T *items = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; ++i)
+            new (items + i) T();
+        return items;
+    }
+
+    /** @brief Current position, for a later rewind(). */
+    Marker mark() const { return Marker{current, used}; }
+
+    /**
+     * @brief Release everything allocated since a mark. The chunks are kept for reuse.
+     */
+    void rewind(Marker marker)
+    {
+        current = marker.chunk;
+        used = marker.used;
+    }
+
+    /** @brief Total bytes reserved from the heap. */
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (const auto &c : chunks)
+            total += c.size;
+        return total;
+    }
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    void addChunk(size_t minSize)
+    {
+        size_t size = minSize > chunkSize ? minSize : chunkSize;
+        Chunk chunk{std::unique_ptr<std::byte[]>(new std::byte[size]), size};
+        // Chunks past the current one were released by a rewind; keep them after the new one.
+        size_t at = chunks.empty() ? 0 : current + 1;
+        chunks.insert(chunks.begin() + static_cast<std::ptrdiff_t>(at), std::move(chunk));
+        current = at;
+        used = 0;
+    }
+
+    std::vector<Chunk> chunks;
+    size_t chunkSize;
+    size_t current = 0;
+    size_t used = 0;
+};
@@ -40,7 +40,7 @@ enum class Type
     Float64
 };
 
-enum class ASTNodeType
+enum class ASTNodeType : uint8_t
 {
     Program,
     Block,
@@ -65,9 +65,31 @@ struct ASTNode;
 using ASTNodePtr = std::unique_ptr<ASTNode>;
 using ASTNodeList = std::vector<ASTNodePtr>;
 
+/**
+ * @brief Byte range of a node in its source file.
+ *
+ * Offsets are resolved to line and column only when needed, through the line
+ * table of the file in a SourceManager. The span fits in the padding after the
+ * node type, so it costs 8 bytes per node.
+ */
+struct SourceSpan
+{
+    uint32_t begin = 0; /**< Offset of the first byte */
+    uint32_t end = 0;   /**< Offset one past the last byte */
+    uint16_t file = 0;  /**< File ID in the SourceManager */
+};
+
+/**
+ * @brief Index into a TypeTable. 0 is the error type, which is also what every
+ * node has before it is type checked.
+ */
+using TypeId = uint32_t;
+
 struct ASTNode
 {
     ASTNodeType type;
+    SourceSpan span;
+    TypeId typeId = 0;
     ASTNode* parent;
 
     ASTNode(ASTNodeType t) : type(t), parent(nullptr) {}
@@ -98,9 +120,29 @@ struct TypeNode : ASTNode
     TypeNode(Type t) : ASTNode(ASTNodeType::Identifier), type(t) {}
 };
 
+/**
+ * @brief Declaration a name refers to, filled in by the resolver.
+ *
+ * `decl` is a VarDeclNode, FunctionDeclNode or ClassDeclNode. For a parameter it
+ * is the enclosing FunctionDeclNode and `param` is the index into its params;
+ * otherwise `param` is -1. Bindings are not serialized.
+ */
+struct Binding
+{
+    const ASTNode *decl = nullptr;
+    int32_t param = -1;
+};
+
+/**
+ * @brief Use of a variable, parameter or constant by name.
+ *
+ * `name` is a plain name, or "Class.name" for a static field or constant
+ * read from outside its class.
+ */
 struct IdentifierNode : ASTNode
 {
     std::string name;
+    Binding binding;
     IdentifierNode(std::string n) : ASTNode(ASTNodeType::Identifier), name(std::move(n)) {}
 };
 
@@ -140,9 +182,10 @@ struct VarDeclNode : ASTNode
     Type varType;
     ASTNodePtr value;
     ModifierType modifier;
+    AccessType access;
 
-    VarDeclNode(bool isConst, std::string n, Type t, ASTNodePtr v,ModifierType modifier)
-        : ASTNode(ASTNodeType::VarDecl), isConst(isConst), name(std::move(n)), varType(t), value(std::move(v)), modifier(std::move(modifier)) {
+    VarDeclNode(bool isConst, std::string n, Type t, ASTNodePtr v,ModifierType modifier, AccessType access = AccessType::Public)
+        : ASTNode(ASTNodeType::VarDecl), isConst(isConst), name(std::move(n)), varType(t), value(std::move(v)), modifier(std::move(modifier)), access(access) {
     }
 };
 
@@ -160,10 +203,31 @@ struct AssignExprNode : ASTNode
 {
     std::string name;
     ASTNodePtr value;
+    Binding binding;
 
     AssignExprNode(std::string name, ASTNodePtr value)
         : ASTNode(ASTNodeType::AssignExpr), name(std::move(name)), value(std::move(value)) {}
 };
+/**
+ * @brief Call of a function by name.
+ *
+ * `callee` is a plain name, or "Class.name" for a call to a static member
+ * from outside its class. The resolver binds it to an overload whose
+ * parameter count matches the arguments; when several do, it lists them in
+ * `overloads` and the type checker rebinds the call to the one the argument
+ * types select.
+ */
+struct FunctionCallNode : ASTNode
+{
+    std::string callee;
+    ASTNodeList args;
+    Binding binding;
+    std::vector<const FunctionDeclNode *> overloads;
+
+    FunctionCallNode(std::string callee, ASTNodeList args)
+        : ASTNode(ASTNodeType::FunctionCall), callee(std::move(callee)), args(std::move(args)) {}
+};
+
 struct ClassDeclNode : ASTNode
 {
     std::string name;
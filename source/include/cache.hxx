@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Content-addressed on-disk cache for compiler artifacts.
+ *
+ * Entries are files named `<key>.<kind>` inside the cache directory, where the
+ * key hashes the source bytes together with the compiler version and `kind`
+ * names the artifact (e.g. "vsast"). A hit refreshes the entry's modification
+ * time; when the entries grow past the size cap the least recently used
+ * ones are removed. Other files in the directory are neither counted nor
+ * removed. Writes go through a temporary file and a rename, so concurrent
+ * compilers sharing a directory never observe partial entries.
+ */
+struct ArtifactCache
+{
+    /**
+     * @brief Open (and create if needed) a cache directory.
+     * @param dir Cache directory
+     * @param maxBytes Size cap for all entries together
+     */
+    ArtifactCache(std::filesystem::path dir, uint64_t maxBytes);
+
+    /**
+     * @brief Compute the cache key for a source file.
+     * @param source Source bytes
+     * @param kind Artifact kind
+     * @param formatVersion Version of the artifact's encoding
+     */
+    static uint64_t key(std::string_view source, std::string_view kind, uint32_t formatVersion);
+
+    /**
+     * @brief Look up an entry and mark it as recently used.
+     * @return The path of the entry, or nullopt on a miss
+     */
+    std::optional<std::filesystem::path> lookup(uint64_t key, std::string_view kind);
+
+    /**
+     * @brief Store an entry and evict old entries if the cache is over its cap.
+     * @param trim Evict right away; callers storing many entries pass false
+     * and call evict() once at the end
+     */
+    void store(uint64_t key, std::string_view kind, std::string_view bytes, bool trim = true);
+
+    /**
+     * @brief Remove an entry, e.g. one that failed to load.
+     */
+    void remove(uint64_t key, std::string_view kind);
+
+    /**
+     * @brief Remove least recently used entries until the cache fits its cap.
+     */
+    void evict();
+
+private:
+    std::filesystem::path entryPath(uint64_t key, std::string_view kind) const;
+
+    std::filesystem::path dir;
+    uint64_t maxBytes;
+};
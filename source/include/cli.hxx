@@ -8,3 +8,9 @@ void printHelp();
 void printVersion();
 
 void compileFile(const std::string &filename, const std::vector<std::string>& flags);
+
+/**
+ * @brief Compile a program to bytecode and run its `main()`.
+ * @return int The process exit status: the value `main` returns, or 1 on errors
+ */
+int runFile(const std::string &filename, const std::vector<std::string> &flags);
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ast.hxx>
+
+/**
+ * @brief What a symbol is, numbered as LSP's CompletionItemKind.
+ */
+enum class SymbolKind : uint8_t
+{
+    Method = 2,
+    Function = 3,
+    Field = 5,
+    Variable = 6,
+    Class = 7,
+    Keyword = 14,
+    Constant = 21,
+};
+
+/**
+ * @brief A name completion can offer, with the range of source it is visible in.
+ */
+struct Symbol
+{
+    std::string name;
+    std::string detail;    /**< Type or signature shown next to the name */
+    std::string container; /**< Class of a member, empty otherwise */
+    SymbolKind kind;
+    uint32_t scopeBegin = 0; /**< First offset the name can be used at */
+    uint32_t scopeEnd = 0;   /**< Offset one past the last */
+    uint8_t depth = 0;       /**< Nesting of its scope: locals are deeper than globals */
+    bool isPublic = true;
+};
+
+/**
+ * @brief Where completion was asked for, and the text typed so far.
+ */
+struct CompletionQuery
+{
+    std::string_view prefix;    /**< Identifier characters before the cursor */
+    std::string_view qualifier; /**< Name before a '.' preceding the prefix, if any */
+    uint32_t offset = 0;
+    size_t limit = 50;
+};
+
+/**
+ * @brief Ranked matches, at most the query's limit. `incomplete` is set when
+ * more matched, so a client asks again as the prefix grows.
+ */
+struct Completions
+{
+    std::vector<const Symbol *> items;
+    bool incomplete = false;
+};
+
+/**
+ * @brief Prefix trie from lowercased names to values.
+ */
+class SymbolTrie
+{
+public:
+    SymbolTrie() : nodes(1) {}
+
+    void insert(std::string_view key, uint32_t value);
+
+    /** @brief Append the values of every key starting with `prefix`, in key order. */
+    void collect(std::string_view prefix, std::vector<uint32_t> &values) const;
+
+private:
+    struct Node
+    {
+        std::vector<std::pair<char, uint32_t>> children; /**< Sorted by character */
+        std::vector<uint32_t> values;
+    };
+
+    uint32_t child(uint32_t node, char c) const;
+
+    std::vector<Node> nodes;
+};
+
+/**
+ * @brief The keywords and declarations of a document, indexed by name.
+ *
+ * Built once per parsed version of the document and then only read, so one
+ * index can serve completion requests on several threads.
+ */
+class SymbolIndex
+{
+public:
+    /** @brief Index the keywords, and the declarations under `root` if given. */
+    explicit SymbolIndex(const ASTNode *root = nullptr);
+
+    /**
+     * @brief Symbols matching a query, best first.
+     *
+     * Without a qualifier, names visible at the offset and keywords match.
+     * With one, the members of the class it names do; private members only
+     * from inside the class. Names match their prefix case-insensitively;
+     * exact-case matches, more local scopes and shorter names rank first.
+     * A shadowed name is offered once, for its innermost declaration.
+     */
+    Completions complete(const CompletionQuery &query) const;
+
+    const std::vector<Symbol> &symbols() const { return table; }
+
+private:
+    struct Scope
+    {
+        uint32_t begin;
+        uint32_t end;
+        const ClassDeclNode *owner; /**< Class whose body this is, if any */
+        uint8_t depth;
+    };
+
+    void add(Symbol symbol);
+    void collect(const ASTNode *node, const Scope &scope);
+
+    std::vector<Symbol> table;
+    SymbolTrie trie;
+};
+
+/**
+ * @brief Split the text before the cursor into the prefix being typed and its
+ * qualifier. The views point into `before`.
+ */
+CompletionQuery completionQuery(std::string_view before, uint32_t offset);
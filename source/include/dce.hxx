@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include <ast.hxx>
+#include <diagnostic.hxx>
+
+/**
+ * @brief Remove code that can never run or never be used.
+ *
+ * Runs on a resolved tree, best after constant folding, and removes:
+ * - statements after a `return`, or after an `if` whose branches all return,
+ * - `if` expressions whose condition is a boolean literal; the taken branch
+ *   replaces them and is spliced into the enclosing block when it declares
+ *   no variables,
+ * - private functions and fields of a class that nothing outside themselves
+ *   refers to, repeated until no more become unused.
+ *
+ * @param root Program block
+ * @param diagnostics If not null, receives a warning for every removal
+ * @return size_t Number of nodes removed
+ */
+size_t eliminateDeadCode(ASTNodePtr &root, std::vector<Diagnostic> *diagnostics = nullptr);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <ast.hxx>
+
+enum class Severity : uint8_t
+{
+    Error,
+    Warning,
+    Note,
+};
+
+/**
+ * @brief A message about a range of source, produced by a compiler pass.
+ */
+struct Diagnostic
+{
+    Severity severity;
+    SourceSpan span;
+    std::string message;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <ast.hxx>
+
+/**
+ * @brief Output formats supported by emitAST.
+ */
+enum class EmitFormat
+{
+    Text,  /**< Indented tree, the format of printAST */
+    Json,  /**< One JSON object per node */
+    SExpr  /**< S-expressions */
+};
+
+/**
+ * @brief Parse a format name as accepted by `--emit-ast=<format>`.
+ * @return The format, or nullopt for an unknown name
+ */
+std::optional<EmitFormat> parseEmitFormat(std::string_view name);
+
+/**
+ * @brief Fixed-size output buffer that writes to a stream in large chunks.
+ *
+ * Replaces per-line `std::endl` output, which flushes the stream (and issues a
+ * system call) for every line. Data is handed to the stream only when the
+ * buffer is full, on flush() and on destruction.
+ */
+struct OutputBuffer
+{
+    explicit OutputBuffer(std::ostream &out, size_t capacity = 64 * 1024);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    void write(std::string_view s)
+    {
+        if (s.size() <= capacity - size)
+        {
+            std::char_traits<char>::copy(data.get() + size, s.data(), s.size());
+            size += s.size();
+        }
+        else
+            writeSlow(s);
+    }
+
+    void put(char c)
+    {
+        if (size == capacity)
+            flush();
+        data[size++] = c;
+    }
+
+    void fill(char c, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            put(c);
+    }
+
+    /** @brief Hand all buffered bytes to the stream and flush it. */
+    void flush();
+
+private:
+    void writeSlow(std::string_view s);
+
+    std::ostream &out;
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+    size_t capacity;
+};
+
+/**
+ * @brief Stream an AST in the given format.
+ *
+ * Output is produced during a single traversal; memory use grows with the tree
+ * depth only, never with the number of nodes.
+ *
+ * @param root Root node, may be null
+ * @param format Output format
+ * @param out Destination stream
+ * @param indent Initial indentation (text format only)
+ */
+void emitAST(const ASTNode *root, EmitFormat format, std::ostream &out, int indent = 0);
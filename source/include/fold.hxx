@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <ast.hxx>
+#include <diagnostic.hxx>
+#include <types.hxx>
+
+/**
+ * @brief Budgets for evaluating one call at compile time.
+ */
+struct EvalLimits
+{
+    size_t steps = 100000; /**< Statements and expressions evaluated, across all nested calls */
+    size_t depth = 256;    /**< Nested calls */
+};
+
+/**
+ * @brief Evaluate constant expressions at compile time.
+ *
+ * Runs on a type-checked tree and replaces, in place:
+ * - binary expressions whose operands are literals, with the literal result,
+ * - identifiers bound to a `const` declaration with a constant value, with a
+ *   copy of that value,
+ * - calls of pure functions with literal arguments in the initializers of
+ *   constants and globals, with the value the call returns.
+ *
+ * A function is pure if it is static or at the top level and only reads its
+ * parameters, its locals and constants, and only calls pure functions. Calls
+ * are evaluated over LiteralValue and memoized by their argument values. A
+ * call that overflows or divides by zero is an error in a `const` initializer
+ * and left to run in a global's. A call that runs out of `limits` is left to
+ * run, with a warning.
+ *
+ * Integer arithmetic is exact for the operand's width and signedness. Results
+ * that do not fit are reported and left unfolded, as is division by zero.
+ * float32 and float64 follow IEEE semantics in their own precision. Literals
+ * are also narrowed to the representation of their checked type, so an untyped
+ * `3.14` settled to float32 is stored as a float.
+ *
+ * @param root Program block, after checkTypes
+ * @param types The table the tree was checked with
+ * @param diagnostics Receives overflow and division-by-zero errors, and
+ * warnings for calls that exceeded their budget
+ * @param limits Budgets for each call evaluated in a constant initializer
+ * @return size_t Number of expressions, identifiers and calls replaced by literals
+ */
+size_t foldConstants(ASTNodePtr &root, const TypeTable &types, std::vector<Diagnostic> &diagnostics, const EvalLimits &limits = {});
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * @brief Fast non-cryptographic 64-bit hash (the XXH64 algorithm).
+ *
+ * Used for content-addressed cache keys and structural hashes; it processes
+ * 32 bytes per round and is bounded by memory bandwidth on large inputs.
+ */
+namespace hash
+{
+    inline constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+    inline constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+    inline constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+    inline constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+    inline constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    inline uint64_t read64(const unsigned char *p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t read32(const unsigned char *p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t round(uint64_t acc, uint64_t input)
+    {
+        acc += input * Prime2;
+        acc = rotl(acc, 31);
+        return acc * Prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+    {
+        acc ^= round(0, val);
+        return acc * Prime1 + Prime4;
+    }
+
+    inline uint64_t avalanche(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= Prime2;
+        h ^= h >> 29;
+        h *= Prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    /**
+     * @brief Hash a byte range.
+     * @param data Bytes to hash
+     * @param len Number of bytes
+     * @param seed Seed, used to separate hash domains
+     * @return uint64_t The hash value
+     */
+    inline uint64_t bytes(const void *data, size_t len, uint64_t seed = 0)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        const unsigned char *end = p + len;
+        uint64_t h;
+
+        if (len >= 32)
+        {
+            uint64_t v1 = seed + Prime1 + Prime2;
+            uint64_t v2 = seed + Prime2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - Prime1;
+            const unsigned char *limit = end - 32;
+            do
+            {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        }
+        else
+        {
+            h = seed + Prime5;
+        }
+
+        h += static_cast<uint64_t>(len);
+
+        while (p + 8 <= end)
+        {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * Prime1 + Prime4;
+            p += 8;
+        }
+        if (p + 4 <= end)
+        {
+            h ^= static_cast<uint64_t>(read32(p)) * Prime1;
+            h = rotl(h, 23) * Prime2 + Prime3;
+            p += 4;
+        }
+        while (p < end)
+        {
+            h ^= (*p) * Prime5;
+            h = rotl(h, 11) * Prime1;
+            ++p;
+        }
+        return avalanche(h);
+    }
+
+    inline uint64_t string(std::string_view s, uint64_t seed = 0) { return bytes(s.data(), s.size(), seed); }
+
+    /**
+     * @brief Mix a value into an existing hash.
+     */
+    inline uint64_t combine(uint64_t h, uint64_t v)
+    {
+        return avalanche(h ^ (v * Prime1 + Prime2 + rotl(h, 27)));
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Histogram of non-negative values with a bounded relative error, in
+ * the style of HdrHistogram.
+ *
+ * Values below 64 have a bucket each. Above that, every power of two is split
+ * into 32 buckets, so a percentile is reported within 1/32 (about 3%) of the
+ * true value over the whole 64-bit range, in fixed memory.
+ *
+ * Recording is a handful of relaxed atomic additions and never blocks, so
+ * any number of threads may record while another reads. A reader may see a
+ * value recorded in some counters but not yet in others.
+ */
+struct Histogram
+{
+    static constexpr unsigned SubBucketBits = 5;
+    static constexpr size_t SubBuckets = size_t{1} << SubBucketBits;
+    static constexpr size_t Buckets = 2 * SubBuckets + (64 - SubBucketBits - 1) * SubBuckets;
+
+    void record(uint64_t value);
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /**
+     * @brief The value `percentile` percent of the recorded values are at or
+     * below: the highest value of the bucket that holds that rank, or the
+     * largest value recorded if that is lower. 0 if nothing was recorded.
+     */
+    uint64_t percentile(double percentile) const;
+
+    /** @brief Bucket of a value. */
+    static size_t bucketOf(uint64_t value);
+
+    /** @brief Highest value that falls into a bucket. */
+    static uint64_t highestIn(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, Buckets> buckets{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> largest{0};
+};
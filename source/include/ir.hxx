@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <ast.hxx>
+#include <types.hxx>
+
+/** @brief Index of an instruction in its function; every instruction defines the value with its own ID. */
+using ValueId = uint32_t;
+
+/** @brief Index of a basic block in its function. */
+using BlockId = uint32_t;
+
+enum class Opcode : uint8_t
+{
+    Const, /**< immediate: index into IRModule::constants */
+    Param, /**< immediate: parameter index */
+    Load,  /**< immediate: global index */
+    Store, /**< immediate: global index; operands: value */
+
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Rem,
+    BitOr,
+    And,
+    Eq,
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+
+    Call, /**< immediate: index into IRModule::functions; operands: arguments */
+
+    Phi,         /**< operands: pairs of (predecessor block, value) */
+    Br,          /**< operands: target block */
+    CondBr,      /**< operands: condition, then block, else block */
+    Ret,         /**< operands: the returned value, if any */
+    Unreachable, /**< End of a function that falls off without returning a value */
+};
+
+/**
+ * @brief One SSA instruction.
+ *
+ * Operands live in the function's operand pool, so an instruction is a fixed
+ * 16 bytes and a function's code is one contiguous array. Operands are value
+ * IDs, except where Opcode documents block IDs. Comparisons have a boolean
+ * type; the operands' type is that of their defining instructions.
+ */
+struct IRInstruction
+{
+    Opcode op;
+    uint16_t operandCount;
+    TypeId type;           /**< Type of the defined value; void for stores and terminators */
+    uint32_t firstOperand; /**< Index of the first operand in IRFunction::operands */
+    uint32_t immediate;
+};
+
+/**
+ * @brief A basic block: a range of instructions ending in a terminator.
+ *
+ * Lowering finishes a block before it starts the next, so the instructions of
+ * each block are contiguous and blocks are laid out in ID order. Phis come
+ * first in their block.
+ */
+struct IRBlock
+{
+    uint32_t first;
+    uint32_t end;
+};
+
+struct IRFunction
+{
+    std::string name; /**< Qualified as "Class.name" for methods */
+    std::vector<TypeId> params;
+    TypeId result;
+    std::vector<IRInstruction> instructions;
+    std::vector<uint32_t> operands;
+    std::vector<IRBlock> blocks;
+
+    const uint32_t *operandsOf(const IRInstruction &inst) const { return operands.data() + inst.firstOperand; }
+
+    /** @brief Blocks the terminator of a block can branch to. */
+    std::vector<BlockId> successors(BlockId block) const;
+};
+
+/**
+ * @brief A global variable: a top-level variable or a class field.
+ */
+struct IRGlobal
+{
+    std::string name;
+    TypeId type;
+};
+
+struct IRModule
+{
+    std::vector<IRGlobal> globals;
+    std::vector<IRFunction> functions;
+    std::vector<LiteralValue> constants;
+
+    /**
+     * @brief Name of the function that runs the initializers of globals and
+     * the statements at the top level, in program order.
+     */
+    static constexpr const char *InitFunction = "__init";
+};
+
+/**
+ * @brief Lower a checked program to SSA form.
+ *
+ * Parameters and local variables become SSA values; an assignment defines a new
+ * value and a phi merges the values that differ at the join of an `if`.
+ * Globals and fields live in memory and are read and written with Load and
+ * Store. `&&` is lowered without short-circuiting, since operands cannot have
+ * side effects beyond assignment.
+ *
+ * @param root Program block, after checkTypes and foldConstants
+ * @param types The table the program was checked with
+ * @throws std::runtime_error on a construct the IR cannot express
+ */
+IRModule lowerToIR(const ASTNode *root, const TypeTable &types);
+
+/**
+ * @brief Print a module in its textual form, as emitted by `--emit-ir`.
+ */
+void printIR(const IRModule &module, const TypeTable &types, std::ostream &out);
+
+/**
+ * @brief Textual name of an opcode, e.g. "add".
+ */
+const char *opcodeName(Opcode op);
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Reads JSON text in place, without building a DOM.
+ *
+ * Callers pull the values they need, in the order they appear, and the
+ * scanner skips the rest: object() calls a visitor for each member, and a
+ * member value the visitor does not read is stepped over. Skipping only
+ * matches brackets and strings, so it does not validate what it skips.
+ *
+ * Every method returns false on malformed input, after which ok() is false
+ * and the position is unspecified.
+ */
+class JsonScanner
+{
+public:
+    explicit JsonScanner(std::string_view text) : text(text) {}
+
+    bool ok() const { return !failed; }
+
+    /** @brief Skip one value and return its text, or an empty view on error. */
+    std::string_view raw();
+
+    /** @brief Decode a string value into `out`, replacing its contents. */
+    bool string(std::string &out);
+
+    bool integer(int64_t &out);
+
+    /**
+     * @brief Visit the members of an object.
+     *
+     * `visit(key)` is called with the scanner at the member's value. The key
+     * may point into a buffer the scanner reuses, so it is only valid until
+     * the visitor reads the value.
+     */
+    template <typename Visit>
+    bool object(Visit &&visit);
+
+    /** @brief Call `visit()` with the scanner at each element of an array. */
+    template <typename Visit>
+    bool array(Visit &&visit);
+
+private:
+    void whitespace();
+    bool consume(char c);
+    bool key(std::string_view &out);
+    bool skipString();
+    bool fail()
+    {
+        failed = true;
+        return false;
+    }
+
+    std::string_view text;
+    size_t at = 0;
+    bool failed = false;
+    std::string keyBuffer;
+};
+
+template <typename Visit>
+bool JsonScanner::object(Visit &&visit)
+{
+    if (!consume('{'))
+        return fail();
+    if (consume('}'))
+        return true;
+    while (true)
+    {
+        std::string_view name;
+        if (!key(name) || !consume(':'))
+            return fail();
+        whitespace();
+        size_t before = at;
+        visit(name);
+        if (failed || (at == before && raw().empty()))
+            return fail();
+        if (consume('}'))
+            return true;
+        if (!consume(','))
+            return fail();
+    }
+}
+
+template <typename Visit>
+bool JsonScanner::array(Visit &&visit)
+{
+    if (!consume('['))
+        return fail();
+    if (consume(']'))
+        return true;
+    while (true)
+    {
+        whitespace();
+        size_t before = at;
+        visit();
+        if (failed || (at == before && raw().empty()))
+            return fail();
+        if (consume(']'))
+            return true;
+        if (!consume(','))
+            return fail();
+    }
+}
@@ -1,18 +1,296 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <nlohmann/json.hpp>
+#include <completion.hxx>
+#include <histogram.hxx>
+#include <jsonscan.hxx>
+#include <navigation.hxx>
+#include <rope.hxx>
+#include <semantic.hxx>
+#include <transport.hxx>
+#include <workspace.hxx>
 
 using json = nlohmann::json;
 
-struct LSPServer
+/**
+ * @brief A document the client has open, kept in sync through incremental edits.
+ */
+struct Document
 {
+    Rope text;
+    int64_t version = 0;
+
+    /**
+     * Declarations of the last version that parsed. While the text does not
+     * parse, completion keeps using them.
+     */
+    std::shared_ptr<const SymbolIndex> symbols;
+    int64_t indexedVersion = -1; /**< Last version parsed, or being parsed */
+
+    /**
+     * The version last analyzed, parsed and resolved, which position requests
+     * and semantic tokens share.
+     */
+    std::shared_ptr<const DocumentIndex> analysis;
+    int64_t analyzedVersion = -1;
+
+    /** Semantic tokens last sent, which delta requests are diffed against. */
+    std::shared_ptr<const std::vector<uint32_t>> semanticTokens;
+    std::string semanticResultId;
+};
+
+/**
+ * @brief What the server measured for one method since it started. Times are
+ * in nanoseconds.
+ *
+ * For a request, latency runs from the message being read to its response
+ * being queued for writing, wait included. For a notification it is the time
+ * its handler took, and for `textDocument/publishDiagnostics` the time from
+ * the analysis starting to its result being sent.
+ */
+struct MethodStats
+{
+    Histogram latency;
+    Histogram queueWait;               /**< Requests: from being read to a worker taking them */
+    std::atomic<uint64_t> bytesIn{0};  /**< Message bodies read */
+    std::atomic<uint64_t> bytesOut{0}; /**< Message bodies sent */
+};
+
+/**
+ * @brief Queue a request runs on.
+ *
+ * Each lane has its own threads, so interactive requests such as completion
+ * never wait behind a full-document analysis.
+ */
+enum class Lane
+{
+    Interactive,
+    Background,
+};
+
+/**
+ * @brief Lets a running handler notice that its result is no longer wanted,
+ * because the client cancelled it or edited the document it is about.
+ */
+struct CancellationToken
+{
+    enum State : int
+    {
+        Active,
+        Cancelled,
+        Stale,
+    };
+
+    std::atomic<int> state{Active};
+
+    bool cancelled() const { return state.load(std::memory_order_relaxed) != Active; }
+};
+
+/**
+ * @brief Language server speaking JSON-RPC over a byte source and sink.
+ *
+ * The thread calling runLSP() reads messages and applies document
+ * notifications in order. Requests are queued on their lane's worker pool and
+ * answered through a single writer thread, so responses may come out of
+ * order. `$/cancelRequest` and newer versions of the document a request names
+ * cancel it: one still queued is answered with an error right away, one that
+ * is running when its handler returns.
+ *
+ * The reader only scans a message for its `id`, `method` and `params`.
+ * Request parameters are parsed on the worker that runs the request, and
+ * notification handlers get the raw parameter text, so a document's text goes
+ * from the message into its rope without a DOM in between.
+ *
+ * Diagnostics are pushed with `textDocument/publishDiagnostics`. Opening or
+ * editing a document (re)starts its timer; once it has been quiet for the
+ * diagnostics delay, a background thread parses and checks it, and publishes
+ * the result if it differs from what the client last got. An edit during the
+ * analysis cancels it, so a burst of typing costs one analysis.
+ *
+ * `initialize` starts indexing the declarations of the workspace folders on
+ * their own thread, through the content-addressed artifact cache, and
+ * `workspace/symbol` answers fuzzy queries from the index once it is built.
+ * Files named by `textDocument/didSave`, `textDocument/didClose` and
+ * `workspace/didChangeWatchedFiles` are then indexed again on that thread,
+ * through the same cache; requests use the previous index until it is done.
+ *
+ * Definition, references and hover look the cursor up in the DocumentIndex
+ * of the document's version, built by its analysis or by the first request
+ * that needs it. References in other files come from the workspace index's
+ * reverse-reference map. Requests that may wait for the workspace index,
+ * `workspace/symbol`, definition and references, run on the background lane.
+ *
+ * Every method's latency, queue wait and traffic are recorded as it is
+ * served, and `vsharp/stats` answers with a summary of them.
+ */
+class LSPServer
+{
+public:
+    using RequestHandler = std::function<json(const json &params, const CancellationToken &token)>;
+    /** Gets the JSON text of the params, empty if there are none. */
+    using NotificationHandler = std::function<void(std::string_view params)>;
+
+    /**
+     * @param workers Threads for the interactive lane; 0 picks one per hardware
+     * thread. The background lane always has one.
+     */
+    LSPServer(std::unique_ptr<ByteSource> source, std::unique_ptr<ByteSink> sink, unsigned workers = 0);
+
+    /** @brief Serve over the standard input and output file descriptors. */
+    explicit LSPServer(unsigned workers = 0);
+
+    /** @brief Serve over a pair of streams, e.g. string streams in tests. */
+    LSPServer(std::istream &in, std::ostream &out, unsigned workers = 0);
+
+    ~LSPServer();
+
+    /** @brief Serve until `exit` or the end of the input, then finish the queued requests. */
     void runLSP();
 
+    /** @brief Handle a request method on a lane, replacing any earlier handler. */
+    void onRequest(const std::string &method, RequestHandler handler, Lane lane = Lane::Interactive);
+
+    /** @brief Handle a notification method on the reader thread, in message order. */
+    void onNotification(const std::string &method, NotificationHandler handler);
+
+    /** @brief How long a document must go unedited before it is analyzed; 200 ms by default. */
+    void setDiagnosticsDelay(std::chrono::milliseconds delay) { diagnosticsDelay = delay; }
+
+    /** @brief Write statsReport() to a stream once runLSP() is done; null, the default, writes nothing. */
+    void setStatsLog(std::ostream *log) { statsLog = log; }
+
+    /**
+     * @brief Count, latency and queue wait percentiles in microseconds, and
+     * bytes in and out of every method used so far, as `vsharp/stats` sends them.
+     */
+    json statsReport() const;
+
 private:
-    int readContentLength();
-    std::string readMessage();
-    void sendMessage(const json &response);
-    void handleInitialize(const json &request);
-    void handleShutDown(const json &request);
-    void handleCompletion(const json &request);
-};
\ No newline at end of file
+    /** A message as the reader scanned it; the views point into its body. */
+    struct Message
+    {
+        std::string method;
+        std::string_view id;
+        std::string_view params;
+        size_t size = 0; /**< Bytes of the body */
+    };
+
+    struct Job
+    {
+        json id;
+        std::string method;
+        std::string params; /**< JSON text, parsed when the request runs */
+        std::string uri;     /**< Document the request is about, if any */
+        int64_t version = 0; /**< Its version when the request arrived */
+        CancellationToken token;
+        MethodStats *stats = nullptr;
+        std::chrono::steady_clock::time_point arrived;
+    };
+
+    struct Route
+    {
+        RequestHandler handler;
+        Lane lane;
+    };
+
+    struct Queue
+    {
+        std::deque<std::shared_ptr<Job>> jobs;
+        std::condition_variable ready;
+        std::vector<std::thread> threads;
+    };
+
+    /** @brief Queue a message for the writer, adding it to `measured` if given. */
+    void sendMessage(const json &message, MethodStats *measured = nullptr, std::chrono::steady_clock::time_point since = {});
+    void dispatch(const Message &message);
+    void work(Queue &queue);
+    void finish(const std::shared_ptr<Job> &job, json result);
+    void write();
+    void scheduleAnalysis(const std::string &uri);
+    void analyze();
+    void indexWorkspace(std::vector<std::filesystem::path> roots, std::filesystem::path cacheDir);
+    void reindex(std::string_view uri);
+    void stopIndexing();
+    std::shared_ptr<const DocumentIndex> documentIndex(const std::string &uri);
+    std::shared_ptr<const WorkspaceIndex> workspaceIndex(const CancellationToken &token);
+
+    json handleInitialize(const json &params);
+    json handleShutDown(const json &params);
+    json handleCompletion(const json &params);
+    json handleWorkspaceSymbol(const json &params, const CancellationToken &token);
+    json handleSemanticTokens(const json &params, bool delta);
+    json handleDefinition(const json &params, const CancellationToken &token);
+    json handleReferences(const json &params, const CancellationToken &token);
+    json handleHover(const json &params);
+    void handleDidOpen(std::string_view params);
+    void handleDidChange(std::string_view params);
+    void handleDidClose(std::string_view params);
+    void handleDidSave(std::string_view params);
+    void handleDidChangeWatchedFiles(std::string_view params);
+    void handleCancel(std::string_view params);
+
+    std::unique_ptr<ByteSource> source;
+    std::unique_ptr<ByteSink> sink;
+    unsigned workers;
+    std::unordered_map<std::string, Route> requests;
+    std::unordered_map<std::string, NotificationHandler> notifications;
+
+    // Entries are added as methods are registered, before any thread reads them.
+    std::unordered_map<std::string, MethodStats> stats;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::ostream *statsLog = nullptr;
+
+    /** Open documents by URI; guarded by documentsMutex. */
+    std::unordered_map<std::string, Document> documents;
+    std::mutex documentsMutex;
+    std::atomic<uint64_t> semanticResults{0};
+
+    // Requests that have not been answered yet, by their ID's JSON text.
+    std::unordered_map<std::string, std::shared_ptr<Job>> pending;
+    Queue lanes[2];
+    std::mutex jobsMutex;
+    bool stopping = false;
+
+    std::deque<std::string> outbox;
+    std::condition_variable outboxReady;
+    std::mutex outboxMutex;
+    bool closing = false;
+    std::thread writer;
+
+    // Documents waiting to be analyzed, by URI, and when their analysis is
+    // due. The rest of the analysis state is guarded by analysisMutex too.
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> dueAnalyses;
+    std::string analyzing;                      /**< URI being analyzed, if any */
+    CancellationToken *analysisToken = nullptr; /**< Cancelled by edits to it */
+    std::unordered_map<std::string, std::string> published; /**< Last diagnostics sent per URI, as JSON text */
+    std::chrono::milliseconds diagnosticsDelay{200};
+    std::condition_variable analysisReady;
+    std::mutex analysisMutex;
+    bool analysisStopping = false;
+    std::thread analyzer;
+
+    // Declarations of the workspace folders, replaced when indexing finishes
+    // and after each re-index of the files changed since.
+    std::shared_ptr<const WorkspaceIndex> workspace;
+    bool indexing = false;
+    std::vector<std::filesystem::path> changedFiles; /**< Waiting to be indexed again */
+    std::condition_variable workspaceReady;
+    std::condition_variable workspaceChanged;
+    std::mutex workspaceMutex;
+    std::atomic<bool> indexStop{false};
+    std::thread indexer;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Snapshot of the global heap counters.
+ *
+ * The counters are maintained by a replacement `operator new`/`operator delete`
+ * that memstats.cxx only defines when built with VSHARP_COUNT_ALLOCATIONS. It
+ * puts a header on every block and contended atomics on every allocation, so
+ * only benchmarks and tests turn it on; elsewhere the counters stay zero and
+ * `counted` is false.
+ */
+struct AllocStats
+{
+    uint64_t allocations; /**< Number of calls to operator new */
+    uint64_t frees;       /**< Number of calls to operator delete */
+    uint64_t bytes;       /**< Total bytes requested from operator new */
+    uint64_t liveBytes;   /**< Bytes currently allocated */
+    uint64_t peakBytes;   /**< High-water mark of liveBytes since the last resetPeakBytes() */
+    bool counted;         /**< Whether this binary counts allocations at all */
+};
+
+/**
+ * @brief Read the current heap counters.
+ */
+AllocStats allocStats();
+
+/**
+ * @brief Reset the heap high-water mark to the current live byte count.
+ */
+void resetPeakBytes();
+
+/**
+ * @brief Peak resident set size of the process in bytes, or 0 if unavailable.
+ */
+size_t peakRSS();
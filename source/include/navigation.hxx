@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <ast.hxx>
+#include <source.hxx>
+
+/**
+ * @brief The innermost AST node at every offset of a document.
+ *
+ * Node spans nest, so they split the text into intervals that each have one
+ * innermost node. The index keeps the start of every interval, sorted, and
+ * finds the one holding an offset with a binary search.
+ */
+struct NodeIndex
+{
+    explicit NodeIndex(const ASTNode *root = nullptr);
+
+    /** @brief Innermost node whose span holds the offset, or null. */
+    const ASTNode *at(uint32_t offset) const;
+
+    size_t size() const { return starts.size(); }
+
+private:
+    std::vector<uint32_t> starts;
+    std::vector<const ASTNode *> nodes; /**< Parallel to starts; null outside the tree */
+};
+
+/**
+ * @brief A name in the source: one a declaration introduces, or a use of one.
+ */
+struct NameUse
+{
+    uint32_t begin = 0; /**< Offset of the name's first byte */
+    uint32_t end = 0;   /**< Offset one past its last byte */
+    const ASTNode *node = nullptr; /**< Node the name is part of */
+    Binding binding;    /**< What it names; `decl` is null if it did not resolve */
+    bool declaration = false;
+};
+
+/**
+ * @brief A document parsed and resolved once, indexed for going from a
+ * position to what is named there and back.
+ *
+ * It is not changed once built, so the threads answering requests about the
+ * same version of a document share it.
+ */
+struct DocumentIndex
+{
+    std::string text;
+    ASTNodePtr root; /**< Null if the text does not parse */
+    LineTable lines;
+    NodeIndex nodes;
+
+    /** @brief Parse and resolve a text; one that does not parse gets no tree. */
+    explicit DocumentIndex(std::string text);
+
+    /**
+     * @param text The source, as the lexer holds it
+     * @param root Its program after resolveNames, or null
+     */
+    DocumentIndex(std::string text, ASTNodePtr root);
+
+    /** @brief The name at an offset, or just before it, as a cursor sits after a word. */
+    std::optional<NameUse> nameAt(uint32_t offset) const;
+
+    /** @brief Every name bound to a declaration or parameter, its own name included, in source order. */
+    std::vector<NameUse> references(const Binding &target) const;
+
+    /** @brief The name a declaration or parameter introduces. */
+    std::optional<NameUse> declaration(const Binding &target) const;
+
+    /** @brief Every name in the document, in source order. */
+    const std::vector<NameUse> &names() const { return all; }
+
+    /**
+     * @brief How a name is known outside its file: "name" for a top-level
+     * declaration, "Class.name" for a member. Names that did not resolve are
+     * taken at their word. Locals and parameters have no key.
+     */
+    std::string key(const NameUse &name) const;
+
+private:
+    static std::pair<std::string, ASTNodePtr> parse(std::string text);
+    explicit DocumentIndex(std::pair<std::string, ASTNodePtr> parsed);
+
+    std::vector<NameUse> all;
+    /** Indices into all of the names bound to each declaration */
+    std::unordered_map<const ASTNode *, std::vector<uint32_t>> uses;
+    /** Keys of the declarations at the top level and in classes */
+    std::unordered_map<const ASTNode *, std::string> globals;
+};
+
+/**
+ * @brief The names a single node introduces or uses, without its children's.
+ */
+std::vector<NameUse> namesOf(const ASTNode *node, std::string_view text);
+
+/**
+ * @brief A declaration or parameter as source would declare it, e.g.
+ * `static Math.add(int64[a, b]) int64` or `var total: int64`.
+ */
+std::string describe(const Binding &target);
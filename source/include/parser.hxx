@@ -1,12 +1,25 @@
 #pragma once
 
+#include <stdexcept>
+#include <string>
 #include <ast.hxx>
 #include <token.hxx>
 
+/**
+ * @brief A syntax error, spanning the token it was found at.
+ */
+struct ParseError : std::runtime_error
+{
+    SourceSpan span;
+
+    ParseError(const std::string &message, SourceSpan span) : std::runtime_error(message), span(span) {}
+};
+
 struct Parser
 {
     Lexer &lexer;
     Token current, nextToken;
+    uint32_t lastEnd = 0; /**< End offset of the last consumed token */
 
     Parser(Lexer &lexer) : lexer(lexer)
     {
@@ -15,6 +28,7 @@ struct Parser
     }
     void advance()
     {
+        lastEnd = offsetOf(current) + static_cast<uint32_t>(current.Lexeme.size());
         current = nextToken;
         nextToken = lexer.next();
     }
@@ -35,4 +49,8 @@ struct Parser
 
 private:
     int getPrecedence() const { return lexer.precedence(current.Type); }
+    TokenType peekPastModifiers();
+    uint32_t offsetOf(const Token &tok) const { return static_cast<uint32_t>(tok.Lexeme.data() - lexer.Source.data()); }
+    void setSpan(ASTNode *node, uint32_t begin) const { node->span = SourceSpan{begin, lastEnd, lexer.FileId}; }
+    [[noreturn]] void syntaxError(const std::string &message) const;
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <ast.hxx>
+#include <diagnostic.hxx>
+#include <ir.hxx>
+#include <types.hxx>
+
+/**
+ * @brief Everything the compilation pipeline reads and produces for one file.
+ */
+struct CompileUnit
+{
+    ASTNodePtr ast;
+    TypeTable types;
+    IRModule ir;
+    std::vector<Diagnostic> diagnostics;
+
+    /** @brief Bumped whenever a pass changes the tree; passes compare it to skip repeated work. */
+    uint64_t generation = 0;
+
+    /** @brief Whether any diagnostic is an error. */
+    bool hasErrors() const;
+};
+
+/**
+ * @brief Measurements of one pass over one pipeline run.
+ */
+struct PassStats
+{
+    std::string name;
+    bool ran = false;
+    bool skipped = false;
+    double seconds = 0;
+    uint64_t allocations = 0; /**< Zero unless the binary counts allocations; see AllocStats */
+    uint64_t bytes = 0;
+    uint64_t peakRSSGrowth = 0; /**< How far the process's peak resident set grew during the pass */
+    size_t nodesBefore = 0;
+    size_t nodesAfter = 0;
+    size_t changes = 0;
+};
+
+/**
+ * @brief Runs an ordered pipeline of passes over a CompileUnit.
+ *
+ * A pass returns how many changes it made to the tree. A pass that made no
+ * changes leaves the unit's generation alone, and a pass that appears again
+ * in the pipeline is skipped if the generation is the one its previous run
+ * left behind: an analysis's results are still valid and a transformation has
+ * already reached its fixpoint. The pipeline stops after the first pass that
+ * leaves an error diagnostic behind.
+ */
+class PassManager
+{
+public:
+    using Run = std::function<size_t(CompileUnit &)>;
+
+    /**
+     * @brief Append a pass to the pipeline.
+     * @param name Name shown in the timing report
+     * @param run The pass
+     * @param skippable False for passes that must always run, such as the parser
+     */
+    void add(std::string name, Run run, bool skippable = true);
+
+    /**
+     * @brief Count nodes around every pass. Costs a tree walk per pass, so it is off by default.
+     */
+    void countNodes(bool enable) { trackNodes = enable; }
+
+    /**
+     * @brief Run every pass in order.
+     * @return bool False if the pipeline stopped on an error
+     */
+    bool run(CompileUnit &unit);
+
+    /** @brief Measurements of the last run, in pipeline order. */
+    const std::vector<PassStats> &stats() const { return results; }
+
+    /**
+     * @brief Print a table of the last run's measurements, in the spirit of -ftime-report.
+     */
+    void printReport(std::ostream &out) const;
+
+private:
+    struct Pass
+    {
+        std::string name;
+        Run run;
+        bool skippable;
+    };
+
+    std::vector<Pass> passes;
+    std::vector<PassStats> results;
+    bool trackNodes = false;
+};
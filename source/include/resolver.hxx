@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <arena.hxx>
+#include <ast.hxx>
+#include <diagnostic.hxx>
+
+/**
+ * @brief Stack of lexical scopes mapping names to their declarations.
+ *
+ * Every scope is a flat open-addressing table with linear probing, allocated
+ * from an arena. Pushing a scope allocates its table; popping one rewinds the
+ * arena to where the scope started, which frees the table and any grown copies
+ * of it in O(1). Only the innermost scope can be declared into.
+ *
+ * Names are stored as views, so the strings they point to must outlive the scope.
+ */
+struct SymbolTable
+{
+    SymbolTable() { scopes.reserve(16); }
+
+    /** @brief Open a new innermost scope. */
+    void push();
+
+    /** @brief Close the innermost scope. */
+    void pop();
+
+    /**
+     * @brief Declare a name in the innermost scope.
+     * @return const Binding* The existing binding if the scope already declares
+     * the name (it is left unchanged), otherwise null
+     */
+    const Binding *declare(std::string_view name, Binding binding);
+
+    /**
+     * @brief Find the innermost declaration of a name.
+     * @return const Binding* The binding, or null if no open scope declares the name
+     */
+    const Binding *lookup(std::string_view name) const;
+
+    /** @brief Number of open scopes. */
+    size_t depth() const { return scopes.size(); }
+
+private:
+    struct Slot
+    {
+        const char *name = nullptr; /**< Null for an empty slot */
+        uint32_t length = 0;
+        uint32_t tag = 0; /**< High bits of the hash, compared before the name */
+        Binding binding;
+    };
+
+    struct Scope
+    {
+        Slot *slots;
+        uint32_t mask; /**< Capacity - 1; capacities are powers of two */
+        uint32_t size;
+        Arena::Marker start;
+    };
+
+    static Slot *find(const Scope &scope, std::string_view name, uint64_t hash);
+    void grow(Scope &scope);
+
+    Arena arena;
+    std::vector<Scope> scopes;
+};
+
+/**
+ * @brief Bind every identifier and assignment to its declaration.
+ *
+ * Classes and functions are visible throughout the block that declares them,
+ * and class members throughout the class body. Variables in other blocks are
+ * visible from their declaration to the end of the block. Parameters are
+ * bound to their function with the parameter index. "Class.name" finds a
+ * member of the class, which must not be private unless it is used from
+ * inside that class.
+ *
+ * Undefined names, redefinitions and assignments to constants or non-variables
+ * are reported as errors. Overloaded functions may share a name as long as
+ * their parameter types differ; calls with several overloads of their arity
+ * list them for checkTypes() to choose from.
+ *
+ * @param root Root of the tree, usually the program block
+ * @param diagnostics Receives the errors
+ * @return size_t Number of names bound
+ */
+size_t resolveNames(ASTNode *root, std::vector<Diagnostic> &diagnostics);
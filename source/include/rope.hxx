@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Editable text stored as a treap of chunks.
+ *
+ * Each node holds a chunk of up to MaxChunk bytes and caches the byte and
+ * newline counts of its subtree. That makes an edit at an offset, and finding
+ * the offset where a line starts, O(log n) in the number of chunks. Chunks at
+ * the seams of an edit are merged again when they fit, so a document edited
+ * many times does not decay into one-byte nodes.
+ *
+ * Lines are separated by '\n'. Columns given to offsetAt() count UTF-16 code
+ * units, as LSP positions do by default.
+ */
+class Rope
+{
+public:
+    static constexpr size_t MaxChunk = 1024;
+
+    Rope();
+    explicit Rope(std::string_view text);
+    Rope(Rope &&other) noexcept;
+    Rope &operator=(Rope &&other) noexcept;
+    ~Rope();
+
+    size_t size() const;
+
+    /** @brief Number of lines; a text without '\n' has one. */
+    size_t lineCount() const;
+
+    void insert(size_t offset, std::string_view text);
+    void erase(size_t offset, size_t length);
+
+    /** @brief Replace `length` bytes at `offset` with `text`. */
+    void replace(size_t offset, size_t length, std::string_view text);
+
+    /**
+     * @brief Offset of the first byte of a 0-based line, or size() past the last line.
+     */
+    size_t lineStart(size_t line) const;
+
+    /**
+     * @brief Offset of a 0-based line and UTF-16 column.
+     *
+     * A column past the end of its line is clamped to the line break, and a
+     * line past the last one to the end of the text, as LSP asks.
+     */
+    size_t offsetAt(size_t line, size_t utf16Column) const;
+
+    std::string substr(size_t offset, size_t length) const;
+
+    /**
+     * @brief The whole text as one string.
+     *
+     * Built on first use after an edit and kept until the next one, so
+     * handing the text to the lexer repeatedly costs one copy per edit at most.
+     */
+    const std::string &text() const;
+
+    struct Node;
+
+private:
+    uint32_t nextPriority();
+    std::unique_ptr<Node> build(std::string_view text);
+    void edited() { snapshotValid = false; }
+
+    std::unique_ptr<Node> root;
+    uint32_t seed = 0x9E3779B9u;
+    mutable std::string snapshot;
+    mutable bool snapshotValid = true;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ast.hxx>
+
+/**
+ * @brief Token types of semantic highlighting, numbered as their index in
+ * semanticTokenTypes, the legend the server advertises.
+ */
+enum class SemanticType : uint32_t
+{
+    Keyword,
+    Type,
+    Class,
+    Function,
+    Method,
+    Property,
+    Variable,
+    Parameter,
+    Number,
+    String,
+    Comment,
+};
+
+/** @brief Modifier bits, numbered as their index in semanticTokenModifiers. */
+namespace SemanticModifier
+{
+    inline constexpr uint32_t Declaration = 1 << 0;
+    inline constexpr uint32_t Readonly = 1 << 1;
+    inline constexpr uint32_t Static = 1 << 2;
+}
+
+inline const char *const semanticTokenTypes[] = {"keyword", "type", "class", "function", "method", "property",
+                                                 "variable", "parameter", "number", "string", "comment"};
+inline const char *const semanticTokenModifiers[] = {"declaration", "readonly", "static"};
+
+/**
+ * @brief Highlighting of a source, in LSP's semantic token encoding.
+ *
+ * Five integers per token: line delta, start delta (from the previous token's
+ * start if on the same line), length, type and modifier bits, with columns
+ * and lengths in UTF-16 code units. Tokens come straight from the lexer;
+ * identifiers are classified by the declarations the resolver bound them to.
+ * Operators and punctuation are left to the client.
+ *
+ * @param text Source text
+ * @param root Its program after resolveNames, or null when it does not parse,
+ * in which case every identifier is a variable
+ */
+std::vector<uint32_t> encodeSemanticTokens(const std::string &text, const ASTNode *root);
+
+/**
+ * @brief One edit of a semantic token array: replace `deleteCount` integers
+ * at `start` with `data`.
+ */
+struct SemanticTokensEdit
+{
+    uint32_t start = 0;
+    uint32_t deleteCount = 0;
+    std::vector<uint32_t> data;
+};
+
+/**
+ * @brief The single edit turning one encoding into another: whatever lies
+ * between their longest common prefix and suffix of whole tokens. Since
+ * positions are relative, an edit only changes the tokens it touches and the
+ * one after them, so the edit stays small however large the file.
+ */
+SemanticTokensEdit diffSemanticTokens(const std::vector<uint32_t> &previous, const std::vector<uint32_t> &current);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <ast.hxx>
+
+/**
+ * @brief Version of the `.vsast` binary AST format.
+ *
+ * Bump this whenever the encoding of any node changes; loaders reject files
+ * written with a different version.
+ */
+inline constexpr uint32_t VSAST_VERSION = 4;
+
+/**
+ * @brief Deepest nesting of nodes a `.vsast` file may have.
+ *
+ * Decoding recurses once per level, so a corrupt or hostile file is rejected
+ * at this depth rather than running out of stack.
+ */
+inline constexpr uint32_t VSAST_MAX_DEPTH = 4096;
+
+/**
+ * @brief Encode an AST into the `.vsast` binary format.
+ *
+ * Layout: the magic bytes "VSAT", the format version, a string table and then
+ * the nodes in pre-order, each with its source span. Integers are LEB128
+ * varints (zig-zag for signed values), floating-point values are stored as
+ * little-endian IEEE bits and every name or operator is an index into the
+ * string table.
+ *
+ * @param root Root node, may be null
+ * @return std::string Encoded bytes
+ */
+std::string serializeAST(const ASTNode *root);
+
+/**
+ * @brief Decode an AST from `.vsast` bytes.
+ * @param data Encoded bytes; only read during the call
+ * @return ASTNodePtr The reconstructed tree
+ * @throws std::runtime_error if the data is truncated, corrupt, nested deeper
+ * than VSAST_MAX_DEPTH or of another version
+ */
+ASTNodePtr deserializeAST(std::string_view data);
+
+/**
+ * @brief Serialize an AST and write it to a file.
+ * @throws std::runtime_error if the file cannot be written
+ */
+void writeASTFile(const std::string &path, const ASTNode *root);
+
+/**
+ * @brief Load a `.vsast` file by mapping it into memory and decoding in place.
+ * @throws std::runtime_error if the file cannot be mapped or is invalid
+ */
+ASTNodePtr loadASTFile(const std::string &path);
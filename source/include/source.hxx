@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ast.hxx>
+#include <diagnostic.hxx>
+
+/**
+ * @brief 1-based line and column of a source offset.
+ */
+struct LineColumn
+{
+    uint32_t line;
+    uint32_t column;
+};
+
+/**
+ * @brief Offsets of the first byte of every line of a text.
+ */
+struct LineTable
+{
+    explicit LineTable(std::string_view text);
+
+    /**
+     * @brief Resolve a byte offset with a binary search over the line starts.
+     */
+    LineColumn resolve(uint32_t offset) const;
+
+    /**
+     * @brief UTF-16 code units from the start of the offset's line to it, the
+     * column LSP positions count in.
+     * @param text The text the table was built from
+     */
+    uint32_t utf16Column(std::string_view text, uint32_t offset) const;
+
+    /**
+     * @brief Offset of an LSP position: a 0-based line and UTF-16 code units
+     * into it. Columns past the end of the line stop at its break, lines past
+     * the last one at the end of the text.
+     */
+    uint32_t utf16Offset(std::string_view text, uint32_t line, uint32_t column) const;
+
+    /** @brief Offset of the first byte of a 1-based line. */
+    uint32_t lineStart(uint32_t line) const { return starts[line - 1]; }
+
+    size_t lineCount() const { return starts.size(); }
+
+private:
+    std::vector<uint32_t> starts;
+};
+
+/**
+ * @brief Owns the source text of every file in a compilation.
+ *
+ * File IDs are small integers stored in SourceSpan. Line tables are only built
+ * the first time a span of a file is resolved, so files that never produce a
+ * location pay nothing for them. Resolution is safe to call from several threads.
+ */
+struct SourceManager
+{
+    /**
+     * @brief Register a file.
+     * @return uint16_t The file ID
+     */
+    uint16_t addFile(std::string name, std::string text);
+
+    /**
+     * @brief Register a file whose text is not available, such as a tree
+     * loaded from a .vsast file. Its spans are described by its name alone.
+     * @return uint16_t The file ID
+     */
+    uint16_t addFile(std::string name);
+
+    const std::string &name(uint16_t file) const { return files[file].name; }
+    const std::string &text(uint16_t file) const { return files[file].text; }
+
+    /** @brief Line and column of the start of a span. */
+    LineColumn resolve(const SourceSpan &span) const;
+
+    /** @brief Format a span as "file:line:column", or "file" if its text is not available. */
+    std::string describe(const SourceSpan &span) const;
+
+    /** @brief Format a diagnostic as "file:line:column: severity: message". */
+    std::string format(const Diagnostic &diagnostic) const;
+
+private:
+    struct File
+    {
+        std::string name;
+        std::string text;
+        bool hasText = true;
+        mutable std::once_flag linesBuilt;
+        mutable std::unique_ptr<LineTable> lines;
+    };
+
+    const LineTable &lines(uint16_t file) const;
+
+    std::deque<File> files;
+};
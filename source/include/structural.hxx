@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ast.hxx>
+
+/**
+ * @brief Structural hash of every node of a tree.
+ *
+ * Two subtrees have the same hash when they have the same node types, names,
+ * operators, declared types and literal values in the same shape. Source spans
+ * and parent links are ignored, so the hash survives reformatting and moving code.
+ */
+using StructuralHashes = std::unordered_map<const ASTNode *, uint64_t>;
+
+/**
+ * @brief Hash a subtree without recording the hashes of its descendants.
+ */
+uint64_t structuralHash(const ASTNode *root);
+
+/**
+ * @brief Hash every node of a subtree in one bottom-up pass.
+ * @param root Root of the subtree
+ * @param out Receives the hash of every non-null node
+ * @return uint64_t The hash of the root
+ */
+uint64_t computeStructuralHashes(const ASTNode *root, StructuralHashes &out);
+
+/**
+ * @brief Exact structural comparison, used to confirm hash matches.
+ */
+bool structurallyEqual(const ASTNode *a, const ASTNode *b);
+
+/**
+ * @brief Equivalence classes of literal and expression subtrees.
+ *
+ * Every interned expression is assigned the ID of its class, so identical
+ * subtrees anywhere in a program share one ID, and the first one seen stands
+ * for the class. The tree itself is left alone: nodes own their children, so
+ * duplicates are counted and identified, not merged. Identifiers are compared
+ * by name, not by what they resolve to.
+ */
+struct ExprTable
+{
+    /**
+     * @brief Intern every literal and expression subtree below a root.
+     * @return size_t Number of expression nodes visited
+     */
+    size_t internAll(const ASTNode *root);
+
+    /**
+     * @brief ID of an interned node's class, or UINT32_MAX if it was not interned.
+     */
+    uint32_t idOf(const ASTNode *node) const;
+
+    /** @brief First node seen of a class. */
+    const ASTNode *canonical(uint32_t id) const { return classes[id].node; }
+
+    /** @brief Number of interned nodes in a class. */
+    size_t occurrences(uint32_t id) const { return classes[id].count; }
+
+    /** @brief Number of distinct classes. */
+    size_t size() const { return classes.size(); }
+
+    /** @brief Number of interned nodes that duplicate an earlier one. */
+    size_t duplicates() const { return interned - classes.size(); }
+
+private:
+    struct Class
+    {
+        const ASTNode *node;
+        uint64_t hash;
+        size_t count;
+    };
+
+    uint32_t intern(const ASTNode *node, uint64_t hash);
+
+    std::vector<Class> classes;
+    std::unordered_multimap<uint64_t, uint32_t> byHash;
+    std::unordered_map<const ASTNode *, uint32_t> ids;
+    size_t interned = 0;
+};
+
+/**
+ * @brief How a declaration differs between two parses.
+ */
+enum class DeclChange
+{
+    Unchanged,
+    Changed,
+    Added,
+    Removed
+};
+
+/**
+ * @brief One entry of a declaration diff.
+ */
+struct DeclDiff
+{
+    std::string name;   /**< Qualified name, e.g. "Math.add(int64,int64)" */
+    DeclChange change;
+    const ASTNode *oldDecl; /**< Null for added declarations */
+    const ASTNode *newDecl; /**< Null for removed declarations */
+};
+
+/**
+ * @brief Compare the top-level and class-member declarations of two parses.
+ *
+ * Declarations are matched by qualified name (functions also by parameter
+ * types) and compared by structural hash, so the cost is linear in the size of
+ * both trees.
+ */
+std::vector<DeclDiff> diffDeclarations(const ASTNode *oldRoot, const ASTNode *newRoot);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -168,6 +169,7 @@ struct Lexer
     size_t Line;        /**< Current line number */
     size_t Column;      /**< Current column number */
     std::string File;   /**< Source file name */
+    uint16_t FileId = 0; /**< File ID recorded in the spans of parsed nodes */
 
     /**
      * @brief Construct a new Lexer.
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Where the framing layer reads bytes from.
+ */
+class ByteSource
+{
+public:
+    virtual ~ByteSource() = default;
+
+    /**
+     * @brief Read up to `size` bytes, waiting only until some are available.
+     * @return size_t Bytes read; 0 at the end of the input
+     */
+    virtual size_t read(char *data, size_t size) = 0;
+};
+
+/**
+ * @brief Where the framing layer writes bytes to.
+ */
+class ByteSink
+{
+public:
+    virtual ~ByteSink() = default;
+
+    /**
+     * @brief Write every piece, in order.
+     * @return bool False if the other end is gone; nothing more can be written
+     */
+    virtual bool write(const std::string_view *pieces, size_t count) = 0;
+};
+
+/**
+ * @brief File descriptor read with read(2), or _read on Windows.
+ */
+class FileSource : public ByteSource
+{
+public:
+    explicit FileSource(int fd) : fd(fd) {}
+    size_t read(char *data, size_t size) override;
+
+private:
+    int fd;
+};
+
+/**
+ * @brief File descriptor written with writev(2), so a batch of messages and
+ * their headers costs one system call. Windows writes piece by piece.
+ */
+class FileSink : public ByteSink
+{
+public:
+    explicit FileSink(int fd) : fd(fd) {}
+    bool write(const std::string_view *pieces, size_t count) override;
+
+private:
+    int fd;
+};
+
+/**
+ * @brief Adapts an istream, for tests and embedding.
+ */
+class StreamSource : public ByteSource
+{
+public:
+    explicit StreamSource(std::istream &in) : in(in) {}
+    size_t read(char *data, size_t size) override;
+
+private:
+    std::istream &in;
+};
+
+/**
+ * @brief Adapts an ostream, for tests and embedding.
+ */
+class StreamSink : public ByteSink
+{
+public:
+    explicit StreamSink(std::ostream &out) : out(out) {}
+    bool write(const std::string_view *pieces, size_t count) override;
+
+private:
+    std::ostream &out;
+};
+
+/**
+ * @brief Splits a byte stream into JSON-RPC message bodies.
+ *
+ * Reads into one buffer that is reused for every message and only grows to
+ * fit the largest one. Headers are parsed in place and bodies are returned as
+ * views into the buffer, so framing copies nothing. Messages may arrive in any
+ * number of reads. A header block without a Content-Length is skipped.
+ */
+class MessageReader
+{
+public:
+    explicit MessageReader(ByteSource &source, size_t capacity = 64 * 1024);
+
+    /**
+     * @brief Read the next message.
+     * @param body Set to the body, valid until the next call
+     * @return bool False at the end of the input, including one inside a message
+     */
+    bool next(std::string_view &body);
+
+private:
+    /** Make room for `needed` bytes from `begin` on, then read once. */
+    bool fill(size_t needed);
+
+    ByteSource &source;
+    std::vector<char> buffer;
+    size_t begin = 0; /**< First byte not returned yet */
+    size_t end = 0;   /**< One past the last byte read */
+};
+
+/**
+ * @brief Frames JSON-RPC message bodies, writing a batch of them at once.
+ */
+class MessageWriter
+{
+public:
+    explicit MessageWriter(ByteSink &sink) : sink(sink) {}
+
+    /** @brief Write the bodies with their headers; false if the sink is gone. */
+    bool write(const std::deque<std::string> &bodies);
+
+private:
+    static constexpr size_t HeaderSize = 48;
+
+    ByteSink &sink;
+    std::vector<char> headers; /**< HeaderSize bytes per message, reused */
+    std::vector<std::string_view> pieces;
+};
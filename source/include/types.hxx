@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ast.hxx>
+#include <diagnostic.hxx>
+
+enum class TypeKind : uint8_t
+{
+    Error,
+    Primitive,
+    UntypedInt,   /**< Integer literal whose width comes from its context */
+    UntypedFloat, /**< Floating-point literal whose width comes from its context */
+    Function,
+    Class,
+};
+
+/**
+ * @brief Description of one interned type.
+ */
+struct TypeInfo
+{
+    TypeKind kind;
+    Type primitive = Type::Void;  /**< For Primitive */
+    TypeId result = 0;            /**< For Function */
+    std::vector<TypeId> params;   /**< For Function */
+    const ASTNode *decl = nullptr; /**< The ClassDeclNode for Class */
+
+    explicit TypeInfo(TypeKind kind, Type primitive = Type::Void) : kind(kind), primitive(primitive) {}
+};
+
+/**
+ * @brief Interns every type of a program so types can be compared as 32-bit IDs.
+ *
+ * Structurally equal types always get the same ID, so type equality is integer
+ * equality. The primitive and untyped-literal types have fixed IDs. Interning
+ * is not thread-safe; looking types up is, as long as nothing is interned at
+ * the same time.
+ */
+struct TypeTable
+{
+    static constexpr TypeId Error = 0;
+    static constexpr TypeId UntypedInt = 1;
+    static constexpr TypeId UntypedFloat = 2;
+
+    TypeTable();
+
+    /** @brief ID of a primitive type. */
+    static constexpr TypeId primitive(Type t) { return 3 + static_cast<TypeId>(t); }
+
+    /** @brief Intern the type of a function with the given signature. */
+    TypeId function(const std::vector<TypeId> &params, TypeId result);
+
+    /** @brief Intern the type of a class, identified by its declaration. */
+    TypeId classType(const ASTNode *decl);
+
+    const TypeInfo &info(TypeId id) const { return types[id]; }
+
+    /** @brief Readable name, e.g. "int64" or "(int64, int64) int64". */
+    std::string name(TypeId id) const;
+
+    size_t size() const { return types.size(); }
+
+private:
+    TypeId intern(TypeInfo info);
+
+    std::deque<TypeInfo> types;
+    std::unordered_multimap<uint64_t, TypeId> byHash;
+};
+
+/**
+ * @brief Type check a resolved program.
+ *
+ * Declarations are collected first, so that every class and function type is
+ * interned before any body is checked. Function bodies are then checked in
+ * parallel; each one only writes the types of its own nodes. Every expression
+ * node gets its type in ASTNode::typeId. Untyped literals take the type their
+ * context expects, defaulting to int64 or float64, and must fit in it.
+ * A call with several overloads of its arity is bound to the one its
+ * argument types match best; no match or a tie is an error.
+ *
+ * @param root Program block, after resolveNames
+ * @param types Receives the interned types
+ * @param diagnostics Receives the errors in source order
+ * @param threads Worker threads for function bodies; 0 picks one per hardware thread
+ * @return size_t Number of function bodies checked
+ */
+size_t checkTypes(ASTNode *root, TypeTable &types, std::vector<Diagnostic> &diagnostics, unsigned threads = 0);
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <type_traits>
+#include <ast.hxx>
+
+/**
+ * @brief Maps a node struct to the ASTNodeType tag it is created with.
+ */
+template <typename T>
+struct NodeKind;
+
+template <> struct NodeKind<BlockNode> { static constexpr ASTNodeType value = ASTNodeType::Block; };
+template <> struct NodeKind<LiteralNode> { static constexpr ASTNodeType value = ASTNodeType::Literal; };
+template <> struct NodeKind<IdentifierNode> { static constexpr ASTNodeType value = ASTNodeType::Identifier; };
+template <> struct NodeKind<BinaryExprNode> { static constexpr ASTNodeType value = ASTNodeType::BinaryExpr; };
+template <> struct NodeKind<FunctionDeclNode> { static constexpr ASTNodeType value = ASTNodeType::FunctionDecl; };
+template <> struct NodeKind<ReturnExprNode> { static constexpr ASTNodeType value = ASTNodeType::ReturnExpr; };
+template <> struct NodeKind<VarDeclNode> { static constexpr ASTNodeType value = ASTNodeType::VarDecl; };
+template <> struct NodeKind<IfExprNode> { static constexpr ASTNodeType value = ASTNodeType::IfExpr; };
+template <> struct NodeKind<AssignExprNode> { static constexpr ASTNodeType value = ASTNodeType::AssignExpr; };
+template <> struct NodeKind<FunctionCallNode> { static constexpr ASTNodeType value = ASTNodeType::FunctionCall; };
+template <> struct NodeKind<ClassDeclNode> { static constexpr ASTNodeType value = ASTNodeType::ClassDecl; };
+
+/**
+ * @brief Checked downcast: returns the node as T if its tag matches, otherwise null.
+ */
+template <typename T, typename N>
+inline auto nodeAs(N *node) -> std::conditional_t<std::is_const_v<N>, const T *, T *>
+{
+    using Result = std::conditional_t<std::is_const_v<N>, const T *, T *>;
+    return node && node->type == NodeKind<T>::value ? static_cast<Result>(node) : nullptr;
+}
+
+/**
+ * @brief Statically dispatched AST traversal.
+ *
+ * Derive with CRTP and shadow any of the hooks below; calls are resolved at
+ * compile time, so there is no virtual dispatch and the compiler can inline
+ * the whole traversal.
+ *
+ * - `preVisit(node)` runs before a node is visited. Returning false skips the node
+ *   and its subtree.
+ * - `visitX(node)` handles one node type. The defaults just traverse the children,
+ *   so an override that wants the subtree visited must call `traverseChildren`.
+ * - `postVisit(node)` runs after the node's subtree.
+ * - `stop()` ends the traversal early; no further hooks run.
+ *
+ * @tparam Derived The visitor implementation
+ * @tparam Mutable Whether the hooks receive mutable node pointers
+ */
+template <typename Derived, bool Mutable = false>
+struct ASTVisitor
+{
+    template <typename T>
+    using Ptr = std::conditional_t<Mutable, T *, const T *>;
+    using NodePtr = Ptr<ASTNode>;
+
+    /**
+     * @brief Visit a node and its subtree.
+     * @return false if the traversal has been stopped
+     */
+    bool traverse(NodePtr node)
+    {
+        if (!node || stopped)
+            return !stopped;
+        if (!derived().preVisit(node))
+            return !stopped;
+
+        switch (node->type)
+        {
+        case ASTNodeType::Block:
+            derived().visitBlock(static_cast<Ptr<BlockNode>>(node));
+            break;
+        case ASTNodeType::Literal:
+            derived().visitLiteral(static_cast<Ptr<LiteralNode>>(node));
+            break;
+        case ASTNodeType::Identifier:
+            derived().visitIdentifier(static_cast<Ptr<IdentifierNode>>(node));
+            break;
+        case ASTNodeType::BinaryExpr:
+            derived().visitBinaryExpr(static_cast<Ptr<BinaryExprNode>>(node));
+            break;
+        case ASTNodeType::FunctionDecl:
+            derived().visitFunctionDecl(static_cast<Ptr<FunctionDeclNode>>(node));
+            break;
+        case ASTNodeType::ReturnExpr:
+            derived().visitReturnExpr(static_cast<Ptr<ReturnExprNode>>(node));
+            break;
+        case ASTNodeType::VarDecl:
+            derived().visitVarDecl(static_cast<Ptr<VarDeclNode>>(node));
+            break;
+        case ASTNodeType::IfExpr:
+            derived().visitIfExpr(static_cast<Ptr<IfExprNode>>(node));
+            break;
+        case ASTNodeType::AssignExpr:
+            derived().visitAssignExpr(static_cast<Ptr<AssignExprNode>>(node));
+            break;
+        case ASTNodeType::FunctionCall:
+            derived().visitFunctionCall(static_cast<Ptr<FunctionCallNode>>(node));
+            break;
+        case ASTNodeType::ClassDecl:
+            derived().visitClassDecl(static_cast<Ptr<ClassDeclNode>>(node));
+            break;
+        default:
+            derived().visitUnknown(node);
+            break;
+        }
+
+        if (!stopped)
+            derived().postVisit(node);
+        return !stopped;
+    }
+
+    /**
+     * @brief Traverse the children of a node in source order.
+     */
+    void traverseChildren(NodePtr node)
+    {
+        switch (node->type)
+        {
+        case ASTNodeType::Block:
+            for (auto &child : static_cast<Ptr<BlockNode>>(node)->children)
+                if (!traverse(child.get()))
+                    return;
+            break;
+        case ASTNodeType::BinaryExpr:
+        {
+            auto bin = static_cast<Ptr<BinaryExprNode>>(node);
+            traverse(bin->left.get()) && traverse(bin->right.get());
+            break;
+        }
+        case ASTNodeType::FunctionDecl:
+            traverse(static_cast<Ptr<FunctionDeclNode>>(node)->body.get());
+            break;
+        case ASTNodeType::ReturnExpr:
+            traverse(static_cast<Ptr<ReturnExprNode>>(node)->expr.get());
+            break;
+        case ASTNodeType::VarDecl:
+            traverse(static_cast<Ptr<VarDeclNode>>(node)->value.get());
+            break;
+        case ASTNodeType::IfExpr:
+        {
+            auto ifn = static_cast<Ptr<IfExprNode>>(node);
+            traverse(ifn->condition.get()) && traverse(ifn->thenBranch.get()) && traverse(ifn->elseBranch.get());
+            break;
+        }
+        case ASTNodeType::AssignExpr:
+            traverse(static_cast<Ptr<AssignExprNode>>(node)->value.get());
+            break;
+        case ASTNodeType::FunctionCall:
+            for (auto &arg : static_cast<Ptr<FunctionCallNode>>(node)->args)
+                if (!traverse(arg.get()))
+                    return;
+            break;
+        case ASTNodeType::ClassDecl:
+            traverse(static_cast<Ptr<ClassDeclNode>>(node)->body.get());
+            break;
+        default:
+            break;
+        }
+    }
+
+    /** @brief End the traversal after the current hook returns. */
+    void stop() { stopped = true; }
+
+    /** @brief Whether stop() has been called. */
+    bool isStopped() const { return stopped; }
+
+    bool preVisit(NodePtr) { return true; }
+    void postVisit(NodePtr) {}
+
+    void visitBlock(Ptr<BlockNode> node) { traverseChildren(node); }
+    void visitLiteral(Ptr<LiteralNode>) {}
+    void visitIdentifier(Ptr<IdentifierNode>) {}
+    void visitBinaryExpr(Ptr<BinaryExprNode> node) { traverseChildren(node); }
+    void visitFunctionDecl(Ptr<FunctionDeclNode> node) { traverseChildren(node); }
+    void visitReturnExpr(Ptr<ReturnExprNode> node) { traverseChildren(node); }
+    void visitVarDecl(Ptr<VarDeclNode> node) { traverseChildren(node); }
+    void visitIfExpr(Ptr<IfExprNode> node) { traverseChildren(node); }
+    void visitAssignExpr(Ptr<AssignExprNode> node) { traverseChildren(node); }
+    void visitFunctionCall(Ptr<FunctionCallNode> node) { traverseChildren(node); }
+    void visitClassDecl(Ptr<ClassDeclNode> node) { traverseChildren(node); }
+    void visitUnknown(NodePtr) {}
+
+private:
+    Derived &derived() { return static_cast<Derived &>(*this); }
+
+    bool stopped = false;
+};
+
+/**
+ * @brief Count the nodes of a subtree.
+ */
+inline size_t countNodes(const ASTNode *root)
+{
+    struct Counter : ASTVisitor<Counter>
+    {
+        size_t count = 0;
+        bool preVisit(const ASTNode *)
+        {
+            ++count;
+            return true;
+        }
+    } counter;
+    counter.traverse(root);
+    return counter.count;
+}
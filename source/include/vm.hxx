@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ir.hxx>
+#include <types.hxx>
+
+/**
+ * @brief Contents of a VM register.
+ *
+ * Integers are kept sign- or zero-extended to 64 bits according to their
+ * type, booleans are 0 or 1, and float32 values are stored as the double with
+ * the same value.
+ */
+union VMValue
+{
+    int64_t i;
+    uint64_t u;
+    double f;
+};
+
+// Every opcode, in the order of the dispatch table.
+#define VSHARP_VM_OPCODES(X) \
+    X(LoadK)                 \
+    X(Move)                  \
+    X(LoadG)                 \
+    X(StoreG)                \
+    X(Add)                   \
+    X(Sub)                   \
+    X(Mul)                   \
+    X(DivS)                  \
+    X(DivU)                  \
+    X(RemS)                  \
+    X(RemU)                  \
+    X(Or)                    \
+    X(And)                   \
+    X(Eq)                    \
+    X(Ne)                    \
+    X(LtS)                   \
+    X(LeS)                   \
+    X(GtS)                   \
+    X(GeS)                   \
+    X(LtU)                   \
+    X(LeU)                   \
+    X(GtU)                   \
+    X(GeU)                   \
+    X(FAdd)                  \
+    X(FSub)                  \
+    X(FMul)                  \
+    X(FDiv)                  \
+    X(FEq)                   \
+    X(FNe)                   \
+    X(FLt)                   \
+    X(FLe)                   \
+    X(FGt)                   \
+    X(FGe)                   \
+    X(Sext8)                 \
+    X(Sext16)                \
+    X(Sext32)                \
+    X(Zext8)                 \
+    X(Zext16)                \
+    X(Zext32)                \
+    X(Round32)               \
+    X(Jump)                  \
+    X(JumpIfFalse)           \
+    X(Call)                  \
+    X(Args)                  \
+    X(Ret)                   \
+    X(RetValue)              \
+    X(Trap)
+
+enum class VMOp : uint8_t
+{
+#define VSHARP_VM_ENUM(name) name,
+    VSHARP_VM_OPCODES(VSHARP_VM_ENUM)
+#undef VSHARP_VM_ENUM
+};
+
+/**
+ * @brief One bytecode instruction in 8 bytes.
+ *
+ * `a`, `b` and `c` are register numbers in the current frame. Instructions
+ * with a 32-bit immediate (a constant, global, jump target or function index)
+ * take it from `b` and `c` together, see immediate(). A Call is followed by
+ * Args words holding its argument registers, three to a word.
+ */
+struct VMInstruction
+{
+    VMOp op;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+
+    uint32_t immediate() const { return b | static_cast<uint32_t>(c) << 16; }
+};
+
+struct VMFunction
+{
+    std::string name;
+    uint32_t entry;     /**< Index of the first instruction in BytecodeProgram::code */
+    uint16_t frameSize; /**< Registers used; parameters are the first ones */
+    uint16_t paramCount;
+    bool returnsValue;
+};
+
+/**
+ * @brief All functions of a program in one code array, ready to run.
+ */
+struct BytecodeProgram
+{
+    std::vector<VMInstruction> code;
+    std::vector<VMValue> constants;
+    std::vector<VMFunction> functions;
+    uint32_t globalCount = 0;
+    std::optional<uint32_t> init; /**< The module's initializer, if it has one */
+
+    std::optional<uint32_t> find(std::string_view name) const;
+};
+
+/**
+ * @brief Compile an IR module to register bytecode.
+ *
+ * Every SSA value gets its own register; phis become moves on the edges that
+ * lead into their block. Arithmetic on narrow integers and float32 is done in
+ * 64 bits and brought back to the type's range with a Sext, Zext or Round32.
+ *
+ * @throws std::runtime_error for string values, which the VM does not support,
+ * and for functions that need more than 65535 registers
+ */
+BytecodeProgram compileBytecode(const IRModule &module, const TypeTable &types);
+
+/**
+ * @brief Interpreter for a BytecodeProgram.
+ *
+ * Frames live on one preallocated register stack, so a call only moves the
+ * frame base. With GCC and Clang, dispatch is threaded through computed gotos.
+ */
+class VirtualMachine
+{
+public:
+    /**
+     * @param program Must outlive the VM
+     * @param stackSize Registers available to all frames together
+     * @param maxDepth Deepest allowed call nesting
+     */
+    explicit VirtualMachine(const BytecodeProgram &program, size_t stackSize = 1 << 20, size_t maxDepth = 100000);
+
+    /** @brief Run the module initializer, which sets every global to its initial value. */
+    void initialize();
+
+    /**
+     * @brief Call a function and run it to completion.
+     * @throws std::runtime_error on division by zero, stack overflow or falling off a non-void function
+     */
+    VMValue call(uint32_t function, const std::vector<VMValue> &args = {});
+
+    std::vector<VMValue> globals;
+
+private:
+    struct Frame
+    {
+        const VMInstruction *resume;
+        VMValue *base;
+        const VMFunction *function;
+        uint16_t result;
+    };
+
+    VMValue execute(const VMFunction *function, VMValue *base);
+
+    const BytecodeProgram &program;
+    std::unique_ptr<VMValue[]> stack;
+    size_t stackSize;
+    size_t maxDepth;
+    std::vector<Frame> frames;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cache.hxx>
+#include <completion.hxx>
+
+/**
+ * @brief Version of the `vssym` cache entries holding a file's declarations.
+ *
+ * Bump this whenever their encoding or what is indexed changes.
+ */
+inline constexpr uint32_t WORKSPACE_SYMBOLS_VERSION = 2;
+
+/**
+ * @brief A declaration in a workspace file, with its range as LSP counts it:
+ * 0-based lines and UTF-16 code units.
+ */
+struct WorkspaceSymbol
+{
+    std::string name;
+    std::string container; /**< Class of a member, empty otherwise */
+    SymbolKind kind;
+    uint32_t file = 0; /**< Index into WorkspaceIndex::files */
+    uint32_t line = 0;
+    uint32_t character = 0;
+    uint32_t endLine = 0;
+    uint32_t endCharacter = 0;
+};
+
+/**
+ * @brief Where a workspace-level name is used or declared. A name never spans
+ * lines, so its range ends on the line it starts on.
+ */
+struct WorkspaceReference
+{
+    uint32_t file = 0; /**< Index into WorkspaceIndex::files */
+    uint32_t line = 0;
+    uint32_t character = 0;
+    uint32_t endCharacter = 0;
+    bool declaration = false;
+};
+
+/**
+ * @brief What one file contributes to a WorkspaceIndex.
+ */
+struct FileIndex
+{
+    std::vector<WorkspaceSymbol> symbols;
+    /** Names with a DocumentIndex::key, and where they are, in source order */
+    std::vector<std::pair<std::string, WorkspaceReference>> references;
+};
+
+/**
+ * @brief Classes, functions and fields of every `.vs` file in a workspace,
+ * searchable by fuzzy name, and where each of them is used.
+ */
+struct WorkspaceIndex
+{
+    std::vector<std::filesystem::path> roots;
+    /** Files indexed; one deleted since keeps its slot, with nothing in it */
+    std::vector<std::filesystem::path> files;
+    std::vector<WorkspaceSymbol> symbols;
+    size_t parsed = 0; /**< Files the last build() or update() parsed; the others came from the cache */
+
+    /**
+     * Reverse-reference map: for each DocumentIndex::key, every place a file
+     * declares or uses the name, so finding references reads one entry
+     * instead of rescanning the workspace.
+     */
+    std::unordered_map<std::string, std::vector<WorkspaceReference>> references;
+
+    /**
+     * @brief Index every `.vs` file under the roots.
+     *
+     * Files are read and indexed in parallel. With a cache, a file whose
+     * content has an entry is not parsed again, and the declarations and
+     * references of the others are stored, so a restart only parses what
+     * changed. Files that do not parse contribute nothing.
+     *
+     * @param roots Directories searched recursively; missing ones are skipped
+     * @param cache Cache for the declarations of each file, may be null
+     * @param threads Worker threads; 0 picks one per hardware thread
+     * @param stop Once set, files not yet started are skipped
+     */
+    void build(const std::vector<std::filesystem::path> &roots, ArtifactCache *cache, unsigned threads = 0,
+               const std::atomic<bool> *stop = nullptr);
+
+    /**
+     * @brief Index again the files that changed on disk.
+     *
+     * Each changed `.vs` file under the roots replaces what it contributed,
+     * going through the cache like build() does, so a file saved back to
+     * content seen before is not parsed. New files are added and deleted
+     * ones emptied; other paths are ignored.
+     *
+     * @param changed Paths created, changed or deleted since the last build or update
+     * @param cache Cache for the declarations of each file, may be null
+     */
+    void update(const std::vector<std::filesystem::path> &changed, ArtifactCache *cache);
+
+    /**
+     * @brief Symbols whose name contains the pattern's characters in order,
+     * ignoring case, best matches first.
+     *
+     * Matches at the start of the name and of its words, and runs of matched
+     * characters, rank higher; ties go to shorter names. An empty pattern
+     * matches everything.
+     */
+    std::vector<const WorkspaceSymbol *> query(std::string_view pattern, size_t limit = 100) const;
+
+private:
+    /** Add what a file contributes to the symbols and the reverse-reference map. */
+    void add(uint32_t file, FileIndex &index);
+    /** Drop everything a file contributed. */
+    void remove(uint32_t file);
+
+    /** Lowercased names, and a bit per letter, digit or '_' they contain, parallel to symbols. */
+    std::vector<std::string> keys;
+    std::vector<uint64_t> masks;
+};
+
+/**
+ * @brief Declarations of one source text and the names it uses, as they are
+ * cached. `file` is left 0 throughout.
+ * @throws std::runtime_error if the text does not parse
+ */
+FileIndex indexFile(const std::string &text);
@@ -0,0 +1,591 @@
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <ir.hxx>
+#include <visitor.hxx>
+
+std::vector<BlockId> IRFunction::successors(BlockId block) const
+{
+    const IRBlock &b = blocks[block];
+    if (b.first == b.end)
+        return {};
+    const IRInstruction &last = instructions[b.end - 1];
+    const uint32_t *ops = operandsOf(last);
+    if (last.op == Opcode::Br)
+        return {ops[0]};
+    if (last.op == Opcode::CondBr)
+        return {ops[1], ops[2]};
+    return {};
+}
+
+const char *opcodeName(Opcode op)
+{
+    switch (op)
+    {
+    case Opcode::Const:
+        return "const";
+    case Opcode::Param:
+        return "param";
+    case Opcode::Load:
+        return "load";
+    case Opcode::Store:
+        return "store";
+    case Opcode::Add:
+        return "add";
+    case Opcode::Sub:
+        return "sub";
+    case Opcode::Mul:
+        return "mul";
+    case Opcode::Div:
+        return "div";
+    case Opcode::Rem:
+        return "rem";
+    case Opcode::BitOr:
+        return "or";
+    case Opcode::And:
+        return "and";
+    case Opcode::Eq:
+        return "eq";
+    case Opcode::Ne:
+        return "ne";
+    case Opcode::Lt:
+        return "lt";
+    case Opcode::Le:
+        return "le";
+    case Opcode::Gt:
+        return "gt";
+    case Opcode::Ge:
+        return "ge";
+    case Opcode::Call:
+        return "call";
+    case Opcode::Phi:
+        return "phi";
+    case Opcode::Br:
+        return "br";
+    case Opcode::CondBr:
+        return "condbr";
+    case Opcode::Ret:
+        return "ret";
+    case Opcode::Unreachable:
+        return "unreachable";
+    }
+    return "?";
+}
+
+namespace
+{
+    Opcode binaryOpcode(const std::string &op)
+    {
+        static const std::unordered_map<std::string, Opcode> opcodes = {
+            {"+", Opcode::Add},
+            {"-", Opcode::Sub},
+            {"*", Opcode::Mul},
+            {"/", Opcode::Div},
+            {"%", Opcode::Rem},
+            {"|", Opcode::BitOr},
+            {"&&", Opcode::And},
+            {"==", Opcode::Eq},
+            {"!=", Opcode::Ne},
+            {"<", Opcode::Lt},
+            {"<=", Opcode::Le},
+            {">", Opcode::Gt},
+            {">=", Opcode::Ge},
+        };
+        auto it = opcodes.find(op);
+        if (it == opcodes.end())
+            throw std::runtime_error("cannot lower operator '" + op + "'");
+        return it->second;
+    }
+
+    LiteralValue zeroValue(Type type)
+    {
+        switch (type)
+        {
+        case Type::Boolean:
+            return false;
+        case Type::Byte:
+            return char{0};
+        case Type::String:
+            return std::string();
+        case Type::Int8:
+            return int8_t{0};
+        case Type::Int16:
+            return int16_t{0};
+        case Type::Int32:
+            return int32_t{0};
+        case Type::Uint8:
+            return uint8_t{0};
+        case Type::Uint16:
+            return uint16_t{0};
+        case Type::Uint32:
+            return uint32_t{0};
+        case Type::Uint64:
+            return uint64_t{0};
+        case Type::Float32:
+            return 0.0f;
+        case Type::Float64:
+            return 0.0;
+        default:
+            return int64_t{0};
+        }
+    }
+
+    /**
+     * Where a branch target is still to be filled in: operand `slot` of instruction `branch`.
+     */
+    struct PendingTarget
+    {
+        ValueId branch;
+        uint32_t slot;
+    };
+
+    struct Lowerer
+    {
+        const TypeTable &types;
+        IRModule &module;
+        std::unordered_map<const ASTNode *, uint32_t> globals;
+        std::vector<std::pair<const FunctionDeclNode *, std::string>> functions;
+        std::unordered_map<const ASTNode *, uint32_t> functionIndex;
+
+        // State of the function being lowered.
+        IRFunction *fn = nullptr;
+        bool open = false;
+        // Current SSA value of every parameter and local variable in scope, and
+        // their keys in declaration order so that phis come out deterministically.
+        std::unordered_map<const void *, ValueId> defs;
+        std::vector<const void *> locals;
+
+        Lowerer(const TypeTable &types, IRModule &module) : types(types), module(module) {}
+
+        TypeId typeOf(const ASTNode *node) const
+        {
+            switch (types.info(node->typeId).kind)
+            {
+            case TypeKind::UntypedInt:
+                return TypeTable::primitive(Type::Int64);
+            case TypeKind::UntypedFloat:
+                return TypeTable::primitive(Type::Float64);
+            default:
+                return node->typeId;
+            }
+        }
+
+        ValueId emit(Opcode op, TypeId type, std::initializer_list<uint32_t> operands, uint32_t immediate = 0)
+        {
+            return emit(op, type, operands.begin(), operands.size(), immediate);
+        }
+
+        ValueId emit(Opcode op, TypeId type, const std::vector<uint32_t> &operands, uint32_t immediate)
+        {
+            return emit(op, type, operands.data(), operands.size(), immediate);
+        }
+
+        ValueId emit(Opcode op, TypeId type, const uint32_t *operands, size_t count, uint32_t immediate)
+        {
+            auto id = static_cast<ValueId>(fn->instructions.size());
+            fn->instructions.push_back(IRInstruction{op, static_cast<uint16_t>(count), type, static_cast<uint32_t>(fn->operands.size()), immediate});
+            fn->operands.insert(fn->operands.end(), operands, operands + count);
+            fn->blocks.back().end = id + 1;
+            if (op == Opcode::Br || op == Opcode::CondBr || op == Opcode::Ret || op == Opcode::Unreachable)
+                open = false;
+            return id;
+        }
+
+        BlockId startBlock()
+        {
+            auto first = static_cast<uint32_t>(fn->instructions.size());
+            fn->blocks.push_back(IRBlock{first, first});
+            open = true;
+            return static_cast<BlockId>(fn->blocks.size() - 1);
+        }
+
+        BlockId currentBlock() const { return static_cast<BlockId>(fn->blocks.size() - 1); }
+
+        void patch(PendingTarget target, BlockId block)
+        {
+            fn->operands[fn->instructions[target.branch].firstOperand + target.slot] = block;
+        }
+
+        ValueId constant(LiteralValue value, TypeId type)
+        {
+            module.constants.push_back(std::move(value));
+            return emit(Opcode::Const, type, {}, static_cast<uint32_t>(module.constants.size() - 1));
+        }
+
+        /**
+         * Key of the variable a binding refers to in `defs`.
+         */
+        static const void *variable(const Binding &binding)
+        {
+            if (binding.param >= 0)
+                return &static_cast<const FunctionDeclNode *>(binding.decl)->params[binding.param];
+            return binding.decl;
+        }
+
+        ValueId value(const ASTNode *node)
+        {
+            switch (node->type)
+            {
+            case ASTNodeType::Literal:
+                return constant(static_cast<const LiteralNode *>(node)->value, typeOf(node));
+            case ASTNodeType::Identifier:
+            {
+                const Binding &binding = static_cast<const IdentifierNode *>(node)->binding;
+                if (auto global = globals.find(binding.decl); global != globals.end() && binding.param < 0)
+                    return emit(Opcode::Load, typeOf(node), {}, global->second);
+                auto def = defs.find(variable(binding));
+                if (def == defs.end())
+                    throw std::runtime_error("cannot lower a reference to '" + static_cast<const IdentifierNode *>(node)->name + "'");
+                return def->second;
+            }
+            case ASTNodeType::BinaryExpr:
+            {
+                const auto *bin = static_cast<const BinaryExprNode *>(node);
+                ValueId left = value(bin->left.get());
+                ValueId right = value(bin->right.get());
+                return emit(binaryOpcode(bin->op), typeOf(bin), {left, right});
+            }
+            case ASTNodeType::FunctionCall:
+            {
+                const auto *call = static_cast<const FunctionCallNode *>(node);
+                auto target = functionIndex.find(call->binding.decl);
+                if (target == functionIndex.end())
+                    throw std::runtime_error("cannot lower a call to '" + call->callee + "'");
+                std::vector<uint32_t> args;
+                args.reserve(call->args.size());
+                for (const auto &arg : call->args)
+                    args.push_back(value(arg.get()));
+                return emit(Opcode::Call, typeOf(call), args, target->second);
+            }
+            case ASTNodeType::AssignExpr:
+            {
+                const auto *assign = static_cast<const AssignExprNode *>(node);
+                ValueId v = value(assign->value.get());
+                if (auto global = globals.find(assign->binding.decl); global != globals.end() && assign->binding.param < 0)
+                    emit(Opcode::Store, TypeTable::primitive(Type::Void), {v}, global->second);
+                else
+                    defs[variable(assign->binding)] = v;
+                return v;
+            }
+            default:
+                throw std::runtime_error("cannot lower expression");
+            }
+        }
+
+        void statement(const ASTNode *node)
+        {
+            // Anything after a return is unreachable and gets no block.
+            if (!node || !open)
+                return;
+            switch (node->type)
+            {
+            case ASTNodeType::Block:
+            {
+                size_t scope = locals.size();
+                for (const auto &child : static_cast<const BlockNode *>(node)->children)
+                    statement(child.get());
+                locals.resize(std::min(scope, locals.size()));
+                break;
+            }
+            case ASTNodeType::VarDecl:
+            {
+                const auto *var = static_cast<const VarDeclNode *>(node);
+                TypeId type = TypeTable::primitive(var->varType);
+                ValueId v = var->value ? value(var->value.get()) : constant(zeroValue(var->varType), type);
+                if (auto global = globals.find(var); global != globals.end())
+                    emit(Opcode::Store, TypeTable::primitive(Type::Void), {v}, global->second);
+                else
+                {
+                    defs[var] = v;
+                    locals.push_back(var);
+                }
+                break;
+            }
+            case ASTNodeType::ReturnExpr:
+            {
+                const auto *ret = static_cast<const ReturnExprNode *>(node);
+                if (ret->expr)
+                    emit(Opcode::Ret, TypeTable::primitive(Type::Void), {value(ret->expr.get())});
+                else
+                    emit(Opcode::Ret, TypeTable::primitive(Type::Void), {});
+                break;
+            }
+            case ASTNodeType::IfExpr:
+                lowerIf(static_cast<const IfExprNode *>(node));
+                break;
+            case ASTNodeType::ClassDecl:
+                statement(static_cast<const ClassDeclNode *>(node)->body.get());
+                break;
+            case ASTNodeType::FunctionDecl:
+                // Lowered as functions of their own.
+                break;
+            default:
+                value(node);
+                break;
+            }
+        }
+
+        void lowerIf(const IfExprNode *ifn)
+        {
+            struct Arm
+            {
+                BlockId block;
+                PendingTarget exit;
+                std::unordered_map<const void *, ValueId> defs;
+            };
+
+            ValueId cond = value(ifn->condition.get());
+            BlockId entry = currentBlock();
+            ValueId branch = emit(Opcode::CondBr, TypeTable::primitive(Type::Void), {cond, 0, 0});
+            const auto before = defs;
+            const size_t scope = locals.size();
+            std::vector<Arm> arms;
+
+            patch({branch, 1}, startBlock());
+            statement(ifn->thenBranch.get());
+            if (open)
+            {
+                BlockId end = currentBlock();
+                arms.push_back(Arm{end, {emit(Opcode::Br, TypeTable::primitive(Type::Void), {0}), 0}, std::move(defs)});
+            }
+
+            defs = before;
+            if (ifn->elseBranch)
+            {
+                patch({branch, 2}, startBlock());
+                statement(ifn->elseBranch.get());
+                if (open)
+                {
+                    BlockId end = currentBlock();
+                    arms.push_back(Arm{end, {emit(Opcode::Br, TypeTable::primitive(Type::Void), {0}), 0}, std::move(defs)});
+                }
+            }
+            else
+                arms.push_back(Arm{entry, {branch, 2}, before});
+
+            if (arms.empty())
+                return;
+
+            BlockId join = startBlock();
+            for (const Arm &arm : arms)
+                patch(arm.exit, join);
+            if (arms.size() == 1)
+            {
+                defs = std::move(arms[0].defs);
+                return;
+            }
+
+            defs = before;
+            for (size_t i = 0; i < scope; ++i)
+            {
+                const void *key = locals[i];
+                ValueId a = arms[0].defs.at(key), b = arms[1].defs.at(key);
+                if (a != b)
+                    defs[key] = emit(Opcode::Phi, fn->instructions[a].type, {arms[0].block, a, arms[1].block, b});
+            }
+        }
+
+        /**
+         * Find globals and functions, giving class members qualified names.
+         */
+        void collect(const ASTNode *node, const std::string &prefix)
+        {
+            if (const auto *block = nodeAs<BlockNode>(node))
+            {
+                for (const auto &child : block->children)
+                    collect(child.get(), prefix);
+            }
+            else if (const auto *cls = nodeAs<ClassDeclNode>(node))
+                collect(cls->body.get(), prefix + cls->name + ".");
+            else if (const auto *var = nodeAs<VarDeclNode>(node))
+            {
+                globals.emplace(var, static_cast<uint32_t>(module.globals.size()));
+                module.globals.push_back(IRGlobal{prefix + var->name, TypeTable::primitive(var->varType)});
+            }
+            else if (const auto *decl = nodeAs<FunctionDeclNode>(node))
+            {
+                functionIndex.emplace(decl, static_cast<uint32_t>(functions.size()));
+                functions.emplace_back(decl, prefix + decl->name);
+            }
+        }
+
+        /**
+         * Tell overloads apart by their parameter types, e.g. `Math.add(int64,int64)`,
+         * and reject names that are still taken twice.
+         */
+        void nameOverloads()
+        {
+            std::unordered_map<std::string, size_t> uses;
+            for (const auto &function : functions)
+                ++uses[function.second];
+            for (auto &[decl, name] : functions)
+            {
+                if (uses[name] < 2)
+                    continue;
+                name += '(';
+                for (size_t i = 0; i < decl->params.size(); ++i)
+                    name += (i ? "," : "") + types.name(TypeTable::primitive(decl->params[i].first));
+                name += ')';
+            }
+
+            // Globals and functions are both written `@name`.
+            std::unordered_set<std::string_view> seen;
+            for (const auto &function : functions)
+                if (!seen.insert(function.second).second)
+                    throw std::runtime_error("duplicate function '" + function.second + "'");
+            for (const auto &global : module.globals)
+                if (!seen.insert(global.name).second)
+                    throw std::runtime_error("duplicate global '" + global.name + "'");
+        }
+
+        void lowerFunction(const FunctionDeclNode *decl, std::string name)
+        {
+            fn = &module.functions.emplace_back();
+            fn->name = std::move(name);
+            fn->result = TypeTable::primitive(decl->returnType);
+            defs.clear();
+            locals.clear();
+
+            startBlock();
+            for (size_t i = 0; i < decl->params.size(); ++i)
+            {
+                TypeId type = TypeTable::primitive(decl->params[i].first);
+                fn->params.push_back(type);
+                defs[&decl->params[i]] = emit(Opcode::Param, type, {}, static_cast<uint32_t>(i));
+                locals.push_back(&decl->params[i]);
+            }
+            statement(decl->body.get());
+            if (open)
+                emit(decl->returnType == Type::Void ? Opcode::Ret : Opcode::Unreachable, TypeTable::primitive(Type::Void), {});
+        }
+
+        void lowerInit(const ASTNode *root)
+        {
+            fn = &module.functions.emplace_back();
+            fn->name = IRModule::InitFunction;
+            fn->result = TypeTable::primitive(Type::Void);
+            defs.clear();
+            locals.clear();
+
+            startBlock();
+            statement(root);
+            if (open)
+                emit(Opcode::Ret, TypeTable::primitive(Type::Void), {});
+            // Nothing to initialize: leave the function out.
+            if (fn->instructions.size() == 1)
+                module.functions.pop_back();
+        }
+    };
+}
+
+IRModule lowerToIR(const ASTNode *root, const TypeTable &types)
+{
+    IRModule module;
+    Lowerer lowerer(types, module);
+    lowerer.collect(root, "");
+    lowerer.nameOverloads();
+    module.functions.reserve(lowerer.functions.size() + 1);
+    for (const auto &[decl, name] : lowerer.functions)
+        lowerer.lowerFunction(decl, name);
+    // Last, so that function indices match the order of declarations.
+    lowerer.lowerInit(root);
+    return module;
+}
+
+namespace
+{
+    void printConstant(const LiteralValue &value, std::ostream &out)
+    {
+        std::visit([&](const auto &v)
+                   {
+            using V = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<V, std::string>)
+                out << std::quoted(v);
+            else if constexpr (std::is_same_v<V, bool>)
+                out << (v ? "true" : "false");
+            else if constexpr (std::is_same_v<V, float>)
+                out << std::setprecision(9) << v;
+            else if constexpr (std::is_same_v<V, double>)
+                out << std::setprecision(17) << v;
+            else
+                out << +v; },
+                   value);
+    }
+
+    void printInstruction(const IRModule &module, const IRFunction &fn, const TypeTable &types, ValueId id, std::ostream &out)
+    {
+        const IRInstruction &inst = fn.instructions[id];
+        const uint32_t *ops = fn.operandsOf(inst);
+        out << "    ";
+        bool defines = inst.type != TypeTable::primitive(Type::Void);
+        if (defines)
+            out << '%' << id << " = ";
+        out << opcodeName(inst.op);
+
+        switch (inst.op)
+        {
+        case Opcode::Const:
+            out << ' ';
+            printConstant(module.constants[inst.immediate], out);
+            break;
+        case Opcode::Param:
+            out << ' ' << inst.immediate;
+            break;
+        case Opcode::Load:
+            out << " @" << module.globals[inst.immediate].name;
+            break;
+        case Opcode::Store:
+            out << " @" << module.globals[inst.immediate].name << ", %" << ops[0];
+            break;
+        case Opcode::Call:
+            out << " @" << module.functions[inst.immediate].name << '(';
+            for (uint16_t i = 0; i < inst.operandCount; ++i)
+                out << (i ? ", %" : "%") << ops[i];
+            out << ')';
+            break;
+        case Opcode::Phi:
+            for (uint16_t i = 0; i < inst.operandCount; i += 2)
+                out << (i ? ", " : " ") << "[bb" << ops[i] << ": %" << ops[i + 1] << ']';
+            break;
+        case Opcode::Br:
+            out << " bb" << ops[0];
+            break;
+        case Opcode::CondBr:
+            out << " %" << ops[0] << ", bb" << ops[1] << ", bb" << ops[2];
+            break;
+        default:
+            for (uint16_t i = 0; i < inst.operandCount; ++i)
+                out << (i ? ", %" : " %") << ops[i];
+            break;
+        }
+
+        if (defines)
+            out << " : " << types.name(inst.type);
+        out << '\n';
+    }
+}
+
+void printIR(const IRModule &module, const TypeTable &types, std::ostream &out)
+{
+    for (const auto &global : module.globals)
+        out << "global @" << global.name << " : " << types.name(global.type) << '\n';
+
+    for (const auto &fn : module.functions)
+    {
+        if (&fn != &module.functions.front() || !module.globals.empty())
+            out << '\n';
+        out << "function @" << fn.name << '(';
+        for (size_t i = 0; i < fn.params.size(); ++i)
+            out << (i ? ", " : "") << types.name(fn.params[i]);
+        out << ") " << types.name(fn.result) << " {\n";
+        for (BlockId b = 0; b < fn.blocks.size(); ++b)
+        {
+            out << "bb" << b << ":\n";
+            for (ValueId id = fn.blocks[b].first; id < fn.blocks[b].end; ++id)
+                printInstruction(module, fn, types, id, out);
+        }
+        out << "}\n";
+    }
+}
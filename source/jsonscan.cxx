@@ -0,0 +1,251 @@
+#include <charconv>
+#include <cstring>
+#include <jsonscan.hxx>
+
+namespace
+{
+    int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    void appendUtf8(std::string &out, uint32_t cp)
+    {
+        if (cp < 0x80)
+            out += static_cast<char>(cp);
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+}
+
+void JsonScanner::whitespace()
+{
+    while (at < text.size() && (text[at] == ' ' || text[at] == '\n' || text[at] == '\r' || text[at] == '\t'))
+        ++at;
+}
+
+bool JsonScanner::consume(char c)
+{
+    whitespace();
+    if (at < text.size() && text[at] == c)
+    {
+        ++at;
+        return true;
+    }
+    return false;
+}
+
+bool JsonScanner::skipString()
+{
+    // at is on the opening quote.
+    for (++at; at < text.size(); ++at)
+    {
+        if (text[at] == '\\')
+            ++at;
+        else if (text[at] == '"')
+        {
+            ++at;
+            return true;
+        }
+    }
+    return fail();
+}
+
+bool JsonScanner::key(std::string_view &out)
+{
+    whitespace();
+    if (at >= text.size() || text[at] != '"')
+        return fail();
+    size_t start = at + 1;
+    if (!skipString())
+        return false;
+    out = text.substr(start, at - 1 - start);
+    if (out.find('\\') == std::string_view::npos)
+        return true;
+
+    at = start - 1;
+    if (!string(keyBuffer))
+        return false;
+    out = keyBuffer;
+    return true;
+}
+
+std::string_view JsonScanner::raw()
+{
+    whitespace();
+    if (at >= text.size())
+    {
+        fail();
+        return {};
+    }
+
+    size_t start = at;
+    char c = text[at];
+    if (c == '"')
+    {
+        if (!skipString())
+            return {};
+    }
+    else if (c == '{' || c == '[')
+    {
+        size_t depth = 0;
+        while (at < text.size())
+        {
+            c = text[at];
+            if (c == '"')
+            {
+                if (!skipString())
+                    return {};
+                continue;
+            }
+            ++at;
+            if (c == '{' || c == '[')
+                ++depth;
+            else if ((c == '}' || c == ']') && --depth == 0)
+                break;
+        }
+        if (depth != 0)
+        {
+            fail();
+            return {};
+        }
+    }
+    else
+    {
+        while (at < text.size() && !std::strchr(",}] \t\r\n", text[at]))
+            ++at;
+        if (at == start)
+        {
+            fail();
+            return {};
+        }
+    }
+    return text.substr(start, at - start);
+}
+
+bool JsonScanner::string(std::string &out)
+{
+    out.clear();
+    whitespace();
+    if (at >= text.size() || text[at] != '"')
+        return fail();
+    ++at;
+
+    while (true)
+    {
+        // Copy the run up to the next quote or escape in one go.
+        size_t run = at;
+        while (run < text.size() && text[run] != '"' && text[run] != '\\')
+            ++run;
+        out.append(text.data() + at, run - at);
+        at = run;
+        if (at >= text.size())
+            return fail();
+        if (text[at++] == '"')
+            return true;
+        if (at >= text.size())
+            return fail();
+
+        char escape = text[at++];
+        switch (escape)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            out += escape;
+            break;
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'u':
+        {
+            auto unit = [&](uint32_t &value) {
+                if (at + 4 > text.size())
+                    return false;
+                value = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    int digit = hexDigit(text[at++]);
+                    if (digit < 0)
+                        return false;
+                    value = value << 4 | static_cast<uint32_t>(digit);
+                }
+                return true;
+            };
+            uint32_t cp;
+            if (!unit(cp))
+                return fail();
+            // A high surrogate followed by a low one encodes one code point;
+            // unpaired surrogates become U+FFFD.
+            if (cp >= 0xD800 && cp < 0xDC00)
+            {
+                uint32_t low;
+                if (at + 6 <= text.size() && text[at] == '\\' && text[at + 1] == 'u')
+                {
+                    size_t save = at;
+                    at += 2;
+                    if (unit(low) && low >= 0xDC00 && low < 0xE000)
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    else
+                    {
+                        at = save;
+                        cp = 0xFFFD;
+                    }
+                }
+                else
+                    cp = 0xFFFD;
+            }
+            else if (cp >= 0xDC00 && cp < 0xE000)
+                cp = 0xFFFD;
+            appendUtf8(out, cp);
+            break;
+        }
+        default:
+            return fail();
+        }
+    }
+}
+
+bool JsonScanner::integer(int64_t &out)
+{
+    whitespace();
+    auto [end, ec] = std::from_chars(text.data() + at, text.data() + text.size(), out);
+    if (ec != std::errc())
+        return fail();
+    at = static_cast<size_t>(end - text.data());
+    return true;
+}
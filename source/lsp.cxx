@@ -1,91 +1,1238 @@
-#include <iostream>
-#include <token.hxx>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <parser.hxx>
 #include <lsp.hxx>
+#include <resolver.hxx>
+#include <source.hxx>
+#include <types.hxx>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace
+{
+    // JSON-RPC and LSP error codes.
+    constexpr int JsonParseError = -32700;
+    constexpr int MethodNotFound = -32601;
+    constexpr int InternalError = -32603;
+    constexpr int RequestCancelled = -32800;
+    constexpr int ContentModified = -32801;
+
+    // Most completion items sent for one request.
+    constexpr size_t CompletionLimit = 50;
+
+    // Most symbols sent for one workspace/symbol query.
+    constexpr size_t WorkspaceSymbolLimit = 100;
+
+    // Size cap of the cache holding the declarations of workspace files.
+    constexpr uint64_t SymbolCacheBytes = uint64_t{64} << 20;
+
+    uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    json error(int code, const std::string &message)
+    {
+        return {{"error", {{"code", code}, {"message", message}}}};
+    }
+
+    /**
+     * Byte offset of an LSP position in a document.
+     */
+    size_t offsetOf(const Rope &text, const json &position)
+    {
+        return text.offsetAt(position.value("line", size_t{0}), position.value("character", size_t{0}));
+    }
+
+    /**
+     * Read an LSP position, leaving absent fields at 0.
+     */
+    bool readPosition(JsonScanner &scanner, int64_t &line, int64_t &character)
+    {
+        line = character = 0;
+        return scanner.object([&](std::string_view key) {
+            if (key == "line")
+                scanner.integer(line);
+            else if (key == "character")
+                scanner.integer(character);
+        });
+    }
+
+    size_t offsetOf(const Rope &text, int64_t line, int64_t character)
+    {
+        return text.offsetAt(static_cast<size_t>(std::max<int64_t>(0, line)), static_cast<size_t>(std::max<int64_t>(0, character)));
+    }
+
+    /**
+     * The `textDocument` of some params: its URI and, if it has one, version.
+     */
+    bool readTextDocument(std::string_view params, std::string &uri, int64_t *version = nullptr, std::string *text = nullptr)
+    {
+        JsonScanner scanner(params);
+        scanner.object([&](std::string_view key) {
+            if (key != "textDocument")
+                return;
+            scanner.object([&](std::string_view field) {
+                if (field == "uri")
+                    scanner.string(uri);
+                else if (field == "version" && version)
+                    scanner.integer(*version);
+                else if (field == "text" && text)
+                    scanner.string(*text);
+            });
+        });
+        return scanner.ok();
+    }
+
+    /**
+     * Path of a `file://` URI, or an empty path for other schemes.
+     */
+    std::filesystem::path pathOf(std::string_view uri)
+    {
+        constexpr std::string_view scheme = "file://";
+        if (uri.substr(0, scheme.size()) != scheme)
+            return {};
+        uri.remove_prefix(scheme.size());
+        std::string path;
+        for (size_t i = 0; i < uri.size(); ++i)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+                std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+            {
+                path += static_cast<char>(std::stoi(std::string(uri.substr(i + 1, 2)), nullptr, 16));
+                i += 2;
+            }
+            else
+                path += uri[i];
+        }
+#if defined(_WIN32)
+        // file:///c:/src names c:/src.
+        if (path.size() > 2 && path[0] == '/' && path[2] == ':')
+            path.erase(0, 1);
+#endif
+        return std::filesystem::path(path);
+    }
+
+    std::string uriOf(const std::filesystem::path &path)
+    {
+        std::string text = path.generic_string();
+        std::string uri = text.empty() || text[0] != '/' ? "file:///" : "file://";
+        for (char c : text)
+        {
+            auto byte = static_cast<unsigned char>(c);
+            if (std::isalnum(byte) || std::strchr("/-._~", c))
+                uri += c;
+            else
+            {
+                char escaped[4];
+                std::snprintf(escaped, sizeof(escaped), "%%%02X", byte);
+                uri += escaped;
+            }
+        }
+        return uri;
+    }
+
+    /**
+     * Where workspace declarations are cached: the `cacheDir` initialization
+     * option, else the user's cache directory.
+     */
+    std::filesystem::path symbolCacheDir(const json &params)
+    {
+        if (auto options = params.find("initializationOptions"); options != params.end() && options->is_object())
+            if (auto dir = options->find("cacheDir"); dir != options->end() && dir->is_string())
+                return dir->get<std::string>();
+        if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+            return std::filesystem::path(xdg) / "vsharp";
+        if (const char *home = std::getenv("HOME"); home && *home)
+            return std::filesystem::path(home) / ".cache" / "vsharp";
+        if (const char *local = std::getenv("LOCALAPPDATA"); local && *local)
+            return std::filesystem::path(local) / "vsharp";
+        return {};
+    }
+
+    /**
+     * LSP's SymbolKind of a declaration, which numbers kinds differently from
+     * completion items.
+     */
+    int lspSymbolKind(SymbolKind kind)
+    {
+        switch (kind)
+        {
+        case SymbolKind::Class:
+            return 5;
+        case SymbolKind::Method:
+            return 6;
+        case SymbolKind::Field:
+            return 8;
+        case SymbolKind::Function:
+            return 12;
+        case SymbolKind::Constant:
+            return 14;
+        default:
+            return 13;
+        }
+    }
+
+    /**
+     * LSP position of a byte offset: its line, and UTF-16 code units into it.
+     */
+    json positionOf(std::string_view text, const LineTable &lines, uint32_t offset)
+    {
+        offset = std::min(offset, static_cast<uint32_t>(text.size()));
+        return {{"line", lines.resolve(offset).line - 1}, {"character", lines.utf16Column(text, offset)}};
+    }
+
+    /**
+     * Parse, resolve and type check a document, stopping between passes once
+     * the token is cancelled. Like the compiler, types are only checked when
+     * names resolve. The resolved tree is left indexed in `index`.
+     */
+    json diagnose(const std::string &uri, std::string text, const CancellationToken &token, std::shared_ptr<const DocumentIndex> &index)
+    {
+        std::vector<Diagnostic> found;
+        Lexer lexer(std::move(text), uri);
+        ASTNodePtr root;
+        try
+        {
+            Parser parser(lexer);
+            root = parser.parserProgram();
+        }
+        catch (const ParseError &e)
+        {
+            found.push_back({Severity::Error, e.span, e.what()});
+        }
+        catch (const std::exception &e)
+        {
+            found.push_back({Severity::Error, SourceSpan{}, e.what()});
+        }
+        auto hasErrors = [&] {
+            return std::any_of(found.begin(), found.end(), [](const Diagnostic &d) { return d.severity == Severity::Error; });
+        };
+        if (root && !token.cancelled())
+            resolveNames(root.get(), found);
+        if (root && !hasErrors() && !token.cancelled())
+        {
+            // One thread: the interactive lane keeps the rest.
+            TypeTable types;
+            checkTypes(root.get(), types, found, 1);
+        }
+
+        const std::string &source = lexer.Source;
+        LineTable lines(source);
+        json diagnostics = json::array();
+        for (const Diagnostic &d : found)
+            diagnostics.push_back({{"range", {{"start", positionOf(source, lines, d.span.begin)}, {"end", positionOf(source, lines, std::max(d.span.begin, d.span.end))}}},
+                                   {"severity", static_cast<int>(d.severity) + 1},
+                                   {"source", "vsharp"},
+                                   {"message", d.message}});
+        index = std::make_shared<const DocumentIndex>(std::move(lexer.Source), std::move(root));
+        return diagnostics;
+    }
+
+    json rangeOf(const DocumentIndex &doc, const NameUse &name)
+    {
+        return {{"start", positionOf(doc.text, doc.lines, name.begin)}, {"end", positionOf(doc.text, doc.lines, name.end)}};
+    }
+
+    json locationOf(const WorkspaceIndex &workspace, const WorkspaceReference &r)
+    {
+        return {{"uri", uriOf(workspace.files[r.file])},
+                {"range", {{"start", {{"line", r.line}, {"character", r.character}}}, {"end", {{"line", r.line}, {"character", r.endCharacter}}}}}};
+    }
+
+    /**
+     * The name at the position of some params, if there is one.
+     */
+    std::optional<NameUse> nameAt(const DocumentIndex &doc, const json &params)
+    {
+        json position = params.value("position", json::object());
+        auto line = position.value("line", int64_t{0});
+        auto character = position.value("character", int64_t{0});
+        if (line < 0 || character < 0)
+            return std::nullopt;
+        return doc.nameAt(doc.lines.utf16Offset(doc.text, static_cast<uint32_t>(std::min<int64_t>(line, UINT32_MAX)),
+                                                static_cast<uint32_t>(std::min<int64_t>(character, UINT32_MAX))));
+    }
+}
+
+LSPServer::LSPServer(std::unique_ptr<ByteSource> source, std::unique_ptr<ByteSink> sink, unsigned workers)
+    : source(std::move(source)), sink(std::move(sink)), workers(workers ? workers : std::max(1u, std::thread::hardware_concurrency()))
+{
+    onRequest("initialize", [this](const json &params, const CancellationToken &) { return handleInitialize(params); });
+    onRequest("shutdown", [this](const json &params, const CancellationToken &) { return handleShutDown(params); });
+    onRequest("textDocument/completion", [this](const json &params, const CancellationToken &) { return handleCompletion(params); });
+    onRequest("textDocument/semanticTokens/full", [this](const json &params, const CancellationToken &) { return handleSemanticTokens(params, false); });
+    onRequest("textDocument/semanticTokens/full/delta", [this](const json &params, const CancellationToken &) { return handleSemanticTokens(params, true); });
+    // These may wait for the workspace index, so they never hold a worker completion needs.
+    onRequest("workspace/symbol", [this](const json &params, const CancellationToken &token) { return handleWorkspaceSymbol(params, token); }, Lane::Background);
+    onRequest("textDocument/definition", [this](const json &params, const CancellationToken &token) { return handleDefinition(params, token); }, Lane::Background);
+    onRequest("textDocument/references", [this](const json &params, const CancellationToken &token) { return handleReferences(params, token); }, Lane::Background);
+    onRequest("textDocument/hover", [this](const json &params, const CancellationToken &) { return handleHover(params); });
+    onRequest("vsharp/stats", [this](const json &, const CancellationToken &) { return statsReport(); });
+    onNotification("textDocument/didOpen", [this](std::string_view params) { handleDidOpen(params); });
+    onNotification("textDocument/didChange", [this](std::string_view params) { handleDidChange(params); });
+    onNotification("textDocument/didClose", [this](std::string_view params) { handleDidClose(params); });
+    onNotification("textDocument/didSave", [this](std::string_view params) { handleDidSave(params); });
+    onNotification("workspace/didChangeWatchedFiles", [this](std::string_view params) { handleDidChangeWatchedFiles(params); });
+    onNotification("$/cancelRequest", [this](std::string_view params) { handleCancel(params); });
+    stats.try_emplace("textDocument/publishDiagnostics");
+}
+
+LSPServer::LSPServer(unsigned workers)
+    : LSPServer(std::make_unique<FileSource>(0), std::make_unique<FileSink>(1), workers)
+{
+#if defined(_WIN32)
+    // Content-Length counts bytes; text mode would translate line breaks.
+    _setmode(0, _O_BINARY);
+    _setmode(1, _O_BINARY);
+#endif
+}
+
+LSPServer::LSPServer(std::istream &in, std::ostream &out, unsigned workers)
+    : LSPServer(std::make_unique<StreamSource>(in), std::make_unique<StreamSink>(out), workers)
+{
+}
+
+LSPServer::~LSPServer()
+{
+    // Only left running if runLSP threw.
+    stopIndexing();
+    {
+        std::lock_guard<std::mutex> lock(analysisMutex);
+        analysisStopping = true;
+    }
+    analysisReady.notify_all();
+    if (analyzer.joinable())
+        analyzer.join();
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    for (Queue &queue : lanes)
+    {
+        queue.ready.notify_all();
+        for (auto &thread : queue.threads)
+            if (thread.joinable())
+                thread.join();
+    }
+    if (indexer.joinable())
+        indexer.join();
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        closing = true;
+    }
+    outboxReady.notify_all();
+    if (writer.joinable())
+        writer.join();
+}
+
+void LSPServer::onRequest(const std::string &method, RequestHandler handler, Lane lane)
+{
+    requests[method] = Route{std::move(handler), lane};
+    stats.try_emplace(method);
+}
+
+void LSPServer::onNotification(const std::string &method, NotificationHandler handler)
+{
+    notifications[method] = std::move(handler);
+    stats.try_emplace(method);
+}
 
 void LSPServer::runLSP()
+{
+    writer = std::thread([this] { write(); });
+    analyzer = std::thread([this] { analyze(); });
+    for (unsigned i = 0; i < workers; ++i)
+        lanes[static_cast<int>(Lane::Interactive)].threads.emplace_back([this] { work(lanes[static_cast<int>(Lane::Interactive)]); });
+    lanes[static_cast<int>(Lane::Background)].threads.emplace_back([this] { work(lanes[static_cast<int>(Lane::Background)]); });
+
+    MessageReader reader(*source);
+    std::string_view body;
+    Message message;
+    while (reader.next(body))
+    {
+        message.id = message.params = {};
+        message.method.clear();
+        message.size = body.size();
+        JsonScanner scanner(body);
+        bool wellFormed = scanner.object([&](std::string_view key) {
+            if (key == "method")
+                scanner.string(message.method);
+            else if (key == "id")
+                message.id = scanner.raw();
+            else if (key == "params")
+                message.params = scanner.raw();
+        });
+        if (!wellFormed)
+            continue;
+        if (message.method == "exit")
+            break;
+        dispatch(message);
+    }
+
+    // Analyses still waiting are dropped; one running is cut short, and so
+    // is indexing.
+    stopIndexing();
+    {
+        std::lock_guard<std::mutex> lock(analysisMutex);
+        analysisStopping = true;
+        if (analysisToken)
+            analysisToken->state = CancellationToken::Cancelled;
+    }
+    analysisReady.notify_all();
+    analyzer.join();
+
+    // Answer everything already queued, then flush the answers.
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    for (Queue &queue : lanes)
+    {
+        queue.ready.notify_all();
+        for (auto &thread : queue.threads)
+            thread.join();
+        queue.threads.clear();
+    }
+    if (indexer.joinable())
+        indexer.join();
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        closing = true;
+    }
+    outboxReady.notify_all();
+    writer.join();
+
+    if (statsLog)
+        *statsLog << statsReport().dump(2) << std::endl;
+}
+
+void LSPServer::dispatch(const Message &message)
+{
+    auto arrived = std::chrono::steady_clock::now();
+    MethodStats *measured = nullptr;
+    if (auto it = stats.find(message.method); it != stats.end())
+    {
+        measured = &it->second;
+        measured->bytesIn.fetch_add(message.size, std::memory_order_relaxed);
+    }
+
+    if (message.id.empty())
+    {
+        if (auto it = notifications.find(message.method); it != notifications.end())
+        {
+            it->second(message.params);
+            if (measured)
+                measured->latency.record(nanosecondsSince(arrived));
+        }
+        return;
+    }
+    // A response to a request of ours.
+    if (message.method.empty())
+        return;
+
+    json id = json::parse(message.id, nullptr, false);
+    if (id.is_discarded())
+        return;
+
+    auto route = requests.find(message.method);
+    if (route == requests.end())
+    {
+        json response = error(MethodNotFound, "method not found: " + message.method);
+        response["jsonrpc"] = "2.0";
+        response["id"] = std::move(id);
+        sendMessage(response);
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->id = std::move(id);
+    job->method = message.method;
+    job->params = message.params;
+    job->stats = measured;
+    job->arrived = arrived;
+    if (readTextDocument(message.params, job->uri) && !job->uri.empty())
+    {
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        if (auto doc = documents.find(job->uri); doc != documents.end())
+            job->version = doc->second.version;
+    }
+
+    Queue &queue = lanes[static_cast<int>(route->second.lane)];
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        pending[job->id.dump()] = job;
+        queue.jobs.push_back(job);
+    }
+    queue.ready.notify_one();
+}
+
+void LSPServer::work(Queue &queue)
 {
     while (true)
     {
-        std::string msg = readMessage();
-        if (msg.empty())
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            queue.ready.wait(lock, [&] { return stopping || !queue.jobs.empty(); });
+            if (queue.jobs.empty())
+                return;
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        if (job->stats)
+            job->stats->queueWait.record(nanosecondsSince(job->arrived));
+
+        json response;
+        json params = job->params.empty() ? json::object() : json::parse(job->params, nullptr, false);
+        if (params.is_discarded())
+            response = error(JsonParseError, "malformed params");
+        else if (!job->token.cancelled())
+        {
+            try
+            {
+                response["result"] = requests.at(job->method).handler(params, job->token);
+            }
+            catch (const std::exception &e)
+            {
+                response = error(InternalError, e.what());
+            }
+        }
+        finish(job, std::move(response));
+    }
+}
+
+void LSPServer::finish(const std::shared_ptr<Job> &job, json response)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        // Already answered, e.g. cancelled while queued.
+        if (pending.erase(job->id.dump()) == 0)
+            return;
+    }
+    switch (job->token.state.load())
+    {
+    case CancellationToken::Cancelled:
+        response = error(RequestCancelled, "request cancelled");
+        break;
+    case CancellationToken::Stale:
+        response = error(ContentModified, "document changed");
+        break;
+    default:
+        break;
+    }
+    response["jsonrpc"] = "2.0";
+    response["id"] = job->id;
+    sendMessage(response, job->stats, job->arrived);
+}
+
+void LSPServer::sendMessage(const json &message, MethodStats *measured, std::chrono::steady_clock::time_point since)
+{
+    std::string s = message.dump();
+    // Counted before it is queued, so a client that has seen a message finds
+    // it in the stats.
+    if (measured)
+    {
+        measured->bytesOut.fetch_add(s.size(), std::memory_order_relaxed);
+        measured->latency.record(nanosecondsSince(since));
+    }
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        outbox.push_back(std::move(s));
+    }
+    outboxReady.notify_one();
+}
+
+void LSPServer::write()
+{
+    MessageWriter framer(*sink);
+    std::deque<std::string> batch;
+    bool open = true;
+    std::unique_lock<std::mutex> lock(outboxMutex);
+    while (true)
+    {
+        outboxReady.wait(lock, [&] { return closing || !outbox.empty(); });
+        if (outbox.empty())
+            return;
+        batch.swap(outbox);
+        lock.unlock();
+        // Once the client is gone, responses are dropped.
+        open = open && framer.write(batch);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void LSPServer::scheduleAnalysis(const std::string &uri)
+{
+    {
+        std::lock_guard<std::mutex> lock(analysisMutex);
+        // Pushing the deadline back coalesces a burst of edits into one analysis.
+        dueAnalyses[uri] = std::chrono::steady_clock::now() + diagnosticsDelay;
+        if (analyzing == uri)
+            analysisToken->state = CancellationToken::Stale;
+    }
+    analysisReady.notify_one();
+}
+
+void LSPServer::analyze()
+{
+    std::unique_lock<std::mutex> lock(analysisMutex);
+    while (!analysisStopping)
+    {
+        auto next = std::min_element(dueAnalyses.begin(), dueAnalyses.end(), [](const auto &a, const auto &b)
+                                     { return a.second < b.second; });
+        if (next == dueAnalyses.end())
+        {
+            analysisReady.wait(lock);
+            continue;
+        }
+        if (next->second > std::chrono::steady_clock::now())
+        {
+            analysisReady.wait_until(lock, next->second);
             continue;
+        }
+
+        std::string uri = next->first;
+        dueAnalyses.erase(next);
+        auto analysisStart = std::chrono::steady_clock::now();
+        CancellationToken token;
+        analyzing = uri;
+        analysisToken = &token;
+        lock.unlock();
+
+        // Edits from here on cancel the token, so the snapshot is never newer
+        // than what gets published for it.
+        std::string text;
+        int64_t version = 0;
+        bool open = false;
+        {
+            std::lock_guard<std::mutex> documentsLock(documentsMutex);
+            if (auto it = documents.find(uri); it != documents.end())
+            {
+                text = it->second.text.text();
+                version = it->second.version;
+                open = true;
+            }
+        }
+        std::shared_ptr<const DocumentIndex> index;
+        json diagnostics = open ? diagnose(uri, std::move(text), token, index) : json::array();
+        if (index && !token.cancelled())
+        {
+            std::lock_guard<std::mutex> documentsLock(documentsMutex);
+            if (auto it = documents.find(uri); it != documents.end() && it->second.version == version)
+            {
+                it->second.analysis = std::move(index);
+                it->second.analyzedVersion = version;
+            }
+        }
 
-        json request = json::parse(msg, nullptr, false);
-        if (request.is_discarded())
+        lock.lock();
+        analyzing.clear();
+        analysisToken = nullptr;
+        if (!open || token.cancelled())
             continue;
 
-        std::string method = request.value("method", "");
-        if (method == "initialize")
-            handleInitialize(request);
-        else if (method == "textDocument/completion")
-            handleCompletion(request);
-        else if (method == "shutdown")
-            handleShutDown(request);
-        else if (method == "exit")
-            break;
+        // Only changed sets are sent; a client that has none needs no empty one.
+        std::string dumped = diagnostics.dump();
+        auto last = published.find(uri);
+        if (last == published.end() ? diagnostics.empty() : last->second == dumped)
+            continue;
+        published[uri] = std::move(dumped);
+        sendMessage({{"jsonrpc", "2.0"},
+                     {"method", "textDocument/publishDiagnostics"},
+                     {"params", {{"uri", uri}, {"version", version}, {"diagnostics", std::move(diagnostics)}}}},
+                    &stats.at("textDocument/publishDiagnostics"), analysisStart);
     }
 }
 
-int LSPServer::readContentLength()
+json LSPServer::handleCompletion(const json &params)
 {
-    std::string line;
-    int contentLength = 0;
-    while (std::getline(std::cin, line) && line != "\r" && !line.empty())
+    static const SymbolIndex keywordsOnly;
+
+    std::string uri;
+    if (params.contains("textDocument"))
+        uri = params["textDocument"].value("uri", "");
+    std::shared_ptr<const SymbolIndex> index;
+    std::string before;
+    uint32_t offset = 0;
+    bool reindex = false;
+    std::string text;
+    int64_t version = 0;
     {
-        if (line.substr(0, 15) == "Content-Length:")
-            contentLength = std::stoi(line.substr(15));
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        if (auto it = documents.find(uri); it != documents.end())
+        {
+            Document &doc = it->second;
+            json position = params.value("position", json::object());
+            size_t at = offsetOf(doc.text, position);
+            size_t lineStart = std::min(at, doc.text.lineStart(position.value("line", size_t{0})));
+            before = doc.text.substr(lineStart, at - lineStart);
+            offset = static_cast<uint32_t>(at);
+            index = doc.symbols;
+            if (doc.indexedVersion != doc.version)
+            {
+                reindex = true;
+                text = doc.text.text();
+                version = doc.indexedVersion = doc.version;
+            }
+        }
     }
-    return contentLength;
+
+    // Parse outside the lock; notifications keep being applied meanwhile.
+    if (reindex)
+    {
+        try
+        {
+            Lexer lexer(std::move(text), uri);
+            Parser parser(lexer);
+            ASTNodePtr root = parser.parserProgram();
+            index = std::make_shared<const SymbolIndex>(root.get());
+
+            std::lock_guard<std::mutex> lock(documentsMutex);
+            if (auto it = documents.find(uri); it != documents.end() && it->second.indexedVersion == version)
+                it->second.symbols = index;
+        }
+        catch (const std::exception &)
+        {
+            // Half-typed code; the last index that parsed stays in use.
+        }
+    }
+
+    CompletionQuery query = completionQuery(before, offset);
+    query.limit = CompletionLimit;
+    Completions completions = (index ? *index : keywordsOnly).complete(query);
+
+    json items = json::array();
+    for (size_t i = 0; i < completions.items.size(); ++i)
+    {
+        const Symbol *symbol = completions.items[i];
+        // Clients sort by sortText, so it carries the rank.
+        char rank[24];
+        std::snprintf(rank, sizeof(rank), "%04zu", i);
+        items.push_back({{"label", symbol->name},
+                         {"kind", static_cast<int>(symbol->kind)},
+                         {"detail", symbol->detail},
+                         {"sortText", rank}});
+    }
+    return {{"isIncomplete", completions.incomplete}, {"items", std::move(items)}};
 }
 
-std::string LSPServer::readMessage()
+void LSPServer::indexWorkspace(std::vector<std::filesystem::path> roots, std::filesystem::path cacheDir)
 {
-    int len = readContentLength();
-    std::string msg(len, '\0');
-    std::cin.read(&msg[0], len);
-    return msg;
+    std::optional<ArtifactCache> cache;
+    if (!cacheDir.empty())
+    {
+        try
+        {
+            cache.emplace(cacheDir, SymbolCacheBytes);
+        }
+        catch (const std::exception &)
+        {
+            // Without a cache every start parses every file.
+        }
+    }
+    auto index = std::make_shared<WorkspaceIndex>();
+    index->build(roots, cache ? &*cache : nullptr, 0, &indexStop);
+    std::shared_ptr<const WorkspaceIndex> current = index;
+    {
+        std::lock_guard<std::mutex> lock(workspaceMutex);
+        workspace = std::move(index);
+        indexing = false;
+    }
+    workspaceReady.notify_all();
+
+    // Changed files are indexed into a copy, which then replaces the index;
+    // requests already holding the old one keep it.
+    while (true)
+    {
+        std::vector<std::filesystem::path> changed;
+        {
+            std::unique_lock<std::mutex> lock(workspaceMutex);
+            workspaceChanged.wait(lock, [&] { return indexStop || !changedFiles.empty(); });
+            if (indexStop)
+                return;
+            changed.swap(changedFiles);
+        }
+        auto next = std::make_shared<WorkspaceIndex>(*current);
+        next->update(changed, cache ? &*cache : nullptr);
+        current = next;
+        std::lock_guard<std::mutex> lock(workspaceMutex);
+        workspace = std::move(next);
+    }
 }
 
-void LSPServer::sendMessage(const json &response)
+void LSPServer::reindex(std::string_view uri)
 {
-    std::string s = response.dump();
-    std::cout << "Content-Length: " << s.size() << "\r\n\r\n"
-              << s;
-    std::cout.flush();
+    std::filesystem::path path = pathOf(uri);
+    if (path.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(workspaceMutex);
+        // Without workspace folders there is nothing to keep current.
+        if (!indexing && !workspace)
+            return;
+        changedFiles.push_back(std::move(path));
+    }
+    workspaceChanged.notify_one();
 }
 
-void LSPServer::handleCompletion(const json &request)
+void LSPServer::stopIndexing()
 {
-    json response;
-    response["jsonrpc"] = "2.0";
-    response["id"] = request["id"];
-    response["result"] = json::array();
+    {
+        std::lock_guard<std::mutex> lock(workspaceMutex);
+        indexStop = true;
+    }
+    workspaceChanged.notify_all();
+}
 
-    for (const auto &kv : keywords)
+std::shared_ptr<const WorkspaceIndex> LSPServer::workspaceIndex(const CancellationToken &token)
+{
+    // Until the first index is built, wait for it rather than answer empty.
+    std::unique_lock<std::mutex> lock(workspaceMutex);
+    while (indexing && !token.cancelled())
+        workspaceReady.wait_for(lock, std::chrono::milliseconds(50));
+    return workspace;
+}
+
+std::shared_ptr<const DocumentIndex> LSPServer::documentIndex(const std::string &uri)
+{
+    std::string text;
+    int64_t version = 0;
     {
-        response["result"].push_back({{"label", kv.first},
-                                      {"kind", 14},
-                                      {"detail", kv.second}});
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        auto it = documents.find(uri);
+        if (it == documents.end())
+            return nullptr;
+        if (it->second.analyzedVersion == it->second.version)
+            return it->second.analysis;
+        text = it->second.text.text();
+        version = it->second.version;
     }
 
-    sendMessage(response);
+    // The analysis has not caught up with the edits yet; later requests about
+    // this version reuse what is built here.
+    auto index = std::make_shared<const DocumentIndex>(std::move(text));
+    std::lock_guard<std::mutex> lock(documentsMutex);
+    if (auto it = documents.find(uri); it != documents.end() && it->second.version == version)
+    {
+        it->second.analysis = index;
+        it->second.analyzedVersion = version;
+    }
+    return index;
 }
 
-void LSPServer::handleInitialize(const json &request)
+json LSPServer::handleWorkspaceSymbol(const json &params, const CancellationToken &token)
 {
-    json response;
-    response["jsonrpc"] = "2.0";
-    response["id"] = request["id"];
-    response["result"] = {
-        {"capabilities", {{"completionProvider", {{"resolveProvider", false}}}}}};
-    sendMessage(response);
+    std::shared_ptr<const WorkspaceIndex> index = workspaceIndex(token);
+    json symbols = json::array();
+    if (!index)
+        return symbols;
+
+    for (const WorkspaceSymbol *symbol : index->query(params.value("query", ""), WorkspaceSymbolLimit))
+    {
+        json range = {{"start", {{"line", symbol->line}, {"character", symbol->character}}},
+                      {"end", {{"line", symbol->endLine}, {"character", symbol->endCharacter}}}};
+        json item = {{"name", symbol->name},
+                     {"kind", lspSymbolKind(symbol->kind)},
+                     {"location", {{"uri", uriOf(index->files[symbol->file])}, {"range", std::move(range)}}}};
+        if (!symbol->container.empty())
+            item["containerName"] = symbol->container;
+        symbols.push_back(std::move(item));
+    }
+    return symbols;
 }
 
-void LSPServer::handleShutDown(const json &request)
+json LSPServer::handleSemanticTokens(const json &params, bool delta)
 {
-    json response;
-    response["jsonrpc"] = "2.0";
-    response["id"] = request["id"];
-    response["result"] = nullptr;
-    sendMessage(response);
-}
\ No newline at end of file
+    std::string uri;
+    if (params.contains("textDocument"))
+        uri = params["textDocument"].value("uri", "");
+    std::shared_ptr<const std::vector<uint32_t>> previous;
+    std::string previousId;
+    {
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        auto it = documents.find(uri);
+        if (it == documents.end())
+            return nullptr;
+        previous = it->second.semanticTokens;
+        previousId = it->second.semanticResultId;
+    }
+
+    // Identifiers are classified by what they resolve to; text that does not
+    // parse is still highlighted token by token.
+    std::shared_ptr<const DocumentIndex> doc = documentIndex(uri);
+    if (!doc)
+        return nullptr;
+    auto tokens = std::make_shared<const std::vector<uint32_t>>(encodeSemanticTokens(doc->text, doc->root.get()));
+    std::string resultId = std::to_string(++semanticResults);
+    {
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        if (auto it = documents.find(uri); it != documents.end())
+        {
+            it->second.semanticTokens = tokens;
+            it->second.semanticResultId = resultId;
+        }
+    }
+
+    if (delta && previous && params.value("previousResultId", "") == previousId)
+    {
+        SemanticTokensEdit edit = diffSemanticTokens(*previous, *tokens);
+        json edits = json::array();
+        if (edit.deleteCount > 0 || !edit.data.empty())
+            edits.push_back({{"start", edit.start}, {"deleteCount", edit.deleteCount}, {"data", std::move(edit.data)}});
+        return {{"resultId", std::move(resultId)}, {"edits", std::move(edits)}};
+    }
+    return {{"resultId", std::move(resultId)}, {"data", *tokens}};
+}
+
+json LSPServer::handleDefinition(const json &params, const CancellationToken &token)
+{
+    std::string uri;
+    if (params.contains("textDocument"))
+        uri = params["textDocument"].value("uri", "");
+    std::shared_ptr<const DocumentIndex> doc = documentIndex(uri);
+    std::optional<NameUse> name = doc ? nameAt(*doc, params) : std::nullopt;
+    if (!name)
+        return nullptr;
+
+    if (name->binding.decl)
+    {
+        std::optional<NameUse> declared = doc->declaration(name->binding);
+        if (!declared)
+            return nullptr;
+        return {{"uri", uri}, {"range", rangeOf(*doc, *declared)}};
+    }
+
+    // Not declared in this file: whatever the workspace declares by that name.
+    std::string key = doc->key(*name);
+    std::shared_ptr<const WorkspaceIndex> workspace = key.empty() ? nullptr : workspaceIndex(token);
+    json locations = json::array();
+    if (!workspace)
+        return locations;
+    if (auto found = workspace->references.find(key); found != workspace->references.end())
+        for (const WorkspaceReference &r : found->second)
+            if (r.declaration)
+                locations.push_back(locationOf(*workspace, r));
+    return locations;
+}
+
+json LSPServer::handleReferences(const json &params, const CancellationToken &token)
+{
+    std::string uri;
+    if (params.contains("textDocument"))
+        uri = params["textDocument"].value("uri", "");
+    bool withDeclaration = params.value("context", json::object()).value("includeDeclaration", false);
+    std::shared_ptr<const DocumentIndex> doc = documentIndex(uri);
+    std::optional<NameUse> name = doc ? nameAt(*doc, params) : std::nullopt;
+    json locations = json::array();
+    if (!name)
+        return locations;
+
+    std::string key = doc->key(*name);
+    auto add = [&](const NameUse &use) {
+        if (withDeclaration || !use.declaration)
+            locations.push_back({{"uri", uri}, {"range", rangeOf(*doc, use)}});
+    };
+    if (name->binding.decl)
+    {
+        for (const NameUse &use : doc->references(name->binding))
+            add(use);
+    }
+    else
+    {
+        // Unresolved names only match by their text.
+        for (const NameUse &use : doc->names())
+            if (!use.binding.decl && doc->key(use) == key)
+                add(use);
+    }
+    if (key.empty())
+        return locations;
+
+    // Other files, from the reverse-reference map. The open document is
+    // fresher than what was indexed from disk.
+    std::shared_ptr<const WorkspaceIndex> workspace = workspaceIndex(token);
+    if (!workspace)
+        return locations;
+    auto found = workspace->references.find(key);
+    if (found == workspace->references.end())
+        return locations;
+    std::filesystem::path self = pathOf(uri).lexically_normal();
+    for (const WorkspaceReference &r : found->second)
+        if ((withDeclaration || !r.declaration) && workspace->files[r.file].lexically_normal() != self)
+            locations.push_back(locationOf(*workspace, r));
+    return locations;
+}
+
+json LSPServer::handleHover(const json &params)
+{
+    std::string uri;
+    if (params.contains("textDocument"))
+        uri = params["textDocument"].value("uri", "");
+    std::shared_ptr<const DocumentIndex> doc = documentIndex(uri);
+    std::optional<NameUse> name = doc ? nameAt(*doc, params) : std::nullopt;
+    std::string declared = name ? describe(name->binding) : std::string();
+    if (declared.empty())
+        return nullptr;
+    return {{"contents", {{"kind", "markdown"}, {"value", "```vsharp\n" + declared + "\n```"}}},
+            {"range", rangeOf(*doc, *name)}};
+}
+
+json LSPServer::statsReport() const
+{
+    auto summary = [](const Histogram &h) {
+        return json{{"p50", static_cast<double>(h.percentile(50)) / 1e3},
+                    {"p95", static_cast<double>(h.percentile(95)) / 1e3},
+                    {"p99", static_cast<double>(h.percentile(99)) / 1e3},
+                    {"max", static_cast<double>(h.max()) / 1e3},
+                    {"mean", h.mean() / 1e3}};
+    };
+    json methods = json::object();
+    for (const auto &[method, s] : stats)
+    {
+        uint64_t bytesIn = s.bytesIn.load(std::memory_order_relaxed);
+        uint64_t bytesOut = s.bytesOut.load(std::memory_order_relaxed);
+        if (s.latency.count() == 0 && bytesIn == 0 && bytesOut == 0)
+            continue;
+        json entry = {{"count", s.latency.count()}, {"latencyUs", summary(s.latency)}, {"bytesIn", bytesIn}, {"bytesOut", bytesOut}};
+        if (s.queueWait.count() > 0)
+            entry["queueWaitUs"] = summary(s.queueWait);
+        methods[method] = std::move(entry);
+    }
+    return {{"uptimeMs", nanosecondsSince(started) / 1000000}, {"methods", std::move(methods)}};
+}
+
+json LSPServer::handleInitialize(const json &params)
+{
+    std::vector<std::filesystem::path> roots;
+    if (auto folders = params.find("workspaceFolders"); folders != params.end() && folders->is_array())
+    {
+        for (const auto &folder : *folders)
+            if (folder.is_object() && folder.contains("uri") && folder["uri"].is_string())
+                roots.push_back(pathOf(folder["uri"].get<std::string>()));
+    }
+    else if (auto root = params.find("rootUri"); root != params.end() && root->is_string())
+        roots.push_back(pathOf(root->get<std::string>()));
+    else if (auto path = params.find("rootPath"); path != params.end() && path->is_string())
+        roots.push_back(path->get<std::string>());
+    roots.erase(std::remove(roots.begin(), roots.end(), std::filesystem::path()), roots.end());
+
+    std::lock_guard<std::mutex> lock(workspaceMutex);
+    if (!roots.empty() && !indexing && !workspace)
+    {
+        indexing = true;
+        indexer = std::thread(&LSPServer::indexWorkspace, this, std::move(roots), symbolCacheDir(params));
+    }
+
+    return {
+        {"capabilities", {
+            // Open, close and save notifications, and incremental changes.
+            {"textDocumentSync", {{"openClose", true}, {"change", 2}, {"save", {{"includeText", false}}}}},
+            {"completionProvider", {{"resolveProvider", false}, {"triggerCharacters", {"."}}}},
+            {"workspaceSymbolProvider", true},
+            {"definitionProvider", true},
+            {"referencesProvider", true},
+            {"hoverProvider", true},
+            {"semanticTokensProvider", {
+                {"legend", {{"tokenTypes", semanticTokenTypes}, {"tokenModifiers", semanticTokenModifiers}}},
+                {"full", {{"delta", true}}},
+            }},
+        }}};
+}
+
+json LSPServer::handleShutDown(const json &)
+{
+    return nullptr;
+}
+
+void LSPServer::handleDidOpen(std::string_view params)
+{
+    std::string uri;
+    int64_t version = 0;
+    std::string text;
+    if (!readTextDocument(params, uri, &version, &text))
+        return;
+
+    Rope rope(text);
+    {
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        Document &open = documents[uri];
+        open.text = std::move(rope);
+        open.version = version;
+    }
+    scheduleAnalysis(uri);
+}
+
+void LSPServer::handleDidChange(std::string_view params)
+{
+    // Members may come in any order, so find both before applying changes.
+    std::string_view textDocument;
+    std::string_view contentChanges;
+    JsonScanner scanner(params);
+    scanner.object([&](std::string_view key) {
+        if (key == "textDocument")
+            textDocument = scanner.raw();
+        else if (key == "contentChanges")
+            contentChanges = scanner.raw();
+    });
+    std::string uri;
+    int64_t version = -1;
+    JsonScanner document(textDocument);
+    document.object([&](std::string_view key) {
+        if (key == "uri")
+            document.string(uri);
+        else if (key == "version")
+            document.integer(version);
+    });
+    if (!scanner.ok() || !document.ok())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        auto it = documents.find(uri);
+        if (it == documents.end())
+            return;
+        Document &doc = it->second;
+
+        // Changes apply in order, each to the text the previous one left.
+        // Their text is unescaped straight into a reused buffer.
+        std::string text;
+        JsonScanner changes(contentChanges);
+        changes.array([&] {
+            bool ranged = false;
+            int64_t startLine = 0, startCharacter = 0, endLine = 0, endCharacter = 0;
+            changes.object([&](std::string_view key) {
+                if (key == "text")
+                    changes.string(text);
+                else if (key == "range")
+                {
+                    ranged = true;
+                    changes.object([&](std::string_view end) {
+                        if (end == "start")
+                            readPosition(changes, startLine, startCharacter);
+                        else if (end == "end")
+                            readPosition(changes, endLine, endCharacter);
+                    });
+                }
+            });
+            if (!changes.ok())
+                return;
+            if (!ranged)
+            {
+                doc.text = Rope(text);
+                return;
+            }
+            size_t start = offsetOf(doc.text, startLine, startCharacter);
+            size_t end = std::max(start, offsetOf(doc.text, endLine, endCharacter));
+            doc.text.replace(start, end - start, text);
+        });
+        version = doc.version = version >= 0 ? version : doc.version + 1;
+    }
+
+    // Requests about an older version are superseded.
+    std::vector<std::shared_ptr<Job>> stale;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        for (const auto &[id, job] : pending)
+            if (job->uri == uri && job->version < version)
+            {
+                job->token.state = CancellationToken::Stale;
+                stale.push_back(job);
+            }
+        for (Queue &queue : lanes)
+            queue.jobs.erase(std::remove_if(queue.jobs.begin(), queue.jobs.end(), [&](const auto &job)
+                                            { return job->token.cancelled(); }),
+                             queue.jobs.end());
+    }
+    for (const auto &job : stale)
+        finish(job, {});
+    scheduleAnalysis(uri);
+}
+
+void LSPServer::handleDidClose(std::string_view params)
+{
+    std::string uri;
+    if (!readTextDocument(params, uri))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(documentsMutex);
+        documents.erase(uri);
+    }
+    // Edits may have been saved, or dropped, since the file was indexed.
+    reindex(uri);
+
+    // Diagnostics of a closed document are cleared.
+    std::lock_guard<std::mutex> lock(analysisMutex);
+    dueAnalyses.erase(uri);
+    if (analyzing == uri)
+        analysisToken->state = CancellationToken::Cancelled;
+    auto last = published.find(uri);
+    if (last == published.end())
+        return;
+    bool empty = last->second == "[]";
+    published.erase(last);
+    if (!empty)
+        sendMessage({{"jsonrpc", "2.0"},
+                     {"method", "textDocument/publishDiagnostics"},
+                     {"params", {{"uri", uri}, {"diagnostics", json::array()}}}});
+}
+
+void LSPServer::handleDidSave(std::string_view params)
+{
+    std::string uri;
+    if (readTextDocument(params, uri))
+        reindex(uri);
+}
+
+void LSPServer::handleDidChangeWatchedFiles(std::string_view params)
+{
+    // Created, changed and deleted files alike: the index reads what is on disk.
+    JsonScanner scanner(params);
+    scanner.object([&](std::string_view key) {
+        if (key != "changes")
+            return;
+        scanner.array([&] {
+            std::string uri;
+            scanner.object([&](std::string_view field) {
+                if (field == "uri")
+                    scanner.string(uri);
+            });
+            reindex(uri);
+        });
+    });
+}
+
+void LSPServer::handleCancel(std::string_view params)
+{
+    std::string_view id;
+    JsonScanner scanner(params);
+    scanner.object([&](std::string_view key) {
+        if (key == "id")
+            id = scanner.raw();
+    });
+    // Parsed so that the key matches however the client spaced the ID.
+    json parsed = json::parse(id, nullptr, false);
+    if (!scanner.ok() || id.empty() || parsed.is_discarded())
+        return;
+
+    std::shared_ptr<Job> job;
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        auto it = pending.find(parsed.dump());
+        if (it == pending.end())
+            return;
+        job = it->second;
+        job->token.state = CancellationToken::Cancelled;
+        for (Queue &queue : lanes)
+            queue.jobs.erase(std::remove(queue.jobs.begin(), queue.jobs.end(), job), queue.jobs.end());
+    }
+    finish(job, {});
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <fstream>
 #include <map>
 #include <iostream>
 #include <functional>
@@ -22,9 +24,16 @@ int main(int argc, char *argv[])
     {
         printVersion();
     };
-    commands["lsp"] = [](const auto &)
+    commands["lsp"] = [](const auto &args)
     {
+        // `--stats-log <file>` appends what the server measured when it exits.
+        std::ofstream statsLog;
+        auto flag = std::find(args.begin(), args.end(), "--stats-log");
+        if (flag != args.end() && flag + 1 != args.end())
+            statsLog.open(*(flag + 1), std::ios::app);
         LSPServer server;
+        if (statsLog.is_open())
+            server.setStatsLog(&statsLog);
         server.runLSP();
     };
     commands["compile"] = [](const auto &args)
@@ -38,6 +47,17 @@ int main(int argc, char *argv[])
         std::vector<std::string> flags(args.begin() + 1, args.end());
         compileFile(file, flags);
     };
+    commands["run"] = [](const auto &args)
+    {
+        if (args.empty())
+        {
+            std::cerr << "Error: No file provided." << std::endl;
+            exit(1);
+        }
+        std::string file = args[0];
+        std::vector<std::string> flags(args.begin() + 1, args.end());
+        exit(runFile(file, flags));
+    };
 
     std::string command = argv[1];
     std::vector<std::string> args(argv + 2, argv + argc);
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <memstats.hxx>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+#if defined(VSHARP_COUNT_ALLOCATIONS)
+namespace
+{
+    std::atomic<uint64_t> allocCount{0};
+    std::atomic<uint64_t> freeCount{0};
+    std::atomic<uint64_t> allocBytes{0};
+    std::atomic<uint64_t> liveBytes{0};
+    std::atomic<uint64_t> peakBytes{0};
+
+    // Every block carries its size in a header so frees can be accounted for
+    // even when the unsized operator delete is used.
+    constexpr size_t headerSize = alignof(std::max_align_t);
+
+    void *countedAlloc(size_t size) noexcept
+    {
+        void *raw = std::malloc(size + headerSize);
+        if (!raw)
+            return nullptr;
+        *static_cast<size_t *>(raw) = size;
+
+        allocCount.fetch_add(1, std::memory_order_relaxed);
+        allocBytes.fetch_add(size, std::memory_order_relaxed);
+        uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+        return static_cast<char *>(raw) + headerSize;
+    }
+
+    void countedFree(void *ptr) noexcept
+    {
+        if (!ptr)
+            return;
+        void *raw = static_cast<char *>(ptr) - headerSize;
+        freeCount.fetch_add(1, std::memory_order_relaxed);
+        liveBytes.fetch_sub(*static_cast<size_t *>(raw), std::memory_order_relaxed);
+        std::free(raw);
+    }
+
+    void *throwingAlloc(size_t size)
+    {
+        if (size == 0)
+            size = 1;
+        while (true)
+        {
+            if (void *p = countedAlloc(size))
+                return p;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+AllocStats allocStats()
+{
+    return AllocStats{
+        allocCount.load(std::memory_order_relaxed),
+        freeCount.load(std::memory_order_relaxed),
+        allocBytes.load(std::memory_order_relaxed),
+        liveBytes.load(std::memory_order_relaxed),
+        peakBytes.load(std::memory_order_relaxed),
+        true};
+}
+
+void resetPeakBytes()
+{
+    peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void *operator new(size_t size) { return throwingAlloc(size); }
+void *operator new[](size_t size) { return throwingAlloc(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size ? size : 1); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size ? size : 1); }
+
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { countedFree(ptr); }
+#else
+AllocStats allocStats() { return AllocStats{0, 0, 0, 0, 0, false}; }
+
+void resetPeakBytes() {}
+#endif
+
+size_t peakRSS()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
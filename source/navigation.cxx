@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cctype>
+#include <navigation.hxx>
+#include <parser.hxx>
+#include <resolver.hxx>
+#include <string.hxx>
+#include <visitor.hxx>
+
+namespace
+{
+    bool isIdentifierChar(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    /**
+     * Offset of the first whole-word occurrence of a name in [from, to), or
+     * `to` if there is none. Declarations only keep their names, so this is
+     * how they are found again in the text of the node.
+     */
+    uint32_t findName(std::string_view text, uint32_t from, uint32_t to, std::string_view name)
+    {
+        to = std::min(to, static_cast<uint32_t>(text.size()));
+        for (size_t at = text.find(name, from); at != std::string_view::npos && at + name.size() <= to; at = text.find(name, at + 1))
+        {
+            bool starts = at == 0 || !isIdentifierChar(text[at - 1]);
+            bool ends = at + name.size() == text.size() || !isIdentifierChar(text[at + name.size()]);
+            if (starts && ends)
+                return static_cast<uint32_t>(at);
+        }
+        return to;
+    }
+
+    struct Spans : ASTVisitor<Spans>
+    {
+        std::vector<uint32_t> &starts;
+        std::vector<const ASTNode *> &nodes;
+        std::vector<const ASTNode *> open;
+
+        Spans(std::vector<uint32_t> &starts, std::vector<const ASTNode *> &nodes) : starts(starts), nodes(nodes) {}
+
+        bool preVisit(const ASTNode *node)
+        {
+            if (node->span.end > node->span.begin)
+            {
+                starts.push_back(node->span.begin);
+                nodes.push_back(node);
+            }
+            open.push_back(node);
+            return true;
+        }
+
+        void postVisit(const ASTNode *node)
+        {
+            open.pop_back();
+            if (node->span.end <= node->span.begin)
+                return;
+            // Back to the innermost enclosing node with a span.
+            auto outer = std::find_if(open.rbegin(), open.rend(), [](const ASTNode *n) { return n->span.end > n->span.begin; });
+            starts.push_back(node->span.end);
+            nodes.push_back(outer == open.rend() ? nullptr : *outer);
+        }
+    };
+
+    struct Names : ASTVisitor<Names>
+    {
+        std::string_view text;
+        std::vector<NameUse> &all;
+
+        Names(std::string_view text, std::vector<NameUse> &all) : text(text), all(all) {}
+
+        bool preVisit(const ASTNode *node)
+        {
+            auto found = namesOf(node, text);
+            all.insert(all.end(), found.begin(), found.end());
+            return true;
+        }
+    };
+
+    void collectGlobals(const ASTNode *block, const ClassDeclNode *owner, std::unordered_map<const ASTNode *, std::string> &globals)
+    {
+        auto *body = nodeAs<BlockNode>(block);
+        if (!body)
+            return;
+        std::string prefix = owner ? owner->name + "." : std::string();
+        for (const auto &child : body->children)
+        {
+            if (auto *cls = nodeAs<ClassDeclNode>(child.get()))
+            {
+                globals[cls] = prefix + cls->name;
+                collectGlobals(cls->body.get(), cls, globals);
+            }
+            else if (auto *fn = nodeAs<FunctionDeclNode>(child.get()))
+                globals[fn] = prefix + fn->name;
+            else if (auto *var = nodeAs<VarDeclNode>(child.get()))
+                globals[var] = prefix + var->name;
+        }
+    }
+
+    bool sameTarget(const Binding &a, const Binding &b)
+    {
+        return a.decl == b.decl && a.param == b.param;
+    }
+
+    std::string modifiers(ModifierType modifier)
+    {
+        switch (modifier)
+        {
+        case ModifierType::Static:
+            return "static ";
+        case ModifierType::Virtual:
+            return "virtual ";
+        case ModifierType::Override:
+            return "override ";
+        default:
+            return "";
+        }
+    }
+
+    std::string qualified(const ASTNode *decl, const std::string &name)
+    {
+        auto *owner = nodeAs<ClassDeclNode>(decl->parent);
+        return owner ? owner->name + "." + name : name;
+    }
+}
+
+std::pair<std::string, ASTNodePtr> DocumentIndex::parse(std::string source)
+{
+    Lexer lexer(std::move(source), "");
+    ASTNodePtr root;
+    try
+    {
+        Parser parser(lexer);
+        root = parser.parserProgram();
+        std::vector<Diagnostic> ignored;
+        resolveNames(root.get(), ignored);
+    }
+    catch (const std::exception &)
+    {
+        root.reset();
+    }
+    return {std::move(lexer.Source), std::move(root)};
+}
+
+NodeIndex::NodeIndex(const ASTNode *root)
+{
+    if (!root)
+        return;
+    Spans spans(starts, nodes);
+    spans.traverse(root);
+
+    // An interval that starts where a later one does is empty; the later one,
+    // a child or the next sibling, is the innermost there.
+    std::vector<uint32_t> order(starts.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return starts[a] < starts[b]; });
+    std::vector<uint32_t> sortedStarts;
+    std::vector<const ASTNode *> sortedNodes;
+    for (uint32_t i : order)
+    {
+        if (!sortedStarts.empty() && sortedStarts.back() == starts[i])
+            sortedNodes.back() = nodes[i];
+        else
+        {
+            sortedStarts.push_back(starts[i]);
+            sortedNodes.push_back(nodes[i]);
+        }
+    }
+    starts = std::move(sortedStarts);
+    nodes = std::move(sortedNodes);
+}
+
+const ASTNode *NodeIndex::at(uint32_t offset) const
+{
+    auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+    if (it == starts.begin())
+        return nullptr;
+    return nodes[static_cast<size_t>(it - starts.begin()) - 1];
+}
+
+std::vector<NameUse> namesOf(const ASTNode *node, std::string_view text)
+{
+    std::vector<NameUse> names;
+    uint32_t begin = node->span.begin;
+    uint32_t end = node->span.end;
+    auto add = [&](uint32_t at, std::string_view name, Binding binding, bool declaration) {
+        if (at < end && !name.empty())
+            names.push_back({at, static_cast<uint32_t>(at + name.size()), node, binding, declaration});
+    };
+    // A plain name, or "Class.member" where the class is the one the member was found in.
+    auto use = [&](std::string_view name, const Binding &binding) {
+        size_t dot = name.find('.');
+        if (dot == std::string_view::npos)
+        {
+            add(begin, name, binding, false);
+            return;
+        }
+        std::string_view owner = name.substr(0, dot);
+        std::string_view member = name.substr(dot + 1);
+        Binding cls;
+        if (binding.decl && nodeAs<ClassDeclNode>(binding.decl->parent))
+            cls.decl = binding.decl->parent;
+        add(begin, owner, cls, false);
+        add(findName(text, static_cast<uint32_t>(begin + owner.size()), end, member), member, binding, false);
+    };
+
+    switch (node->type)
+    {
+    case ASTNodeType::Identifier:
+    {
+        auto *identifier = static_cast<const IdentifierNode *>(node);
+        use(identifier->name, identifier->binding);
+        break;
+    }
+    case ASTNodeType::AssignExpr:
+    {
+        auto *assign = static_cast<const AssignExprNode *>(node);
+        add(begin, assign->name, assign->binding, false);
+        break;
+    }
+    case ASTNodeType::FunctionCall:
+    {
+        auto *call = static_cast<const FunctionCallNode *>(node);
+        use(call->callee, call->binding);
+        break;
+    }
+    case ASTNodeType::VarDecl:
+    {
+        auto *var = static_cast<const VarDeclNode *>(node);
+        add(findName(text, begin, end, var->name), var->name, Binding{node, -1}, true);
+        break;
+    }
+    case ASTNodeType::FunctionDecl:
+    {
+        auto *fn = static_cast<const FunctionDeclNode *>(node);
+        uint32_t header = fn->body ? std::min(end, fn->body->span.begin) : end;
+        uint32_t at = findName(text, begin, header, fn->name);
+        add(at, fn->name, Binding{node, -1}, true);
+        // Parameter names follow in order, each after the one before.
+        for (size_t i = 0; i < fn->params.size() && at < header; ++i)
+        {
+            const std::string &param = fn->params[i].second;
+            at = findName(text, static_cast<uint32_t>(std::min<size_t>(at + (i ? fn->params[i - 1].second.size() : fn->name.size()), header)), header, param);
+            add(at, param, Binding{node, static_cast<int32_t>(i)}, true);
+        }
+        break;
+    }
+    case ASTNodeType::ClassDecl:
+    {
+        auto *cls = static_cast<const ClassDeclNode *>(node);
+        uint32_t header = cls->body ? std::min(end, cls->body->span.begin) : end;
+        add(findName(text, begin, header, cls->name), cls->name, Binding{node, -1}, true);
+        break;
+    }
+    default:
+        break;
+    }
+    return names;
+}
+
+DocumentIndex::DocumentIndex(std::string source) : DocumentIndex(parse(std::move(source)))
+{
+}
+
+DocumentIndex::DocumentIndex(std::pair<std::string, ASTNodePtr> parsed) : DocumentIndex(std::move(parsed.first), std::move(parsed.second))
+{
+}
+
+DocumentIndex::DocumentIndex(std::string source, ASTNodePtr tree)
+    : text(std::move(source)), root(std::move(tree)), lines(text), nodes(root.get())
+{
+    if (!root)
+        return;
+    Names names(text, all);
+    names.traverse(root.get());
+    std::stable_sort(all.begin(), all.end(), [](const NameUse &a, const NameUse &b) { return a.begin < b.begin; });
+    for (uint32_t i = 0; i < all.size(); ++i)
+        if (all[i].binding.decl)
+            uses[all[i].binding.decl].push_back(i);
+    collectGlobals(root.get(), nullptr, globals);
+}
+
+std::optional<NameUse> DocumentIndex::nameAt(uint32_t offset) const
+{
+    for (uint32_t at : {offset, offset - 1})
+    {
+        if (at == UINT32_MAX)
+            break;
+        const ASTNode *node = nodes.at(at);
+        if (!node)
+            continue;
+        for (const NameUse &name : namesOf(node, text))
+            if (name.begin <= at && at < name.end)
+                return name;
+    }
+    return std::nullopt;
+}
+
+std::vector<NameUse> DocumentIndex::references(const Binding &target) const
+{
+    std::vector<NameUse> found;
+    auto it = uses.find(target.decl);
+    if (it == uses.end())
+        return found;
+    for (uint32_t i : it->second)
+        if (sameTarget(all[i].binding, target))
+            found.push_back(all[i]);
+    return found;
+}
+
+std::optional<NameUse> DocumentIndex::declaration(const Binding &target) const
+{
+    for (const NameUse &name : references(target))
+        if (name.declaration)
+            return name;
+    return std::nullopt;
+}
+
+std::string DocumentIndex::key(const NameUse &name) const
+{
+    if (name.binding.decl)
+    {
+        if (name.binding.param >= 0)
+            return {};
+        auto it = globals.find(name.binding.decl);
+        return it != globals.end() ? it->second : std::string();
+    }
+    // Unresolved: maybe declared in another file.
+    if (name.begin != name.node->span.begin)
+    {
+        if (auto *call = nodeAs<FunctionCallNode>(name.node))
+            return call->callee;
+        if (auto *id = nodeAs<IdentifierNode>(name.node))
+            return id->name;
+    }
+    return text.substr(name.begin, name.end - name.begin);
+}
+
+std::string describe(const Binding &target)
+{
+    if (!target.decl)
+        return {};
+    if (auto *fn = nodeAs<FunctionDeclNode>(target.decl))
+    {
+        if (target.param >= 0 && static_cast<size_t>(target.param) < fn->params.size())
+        {
+            const auto &param = fn->params[static_cast<size_t>(target.param)];
+            return param.second + ": " + std::string(typeToString(param.first));
+        }
+        // Parameters of one type are grouped as the parser reads them.
+        std::string s = modifiers(fn->modifier) + qualified(fn, fn->name) + "(";
+        for (size_t i = 0; i < fn->params.size(); ++i)
+        {
+            bool first = i == 0 || fn->params[i - 1].first != fn->params[i].first;
+            bool last = i + 1 == fn->params.size() || fn->params[i + 1].first != fn->params[i].first;
+            if (first)
+                s += (i ? ", " : "") + std::string(typeToString(fn->params[i].first)) + "[";
+            else
+                s += ", ";
+            s += fn->params[i].second;
+            if (last)
+                s += "]";
+        }
+        return s + ") " + std::string(typeToString(fn->returnType));
+    }
+    if (auto *var = nodeAs<VarDeclNode>(target.decl))
+        return modifiers(var->modifier) + (var->isConst ? "const " : "var ") + qualified(var, var->name) + ": " +
+               std::string(typeToString(var->varType));
+    if (auto *cls = nodeAs<ClassDeclNode>(target.decl))
+        return "class " + cls->name;
+    return {};
+}
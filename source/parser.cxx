@@ -1,15 +1,21 @@
-#include <stdexcept>
 #include <parser.hxx>
 
+void Parser::syntaxError(const std::string &message) const
+{
+    uint32_t begin = offsetOf(current);
+    throw ParseError(message, SourceSpan{begin, begin + static_cast<uint32_t>(current.Lexeme.size()), lexer.FileId});
+}
+
 void Parser::expect(TokenType type)
 {
     if (current.Type != type)
-        throw std::runtime_error("Unexpected token: '" + std::string(current.Lexeme) +
+        syntaxError("Unexpected token: '" + std::string(current.Lexeme) +
                                  "' at line " + std::to_string(current.Line));
     advance();
 }
 
 ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode* parent, bool shouldAdvance) {
+    uint32_t begin = offsetOf(current);
     ASTNodeList expressions;
     while (current.Type != endcase && current.Type != TokenType::EndOfFile)
     {
@@ -37,6 +43,8 @@ ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode* parent, bool shouldAdva
 
         if (hasAccess) {
             Token next = peekToken();
+            if (next.Type == TokenType::KwStatic || next.Type == TokenType::KwVirtual || next.Type == TokenType::KwOverride)
+                next.Type = peekPastModifiers();
             if (next.Type == TokenType::KwClass) {
                 node = parseClassDecl();
             }
@@ -74,7 +82,7 @@ ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode* parent, bool shouldAdva
                     if (parent == nullptr)
                         node = parseExpression();
                     else   
-                        throw std::runtime_error("Unexpected token in class body at line " + std::to_string(current.Line));
+                        syntaxError("Unexpected token in class body at line " + std::to_string(current.Line));
                  }
 
                 
@@ -90,17 +98,20 @@ ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode* parent, bool shouldAdva
 		advance();
     auto block = std::make_unique<BlockNode>();
     block->children = std::move(expressions);
+    setSpan(block.get(), begin);
     return block;
 }
 
 ASTNodePtr Parser::parserProgram()
 {
     auto block = parseBody(TokenType::EndOfFile, nullptr, false);
+    block->span = SourceSpan{0, static_cast<uint32_t>(lexer.Source.size()), lexer.FileId};
     return block;
 }
 
 ASTNodePtr Parser::parsePrimary()
 {
+    uint32_t begin = offsetOf(current);
     switch (current.Type)
     {
     case TokenType::KwIf:
@@ -111,36 +122,54 @@ ASTNodePtr Parser::parsePrimary()
     case TokenType::KwReturn:
     {
         advance();
-        return std::make_unique<ReturnExprNode>(parseExpression());
+        auto node = std::make_unique<ReturnExprNode>(parseExpression());
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::Integer:
     {
-        int64_t value = std::stoi(std::string(current.Lexeme));
+        int64_t value;
+        try {
+            value = std::stoll(std::string(current.Lexeme));
+        } catch (const std::out_of_range &) {
+            syntaxError("Integer literal out of range at line " + std::to_string(current.Line));
+        }
         advance();
-        return std::make_unique<LiteralNode>(Type::Int64, value);
+        auto node = std::make_unique<LiteralNode>(Type::Int64, value);
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::Float:
     {
         double value = std::stod(std::string(current.Lexeme));
         advance();
-        return std::make_unique<LiteralNode>(Type::Float64, value);
+        auto node = std::make_unique<LiteralNode>(Type::Float64, value);
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::Unsigned:
     {
-        uint64_t value = std::stoul(std::string(current.Lexeme));
+        uint64_t value;
+        try {
+            value = std::stoull(std::string(current.Lexeme));
+        } catch (const std::out_of_range &) {
+            syntaxError("Integer literal out of range at line " + std::to_string(current.Line));
+        }
         advance();
-        return std::make_unique<LiteralNode>(Type::Uint64, value);
+        auto node = std::make_unique<LiteralNode>(Type::Uint64, value);
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::Byte:
     {
         std::string_view lex = current.Lexeme;
         if (lex.size() < 3 || lex.front() != '\'' || lex.back() != '\'')
-            throw std::runtime_error("Invalid byte literal at line " + std::to_string(current.Line));
+            syntaxError("Invalid byte literal at line " + std::to_string(current.Line));
         char value = lex[1];
         if (value == '\\')
         {
             if (lex.size() < 4)
-                throw std::runtime_error("Invalid escape sequence in byte literal");
+                syntaxError("Invalid escape sequence in byte literal");
             switch (lex[2])
             {
             case 'n':
@@ -167,25 +196,56 @@ ASTNodePtr Parser::parsePrimary()
             }
         }
         advance();
-        return std::make_unique<LiteralNode>(Type::Byte, value);
+        auto node = std::make_unique<LiteralNode>(Type::Byte, value);
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::String:
     {
         std::string value = std::string(current.Lexeme);
         advance();
-        return std::make_unique<LiteralNode>(Type::String, value);
+        auto node = std::make_unique<LiteralNode>(Type::String, value);
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::Boolean:
     {
         bool value = (current.Lexeme == "true");
         advance();
-        return std::make_unique<LiteralNode>(Type::Boolean, value);
+        auto node = std::make_unique<LiteralNode>(Type::Boolean, value);
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::Identifier:
     {
         std::string name(current.Lexeme);
         advance();
-        return std::make_unique<IdentifierNode>(name);
+        if (current.Type == TokenType::Dot && peekToken().Type == TokenType::Identifier)
+        {
+            advance();
+            name += '.';
+            name += current.Lexeme;
+            advance();
+        }
+        if (current.Type == TokenType::LeftParen)
+        {
+            advance();
+            ASTNodeList args;
+            while (current.Type != TokenType::RightParen)
+            {
+                args.push_back(parseExpression());
+                if (current.Type != TokenType::Comma)
+                    break;
+                advance();
+            }
+            expect(TokenType::RightParen);
+            auto node = std::make_unique<FunctionCallNode>(std::move(name), std::move(args));
+            setSpan(node.get(), begin);
+            return node;
+        }
+        auto node = std::make_unique<IdentifierNode>(name);
+        setSpan(node.get(), begin);
+        return node;
     }
     case TokenType::LeftParen:
     {
@@ -195,7 +255,7 @@ ASTNodePtr Parser::parsePrimary()
         return expr;
     }
     default:
-        throw std::runtime_error("Unexpected token in expression at line " + std::to_string(current.Line));
+        syntaxError("Unexpected token in expression at line " + std::to_string(current.Line));
     }
 }
 
@@ -211,9 +271,11 @@ ASTNodePtr Parser::parseExpression(int minPrec)
             advance();
             advance();
             ASTNodePtr value = parseExpression();
-            return std::make_unique<AssignExprNode>(
+            auto node = std::make_unique<AssignExprNode>(
                 std::string(ident.Lexeme),
                 std::move(value));
+            setSpan(node.get(), offsetOf(ident));
+            return node;
         }
     }
 
@@ -229,7 +291,9 @@ ASTNodePtr Parser::parseExpression(int minPrec)
         advance();
         ASTNodePtr right = parseExpression(prec + 1);
 
+        uint32_t begin = left->span.begin;
         left = std::make_unique<BinaryExprNode>(std::string(op.Lexeme), std::move(left), std::move(right));
+        setSpan(left.get(), begin);
     }
 
     return left;
@@ -237,6 +301,7 @@ ASTNodePtr Parser::parseExpression(int minPrec)
 
 ASTNodePtr Parser::parseFunction(ASTNode* parent)
 {
+    uint32_t begin = offsetOf(current);
 
 	AccessType access = parseAccessModifier();
     if (access == AccessType::Default && parent != nullptr) {
@@ -250,7 +315,7 @@ ASTNodePtr Parser::parseFunction(ASTNode* parent)
     ModifierType modifier = parseModifiers();
 
     if (current.Type != TokenType::Identifier)
-        throw std::runtime_error("Expected function name at line " + std::to_string(current.Line));
+        syntaxError("Expected function name at line " + std::to_string(current.Line));
     std::string name(current.Lexeme);
     advance();
 
@@ -266,7 +331,7 @@ ASTNodePtr Parser::parseFunction(ASTNode* parent)
             while (true)
             {
                 if (current.Type != TokenType::Identifier)
-                    throw std::runtime_error("Expected parameter name inside brackets at line " + std::to_string(current.Line));
+                    syntaxError("Expected parameter name inside brackets at line " + std::to_string(current.Line));
                 std::string paramName(current.Lexeme);
                 params.emplace_back(paramType, paramName);
                 advance();
@@ -279,13 +344,13 @@ ASTNodePtr Parser::parseFunction(ASTNode* parent)
                     break;
                 }
                 else
-                    throw std::runtime_error("Expected ',' or ']' in parameter list at line " + std::to_string(current.Line));
+                    syntaxError("Expected ',' or ']' in parameter list at line " + std::to_string(current.Line));
             }
         }
         else
         {
             if (current.Type != TokenType::Identifier)
-                throw std::runtime_error("Expected parameter name at line " + std::to_string(current.Line));
+                syntaxError("Expected parameter name at line " + std::to_string(current.Line));
             std::string paramName(current.Lexeme);
             params.emplace_back(paramType, paramName);
             advance();
@@ -302,8 +367,10 @@ ASTNodePtr Parser::parseFunction(ASTNode* parent)
         retType = parseType();
 
     ASTNodePtr body = std::make_unique<BlockNode>();
+    uint32_t bodyBegin = lastEnd;
     if (current.Type == TokenType::LeftBrace)
     {
+        bodyBegin = offsetOf(current);
         advance();
         ASTNodeList expressions;
         while (current.Type != TokenType::RightBrace && current.Type != TokenType::EndOfFile)
@@ -313,10 +380,12 @@ ASTNodePtr Parser::parseFunction(ASTNode* parent)
         expect(TokenType::RightBrace);
         static_cast<BlockNode *>(body.get())->children = std::move(expressions);
     }
+    setSpan(body.get(), bodyBegin);
 
 
     auto node = std::make_unique<FunctionDeclNode>(modifier, name, params, retType, std::move(body), access);
 	node.get()->parent = parent;
+    setSpan(node.get(), begin);
     return node;
 }
 
@@ -367,15 +436,16 @@ Type Parser::parseType()
         advance();
         return Type::Void;
     default:
-        throw std::runtime_error("Expected type at line " + std::to_string(current.Line));
+        syntaxError("Expected type at line " + std::to_string(current.Line));
     }
 }
 
 ASTNodePtr Parser::parseVarDecl(ASTNode* parent)
 {
+    uint32_t begin = offsetOf(current);
 	AccessType access = parseAccessModifier();
     if (access == AccessType::Default && parent != nullptr) {
-		access == AccessType::Private;
+		access = AccessType::Private;
     }
     else if(access == AccessType::Default && parent == nullptr)
     {
@@ -389,7 +459,7 @@ ASTNodePtr Parser::parseVarDecl(ASTNode* parent)
     advance();
 
     if (current.Type != TokenType::Identifier)
-        throw std::runtime_error("Expected variable name at line " + std::to_string(current.Line));
+        syntaxError("Expected variable name at line " + std::to_string(current.Line));
     std::string name(current.Lexeme);
     advance();
 
@@ -403,16 +473,19 @@ ASTNodePtr Parser::parseVarDecl(ASTNode* parent)
         advance();
         value = parseExpression();
     }
-    auto node = std::make_unique<VarDeclNode>(isConst, name, varType, std::move(value), modifier);
+    auto node = std::make_unique<VarDeclNode>(isConst, name, varType, std::move(value), modifier, access);
 	node.get()->parent = parent;
+    setSpan(node.get(), begin);
     return node;
 }
 
 ASTNodePtr Parser::parseIfExpr()
 {
+    uint32_t begin = offsetOf(current);
     expect(TokenType::KwIf);
 
     ASTNodePtr condition = parseExpression();
+    uint32_t thenBegin = offsetOf(current);
     expect(TokenType::LeftBrace);
 
     ASTNodeList thenExpressions;
@@ -423,6 +496,7 @@ ASTNodePtr Parser::parseIfExpr()
     expect(TokenType::RightBrace);
     ASTNodePtr thenBlock = std::make_unique<BlockNode>();
     static_cast<BlockNode *>(thenBlock.get())->children = std::move(thenExpressions);
+    setSpan(thenBlock.get(), thenBegin);
 
     ASTNodePtr elseBranch = nullptr;
     if (current.Type == TokenType::KwElse)
@@ -434,6 +508,7 @@ ASTNodePtr Parser::parseIfExpr()
         }
         else if (current.Type == TokenType::LeftBrace)
         {
+            uint32_t elseBegin = offsetOf(current);
             advance();
             ASTNodeList elseExpressions;
             while (current.Type != TokenType::RightBrace && current.Type != TokenType::EndOfFile)
@@ -443,24 +518,28 @@ ASTNodePtr Parser::parseIfExpr()
             expect(TokenType::RightBrace);
             elseBranch = std::make_unique<BlockNode>();
             static_cast<BlockNode *>(elseBranch.get())->children = std::move(elseExpressions);
+            setSpan(elseBranch.get(), elseBegin);
         }
         else
         {
-            throw std::runtime_error("Expected '{' or 'if' after 'else' at line " + std::to_string(current.Line));
+            syntaxError("Expected '{' or 'if' after 'else' at line " + std::to_string(current.Line));
         }
     }
-    return std::make_unique<IfExprNode>(std::move(condition), std::move(thenBlock), std::move(elseBranch));
+    auto node = std::make_unique<IfExprNode>(std::move(condition), std::move(thenBlock), std::move(elseBranch));
+    setSpan(node.get(), begin);
+    return node;
 }
 
 ASTNodePtr Parser::parseClassDecl()
 {
+    uint32_t begin = offsetOf(current);
 	auto access = parseAccessModifier();
     if (access == AccessType::Default) {
 		access = AccessType::Public;
     }
 	expect(TokenType::KwClass);
     if (current.Type != TokenType::Identifier) {
-        throw std::runtime_error("Expected class name at line " + std::to_string(current.Line));
+        syntaxError("Expected class name at line " + std::to_string(current.Line));
     }
     std::string name(current.Lexeme);
     
@@ -470,16 +549,19 @@ ASTNodePtr Parser::parseClassDecl()
     ASTNodePtr body = std::make_unique<BlockNode>();
     if (current.Type == TokenType::LeftBrace)
     {
+        uint32_t bodyBegin = offsetOf(current);
         advance();
         ASTNodeList expressions;
 
         body = parseBody(TokenType::RightBrace, clazz.get());
+        setSpan(body.get(), bodyBegin);
 
     }
     else {
-		throw std::runtime_error("Expected '{' after class name at line " + std::to_string(current.Line));
+		syntaxError("Expected '{' after class name at line " + std::to_string(current.Line));
     }
 	((ClassDeclNode*)clazz.get())->body = std::move(body);
+    setSpan(clazz.get(), begin);
     return clazz;
 }
 
@@ -499,6 +581,22 @@ AccessType Parser::parseAccessModifier()
     
 }
 
+/**
+ * @brief Type of the first token after the access keyword at `current` and the
+ * modifiers that follow it, without consuming anything.
+ */
+TokenType Parser::peekPastModifiers()
+{
+    size_t position = lexer.Position, line = lexer.Line, column = lexer.Column;
+    Token tok = nextToken;
+    while (tok.Type == TokenType::KwStatic || tok.Type == TokenType::KwVirtual || tok.Type == TokenType::KwOverride)
+        tok = lexer.next();
+    lexer.Position = position;
+    lexer.Line = line;
+    lexer.Column = column;
+    return tok.Type;
+}
+
 ModifierType Parser::parseModifiers()
 {
 
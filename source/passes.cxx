@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+#include <memstats.hxx>
+#include <passes.hxx>
+#include <visitor.hxx>
+
+bool CompileUnit::hasErrors() const
+{
+    return std::any_of(diagnostics.begin(), diagnostics.end(), [](const Diagnostic &d)
+                       { return d.severity == Severity::Error; });
+}
+
+void PassManager::add(std::string name, Run run, bool skippable)
+{
+    passes.push_back(Pass{std::move(name), std::move(run), skippable});
+}
+
+bool PassManager::run(CompileUnit &unit)
+{
+    results.clear();
+    results.reserve(passes.size());
+    std::unordered_map<std::string, uint64_t> settled;
+
+    for (const Pass &pass : passes)
+    {
+        PassStats stats;
+        stats.name = pass.name;
+        auto previous = settled.find(pass.name);
+        if (pass.skippable && previous != settled.end() && previous->second == unit.generation)
+        {
+            stats.skipped = true;
+            results.push_back(std::move(stats));
+            continue;
+        }
+
+        if (trackNodes)
+            stats.nodesBefore = ::countNodes(unit.ast.get());
+        AllocStats before = allocStats();
+        size_t rssBefore = peakRSS();
+        auto start = std::chrono::steady_clock::now();
+        stats.changes = pass.run(unit);
+        auto end = std::chrono::steady_clock::now();
+        size_t rssAfter = peakRSS();
+        AllocStats after = allocStats();
+
+        stats.ran = true;
+        stats.seconds = std::chrono::duration<double>(end - start).count();
+        stats.allocations = after.allocations - before.allocations;
+        stats.bytes = after.bytes - before.bytes;
+        stats.peakRSSGrowth = rssAfter - rssBefore;
+        if (trackNodes)
+            stats.nodesAfter = ::countNodes(unit.ast.get());
+        results.push_back(std::move(stats));
+
+        if (results.back().changes > 0)
+            ++unit.generation;
+        settled[pass.name] = unit.generation;
+        if (unit.hasErrors())
+            return false;
+    }
+    return true;
+}
+
+void PassManager::printReport(std::ostream &out) const
+{
+    double total = 0;
+    uint64_t allocations = 0, bytes = 0, rss = 0;
+    for (const auto &s : results)
+    {
+        total += s.seconds;
+        allocations += s.allocations;
+        bytes += s.bytes;
+        rss += s.peakRSSGrowth;
+    }
+    // Binaries without the counting allocator have no allocation figures to show.
+    bool counted = allocStats().counted;
+
+    char line[176];
+    auto row = [&](const char *name, const char *time, const char *percent, const char *allocs, const char *kb, const char *rssKb,
+                   const char *nodes)
+    {
+        std::snprintf(line, sizeof(line), " %-14s %12s %7s %10s %12s %12s %19s\n", name, time, percent, allocs, kb, rssKb, nodes);
+        out << line;
+    };
+    auto amounts = [&](uint64_t count, uint64_t allocated, uint64_t grown, char (&allocs)[24], char (&kb)[24], char (&rssKb)[24])
+    {
+        if (counted)
+        {
+            std::snprintf(allocs, sizeof(allocs), "%llu", static_cast<unsigned long long>(count));
+            std::snprintf(kb, sizeof(kb), "%.1f", allocated / 1024.0);
+        }
+        else
+        {
+            std::snprintf(allocs, sizeof(allocs), "-");
+            std::snprintf(kb, sizeof(kb), "-");
+        }
+        std::snprintf(rssKb, sizeof(rssKb), "%.1f", grown / 1024.0);
+    };
+
+    out << "===-------------------------------------------------------------------------------------===\n"
+        << "                               Pass execution timing report\n"
+        << "===-------------------------------------------------------------------------------------===\n";
+    row("Pass", "Wall (ms)", "%", "Allocs", "Alloc (KB)", "Peak RSS +KB", "Nodes before/after");
+    for (const auto &s : results)
+    {
+        char time[32], percent[16], allocs[24], kb[24], rssKb[24], nodes[40] = "";
+        if (s.skipped)
+        {
+            row(s.name.c_str(), "skipped", "", "", "", "", "");
+            continue;
+        }
+        std::snprintf(time, sizeof(time), "%.3f", s.seconds * 1e3);
+        std::snprintf(percent, sizeof(percent), "%.1f", total > 0 ? 100.0 * s.seconds / total : 0.0);
+        amounts(s.allocations, s.bytes, s.peakRSSGrowth, allocs, kb, rssKb);
+        if (trackNodes)
+            std::snprintf(nodes, sizeof(nodes), "%zu/%zu", s.nodesBefore, s.nodesAfter);
+        row(s.name.c_str(), time, percent, allocs, kb, rssKb, nodes);
+    }
+
+    char time[32], allocs[24], kb[24], rssKb[24];
+    std::snprintf(time, sizeof(time), "%.3f", total * 1e3);
+    amounts(allocations, bytes, rss, allocs, kb, rssKb);
+    row("Total", time, "100.0", allocs, kb, rssKb, "");
+}
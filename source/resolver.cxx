@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <hash.hxx>
+#include <resolver.hxx>
+#include <visitor.hxx>
+
+namespace
+{
+    constexpr uint32_t initialCapacity = 8;
+
+    uint32_t tagOf(uint64_t hash) { return static_cast<uint32_t>(hash >> 32); }
+}
+
+void SymbolTable::push()
+{
+    Arena::Marker start = arena.mark();
+    Slot *slots = arena.allocateArray<Slot>(initialCapacity);
+    scopes.push_back(Scope{slots, initialCapacity - 1, 0, start});
+}
+
+void SymbolTable::pop()
+{
+    arena.rewind(scopes.back().start);
+    scopes.pop_back();
+}
+
+SymbolTable::Slot *SymbolTable::find(const Scope &scope, std::string_view name, uint64_t hash)
+{
+    uint32_t tag = tagOf(hash);
+    for (uint32_t i = static_cast<uint32_t>(hash) & scope.mask;; i = (i + 1) & scope.mask)
+    {
+        Slot &slot = scope.slots[i];
+        if (!slot.name)
+            return &slot;
+        if (slot.tag == tag && slot.length == name.size() && std::memcmp(slot.name, name.data(), name.size()) == 0)
+            return &slot;
+    }
+}
+
+void SymbolTable::grow(Scope &scope)
+{
+    uint32_t capacity = (scope.mask + 1) * 2;
+    Slot *slots = arena.allocateArray<Slot>(capacity);
+    Scope grown{slots, capacity - 1, scope.size, scope.start};
+    // The old table stays in the arena until the scope is popped.
+    for (uint32_t i = 0; i <= scope.mask; ++i)
+    {
+        const Slot &slot = scope.slots[i];
+        if (slot.name)
+            *find(grown, std::string_view(slot.name, slot.length), hash::string(std::string_view(slot.name, slot.length))) = slot;
+    }
+    scope = grown;
+}
+
+const Binding *SymbolTable::declare(std::string_view name, Binding binding)
+{
+    Scope &scope = scopes.back();
+    uint64_t hash = hash::string(name);
+    Slot *slot = find(scope, name, hash);
+    if (slot->name)
+        return &slot->binding;
+
+    // Keep the load factor at or below 3/4 so probe sequences stay short.
+    if ((scope.size + 1) * 4 > (scope.mask + 1) * 3)
+    {
+        grow(scope);
+        slot = find(scope, name, hash);
+    }
+    *slot = Slot{name.data(), static_cast<uint32_t>(name.size()), tagOf(hash), binding};
+    ++scope.size;
+    return nullptr;
+}
+
+const Binding *SymbolTable::lookup(std::string_view name) const
+{
+    uint64_t hash = hash::string(name);
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it)
+    {
+        const Slot *slot = find(*it, name, hash);
+        if (slot->name)
+            return &slot->binding;
+    }
+    return nullptr;
+}
+
+namespace
+{
+    struct Resolver : ASTVisitor<Resolver, true>
+    {
+        SymbolTable symbols;
+        std::vector<Diagnostic> &diagnostics;
+        size_t bound = 0;
+        // The table keeps the first declaration of an overloaded name; the rest are listed here.
+        std::unordered_map<const ASTNode *, std::vector<const FunctionDeclNode *>> overloads;
+        std::vector<const ClassDeclNode *> classes;
+
+        explicit Resolver(std::vector<Diagnostic> &diagnostics) : diagnostics(diagnostics) {}
+
+        void error(const ASTNode *at, std::string message)
+        {
+            diagnostics.push_back(Diagnostic{Severity::Error, at->span, std::move(message)});
+        }
+
+        void declare(const std::string &name, Binding binding, const ASTNode *at)
+        {
+            const Binding *previous = symbols.declare(name, binding);
+            if (!previous)
+                return;
+            const auto *fn = binding.param < 0 ? nodeAs<FunctionDeclNode>(binding.decl) : nullptr;
+            const auto *first = previous->param < 0 ? nodeAs<FunctionDeclNode>(previous->decl) : nullptr;
+            if (fn && first && !sameSignature(fn, first))
+            {
+                auto &more = overloads[first];
+                if (std::none_of(more.begin(), more.end(), [&](const FunctionDeclNode *other) { return sameSignature(fn, other); }))
+                {
+                    more.push_back(fn);
+                    return;
+                }
+            }
+            error(at, "redefinition of '" + name + "'");
+        }
+
+        /** Whether two functions take the same parameter types; overloads must not. */
+        static bool sameSignature(const FunctionDeclNode *a, const FunctionDeclNode *b)
+        {
+            return std::equal(a->params.begin(), a->params.end(), b->params.begin(), b->params.end(),
+                              [](const auto &x, const auto &y) { return x.first == y.first; });
+        }
+
+        /**
+         * Resolve the statements of a block in the innermost scope. Classes and
+         * functions are declared up front; so are variables when the block is a
+         * class body.
+         */
+        void resolveContents(BlockNode *block, bool membersVisible)
+        {
+            for (auto &child : block->children)
+            {
+                ASTNode *node = child.get();
+                if (auto *fn = nodeAs<FunctionDeclNode>(node))
+                    declare(fn->name, Binding{fn, -1}, fn);
+                else if (auto *cls = nodeAs<ClassDeclNode>(node))
+                    declare(cls->name, Binding{cls, -1}, cls);
+                else if (auto *var = nodeAs<VarDeclNode>(node); var && membersVisible)
+                    declare(var->name, Binding{var, -1}, var);
+            }
+
+            for (auto &child : block->children)
+            {
+                // Members are already declared; only their initializers need resolving.
+                auto *member = membersVisible ? nodeAs<VarDeclNode>(child.get()) : nullptr;
+                if (!traverse(member ? member->value.get() : child.get()))
+                    return;
+            }
+        }
+
+        void visitBlock(BlockNode *block)
+        {
+            symbols.push();
+            resolveContents(block, false);
+            symbols.pop();
+        }
+
+        void visitClassDecl(ClassDeclNode *cls)
+        {
+            auto *body = nodeAs<BlockNode>(cls->body.get());
+            if (!body)
+                return;
+            symbols.push();
+            classes.push_back(cls);
+            resolveContents(body, true);
+            classes.pop_back();
+            symbols.pop();
+        }
+
+        void visitFunctionDecl(FunctionDeclNode *fn)
+        {
+            symbols.push();
+            for (size_t i = 0; i < fn->params.size(); ++i)
+                declare(fn->params[i].second, Binding{fn, static_cast<int32_t>(i)}, fn);
+            // Parameters and the outermost locals share a scope, so a local cannot shadow a parameter.
+            if (auto *body = nodeAs<BlockNode>(fn->body.get()))
+                resolveContents(body, false);
+            else
+                traverse(fn->body.get());
+            symbols.pop();
+        }
+
+        void visitVarDecl(VarDeclNode *var)
+        {
+            // The initializer cannot see the variable it initializes.
+            traverse(var->value.get());
+            declare(var->name, Binding{var, -1}, var);
+        }
+
+        /**
+         * The class a "Class.member" name starts with, or null after reporting
+         * that there is no such class.
+         */
+        const ClassDeclNode *ownerOf(const ASTNode *at, std::string_view className)
+        {
+            const Binding *binding = symbols.lookup(className);
+            const auto *owner = binding ? nodeAs<ClassDeclNode>(binding->decl) : nullptr;
+            if (!owner)
+                error(at, "use of undeclared class '" + std::string(className) + "'");
+            return owner;
+        }
+
+        /** Private members are visible only inside their own class. */
+        bool visible(const ClassDeclNode *owner, AccessType access) const
+        {
+            return access != AccessType::Private || std::find(classes.begin(), classes.end(), owner) != classes.end();
+        }
+
+        bool accessible(const ASTNode *at, const ClassDeclNode *owner, AccessType access, std::string_view name)
+        {
+            if (visible(owner, access))
+                return true;
+            error(at, "'" + std::string(name) + "' is private to '" + owner->name + "'");
+            return false;
+        }
+
+        void visitIdentifier(IdentifierNode *id)
+        {
+            if (size_t dot = id->name.find('.'); dot != std::string::npos)
+            {
+                id->binding = Binding{};
+                std::string_view name = std::string_view(id->name).substr(dot + 1);
+                const ClassDeclNode *owner = ownerOf(id, std::string_view(id->name).substr(0, dot));
+                if (!owner)
+                    return;
+                const VarDeclNode *field = nullptr;
+                if (const auto *body = nodeAs<BlockNode>(owner->body.get()))
+                    for (const auto &member : body->children)
+                        if (const auto *var = nodeAs<VarDeclNode>(member.get()); var && var->name == name)
+                            field = var;
+                if (!field)
+                    error(id, "no field '" + std::string(name) + "' in class '" + owner->name + "'");
+                else if (accessible(id, owner, field->access, name))
+                {
+                    id->binding = Binding{field, -1};
+                    ++bound;
+                }
+                return;
+            }
+            if (const Binding *binding = symbols.lookup(id->name))
+            {
+                id->binding = *binding;
+                ++bound;
+            }
+            else
+            {
+                id->binding = Binding{};
+                error(id, "use of undeclared identifier '" + id->name + "'");
+            }
+        }
+
+        void visitFunctionCall(FunctionCallNode *call)
+        {
+            traverseChildren(call);
+            call->binding = Binding{};
+            call->overloads.clear();
+
+            std::string_view name = call->callee;
+            std::vector<const FunctionDeclNode *> candidates;
+            const ClassDeclNode *owner = nullptr;
+            if (size_t dot = name.find('.'); dot != std::string_view::npos)
+            {
+                owner = ownerOf(call, name.substr(0, dot));
+                if (!owner)
+                    return;
+                name = name.substr(dot + 1);
+                if (const auto *body = nodeAs<BlockNode>(owner->body.get()))
+                    for (const auto &member : body->children)
+                        if (const auto *fn = nodeAs<FunctionDeclNode>(member.get()); fn && fn->name == name)
+                            candidates.push_back(fn);
+            }
+            else
+            {
+                const Binding *binding = symbols.lookup(name);
+                if (!binding)
+                {
+                    error(call, "use of undeclared identifier '" + call->callee + "'");
+                    return;
+                }
+                const auto *fn = binding->param < 0 ? nodeAs<FunctionDeclNode>(binding->decl) : nullptr;
+                if (!fn)
+                {
+                    error(call, "'" + call->callee + "' is not a function");
+                    return;
+                }
+                candidates.push_back(fn);
+                if (auto more = overloads.find(fn); more != overloads.end())
+                    candidates.insert(candidates.end(), more->second.begin(), more->second.end());
+            }
+
+            if (candidates.empty())
+            {
+                error(call, "no function '" + std::string(name) + "' in class '" + owner->name + "'");
+                return;
+            }
+            auto match = std::find_if(candidates.begin(), candidates.end(), [&](const FunctionDeclNode *fn)
+                                      { return fn->params.size() == call->args.size(); });
+            if (match == candidates.end())
+            {
+                error(call, "no overload of '" + call->callee + "' takes " + std::to_string(call->args.size()) + " arguments");
+                return;
+            }
+            // Private overloads are only candidates inside their class.
+            std::vector<const FunctionDeclNode *> viable;
+            for (const FunctionDeclNode *fn : candidates)
+                if (fn->params.size() == call->args.size() && (!owner || visible(owner, fn->access)))
+                    viable.push_back(fn);
+            if (viable.empty())
+            {
+                accessible(call, owner, (*match)->access, name);
+                return;
+            }
+            // Types are not known yet; the type checker chooses among several.
+            call->binding = Binding{viable[0], -1};
+            if (viable.size() > 1)
+                call->overloads = std::move(viable);
+            ++bound;
+        }
+
+        void visitAssignExpr(AssignExprNode *assign)
+        {
+            traverse(assign->value.get());
+            const Binding *binding = symbols.lookup(assign->name);
+            if (!binding)
+            {
+                assign->binding = Binding{};
+                error(assign, "use of undeclared identifier '" + assign->name + "'");
+                return;
+            }
+
+            assign->binding = *binding;
+            ++bound;
+            if (binding->param >= 0)
+                return;
+            if (const auto *var = nodeAs<VarDeclNode>(binding->decl))
+            {
+                if (var->isConst)
+                    error(assign, "cannot assign to constant '" + assign->name + "'");
+            }
+            else
+            {
+                error(assign, "'" + assign->name + "' is not a variable");
+            }
+        }
+    };
+}
+
+size_t resolveNames(ASTNode *root, std::vector<Diagnostic> &diagnostics)
+{
+    Resolver resolver(diagnostics);
+    resolver.traverse(root);
+    return resolver.bound;
+}
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <utility>
+#include <rope.hxx>
+
+struct Rope::Node
+{
+    std::string chunk;
+    uint32_t priority;
+    size_t chunkNewlines = 0;
+    size_t bytes = 0;    /**< Bytes in the subtree */
+    size_t newlines = 0; /**< '\n' in the subtree */
+    std::unique_ptr<Node> left;
+    std::unique_ptr<Node> right;
+
+    Node(std::string_view text, uint32_t priority) : chunk(text), priority(priority)
+    {
+        chunkChanged();
+    }
+
+    void chunkChanged()
+    {
+        chunkNewlines = static_cast<size_t>(std::count(chunk.begin(), chunk.end(), '\n'));
+        update();
+    }
+
+    void update()
+    {
+        bytes = chunk.size();
+        newlines = chunkNewlines;
+        if (left)
+        {
+            bytes += left->bytes;
+            newlines += left->newlines;
+        }
+        if (right)
+        {
+            bytes += right->bytes;
+            newlines += right->newlines;
+        }
+    }
+};
+
+namespace
+{
+    using Node = Rope::Node;
+    using NodePtr = std::unique_ptr<Node>;
+
+    size_t bytesOf(const NodePtr &t) { return t ? t->bytes : 0; }
+    size_t newlinesOf(const NodePtr &t) { return t ? t->newlines : 0; }
+
+    NodePtr merge(NodePtr a, NodePtr b)
+    {
+        if (!a)
+            return b;
+        if (!b)
+            return a;
+        if (a->priority > b->priority)
+        {
+            a->right = merge(std::move(a->right), std::move(b));
+            a->update();
+            return a;
+        }
+        b->left = merge(std::move(a), std::move(b->left));
+        b->update();
+        return b;
+    }
+
+    /**
+     * Split off the first `offset` bytes, cutting a chunk in two if the
+     * offset falls inside it.
+     */
+    std::pair<NodePtr, NodePtr> split(NodePtr t, size_t offset, uint32_t priority)
+    {
+        if (!t)
+            return {};
+        size_t leftBytes = bytesOf(t->left);
+        if (offset <= leftBytes)
+        {
+            auto [a, b] = split(std::move(t->left), offset, priority);
+            t->left = std::move(b);
+            t->update();
+            return {std::move(a), std::move(t)};
+        }
+        size_t chunkEnd = leftBytes + t->chunk.size();
+        if (offset >= chunkEnd)
+        {
+            auto [a, b] = split(std::move(t->right), offset - chunkEnd, priority);
+            t->right = std::move(a);
+            t->update();
+            return {std::move(t), std::move(b)};
+        }
+
+        size_t cut = offset - leftBytes;
+        auto tail = std::make_unique<Node>(std::string_view(t->chunk).substr(cut), priority);
+        t->chunk.resize(cut);
+        NodePtr right = std::move(t->right);
+        t->chunkChanged();
+        return {std::move(t), merge(std::move(tail), std::move(right))};
+    }
+
+    Node *rightmost(Node *t)
+    {
+        while (t->right)
+            t = t->right.get();
+        return t;
+    }
+
+    Node *leftmost(Node *t)
+    {
+        while (t->left)
+            t = t->left.get();
+        return t;
+    }
+
+    void appendRightmost(Node *t, std::string_view text)
+    {
+        if (t->right)
+        {
+            appendRightmost(t->right.get(), text);
+            t->update();
+        }
+        else
+        {
+            t->chunk.append(text);
+            t->chunkChanged();
+        }
+    }
+
+    std::string popLeftmost(NodePtr &t)
+    {
+        if (!t->left)
+        {
+            std::string chunk = std::move(t->chunk);
+            t = std::move(t->right);
+            return chunk;
+        }
+        std::string chunk = popLeftmost(t->left);
+        t->update();
+        return chunk;
+    }
+
+    /**
+     * Concatenate, merging the chunks at the seam if they fit in one.
+     */
+    NodePtr join(NodePtr a, NodePtr b)
+    {
+        if (!a)
+            return b;
+        if (!b)
+            return a;
+        if (rightmost(a.get())->chunk.size() + leftmost(b.get())->chunk.size() <= Rope::MaxChunk)
+            appendRightmost(a.get(), popLeftmost(b));
+        return merge(std::move(a), std::move(b));
+    }
+
+    /**
+     * Call `visit` with the pieces of text from `from` on, in order, until it
+     * returns false. Returns false if it was stopped.
+     */
+    template <typename Visit>
+    bool scan(const Node *t, size_t from, Visit &visit)
+    {
+        if (!t)
+            return true;
+        size_t leftBytes = bytesOf(t->left);
+        if (from < leftBytes && !scan(t->left.get(), from, visit))
+            return false;
+        size_t start = from > leftBytes ? from - leftBytes : 0;
+        if (start < t->chunk.size() && !visit(std::string_view(t->chunk).substr(start)))
+            return false;
+        size_t chunkEnd = leftBytes + t->chunk.size();
+        return scan(t->right.get(), from > chunkEnd ? from - chunkEnd : 0, visit);
+    }
+}
+
+Rope::Rope() = default;
+Rope::Rope(Rope &&other) noexcept = default;
+Rope &Rope::operator=(Rope &&other) noexcept = default;
+Rope::~Rope() = default;
+
+Rope::Rope(std::string_view text)
+{
+    root = build(text);
+    edited();
+}
+
+uint32_t Rope::nextPriority()
+{
+    // xorshift32: treap priorities only need to look random.
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+std::unique_ptr<Rope::Node> Rope::build(std::string_view text)
+{
+    NodePtr t;
+    for (size_t at = 0; at < text.size(); at += MaxChunk)
+        t = merge(std::move(t), std::make_unique<Node>(text.substr(at, MaxChunk), nextPriority()));
+    return t;
+}
+
+size_t Rope::size() const { return bytesOf(root); }
+
+size_t Rope::lineCount() const { return newlinesOf(root) + 1; }
+
+void Rope::insert(size_t offset, std::string_view text)
+{
+    replace(offset, 0, text);
+}
+
+void Rope::erase(size_t offset, size_t length)
+{
+    replace(offset, length, {});
+}
+
+void Rope::replace(size_t offset, size_t length, std::string_view text)
+{
+    offset = std::min(offset, size());
+    length = std::min(length, size() - offset);
+    if (length == 0 && text.empty())
+        return;
+    auto [before, rest] = split(std::move(root), offset, nextPriority());
+    auto [removed, after] = split(std::move(rest), length, nextPriority());
+    root = join(join(std::move(before), build(text)), std::move(after));
+    edited();
+}
+
+size_t Rope::lineStart(size_t line) const
+{
+    if (line == 0)
+        return 0;
+    if (line > newlinesOf(root))
+        return size();
+
+    // Find the line-th '\n' and start after it.
+    size_t offset = 0;
+    size_t remaining = line;
+    const Node *t = root.get();
+    while (t)
+    {
+        if (remaining <= newlinesOf(t->left))
+        {
+            t = t->left.get();
+            continue;
+        }
+        remaining -= newlinesOf(t->left);
+        offset += bytesOf(t->left);
+        if (remaining <= t->chunkNewlines)
+        {
+            size_t at = 0;
+            for (;; ++at)
+                if (t->chunk[at] == '\n' && --remaining == 0)
+                    return offset + at + 1;
+        }
+        remaining -= t->chunkNewlines;
+        offset += t->chunk.size();
+        t = t->right.get();
+    }
+    return size();
+}
+
+size_t Rope::offsetAt(size_t line, size_t utf16Column) const
+{
+    size_t offset = lineStart(line);
+    if (line > newlinesOf(root))
+        return offset;
+
+    size_t units = 0;
+    auto visit = [&](std::string_view piece) {
+        for (char c : piece)
+        {
+            auto byte = static_cast<unsigned char>(c);
+            bool continuation = (byte & 0xC0) == 0x80;
+            if (!continuation && (units >= utf16Column || c == '\n' || c == '\r'))
+                return false;
+            if (!continuation)
+                units += byte >= 0xF0 ? 2 : 1;
+            ++offset;
+        }
+        return true;
+    };
+    scan(root.get(), offset, visit);
+    return offset;
+}
+
+std::string Rope::substr(size_t offset, size_t length) const
+{
+    std::string out;
+    length = std::min(length, size() - std::min(offset, size()));
+    out.reserve(length);
+    auto visit = [&](std::string_view piece) {
+        out.append(piece.substr(0, length - out.size()));
+        return out.size() < length;
+    };
+    if (length)
+        scan(root.get(), offset, visit);
+    return out;
+}
+
+const std::string &Rope::text() const
+{
+    if (!snapshotValid)
+    {
+        snapshot.clear();
+        snapshot.reserve(size());
+        auto visit = [&](std::string_view piece) {
+            snapshot.append(piece);
+            return true;
+        };
+        scan(root.get(), 0, visit);
+        snapshotValid = true;
+    }
+    return snapshot;
+}
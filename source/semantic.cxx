@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <semantic.hxx>
+#include <token.hxx>
+#include <visitor.hxx>
+
+namespace
+{
+    struct Classification
+    {
+        SemanticType type = SemanticType::Variable;
+        uint32_t modifiers = 0;
+    };
+
+    bool isMember(const ASTNode *decl)
+    {
+        return decl->parent && decl->parent->type == ASTNodeType::ClassDecl;
+    }
+
+    /**
+     * What a name bound to a declaration is; `unbound` is used when the
+     * resolver could not bind it.
+     */
+    Classification classify(const Binding &binding, SemanticType unbound = SemanticType::Variable)
+    {
+        if (binding.param >= 0)
+            return {SemanticType::Parameter, 0};
+        if (auto *fn = nodeAs<FunctionDeclNode>(binding.decl))
+            return {isMember(fn) ? SemanticType::Method : SemanticType::Function,
+                    fn->modifier == ModifierType::Static ? SemanticModifier::Static : 0};
+        if (auto *var = nodeAs<VarDeclNode>(binding.decl))
+        {
+            uint32_t modifiers = (var->isConst ? SemanticModifier::Readonly : 0) |
+                                 (var->modifier == ModifierType::Static ? SemanticModifier::Static : 0);
+            return {isMember(var) ? SemanticType::Property : SemanticType::Variable, modifiers};
+        }
+        if (nodeAs<ClassDeclNode>(binding.decl))
+            return {SemanticType::Class, 0};
+        return {unbound, 0};
+    }
+
+    /**
+     * Collects how the names in a resolved tree are classified. Uses are
+     * keyed by the offset of their first token. Declaration nodes start
+     * before their name (at `var`, modifiers and so on), so they are matched
+     * to the first identifier token with their name after they start.
+     */
+    struct Classifier : ASTVisitor<Classifier>
+    {
+        struct Use
+        {
+            uint32_t offset;
+            Classification what;
+            bool qualified; /**< "Class.member": `member` applies after the dot */
+            Classification member;
+        };
+
+        struct Decl
+        {
+            uint32_t begin;
+            std::string_view name;
+            Classification what;
+        };
+
+        std::vector<Use> uses;
+        std::vector<Decl> decls;
+
+        void declare(const ASTNode *node, std::string_view name, Classification what)
+        {
+            what.modifiers |= SemanticModifier::Declaration;
+            decls.push_back({node->span.begin, name, what});
+        }
+
+        void visitIdentifier(const IdentifierNode *node)
+        {
+            if (node->name.find('.') != std::string::npos)
+                uses.push_back({node->span.begin, {SemanticType::Class, 0}, true, classify(node->binding)});
+            else
+                uses.push_back({node->span.begin, classify(node->binding), false, {}});
+        }
+
+        void visitAssignExpr(const AssignExprNode *node)
+        {
+            uses.push_back({node->span.begin, classify(node->binding), false, {}});
+            traverseChildren(node);
+        }
+
+        void visitFunctionCall(const FunctionCallNode *node)
+        {
+            Classification callee = classify(node->binding, SemanticType::Function);
+            if (node->callee.find('.') != std::string::npos)
+                uses.push_back({node->span.begin, {SemanticType::Class, 0}, true, callee});
+            else
+                uses.push_back({node->span.begin, callee, false, {}});
+            traverseChildren(node);
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *node)
+        {
+            declare(node, node->name, classify(Binding{node, -1}));
+            for (const auto &param : node->params)
+                declare(node, param.second, {SemanticType::Parameter, 0});
+            traverseChildren(node);
+        }
+
+        void visitVarDecl(const VarDeclNode *node)
+        {
+            declare(node, node->name, classify(Binding{node, -1}));
+            traverseChildren(node);
+        }
+
+        void visitClassDecl(const ClassDeclNode *node)
+        {
+            declare(node, node->name, {SemanticType::Class, 0});
+            traverseChildren(node);
+        }
+    };
+
+    bool lexical(TokenType type, SemanticType &out)
+    {
+        switch (type)
+        {
+        case TokenType::Integer:
+        case TokenType::Float:
+        case TokenType::Unsigned:
+        case TokenType::Int8:
+        case TokenType::Int16:
+        case TokenType::Int32:
+        case TokenType::Int64:
+        case TokenType::UInt8:
+        case TokenType::UInt16:
+        case TokenType::UInt32:
+        case TokenType::UInt64:
+        case TokenType::Float32:
+        case TokenType::Float64:
+            out = SemanticType::Number;
+            return true;
+        case TokenType::String:
+        case TokenType::Byte:
+            out = SemanticType::String;
+            return true;
+        case TokenType::Comment:
+            out = SemanticType::Comment;
+            return true;
+        case TokenType::Boolean:
+            out = SemanticType::Keyword;
+            return true;
+        default:
+            if (type >= TokenType::KwInt8 && type <= TokenType::KwVoid)
+                out = SemanticType::Type;
+            else if (type >= TokenType::KwPublic && type < TokenType::EndOfFile)
+                out = SemanticType::Keyword;
+            else
+                return false;
+            return true;
+        }
+    }
+
+    /**
+     * Walks the text once, turning byte offsets into lines and UTF-16 columns.
+     */
+    struct Cursor
+    {
+        const std::string &text;
+        size_t at = 0;
+        uint32_t line = 0;
+        uint32_t column = 0;
+
+        void advance(size_t to)
+        {
+            for (; at < to; ++at)
+            {
+                auto byte = static_cast<unsigned char>(text[at]);
+                if (byte == '\n')
+                {
+                    ++line;
+                    column = 0;
+                }
+                else if ((byte & 0xC0) != 0x80)
+                    column += byte >= 0xF0 ? 2 : 1;
+            }
+        }
+    };
+
+    /** UTF-16 length of a token, up to the end of its first line. */
+    uint32_t utf16Length(std::string_view lexeme)
+    {
+        uint32_t units = 0;
+        for (char c : lexeme)
+        {
+            auto byte = static_cast<unsigned char>(c);
+            if (byte == '\n')
+                break;
+            if ((byte & 0xC0) != 0x80)
+                units += byte >= 0xF0 ? 2 : 1;
+        }
+        return units;
+    }
+}
+
+std::vector<uint32_t> encodeSemanticTokens(const std::string &text, const ASTNode *root)
+{
+    Classifier classifier;
+    if (root)
+        classifier.traverse(root);
+    auto &uses = classifier.uses;
+    std::stable_sort(uses.begin(), uses.end(), [](const auto &a, const auto &b) { return a.offset < b.offset; });
+    const auto &decls = classifier.decls;
+
+    std::vector<uint32_t> data;
+    data.reserve(text.size() / 2);
+    Lexer lexer(text, "");
+    Cursor cursor{lexer.Source};
+    uint32_t previousLine = 0;
+    uint32_t previousColumn = 0;
+    size_t nextUse = 0;
+    size_t nextDecl = 0;
+    std::vector<const Classifier::Decl *> open; // Declarations whose name has not been seen yet
+    const Classifier::Use *qualifier = nullptr;  // Set between "Class" and "." of a qualified call
+    TokenType previous = TokenType::Illegal;
+
+    for (Token token = lexer.next(); token.Type != TokenType::EndOfFile; previous = token.Type, token = lexer.next())
+    {
+        auto offset = static_cast<uint32_t>(token.Lexeme.data() - lexer.Source.data());
+        Classification what;
+        if (token.Type == TokenType::Identifier)
+        {
+            while (nextDecl < decls.size() && decls[nextDecl].begin <= offset)
+                open.push_back(&decls[nextDecl++]);
+            while (nextUse < uses.size() && uses[nextUse].offset < offset)
+                ++nextUse;
+
+            auto decl = std::find_if(open.begin(), open.end(), [&](const auto *d) { return d->name == token.Lexeme; });
+            if (decl != open.end())
+            {
+                what = (*decl)->what;
+                open.erase(decl);
+                qualifier = nullptr;
+            }
+            else if (nextUse < uses.size() && uses[nextUse].offset == offset)
+            {
+                what = uses[nextUse].what;
+                qualifier = uses[nextUse].qualified ? &uses[nextUse] : nullptr;
+            }
+            else if (qualifier && previous == TokenType::Dot)
+            {
+                what = qualifier->member;
+                qualifier = nullptr;
+            }
+        }
+        else if (!lexical(token.Type, what.type))
+            continue;
+
+        cursor.advance(offset);
+        data.push_back(cursor.line - previousLine);
+        data.push_back(cursor.line == previousLine ? cursor.column - previousColumn : cursor.column);
+        data.push_back(utf16Length(token.Lexeme));
+        data.push_back(static_cast<uint32_t>(what.type));
+        data.push_back(what.modifiers);
+        previousLine = cursor.line;
+        previousColumn = cursor.column;
+    }
+    return data;
+}
+
+SemanticTokensEdit diffSemanticTokens(const std::vector<uint32_t> &previous, const std::vector<uint32_t> &current)
+{
+    size_t limit = std::min(previous.size(), current.size());
+    size_t prefix = static_cast<size_t>(std::mismatch(previous.begin(), previous.begin() + static_cast<std::ptrdiff_t>(limit), current.begin()).first - previous.begin());
+    prefix -= prefix % 5;
+
+    size_t suffix = 0;
+    while (suffix < limit - prefix && previous[previous.size() - 1 - suffix] == current[current.size() - 1 - suffix])
+        ++suffix;
+    suffix -= suffix % 5;
+
+    SemanticTokensEdit edit;
+    edit.start = static_cast<uint32_t>(prefix);
+    edit.deleteCount = static_cast<uint32_t>(previous.size() - prefix - suffix);
+    edit.data.assign(current.begin() + static_cast<std::ptrdiff_t>(prefix), current.end() - static_cast<std::ptrdiff_t>(suffix));
+    return edit;
+}
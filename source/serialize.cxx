@@ -0,0 +1,582 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <serialize.hxx>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char magic[4] = {'V', 'S', 'A', 'T'};
+
+    struct Writer
+    {
+        std::string body;
+        std::vector<std::string_view> strings;
+        std::unordered_map<std::string_view, uint32_t> stringIds;
+
+        void byte(uint8_t b) { body.push_back(static_cast<char>(b)); }
+
+        void varint(uint64_t v)
+        {
+            while (v >= 0x80)
+            {
+                byte(static_cast<uint8_t>(v | 0x80));
+                v >>= 7;
+            }
+            byte(static_cast<uint8_t>(v));
+        }
+
+        void svarint(int64_t v) { varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+
+        void fixed(uint64_t bits, int size)
+        {
+            for (int i = 0; i < size; ++i)
+                byte(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+
+        // Names point into the AST being serialized, which outlives the writer.
+        void str(std::string_view s)
+        {
+            auto [it, inserted] = stringIds.try_emplace(s, static_cast<uint32_t>(strings.size()));
+            if (inserted)
+                strings.push_back(s);
+            varint(it->second);
+        }
+
+        void literal(const LiteralValue &value)
+        {
+            varint(value.index());
+            std::visit([this](const auto &v)
+                       {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, std::string>)
+                    str(v);
+                else if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, char>)
+                    byte(static_cast<uint8_t>(v));
+                else if constexpr (std::is_same_v<T, float>)
+                {
+                    uint32_t bits;
+                    std::memcpy(&bits, &v, sizeof(bits));
+                    fixed(bits, 4);
+                }
+                else if constexpr (std::is_same_v<T, double>)
+                {
+                    uint64_t bits;
+                    std::memcpy(&bits, &v, sizeof(bits));
+                    fixed(bits, 8);
+                }
+                else if constexpr (std::is_signed_v<T>)
+                    svarint(v);
+                else
+                    varint(v); },
+                       value);
+        }
+
+        void node(const ASTNode *n)
+        {
+            if (!n)
+            {
+                varint(0);
+                return;
+            }
+            varint(static_cast<uint64_t>(n->type) + 1);
+            varint(n->span.file);
+            varint(n->span.begin);
+            varint(n->span.end - n->span.begin);
+
+            switch (n->type)
+            {
+            case ASTNodeType::Block:
+            {
+                const auto *blk = static_cast<const BlockNode *>(n);
+                varint(blk->children.size());
+                for (const auto &child : blk->children)
+                    node(child.get());
+                break;
+            }
+            case ASTNodeType::Literal:
+            {
+                const auto *lit = static_cast<const LiteralNode *>(n);
+                varint(static_cast<uint64_t>(lit->literalType));
+                literal(lit->value);
+                break;
+            }
+            case ASTNodeType::Identifier:
+                str(static_cast<const IdentifierNode *>(n)->name);
+                break;
+            case ASTNodeType::BinaryExpr:
+            {
+                const auto *bin = static_cast<const BinaryExprNode *>(n);
+                str(bin->op);
+                node(bin->left.get());
+                node(bin->right.get());
+                break;
+            }
+            case ASTNodeType::FunctionDecl:
+            {
+                const auto *fn = static_cast<const FunctionDeclNode *>(n);
+                str(fn->name);
+                varint(static_cast<uint64_t>(fn->access));
+                varint(static_cast<uint64_t>(fn->modifier));
+                varint(static_cast<uint64_t>(fn->returnType));
+                varint(fn->params.size());
+                for (const auto &p : fn->params)
+                {
+                    varint(static_cast<uint64_t>(p.first));
+                    str(p.second);
+                }
+                node(fn->body.get());
+                break;
+            }
+            case ASTNodeType::ReturnExpr:
+                node(static_cast<const ReturnExprNode *>(n)->expr.get());
+                break;
+            case ASTNodeType::VarDecl:
+            {
+                const auto *var = static_cast<const VarDeclNode *>(n);
+                byte(var->isConst ? 1 : 0);
+                str(var->name);
+                varint(static_cast<uint64_t>(var->varType));
+                varint(static_cast<uint64_t>(var->modifier));
+                varint(static_cast<uint64_t>(var->access));
+                node(var->value.get());
+                break;
+            }
+            case ASTNodeType::IfExpr:
+            {
+                const auto *ifn = static_cast<const IfExprNode *>(n);
+                node(ifn->condition.get());
+                node(ifn->thenBranch.get());
+                node(ifn->elseBranch.get());
+                break;
+            }
+            case ASTNodeType::AssignExpr:
+            {
+                const auto *as = static_cast<const AssignExprNode *>(n);
+                str(as->name);
+                node(as->value.get());
+                break;
+            }
+            case ASTNodeType::FunctionCall:
+            {
+                const auto *call = static_cast<const FunctionCallNode *>(n);
+                str(call->callee);
+                varint(call->args.size());
+                for (const auto &arg : call->args)
+                    node(arg.get());
+                break;
+            }
+            case ASTNodeType::ClassDecl:
+            {
+                const auto *cls = static_cast<const ClassDeclNode *>(n);
+                str(cls->name);
+                varint(static_cast<uint64_t>(cls->access));
+                node(cls->body.get());
+                break;
+            }
+            default:
+                throw std::runtime_error("Cannot serialize AST node of type " + std::to_string(static_cast<int>(n->type)));
+            }
+        }
+    };
+
+    struct Reader
+    {
+        const uint8_t *pos;
+        const uint8_t *end;
+        std::vector<std::string_view> strings;
+        uint32_t depth = 0;
+
+        [[noreturn]] static void corrupt(const char *what)
+        {
+            throw std::runtime_error(std::string("Invalid AST file: ") + what);
+        }
+
+        uint8_t byte()
+        {
+            if (pos == end)
+                corrupt("unexpected end of data");
+            return *pos++;
+        }
+
+        uint64_t varint()
+        {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                uint8_t b = byte();
+                v |= static_cast<uint64_t>(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return v;
+            }
+            corrupt("varint too long");
+        }
+
+        int64_t svarint()
+        {
+            uint64_t v = varint();
+            return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+        }
+
+        uint64_t fixed(int size)
+        {
+            if (end - pos < size)
+                corrupt("unexpected end of data");
+            uint64_t v = 0;
+            for (int i = 0; i < size; ++i)
+                v |= static_cast<uint64_t>(pos[i]) << (8 * i);
+            pos += size;
+            return v;
+        }
+
+        size_t count()
+        {
+            uint64_t n = varint();
+            // Every element takes at least one byte, which bounds hostile counts.
+            if (n > static_cast<uint64_t>(end - pos))
+                corrupt("count exceeds data size");
+            return static_cast<size_t>(n);
+        }
+
+        std::string_view str()
+        {
+            uint64_t id = varint();
+            if (id >= strings.size())
+                corrupt("string index out of range");
+            return strings[id];
+        }
+
+        template <typename E>
+        E enumValue(E last)
+        {
+            uint64_t v = varint();
+            if (v > static_cast<uint64_t>(last))
+                corrupt("enum value out of range");
+            return static_cast<E>(v);
+        }
+
+        Type type() { return enumValue(Type::Float64); }
+
+        template <size_t I = 0>
+        LiteralValue literalAlternative(size_t index)
+        {
+            if constexpr (I < std::variant_size_v<LiteralValue>)
+            {
+                if (index != I)
+                    return literalAlternative<I + 1>(index);
+                using T = std::variant_alternative_t<I, LiteralValue>;
+                if constexpr (std::is_same_v<T, std::string>)
+                    return LiteralValue(std::in_place_index<I>, std::string(str()));
+                else if constexpr (std::is_same_v<T, bool>)
+                    return LiteralValue(std::in_place_index<I>, byte() != 0);
+                else if constexpr (std::is_same_v<T, char>)
+                    return LiteralValue(std::in_place_index<I>, static_cast<char>(byte()));
+                else if constexpr (std::is_same_v<T, float>)
+                {
+                    uint32_t bits = static_cast<uint32_t>(fixed(4));
+                    float f;
+                    std::memcpy(&f, &bits, sizeof(f));
+                    return LiteralValue(std::in_place_index<I>, f);
+                }
+                else if constexpr (std::is_same_v<T, double>)
+                {
+                    uint64_t bits = fixed(8);
+                    double d;
+                    std::memcpy(&d, &bits, sizeof(d));
+                    return LiteralValue(std::in_place_index<I>, d);
+                }
+                else if constexpr (std::is_signed_v<T>)
+                    return LiteralValue(std::in_place_index<I>, static_cast<T>(svarint()));
+                else
+                    return LiteralValue(std::in_place_index<I>, static_cast<T>(varint()));
+            }
+            else
+            {
+                (void)index;
+                corrupt("literal kind out of range");
+            }
+        }
+
+        ASTNodePtr node()
+        {
+            uint64_t tag = varint();
+            if (tag == 0)
+                return nullptr;
+            if (tag - 1 > static_cast<uint64_t>(ASTNodeType::ClassDecl))
+                corrupt("unknown node type");
+
+            SourceSpan span;
+            uint64_t file = varint();
+            uint64_t begin = varint();
+            uint64_t length = varint();
+            if (file > UINT16_MAX || begin + length > UINT32_MAX)
+                corrupt("span out of range");
+            span.file = static_cast<uint16_t>(file);
+            span.begin = static_cast<uint32_t>(begin);
+            span.end = static_cast<uint32_t>(begin + length);
+
+            if (++depth > VSAST_MAX_DEPTH)
+                corrupt("nesting too deep");
+            ASTNodePtr n = nodeBody(static_cast<ASTNodeType>(tag - 1));
+            --depth;
+            n->span = span;
+            return n;
+        }
+
+        ASTNodePtr nodeBody(ASTNodeType kind)
+        {
+            switch (kind)
+            {
+            case ASTNodeType::Block:
+            {
+                auto blk = std::make_unique<BlockNode>();
+                size_t n = count();
+                blk->children.reserve(n);
+                for (size_t i = 0; i < n; ++i)
+                    blk->children.push_back(node());
+                return blk;
+            }
+            case ASTNodeType::Literal:
+            {
+                Type t = type();
+                LiteralValue value = literalAlternative(varint());
+                return std::make_unique<LiteralNode>(t, std::move(value));
+            }
+            case ASTNodeType::Identifier:
+                return std::make_unique<IdentifierNode>(std::string(str()));
+            case ASTNodeType::BinaryExpr:
+            {
+                std::string op(str());
+                ASTNodePtr left = node();
+                ASTNodePtr right = node();
+                return std::make_unique<BinaryExprNode>(std::move(op), std::move(left), std::move(right));
+            }
+            case ASTNodeType::FunctionDecl:
+            {
+                std::string name(str());
+                AccessType access = enumValue(AccessType::Private);
+                ModifierType modifier = enumValue(ModifierType::Override);
+                Type returnType = type();
+                std::vector<std::pair<Type, std::string>> params(count());
+                for (auto &p : params)
+                {
+                    p.first = type();
+                    p.second = std::string(str());
+                }
+                ASTNodePtr body = node();
+                return std::make_unique<FunctionDeclNode>(modifier, std::move(name), std::move(params), returnType, std::move(body), access);
+            }
+            case ASTNodeType::ReturnExpr:
+                return std::make_unique<ReturnExprNode>(node());
+            case ASTNodeType::VarDecl:
+            {
+                bool isConst = byte() != 0;
+                std::string name(str());
+                Type varType = type();
+                ModifierType modifier = enumValue(ModifierType::Override);
+                AccessType access = enumValue(AccessType::Private);
+                ASTNodePtr value = node();
+                return std::make_unique<VarDeclNode>(isConst, std::move(name), varType, std::move(value), modifier, access);
+            }
+            case ASTNodeType::IfExpr:
+            {
+                ASTNodePtr cond = node();
+                ASTNodePtr thenB = node();
+                ASTNodePtr elseB = node();
+                return std::make_unique<IfExprNode>(std::move(cond), std::move(thenB), std::move(elseB));
+            }
+            case ASTNodeType::AssignExpr:
+            {
+                std::string name(str());
+                return std::make_unique<AssignExprNode>(std::move(name), node());
+            }
+            case ASTNodeType::FunctionCall:
+            {
+                std::string callee(str());
+                ASTNodeList args(count());
+                for (auto &arg : args)
+                    arg = node();
+                return std::make_unique<FunctionCallNode>(std::move(callee), std::move(args));
+            }
+            case ASTNodeType::ClassDecl:
+            {
+                std::string name(str());
+                AccessType access = enumValue(AccessType::Private);
+                auto cls = std::make_unique<ClassDeclNode>(std::move(name), access, node());
+                // The parser links the members of a class body back to the class.
+                if (cls->body && cls->body->type == ASTNodeType::Block)
+                    for (auto &member : static_cast<BlockNode *>(cls->body.get())->children)
+                        if (member)
+                            member->parent = cls.get();
+                return cls;
+            }
+            default:
+                corrupt("unsupported node type");
+            }
+        }
+    };
+
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string &path)
+        {
+#if defined(_WIN32)
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("Cannot open AST file: " + path);
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize))
+            {
+                CloseHandle(file);
+                throw std::runtime_error("Cannot stat AST file: " + path);
+            }
+            size = static_cast<size_t>(fileSize.QuadPart);
+            if (size == 0)
+                return;
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping)
+                data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!data)
+            {
+                if (mapping)
+                    CloseHandle(mapping);
+                CloseHandle(file);
+                throw std::runtime_error("Cannot map AST file: " + path);
+            }
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open AST file: " + path);
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Cannot stat AST file: " + path);
+            }
+            size = static_cast<size_t>(st.st_size);
+            if (size > 0)
+            {
+                void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw std::runtime_error("Cannot map AST file: " + path);
+                }
+                ::madvise(p, size, MADV_SEQUENTIAL);
+                data = static_cast<const uint8_t *>(p);
+            }
+            ::close(fd);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#if defined(_WIN32)
+            if (data)
+                UnmapViewOfFile(data);
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+#else
+            if (data)
+                ::munmap(const_cast<uint8_t *>(data), size);
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        std::string_view view() const { return {reinterpret_cast<const char *>(data), size}; }
+
+    private:
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+#if defined(_WIN32)
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+    };
+}
+
+std::string serializeAST(const ASTNode *root)
+{
+    Writer w;
+    w.node(root);
+
+    Writer header;
+    header.body.append(magic, sizeof(magic));
+    header.varint(VSAST_VERSION);
+    header.varint(w.strings.size());
+    for (std::string_view s : w.strings)
+    {
+        header.varint(s.size());
+        header.body.append(s.data(), s.size());
+    }
+    header.varint(w.body.size());
+
+    std::string out;
+    out.reserve(header.body.size() + w.body.size());
+    out += header.body;
+    out += w.body;
+    return out;
+}
+
+ASTNodePtr deserializeAST(std::string_view data)
+{
+    Reader r{reinterpret_cast<const uint8_t *>(data.data()),
+             reinterpret_cast<const uint8_t *>(data.data()) + data.size(),
+             {}};
+
+    if (data.size() < sizeof(magic) || std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+        Reader::corrupt("bad magic");
+    r.pos += sizeof(magic);
+    if (r.varint() != VSAST_VERSION)
+        throw std::runtime_error("Unsupported AST file version");
+
+    // String table entries are views into the input, nothing is copied until a
+    // node takes ownership of its name.
+    size_t stringCount = r.count();
+    r.strings.reserve(stringCount);
+    for (size_t i = 0; i < stringCount; ++i)
+    {
+        size_t len = r.count();
+        r.strings.emplace_back(reinterpret_cast<const char *>(r.pos), len);
+        r.pos += len;
+    }
+
+    size_t bodySize = r.count();
+    if (bodySize != static_cast<size_t>(r.end - r.pos))
+        Reader::corrupt("body size mismatch");
+
+    ASTNodePtr root = r.node();
+    if (r.pos != r.end)
+        Reader::corrupt("trailing data");
+    return root;
+}
+
+void writeASTFile(const std::string &path, const ASTNode *root)
+{
+    std::string bytes = serializeAST(root);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out)
+        throw std::runtime_error("Cannot write AST file: " + path);
+}
+
+ASTNodePtr loadASTFile(const std::string &path)
+{
+    MappedFile file(path);
+    return deserializeAST(file.view());
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <stdexcept>
+#include <source.hxx>
+
+LineTable::LineTable(std::string_view text)
+{
+    starts.push_back(0);
+    for (size_t i = 0; i < text.size(); ++i)
+        if (text[i] == '\n')
+            starts.push_back(static_cast<uint32_t>(i + 1));
+}
+
+LineColumn LineTable::resolve(uint32_t offset) const
+{
+    auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+    uint32_t line = static_cast<uint32_t>(it - starts.begin());
+    return LineColumn{line, offset - starts[line - 1] + 1};
+}
+
+uint32_t LineTable::utf16Column(std::string_view text, uint32_t offset) const
+{
+    uint32_t units = 0;
+    for (uint32_t i = lineStart(resolve(offset).line); i < offset && i < text.size(); ++i)
+    {
+        // Four-byte sequences are surrogate pairs; continuation bytes add nothing.
+        auto byte = static_cast<unsigned char>(text[i]);
+        if ((byte & 0xC0) != 0x80)
+            units += byte >= 0xF0 ? 2 : 1;
+    }
+    return units;
+}
+
+uint32_t LineTable::utf16Offset(std::string_view text, uint32_t line, uint32_t column) const
+{
+    if (line >= starts.size())
+        return static_cast<uint32_t>(text.size());
+    uint32_t offset = starts[line];
+    for (uint32_t units = 0; offset < text.size() && text[offset] != '\n' && units < column; ++offset)
+    {
+        auto byte = static_cast<unsigned char>(text[offset]);
+        if ((byte & 0xC0) != 0x80)
+            units += byte >= 0xF0 ? 2 : 1;
+    }
+    // Never stop inside a character.
+    while (offset < text.size() && (static_cast<unsigned char>(text[offset]) & 0xC0) == 0x80)
+        ++offset;
+    return offset;
+}
+
+uint16_t SourceManager::addFile(std::string name, std::string text)
+{
+    if (files.size() > UINT16_MAX)
+        throw std::runtime_error("Too many source files");
+    if (text.size() > UINT32_MAX)
+        throw std::runtime_error("Source file too large: " + name);
+    File &file = files.emplace_back();
+    file.name = std::move(name);
+    file.text = std::move(text);
+    return static_cast<uint16_t>(files.size() - 1);
+}
+
+uint16_t SourceManager::addFile(std::string name)
+{
+    uint16_t id = addFile(std::move(name), std::string());
+    files[id].hasText = false;
+    return id;
+}
+
+const LineTable &SourceManager::lines(uint16_t file) const
+{
+    const File &f = files.at(file);
+    std::call_once(f.linesBuilt, [&f]
+                   { f.lines = std::make_unique<LineTable>(f.text); });
+    return *f.lines;
+}
+
+LineColumn SourceManager::resolve(const SourceSpan &span) const
+{
+    return lines(span.file).resolve(span.begin);
+}
+
+std::string SourceManager::describe(const SourceSpan &span) const
+{
+    if (!files.at(span.file).hasText)
+        return name(span.file);
+    LineColumn lc = resolve(span);
+    return name(span.file) + ":" + std::to_string(lc.line) + ":" + std::to_string(lc.column);
+}
+
+std::string SourceManager::format(const Diagnostic &diagnostic) const
+{
+    const char *severity = diagnostic.severity == Severity::Error     ? "error"
+                           : diagnostic.severity == Severity::Warning ? "warning"
+                                                                      : "note";
+    return describe(diagnostic.span) + ": " + severity + ": " + diagnostic.message;
+}
@@ -0,0 +1,422 @@
+#include <cstring>
+#include <hash.hxx>
+#include <structural.hxx>
+#include <token.hxx>
+#include <string.hxx>
+#include <visitor.hxx>
+
+namespace
+{
+    constexpr uint64_t nullHash = 0x6e756c6c6e6f6465ULL;
+
+    uint64_t literalHash(const LiteralNode *lit)
+    {
+        uint64_t h = hash::combine(static_cast<uint64_t>(lit->literalType), lit->value.index());
+        return std::visit([h](const auto &v)
+                          {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::string>)
+                return hash::combine(h, hash::string(v));
+            else if constexpr (std::is_same_v<T, float>)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &v, sizeof(bits));
+                return hash::combine(h, bits);
+            }
+            else if constexpr (std::is_same_v<T, double>)
+            {
+                uint64_t bits;
+                std::memcpy(&bits, &v, sizeof(bits));
+                return hash::combine(h, bits);
+            }
+            else
+                return hash::combine(h, static_cast<uint64_t>(v)); },
+                          lit->value);
+    }
+
+    struct Hasher : ASTVisitor<Hasher>
+    {
+        StructuralHashes *table;
+        uint64_t last = nullHash;
+
+        explicit Hasher(StructuralHashes *table) : table(table) {}
+
+        uint64_t of(const ASTNode *node)
+        {
+            if (!node)
+                return nullHash;
+            traverse(node);
+            return last;
+        }
+
+        static uint64_t start(const ASTNode *node) { return hash::combine(0x9ae16a3b2f90404fULL, static_cast<uint64_t>(node->type)); }
+
+        void done(const ASTNode *node, uint64_t h)
+        {
+            last = h;
+            if (table)
+                table->emplace(node, h);
+        }
+
+        void visitBlock(const BlockNode *blk)
+        {
+            uint64_t h = hash::combine(start(blk), blk->children.size());
+            for (const auto &child : blk->children)
+                h = hash::combine(h, of(child.get()));
+            done(blk, h);
+        }
+
+        void visitLiteral(const LiteralNode *lit) { done(lit, hash::combine(start(lit), literalHash(lit))); }
+
+        void visitIdentifier(const IdentifierNode *id) { done(id, hash::combine(start(id), hash::string(id->name))); }
+
+        void visitBinaryExpr(const BinaryExprNode *bin)
+        {
+            uint64_t h = hash::combine(start(bin), hash::string(bin->op));
+            h = hash::combine(h, of(bin->left.get()));
+            h = hash::combine(h, of(bin->right.get()));
+            done(bin, h);
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn)
+        {
+            uint64_t h = hash::combine(start(fn), hash::string(fn->name));
+            h = hash::combine(h, static_cast<uint64_t>(fn->access));
+            h = hash::combine(h, static_cast<uint64_t>(fn->modifier));
+            h = hash::combine(h, static_cast<uint64_t>(fn->returnType));
+            for (const auto &param : fn->params)
+                h = hash::combine(hash::combine(h, static_cast<uint64_t>(param.first)), hash::string(param.second));
+            h = hash::combine(h, of(fn->body.get()));
+            done(fn, h);
+        }
+
+        void visitReturnExpr(const ReturnExprNode *ret) { done(ret, hash::combine(start(ret), of(ret->expr.get()))); }
+
+        void visitVarDecl(const VarDeclNode *var)
+        {
+            uint64_t h = hash::combine(start(var), var->isConst);
+            h = hash::combine(h, hash::string(var->name));
+            h = hash::combine(h, static_cast<uint64_t>(var->varType));
+            h = hash::combine(h, static_cast<uint64_t>(var->modifier));
+            h = hash::combine(h, static_cast<uint64_t>(var->access));
+            h = hash::combine(h, of(var->value.get()));
+            done(var, h);
+        }
+
+        void visitIfExpr(const IfExprNode *ifn)
+        {
+            uint64_t h = hash::combine(start(ifn), of(ifn->condition.get()));
+            h = hash::combine(h, of(ifn->thenBranch.get()));
+            h = hash::combine(h, of(ifn->elseBranch.get()));
+            done(ifn, h);
+        }
+
+        void visitAssignExpr(const AssignExprNode *as)
+        {
+            uint64_t h = hash::combine(start(as), hash::string(as->name));
+            done(as, hash::combine(h, of(as->value.get())));
+        }
+
+        void visitFunctionCall(const FunctionCallNode *call)
+        {
+            uint64_t h = hash::combine(start(call), hash::string(call->callee));
+            h = hash::combine(h, call->args.size());
+            for (const auto &arg : call->args)
+                h = hash::combine(h, of(arg.get()));
+            done(call, h);
+        }
+
+        void visitClassDecl(const ClassDeclNode *cls)
+        {
+            uint64_t h = hash::combine(start(cls), hash::string(cls->name));
+            h = hash::combine(h, static_cast<uint64_t>(cls->access));
+            done(cls, hash::combine(h, of(cls->body.get())));
+        }
+
+        void visitUnknown(const ASTNode *node) { done(node, start(node)); }
+    };
+
+    bool isExpression(const ASTNode *node)
+    {
+        switch (node->type)
+        {
+        case ASTNodeType::Literal:
+        case ASTNodeType::Identifier:
+        case ASTNodeType::BinaryExpr:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+uint64_t structuralHash(const ASTNode *root)
+{
+    return Hasher(nullptr).of(root);
+}
+
+uint64_t computeStructuralHashes(const ASTNode *root, StructuralHashes &out)
+{
+    return Hasher(&out).of(root);
+}
+
+bool structurallyEqual(const ASTNode *a, const ASTNode *b)
+{
+    if (a == b)
+        return true;
+    if (!a || !b || a->type != b->type)
+        return false;
+
+    switch (a->type)
+    {
+    case ASTNodeType::Block:
+    {
+        const auto &x = static_cast<const BlockNode *>(a)->children;
+        const auto &y = static_cast<const BlockNode *>(b)->children;
+        if (x.size() != y.size())
+            return false;
+        for (size_t i = 0; i < x.size(); ++i)
+            if (!structurallyEqual(x[i].get(), y[i].get()))
+                return false;
+        return true;
+    }
+    case ASTNodeType::Literal:
+    {
+        const auto *x = static_cast<const LiteralNode *>(a);
+        const auto *y = static_cast<const LiteralNode *>(b);
+        if (x->literalType != y->literalType || x->value.index() != y->value.index())
+            return false;
+        // Compare bit patterns so that -0.0 and 0.0 differ and NaNs match themselves.
+        return std::visit([y](const auto &v)
+                          {
+            using T = std::decay_t<decltype(v)>;
+            const T &w = std::get<T>(y->value);
+            if constexpr (std::is_floating_point_v<T>)
+                return std::memcmp(&v, &w, sizeof(T)) == 0;
+            else
+                return v == w; },
+                          x->value);
+    }
+    case ASTNodeType::Identifier:
+        return static_cast<const IdentifierNode *>(a)->name == static_cast<const IdentifierNode *>(b)->name;
+    case ASTNodeType::BinaryExpr:
+    {
+        const auto *x = static_cast<const BinaryExprNode *>(a);
+        const auto *y = static_cast<const BinaryExprNode *>(b);
+        return x->op == y->op && structurallyEqual(x->left.get(), y->left.get()) && structurallyEqual(x->right.get(), y->right.get());
+    }
+    case ASTNodeType::FunctionDecl:
+    {
+        const auto *x = static_cast<const FunctionDeclNode *>(a);
+        const auto *y = static_cast<const FunctionDeclNode *>(b);
+        return x->name == y->name && x->access == y->access && x->modifier == y->modifier && x->returnType == y->returnType &&
+               x->params == y->params && structurallyEqual(x->body.get(), y->body.get());
+    }
+    case ASTNodeType::ReturnExpr:
+        return structurallyEqual(static_cast<const ReturnExprNode *>(a)->expr.get(), static_cast<const ReturnExprNode *>(b)->expr.get());
+    case ASTNodeType::VarDecl:
+    {
+        const auto *x = static_cast<const VarDeclNode *>(a);
+        const auto *y = static_cast<const VarDeclNode *>(b);
+        return x->isConst == y->isConst && x->name == y->name && x->varType == y->varType && x->modifier == y->modifier &&
+               x->access == y->access && structurallyEqual(x->value.get(), y->value.get());
+    }
+    case ASTNodeType::IfExpr:
+    {
+        const auto *x = static_cast<const IfExprNode *>(a);
+        const auto *y = static_cast<const IfExprNode *>(b);
+        return structurallyEqual(x->condition.get(), y->condition.get()) && structurallyEqual(x->thenBranch.get(), y->thenBranch.get()) &&
+               structurallyEqual(x->elseBranch.get(), y->elseBranch.get());
+    }
+    case ASTNodeType::AssignExpr:
+    {
+        const auto *x = static_cast<const AssignExprNode *>(a);
+        const auto *y = static_cast<const AssignExprNode *>(b);
+        return x->name == y->name && structurallyEqual(x->value.get(), y->value.get());
+    }
+    case ASTNodeType::FunctionCall:
+    {
+        const auto *x = static_cast<const FunctionCallNode *>(a);
+        const auto *y = static_cast<const FunctionCallNode *>(b);
+        if (x->callee != y->callee || x->args.size() != y->args.size())
+            return false;
+        for (size_t i = 0; i < x->args.size(); ++i)
+            if (!structurallyEqual(x->args[i].get(), y->args[i].get()))
+                return false;
+        return true;
+    }
+    case ASTNodeType::ClassDecl:
+    {
+        const auto *x = static_cast<const ClassDeclNode *>(a);
+        const auto *y = static_cast<const ClassDeclNode *>(b);
+        return x->name == y->name && x->access == y->access && structurallyEqual(x->body.get(), y->body.get());
+    }
+    default:
+        return true;
+    }
+}
+
+size_t ExprTable::internAll(const ASTNode *root)
+{
+    StructuralHashes hashes;
+    hashes.reserve(countNodes(root));
+    computeStructuralHashes(root, hashes);
+
+    // Post-order, so the children of an expression already have their IDs.
+    struct Interner : ASTVisitor<Interner>
+    {
+        ExprTable &table;
+        const StructuralHashes &hashes;
+        size_t visited = 0;
+
+        Interner(ExprTable &table, const StructuralHashes &hashes) : table(table), hashes(hashes) {}
+
+        void postVisit(const ASTNode *node)
+        {
+            if (!isExpression(node))
+                return;
+            table.intern(node, hashes.at(node));
+            ++visited;
+        }
+    } interner(*this, hashes);
+
+    interner.traverse(root);
+    return interner.visited;
+}
+
+uint32_t ExprTable::idOf(const ASTNode *node) const
+{
+    auto it = ids.find(node);
+    return it == ids.end() ? UINT32_MAX : it->second;
+}
+
+uint32_t ExprTable::intern(const ASTNode *node, uint64_t h)
+{
+    ++interned;
+
+    // Children are interned first, so comparing their class IDs is enough to
+    // compare the subtrees; only the node's own fields need a look.
+    auto sameChild = [this](const ASTNode *x, const ASTNode *y)
+    {
+        uint32_t ix = idOf(x), iy = idOf(y);
+        if (ix != UINT32_MAX || iy != UINT32_MAX)
+            return ix == iy;
+        return structurallyEqual(x, y);
+    };
+    auto shallowEqual = [&](const ASTNode *x)
+    {
+        if (x->type != node->type)
+            return false;
+        if (node->type == ASTNodeType::BinaryExpr)
+        {
+            const auto *a = static_cast<const BinaryExprNode *>(x);
+            const auto *b = static_cast<const BinaryExprNode *>(node);
+            return a->op == b->op && sameChild(a->left.get(), b->left.get()) && sameChild(a->right.get(), b->right.get());
+        }
+        return structurallyEqual(x, node);
+    };
+
+    auto range = byHash.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        Class &c = classes[it->second];
+        if (shallowEqual(c.node))
+        {
+            ++c.count;
+            ids.emplace(node, it->second);
+            return it->second;
+        }
+    }
+
+    uint32_t id = static_cast<uint32_t>(classes.size());
+    classes.push_back(Class{node, h, 1});
+    byHash.emplace(h, id);
+    ids.emplace(node, id);
+    return id;
+}
+
+namespace
+{
+    struct Decl
+    {
+        std::string name;
+        const ASTNode *node;
+    };
+
+    std::string functionKey(const std::string &prefix, const FunctionDeclNode *fn)
+    {
+        std::string key = prefix + fn->name + "(";
+        for (size_t i = 0; i < fn->params.size(); ++i)
+        {
+            if (i)
+                key += ",";
+            key += typeToString(fn->params[i].first);
+        }
+        return key + ")";
+    }
+
+    void collectDecls(const ASTNode *block, const std::string &prefix, std::vector<Decl> &out)
+    {
+        const auto *blk = nodeAs<BlockNode>(block);
+        if (!blk)
+            return;
+
+        std::unordered_map<std::string, size_t> seen;
+        for (const auto &child : blk->children)
+        {
+            const ASTNode *node = child.get();
+            std::string key;
+            if (const auto *fn = nodeAs<FunctionDeclNode>(node))
+                key = functionKey(prefix, fn);
+            else if (const auto *var = nodeAs<VarDeclNode>(node))
+                key = prefix + var->name;
+            else if (const auto *cls = nodeAs<ClassDeclNode>(node))
+                key = prefix + cls->name;
+            else
+                continue;
+
+            // Identical signatures can repeat; number them in source order.
+            size_t n = ++seen[key];
+            if (n > 1)
+                key += "#" + std::to_string(n);
+            out.push_back(Decl{key, node});
+
+            if (const auto *cls = nodeAs<ClassDeclNode>(node))
+                collectDecls(cls->body.get(), key + ".", out);
+        }
+    }
+}
+
+std::vector<DeclDiff> diffDeclarations(const ASTNode *oldRoot, const ASTNode *newRoot)
+{
+    StructuralHashes oldHashes, newHashes;
+    computeStructuralHashes(oldRoot, oldHashes);
+    computeStructuralHashes(newRoot, newHashes);
+
+    std::vector<Decl> oldDecls, newDecls;
+    collectDecls(oldRoot, "", oldDecls);
+    collectDecls(newRoot, "", newDecls);
+
+    std::unordered_map<std::string, const ASTNode *> oldByName;
+    for (const auto &d : oldDecls)
+        oldByName.emplace(d.name, d.node);
+
+    std::vector<DeclDiff> diff;
+    diff.reserve(newDecls.size() + oldDecls.size());
+    for (const auto &d : newDecls)
+    {
+        auto it = oldByName.find(d.name);
+        if (it == oldByName.end())
+        {
+            diff.push_back(DeclDiff{d.name, DeclChange::Added, nullptr, d.node});
+            continue;
+        }
+        bool same = oldHashes.at(it->second) == newHashes.at(d.node) && structurallyEqual(it->second, d.node);
+        diff.push_back(DeclDiff{d.name, same ? DeclChange::Unchanged : DeclChange::Changed, it->second, d.node});
+        oldByName.erase(it);
+    }
+    for (const auto &d : oldDecls)
+        if (oldByName.count(d.name))
+            diff.push_back(DeclDiff{d.name, DeclChange::Removed, d.node, nullptr});
+    return diff;
+}
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <transport.hxx>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Content-Length values above this are treated as malformed rather than
+    // allocated for.
+    constexpr size_t MaxMessage = size_t{1} << 30;
+
+    bool startsWithIgnoreCase(std::string_view s, std::string_view prefix)
+    {
+        if (s.size() < prefix.size())
+            return false;
+        for (size_t i = 0; i < prefix.size(); ++i)
+            if ((s[i] | 0x20) != prefix[i])
+                return false;
+        return true;
+    }
+
+    /**
+     * Find the Content-Length among the lines of a header block.
+     */
+    bool contentLength(std::string_view headers, size_t &length)
+    {
+        constexpr std::string_view name = "content-length:";
+        while (!headers.empty())
+        {
+            size_t eol = headers.find("\r\n");
+            std::string_view line = headers.substr(0, eol);
+            headers = eol == std::string_view::npos ? std::string_view{} : headers.substr(eol + 2);
+            if (!startsWithIgnoreCase(line, name))
+                continue;
+
+            size_t at = name.size();
+            while (at < line.size() && (line[at] == ' ' || line[at] == '\t'))
+                ++at;
+            size_t value = 0;
+            auto [end, ec] = std::from_chars(line.data() + at, line.data() + line.size(), value);
+            if (ec != std::errc() || end == line.data() + at || value > MaxMessage)
+                return false;
+            length = value;
+            return true;
+        }
+        return false;
+    }
+}
+
+size_t FileSource::read(char *data, size_t size)
+{
+#if defined(_WIN32)
+    int n = ::_read(fd, data, static_cast<unsigned>(std::min<size_t>(size, INT_MAX)));
+    return n > 0 ? static_cast<size_t>(n) : 0;
+#else
+    while (true)
+    {
+        ssize_t n = ::read(fd, data, size);
+        if (n >= 0)
+            return static_cast<size_t>(n);
+        if (errno != EINTR)
+            return 0;
+    }
+#endif
+}
+
+bool FileSink::write(const std::string_view *pieces, size_t count)
+{
+    size_t i = 0;
+    size_t done = 0; // Bytes of pieces[i] already written
+    while (true)
+    {
+        while (i < count && done == pieces[i].size())
+        {
+            ++i;
+            done = 0;
+        }
+        if (i == count)
+            return true;
+
+#if defined(_WIN32)
+        size_t size = std::min<size_t>(pieces[i].size() - done, INT_MAX);
+        int n = ::_write(fd, pieces[i].data() + done, static_cast<unsigned>(size));
+        if (n < 0)
+            return false;
+        done += static_cast<size_t>(n);
+#else
+#if defined(IOV_MAX)
+        constexpr size_t MaxPieces = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+        constexpr size_t MaxPieces = 16;
+#endif
+        iovec iov[MaxPieces];
+        int used = 0;
+        for (size_t j = i; j < count && static_cast<size_t>(used) < MaxPieces; ++j)
+        {
+            size_t skip = j == i ? done : 0;
+            iov[used].iov_base = const_cast<char *>(pieces[j].data() + skip);
+            iov[used].iov_len = pieces[j].size() - skip;
+            ++used;
+        }
+        ssize_t n = ::writev(fd, iov, used);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        // A short write can stop in the middle of any piece.
+        auto left = static_cast<size_t>(n);
+        while (left > 0)
+        {
+            size_t rest = pieces[i].size() - done;
+            if (left < rest)
+            {
+                done += left;
+                break;
+            }
+            left -= rest;
+            ++i;
+            done = 0;
+        }
+#endif
+    }
+}
+
+size_t StreamSource::read(char *data, size_t size)
+{
+    std::streambuf *buf = in.rdbuf();
+    // Wait for one byte, then take only what is there without blocking.
+    if (size == 0 || buf->sgetc() == std::char_traits<char>::eof())
+    {
+        in.setstate(std::ios::eofbit);
+        return 0;
+    }
+    std::streamsize available = std::max<std::streamsize>(1, buf->in_avail());
+    return static_cast<size_t>(buf->sgetn(data, std::min<std::streamsize>(available, static_cast<std::streamsize>(size))));
+}
+
+bool StreamSink::write(const std::string_view *pieces, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out.write(pieces[i].data(), static_cast<std::streamsize>(pieces[i].size()));
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+MessageReader::MessageReader(ByteSource &source, size_t capacity)
+    : source(source), buffer(std::max<size_t>(capacity, 64))
+{
+}
+
+bool MessageReader::fill(size_t needed)
+{
+    if (begin + needed > buffer.size())
+    {
+        // Move what is left to the front; grow only if it still does not fit.
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        if (needed > buffer.size())
+            buffer.resize(std::max(needed, buffer.size() * 2));
+    }
+    size_t n = source.read(buffer.data() + end, buffer.size() - end);
+    end += n;
+    return n > 0;
+}
+
+bool MessageReader::next(std::string_view &body)
+{
+    if (begin == end)
+        begin = end = 0;
+
+    size_t scanned = 0; // Header bytes from begin known not to end the headers
+    while (true)
+    {
+        std::string_view pending(buffer.data() + begin, end - begin);
+        size_t headerEnd = pending.find("\r\n\r\n", scanned);
+        if (headerEnd == std::string_view::npos)
+        {
+            scanned = pending.size() >= 3 ? pending.size() - 3 : 0;
+            if (!fill(pending.size() + 1))
+                return false;
+            continue;
+        }
+
+        size_t bodyStart = headerEnd + 4;
+        size_t length = 0;
+        if (!contentLength(pending.substr(0, headerEnd), length))
+        {
+            begin += bodyStart;
+            scanned = 0;
+            continue;
+        }
+        while (end - begin < bodyStart + length)
+            if (!fill(bodyStart + length))
+                return false;
+
+        body = std::string_view(buffer.data() + begin + bodyStart, length);
+        begin += bodyStart + length;
+        return true;
+    }
+}
+
+bool MessageWriter::write(const std::deque<std::string> &bodies)
+{
+    constexpr std::string_view prefix = "Content-Length: ";
+    headers.resize(bodies.size() * HeaderSize);
+    pieces.clear();
+
+    char *header = headers.data();
+    for (const std::string &body : bodies)
+    {
+        std::memcpy(header, prefix.data(), prefix.size());
+        char *at = std::to_chars(header + prefix.size(), header + HeaderSize, body.size()).ptr;
+        std::memcpy(at, "\r\n\r\n", 4);
+        pieces.emplace_back(header, static_cast<size_t>(at + 4 - header));
+        pieces.emplace_back(body);
+        header += HeaderSize;
+    }
+    return sink.write(pieces.data(), pieces.size());
+}
@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <hash.hxx>
+#include <types.hxx>
+#include <token.hxx>
+#include <string.hxx>
+#include <visitor.hxx>
+
+TypeTable::TypeTable()
+{
+    types.push_back(TypeInfo{TypeKind::Error});
+    types.push_back(TypeInfo{TypeKind::UntypedInt});
+    types.push_back(TypeInfo{TypeKind::UntypedFloat});
+    for (int t = static_cast<int>(Type::Void); t <= static_cast<int>(Type::Float64); ++t)
+        intern(TypeInfo{TypeKind::Primitive, static_cast<Type>(t)});
+}
+
+TypeId TypeTable::intern(TypeInfo info)
+{
+    uint64_t h = hash::combine(static_cast<uint64_t>(info.kind), static_cast<uint64_t>(info.primitive));
+    h = hash::combine(h, info.result);
+    h = hash::combine(h, reinterpret_cast<uintptr_t>(info.decl));
+    for (TypeId param : info.params)
+        h = hash::combine(h, param);
+
+    auto range = byHash.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const TypeInfo &other = types[it->second];
+        if (other.kind == info.kind && other.primitive == info.primitive && other.result == info.result && other.decl == info.decl &&
+            other.params == info.params)
+            return it->second;
+    }
+
+    TypeId id = static_cast<TypeId>(types.size());
+    types.push_back(std::move(info));
+    byHash.emplace(h, id);
+    return id;
+}
+
+TypeId TypeTable::function(const std::vector<TypeId> &params, TypeId result)
+{
+    TypeInfo info{TypeKind::Function};
+    info.result = result;
+    info.params = params;
+    return intern(std::move(info));
+}
+
+TypeId TypeTable::classType(const ASTNode *decl)
+{
+    TypeInfo info{TypeKind::Class};
+    info.decl = decl;
+    return intern(std::move(info));
+}
+
+std::string TypeTable::name(TypeId id) const
+{
+    const TypeInfo &t = types[id];
+    switch (t.kind)
+    {
+    case TypeKind::Error:
+        return "<error>";
+    case TypeKind::UntypedInt:
+        return "untyped integer";
+    case TypeKind::UntypedFloat:
+        return "untyped float";
+    case TypeKind::Primitive:
+        return std::string(typeToString(t.primitive));
+    case TypeKind::Function:
+    {
+        std::string s = "(";
+        for (size_t i = 0; i < t.params.size(); ++i)
+            s += (i ? ", " : "") + name(t.params[i]);
+        return s + ") " + name(t.result);
+    }
+    case TypeKind::Class:
+        return static_cast<const ClassDeclNode *>(t.decl)->name;
+    }
+    return "<error>";
+}
+
+namespace
+{
+    constexpr TypeId Boolean = TypeTable::primitive(Type::Boolean);
+    constexpr TypeId Void = TypeTable::primitive(Type::Void);
+
+    bool isUntyped(TypeId t) { return t == TypeTable::UntypedInt || t == TypeTable::UntypedFloat; }
+
+    bool isInteger(TypeId t)
+    {
+        return t == TypeTable::UntypedInt || (t >= TypeTable::primitive(Type::Int8) && t <= TypeTable::primitive(Type::Uint64));
+    }
+
+    bool isFloat(TypeId t)
+    {
+        return t == TypeTable::UntypedFloat || t == TypeTable::primitive(Type::Float32) || t == TypeTable::primitive(Type::Float64);
+    }
+
+    bool isNumeric(TypeId t) { return isInteger(t) || isFloat(t); }
+
+    TypeId defaultType(TypeId t)
+    {
+        if (t == TypeTable::UntypedInt)
+            return TypeTable::primitive(Type::Int64);
+        if (t == TypeTable::UntypedFloat)
+            return TypeTable::primitive(Type::Float64);
+        return t;
+    }
+
+    template <typename T>
+    bool fitsIn(int64_t v) { return v >= static_cast<int64_t>(std::numeric_limits<T>::min()) && (v < 0 || static_cast<uint64_t>(v) <= std::numeric_limits<T>::max()); }
+
+    template <typename T>
+    bool fitsIn(uint64_t v) { return v <= std::numeric_limits<T>::max(); }
+
+    /**
+     * Whether a literal's value is representable in a primitive type.
+     */
+    bool literalFits(const LiteralNode *lit, Type target)
+    {
+        if (auto *d = std::get_if<double>(&lit->value))
+            return target == Type::Float64 || !std::isfinite(*d) || std::abs(*d) <= FLT_MAX;
+
+        auto fits = [target](auto v)
+        {
+            using V = decltype(v);
+            switch (target)
+            {
+            case Type::Int8:
+                return fitsIn<int8_t>(v);
+            case Type::Int16:
+                return fitsIn<int16_t>(v);
+            case Type::Int32:
+                return fitsIn<int32_t>(v);
+            case Type::Int64:
+                return fitsIn<int64_t>(v);
+            case Type::Uint8:
+                return fitsIn<uint8_t>(v);
+            case Type::Uint16:
+                return fitsIn<uint16_t>(v);
+            case Type::Uint32:
+                return fitsIn<uint32_t>(v);
+            case Type::Uint64:
+                return std::is_unsigned_v<V> || v >= 0;
+            default:
+                return true;
+            }
+        };
+        if (auto *i = std::get_if<int64_t>(&lit->value))
+            return fits(*i);
+        if (auto *u = std::get_if<uint64_t>(&lit->value))
+            return fits(*u);
+        return true;
+    }
+
+    std::string literalText(const LiteralNode *lit)
+    {
+        return std::visit([](const auto &v)
+                          {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::string>)
+                return v;
+            else if constexpr (std::is_same_v<T, bool>)
+                return std::string(v ? "true" : "false");
+            else if constexpr (std::is_same_v<T, char>)
+                return std::string(1, v);
+            else
+                return std::to_string(v); },
+                          lit->value);
+    }
+
+    struct Checker : ASTVisitor<Checker, true>
+    {
+        const TypeTable &types;
+        std::vector<Diagnostic> diagnostics;
+        TypeId returnType = TypeTable::Error;
+        bool inFunction = false;
+
+        explicit Checker(const TypeTable &types) : types(types) {}
+
+        void error(const ASTNode *at, std::string message)
+        {
+            diagnostics.push_back(Diagnostic{Severity::Error, at->span, std::move(message)});
+        }
+
+        /** Check an expression and return its type, which may still be untyped. */
+        TypeId check(ASTNode *node)
+        {
+            if (!node)
+                return Void;
+            traverse(node);
+            return node->typeId;
+        }
+
+        /** Check an expression whose value must have a given type. */
+        TypeId expect(ASTNode *node, TypeId target)
+        {
+            return convert(node, check(node), target);
+        }
+
+        TypeId convert(ASTNode *node, TypeId from, TypeId target)
+        {
+            if (from == target || from == TypeTable::Error || target == TypeTable::Error)
+                return target;
+            if ((from == TypeTable::UntypedInt && isNumeric(target)) || (from == TypeTable::UntypedFloat && isFloat(target)))
+            {
+                settle(node, target);
+                return target;
+            }
+            error(node, "cannot use " + types.name(from) + " as " + types.name(target));
+            return TypeTable::Error;
+        }
+
+        /** Give an untyped subtree its final type. */
+        void settle(ASTNode *node, TypeId target)
+        {
+            if (!node || !isUntyped(node->typeId))
+                return;
+            node->typeId = target;
+            if (auto *lit = nodeAs<LiteralNode>(node))
+            {
+                if (!literalFits(lit, types.info(target).primitive))
+                {
+                    error(lit, "constant " + literalText(lit) + " overflows " + types.name(target));
+                    lit->typeId = TypeTable::Error;
+                }
+            }
+            else if (auto *bin = nodeAs<BinaryExprNode>(node))
+            {
+                settle(bin->left.get(), target);
+                settle(bin->right.get(), target);
+            }
+        }
+
+        TypeId declaredType(const Binding &binding) const
+        {
+            if (!binding.decl)
+                return TypeTable::Error;
+            if (binding.param >= 0)
+                return TypeTable::primitive(static_cast<const FunctionDeclNode *>(binding.decl)->params[binding.param].first);
+            if (const auto *var = nodeAs<VarDeclNode>(binding.decl))
+                return TypeTable::primitive(var->varType);
+            // Functions and classes were typed before any body was checked.
+            return binding.decl->typeId;
+        }
+
+        void statement(ASTNode *node)
+        {
+            TypeId t = check(node);
+            if (isUntyped(t))
+                settle(node, defaultType(t));
+        }
+
+        void visitBlock(BlockNode *block)
+        {
+            for (auto &child : block->children)
+                statement(child.get());
+            block->typeId = Void;
+        }
+
+        void visitLiteral(LiteralNode *lit)
+        {
+            if (std::holds_alternative<int64_t>(lit->value) || std::holds_alternative<uint64_t>(lit->value))
+                lit->typeId = TypeTable::UntypedInt;
+            else if (std::holds_alternative<double>(lit->value))
+                lit->typeId = TypeTable::UntypedFloat;
+            else
+                lit->typeId = TypeTable::primitive(lit->literalType);
+        }
+
+        void visitIdentifier(IdentifierNode *id) { id->typeId = declaredType(id->binding); }
+
+        void visitBinaryExpr(BinaryExprNode *bin)
+        {
+            TypeId l = check(bin->left.get());
+            TypeId r = check(bin->right.get());
+            bin->typeId = TypeTable::Error;
+            if (l == TypeTable::Error || r == TypeTable::Error)
+                return;
+
+            // Bring both operands to one type; untyped operands adapt to typed ones.
+            TypeId operand;
+            if (isUntyped(l) && isUntyped(r))
+                operand = (l == TypeTable::UntypedFloat || r == TypeTable::UntypedFloat) ? TypeTable::UntypedFloat : TypeTable::UntypedInt;
+            else if (isUntyped(l))
+            {
+                if (convert(bin->left.get(), l, r) == TypeTable::Error)
+                    return;
+                operand = r;
+            }
+            else if (isUntyped(r))
+            {
+                if (convert(bin->right.get(), r, l) == TypeTable::Error)
+                    return;
+                operand = l;
+            }
+            else if (l == r)
+                operand = l;
+            else
+            {
+                error(bin, "invalid operands to '" + bin->op + "': " + types.name(l) + " and " + types.name(r));
+                return;
+            }
+
+            const std::string &op = bin->op;
+            bool valid;
+            TypeId result = operand;
+            if (op == "+")
+                valid = isNumeric(operand) || operand == TypeTable::primitive(Type::String);
+            else if (op == "-" || op == "*" || op == "/")
+                valid = isNumeric(operand);
+            else if (op == "%" || op == "|")
+                valid = isInteger(operand);
+            else if (op == "==" || op == "!=")
+            {
+                valid = true;
+                result = Boolean;
+            }
+            else if (op == "<" || op == "<=" || op == ">" || op == ">=")
+            {
+                valid = isNumeric(operand) || operand == TypeTable::primitive(Type::Byte);
+                result = Boolean;
+            }
+            else if (op == "&&")
+                valid = operand == Boolean;
+            else
+            {
+                error(bin, "unsupported operator '" + op + "'");
+                return;
+            }
+
+            if (!valid)
+            {
+                error(bin, "invalid operands to '" + op + "': " + types.name(l) + " and " + types.name(r));
+                return;
+            }
+            // A comparison consumes its operands, so they take their default types.
+            if (result == Boolean && isUntyped(operand))
+            {
+                settle(bin->left.get(), defaultType(operand));
+                settle(bin->right.get(), defaultType(operand));
+            }
+            bin->typeId = result;
+        }
+
+        void visitFunctionDecl(FunctionDeclNode *)
+        {
+            // Bodies are checked separately, see checkTypes.
+        }
+
+        void visitClassDecl(ClassDeclNode *cls)
+        {
+            check(cls->body.get());
+        }
+
+        void visitReturnExpr(ReturnExprNode *ret)
+        {
+            ret->typeId = Void;
+            if (!inFunction)
+            {
+                error(ret, "return outside of a function");
+                statement(ret->expr.get());
+            }
+            else if (returnType == Void && ret->expr)
+            {
+                error(ret, "function returning void cannot return a value");
+                statement(ret->expr.get());
+            }
+            else if (ret->expr)
+                expect(ret->expr.get(), returnType);
+        }
+
+        void visitVarDecl(VarDeclNode *var)
+        {
+            var->typeId = TypeTable::primitive(var->varType);
+            if (var->value)
+                expect(var->value.get(), var->typeId);
+        }
+
+        void visitIfExpr(IfExprNode *ifn)
+        {
+            expect(ifn->condition.get(), Boolean);
+            statement(ifn->thenBranch.get());
+            statement(ifn->elseBranch.get());
+            ifn->typeId = Void;
+        }
+
+        void visitFunctionCall(FunctionCallNode *call)
+        {
+            // The resolver has already matched the argument count, or reported why it could not.
+            auto *fn = nodeAs<FunctionDeclNode>(call->binding.decl);
+            if (!fn)
+            {
+                for (auto &arg : call->args)
+                    statement(arg.get());
+                call->typeId = TypeTable::Error;
+                return;
+            }
+            std::vector<TypeId> args;
+            args.reserve(call->args.size());
+            for (auto &arg : call->args)
+                args.push_back(check(arg.get()));
+            if (!call->overloads.empty())
+            {
+                fn = choose(call, args);
+                if (!fn)
+                {
+                    for (size_t i = 0; i < call->args.size(); ++i)
+                        if (isUntyped(args[i]))
+                            settle(call->args[i].get(), defaultType(args[i]));
+                    call->typeId = TypeTable::Error;
+                    return;
+                }
+                call->binding = Binding{fn, -1};
+            }
+            for (size_t i = 0; i < call->args.size(); ++i)
+                convert(call->args[i].get(), args[i], TypeTable::primitive(fn->params[i].first));
+            call->typeId = TypeTable::primitive(fn->returnType);
+        }
+
+        /**
+         * The overload the argument types select, or null after reporting
+         * why there is none. An argument matches exactly when it has the
+         * parameter's type, or is an untyped constant whose default type that
+         * is; other untyped constants convert. Exact matches of every argument
+         * win over conversions; two overloads equally good are ambiguous.
+         */
+        const FunctionDeclNode *choose(const FunctionCallNode *call, const std::vector<TypeId> &args)
+        {
+            // Already reported; keep the resolver's choice.
+            if (std::find(args.begin(), args.end(), TypeTable::Error) != args.end())
+                return nodeAs<FunctionDeclNode>(call->binding.decl);
+
+            enum Match { Exact, Converted, None };
+            const FunctionDeclNode *best = nullptr;
+            Match bestMatch = None;
+            bool ambiguous = false;
+            for (const FunctionDeclNode *fn : call->overloads)
+            {
+                Match match = Exact;
+                for (size_t i = 0; i < args.size() && match != None; ++i)
+                {
+                    TypeId param = TypeTable::primitive(fn->params[i].first);
+                    if (args[i] == param || (isUntyped(args[i]) && defaultType(args[i]) == param))
+                        continue;
+                    if ((args[i] == TypeTable::UntypedInt && isNumeric(param)) || (args[i] == TypeTable::UntypedFloat && isFloat(param)))
+                        match = Converted;
+                    else
+                        match = None;
+                }
+                if (match < bestMatch)
+                {
+                    best = fn;
+                    bestMatch = match;
+                    ambiguous = false;
+                }
+                else if (match == bestMatch && match != None)
+                    ambiguous = true;
+            }
+
+            if (!best)
+            {
+                std::string list;
+                for (TypeId t : args)
+                    list += (list.empty() ? "" : ", ") + types.name(t);
+                error(call, "no overload of '" + call->callee + "' takes (" + list + ")");
+            }
+            else if (ambiguous)
+                error(call, "call to '" + call->callee + "' is ambiguous");
+            return ambiguous ? nullptr : best;
+        }
+
+        void visitAssignExpr(AssignExprNode *assign)
+        {
+            // The resolver has already reported assignments to anything but a variable.
+            bool variable = assign->binding.param >= 0 || nodeAs<VarDeclNode>(assign->binding.decl);
+            TypeId target = variable ? declaredType(assign->binding) : TypeTable::Error;
+            expect(assign->value.get(), target);
+            assign->typeId = target;
+        }
+
+        void visitUnknown(ASTNode *node) { node->typeId = TypeTable::Error; }
+    };
+
+    /**
+     * Give every class and function its type, and list the functions whose
+     * bodies need checking.
+     */
+    void collectDeclarations(ASTNode *node, TypeTable &types, std::vector<FunctionDeclNode *> &functions)
+    {
+        if (auto *block = nodeAs<BlockNode>(node))
+        {
+            for (auto &child : block->children)
+                collectDeclarations(child.get(), types, functions);
+        }
+        else if (auto *cls = nodeAs<ClassDeclNode>(node))
+        {
+            cls->typeId = types.classType(cls);
+            collectDeclarations(cls->body.get(), types, functions);
+        }
+        else if (auto *fn = nodeAs<FunctionDeclNode>(node))
+        {
+            std::vector<TypeId> params;
+            params.reserve(fn->params.size());
+            for (const auto &param : fn->params)
+                params.push_back(TypeTable::primitive(param.first));
+            fn->typeId = types.function(params, TypeTable::primitive(fn->returnType));
+            functions.push_back(fn);
+        }
+    }
+}
+
+size_t checkTypes(ASTNode *root, TypeTable &types, std::vector<Diagnostic> &diagnostics, unsigned threads)
+{
+    std::vector<FunctionDeclNode *> functions;
+    collectDeclarations(root, types, functions);
+
+    // Everything outside function bodies: globals, fields and their initializers.
+    Checker outer(types);
+    outer.statement(root);
+
+    std::vector<std::vector<Diagnostic>> results(functions.size());
+    std::atomic<size_t> next{0};
+    auto work = [&]
+    {
+        // Small batches keep the atomic off the hot path while still balancing uneven functions.
+        constexpr size_t batch = 16;
+        for (size_t start; (start = next.fetch_add(batch, std::memory_order_relaxed)) < functions.size();)
+        {
+            for (size_t i = start; i < std::min(start + batch, functions.size()); ++i)
+            {
+                FunctionDeclNode *fn = functions[i];
+                Checker checker(types);
+                checker.inFunction = true;
+                checker.returnType = TypeTable::primitive(fn->returnType);
+                checker.statement(fn->body.get());
+                results[i] = std::move(checker.diagnostics);
+            }
+        }
+    };
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    // Not worth a thread for fewer than a few batches of functions.
+    threads = static_cast<unsigned>(std::min<size_t>(threads, functions.size() / 64 + 1));
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i)
+        workers.emplace_back(work);
+    work();
+    for (auto &worker : workers)
+        worker.join();
+
+    size_t first = diagnostics.size();
+    diagnostics.insert(diagnostics.end(), outer.diagnostics.begin(), outer.diagnostics.end());
+    for (auto &result : results)
+        diagnostics.insert(diagnostics.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+    std::stable_sort(diagnostics.begin() + static_cast<std::ptrdiff_t>(first), diagnostics.end(), [](const Diagnostic &a, const Diagnostic &b)
+                     { return a.span.file != b.span.file ? a.span.file < b.span.file : a.span.begin < b.span.begin; });
+    return functions.size();
+}
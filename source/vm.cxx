@@ -0,0 +1,617 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vm.hxx>
+
+static_assert(sizeof(VMInstruction) == 8, "bytecode instructions must stay 8 bytes");
+
+std::optional<uint32_t> BytecodeProgram::find(std::string_view name) const
+{
+    for (uint32_t i = 0; i < functions.size(); ++i)
+        if (functions[i].name == name)
+            return i;
+    return std::nullopt;
+}
+
+namespace
+{
+    bool isFloat(Type t) { return t == Type::Float32 || t == Type::Float64; }
+
+    bool isUnsigned(Type t)
+    {
+        switch (t)
+        {
+        case Type::Boolean:
+        case Type::Byte:
+        case Type::Uint8:
+        case Type::Uint16:
+        case Type::Uint32:
+        case Type::Uint64:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * The op that brings a 64-bit result back to the range of a narrower type,
+     * or nullopt if every 64-bit result is already valid.
+     */
+    std::optional<VMOp> normalizer(Type t)
+    {
+        switch (t)
+        {
+        case Type::Int8:
+            return VMOp::Sext8;
+        case Type::Int16:
+            return VMOp::Sext16;
+        case Type::Int32:
+            return VMOp::Sext32;
+        case Type::Byte:
+        case Type::Uint8:
+            return VMOp::Zext8;
+        case Type::Uint16:
+            return VMOp::Zext16;
+        case Type::Uint32:
+            return VMOp::Zext32;
+        case Type::Float32:
+            return VMOp::Round32;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    VMValue constantValue(const LiteralValue &literal, Type type)
+    {
+        if (std::holds_alternative<std::string>(literal))
+            throw std::runtime_error("strings are not supported by the bytecode VM");
+
+        VMValue v;
+        if (isFloat(type))
+        {
+            v.f = std::visit([](const auto &x) -> double {
+                if constexpr (std::is_same_v<std::decay_t<decltype(x)>, std::string>)
+                    return 0;
+                else
+                    return static_cast<double>(x); }, literal);
+            if (type == Type::Float32)
+                v.f = static_cast<float>(v.f);
+            return v;
+        }
+
+        v.i = std::visit([](const auto &x) -> int64_t {
+            if constexpr (std::is_same_v<std::decay_t<decltype(x)>, std::string>)
+                return 0;
+            else
+                return static_cast<int64_t>(x); }, literal);
+        switch (type)
+        {
+        case Type::Boolean:
+            v.i = v.i != 0;
+            break;
+        case Type::Int8:
+            v.i = static_cast<int8_t>(v.i);
+            break;
+        case Type::Int16:
+            v.i = static_cast<int16_t>(v.i);
+            break;
+        case Type::Int32:
+            v.i = static_cast<int32_t>(v.i);
+            break;
+        case Type::Byte:
+        case Type::Uint8:
+            v.u = static_cast<uint8_t>(v.u);
+            break;
+        case Type::Uint16:
+            v.u = static_cast<uint16_t>(v.u);
+            break;
+        case Type::Uint32:
+            v.u = static_cast<uint32_t>(v.u);
+            break;
+        default:
+            break;
+        }
+        return v;
+    }
+
+    struct FunctionCompiler
+    {
+        const IRModule &module;
+        const TypeTable &types;
+        BytecodeProgram &program;
+        std::unordered_map<uint64_t, uint32_t> &constants;
+        const IRFunction &fn;
+
+        std::vector<uint16_t> reg;
+        /** Jumps whose immediate is a block, patched once every block has its address. */
+        std::vector<std::pair<size_t, BlockId>> fixups;
+
+        FunctionCompiler(const IRModule &module, const TypeTable &types, BytecodeProgram &program,
+                         std::unordered_map<uint64_t, uint32_t> &constants, const IRFunction &fn)
+            : module(module), types(types), program(program), constants(constants), fn(fn) {}
+
+        Type typeOf(TypeId id) const
+        {
+            const TypeInfo &info = types.info(id);
+            switch (info.kind)
+            {
+            case TypeKind::Primitive:
+                if (info.primitive == Type::String)
+                    throw std::runtime_error("strings are not supported by the bytecode VM");
+                return info.primitive;
+            case TypeKind::UntypedInt:
+                return Type::Int64;
+            case TypeKind::UntypedFloat:
+                return Type::Float64;
+            default:
+                throw std::runtime_error("cannot compile a value of type " + types.name(id));
+            }
+        }
+
+        size_t emit(VMOp op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0)
+        {
+            program.code.push_back(VMInstruction{op, a, b, c});
+            return program.code.size() - 1;
+        }
+
+        size_t emitImmediate(VMOp op, uint16_t a, uint32_t immediate)
+        {
+            return emit(op, a, static_cast<uint16_t>(immediate), static_cast<uint16_t>(immediate >> 16));
+        }
+
+        void setImmediate(size_t at, uint32_t immediate)
+        {
+            program.code[at].b = static_cast<uint16_t>(immediate);
+            program.code[at].c = static_cast<uint16_t>(immediate >> 16);
+        }
+
+        void jumpTo(VMOp op, uint16_t a, BlockId block)
+        {
+            fixups.emplace_back(emitImmediate(op, a, 0), block);
+        }
+
+        uint32_t constant(const LiteralValue &literal, Type type)
+        {
+            VMValue v = constantValue(literal, type);
+            auto [it, added] = constants.emplace(v.u, static_cast<uint32_t>(program.constants.size()));
+            if (added)
+                program.constants.push_back(v);
+            return it->second;
+        }
+
+        /**
+         * Copy the values the phis of `to` take when entered from `from`. Phi
+         * operands are never phis of the same block, so the moves can be done
+         * one after another.
+         */
+        bool edgeMoves(BlockId from, BlockId to, bool emitMoves)
+        {
+            bool any = false;
+            const IRBlock &block = fn.blocks[to];
+            for (ValueId id = block.first; id < block.end && fn.instructions[id].op == Opcode::Phi; ++id)
+            {
+                const IRInstruction &phi = fn.instructions[id];
+                const uint32_t *ops = fn.operandsOf(phi);
+                for (uint16_t i = 0; i < phi.operandCount; i += 2)
+                    if (ops[i] == from)
+                    {
+                        any = true;
+                        if (emitMoves)
+                            emit(VMOp::Move, reg[id], reg[ops[i + 1]]);
+                    }
+            }
+            return any;
+        }
+
+        void binary(const IRInstruction &inst, const uint32_t *ops)
+        {
+            Type operand = typeOf(fn.instructions[ops[0]].type);
+            bool fp = isFloat(operand), unsig = isUnsigned(operand);
+            auto pick = [&](VMOp f, VMOp u, VMOp s) { return fp ? f : unsig ? u : s; };
+
+            VMOp op;
+            bool normalize = false;
+            switch (inst.op)
+            {
+            case Opcode::Add:
+                op = fp ? VMOp::FAdd : VMOp::Add;
+                normalize = true;
+                break;
+            case Opcode::Sub:
+                op = fp ? VMOp::FSub : VMOp::Sub;
+                normalize = true;
+                break;
+            case Opcode::Mul:
+                op = fp ? VMOp::FMul : VMOp::Mul;
+                normalize = true;
+                break;
+            case Opcode::Div:
+                op = pick(VMOp::FDiv, VMOp::DivU, VMOp::DivS);
+                normalize = true;
+                break;
+            case Opcode::Rem:
+                if (fp)
+                    throw std::runtime_error("the bytecode VM has no floating-point remainder");
+                op = unsig ? VMOp::RemU : VMOp::RemS;
+                break;
+            case Opcode::BitOr:
+                op = VMOp::Or;
+                break;
+            case Opcode::And:
+                op = VMOp::And;
+                break;
+            case Opcode::Eq:
+                op = fp ? VMOp::FEq : VMOp::Eq;
+                break;
+            case Opcode::Ne:
+                op = fp ? VMOp::FNe : VMOp::Ne;
+                break;
+            case Opcode::Lt:
+                op = pick(VMOp::FLt, VMOp::LtU, VMOp::LtS);
+                break;
+            case Opcode::Le:
+                op = pick(VMOp::FLe, VMOp::LeU, VMOp::LeS);
+                break;
+            case Opcode::Gt:
+                op = pick(VMOp::FGt, VMOp::GtU, VMOp::GtS);
+                break;
+            default:
+                op = pick(VMOp::FGe, VMOp::GeU, VMOp::GeS);
+                break;
+            }
+
+            uint16_t dst = reg[&inst - fn.instructions.data()];
+            emit(op, dst, reg[ops[0]], reg[ops[1]]);
+            if (normalize)
+                if (auto n = normalizer(typeOf(inst.type)))
+                    emit(*n, dst, dst);
+        }
+
+        void instruction(BlockId block, ValueId id)
+        {
+            const IRInstruction &inst = fn.instructions[id];
+            const uint32_t *ops = fn.operandsOf(inst);
+            switch (inst.op)
+            {
+            case Opcode::Param:
+            case Opcode::Phi:
+                // Parameters arrive in the first registers; phis are filled by edge moves.
+                break;
+            case Opcode::Const:
+                emitImmediate(VMOp::LoadK, reg[id], constant(module.constants[inst.immediate], typeOf(inst.type)));
+                break;
+            case Opcode::Load:
+                emitImmediate(VMOp::LoadG, reg[id], inst.immediate);
+                break;
+            case Opcode::Store:
+                emitImmediate(VMOp::StoreG, reg[ops[0]], inst.immediate);
+                break;
+            case Opcode::Call:
+                emitImmediate(VMOp::Call, reg[id], inst.immediate);
+                for (uint16_t i = 0; i < inst.operandCount; i += 3)
+                    emit(VMOp::Args, reg[ops[i]],
+                         i + 1 < inst.operandCount ? reg[ops[i + 1]] : 0,
+                         i + 2 < inst.operandCount ? reg[ops[i + 2]] : 0);
+                break;
+            case Opcode::Br:
+                edgeMoves(block, ops[0], true);
+                if (ops[0] != block + 1)
+                    jumpTo(VMOp::Jump, 0, ops[0]);
+                break;
+            case Opcode::CondBr:
+                if (!edgeMoves(block, ops[2], false))
+                {
+                    jumpTo(VMOp::JumpIfFalse, reg[ops[0]], ops[2]);
+                    edgeMoves(block, ops[1], true);
+                    if (ops[1] != block + 1)
+                        jumpTo(VMOp::Jump, 0, ops[1]);
+                }
+                else
+                {
+                    size_t skip = emitImmediate(VMOp::JumpIfFalse, reg[ops[0]], 0);
+                    edgeMoves(block, ops[1], true);
+                    jumpTo(VMOp::Jump, 0, ops[1]);
+                    setImmediate(skip, static_cast<uint32_t>(program.code.size()));
+                    edgeMoves(block, ops[2], true);
+                    if (ops[2] != block + 1)
+                        jumpTo(VMOp::Jump, 0, ops[2]);
+                }
+                break;
+            case Opcode::Ret:
+                if (inst.operandCount)
+                    emit(VMOp::RetValue, reg[ops[0]]);
+                else
+                    emit(VMOp::Ret);
+                break;
+            case Opcode::Unreachable:
+                emit(VMOp::Trap);
+                break;
+            default:
+                binary(inst, ops);
+                break;
+            }
+        }
+
+        VMFunction compile()
+        {
+            // Every value gets a register. Calls get one even when void, so the
+            // callee always has somewhere to return to.
+            const TypeId voidType = TypeTable::primitive(Type::Void);
+            reg.assign(fn.instructions.size(), 0);
+            uint32_t count = 0;
+            for (ValueId id = 0; id < fn.instructions.size(); ++id)
+            {
+                const IRInstruction &inst = fn.instructions[id];
+                if (inst.type != voidType || inst.op == Opcode::Call)
+                {
+                    if (count > std::numeric_limits<uint16_t>::max())
+                        throw std::runtime_error("function '" + fn.name + "' needs more than 65535 registers");
+                    reg[id] = static_cast<uint16_t>(count++);
+                }
+            }
+
+            VMFunction out{fn.name, static_cast<uint32_t>(program.code.size()), static_cast<uint16_t>(count),
+                           static_cast<uint16_t>(fn.params.size()), fn.result != voidType};
+            std::vector<uint32_t> blockStart(fn.blocks.size());
+            for (BlockId b = 0; b < fn.blocks.size(); ++b)
+            {
+                blockStart[b] = static_cast<uint32_t>(program.code.size());
+                for (ValueId id = fn.blocks[b].first; id < fn.blocks[b].end; ++id)
+                    instruction(b, id);
+            }
+            for (const auto &[at, block] : fixups)
+                setImmediate(at, blockStart[block]);
+            return out;
+        }
+    };
+}
+
+BytecodeProgram compileBytecode(const IRModule &module, const TypeTable &types)
+{
+    BytecodeProgram program;
+    program.globalCount = static_cast<uint32_t>(module.globals.size());
+    program.functions.reserve(module.functions.size());
+    std::unordered_map<uint64_t, uint32_t> constants;
+    for (const auto &fn : module.functions)
+        program.functions.push_back(FunctionCompiler(module, types, program, constants, fn).compile());
+    program.init = program.find(IRModule::InitFunction);
+    return program;
+}
+
+VirtualMachine::VirtualMachine(const BytecodeProgram &program, size_t stackSize, size_t maxDepth)
+    : globals(program.globalCount, VMValue{0}),
+      program(program),
+      // Left uninitialized: every register is written before it is read.
+      stack(new VMValue[stackSize]),
+      stackSize(stackSize),
+      maxDepth(maxDepth)
+{
+    frames.reserve(std::min<size_t>(maxDepth, 1024));
+}
+
+void VirtualMachine::initialize()
+{
+    globals.assign(program.globalCount, VMValue{0});
+    if (program.init)
+        call(*program.init);
+}
+
+VMValue VirtualMachine::call(uint32_t function, const std::vector<VMValue> &args)
+{
+    const VMFunction &fn = program.functions.at(function);
+    if (args.size() != fn.paramCount)
+        throw std::runtime_error("'" + fn.name + "' takes " + std::to_string(fn.paramCount) + " arguments");
+    if (fn.frameSize > stackSize)
+        throw std::runtime_error("stack overflow");
+    std::copy(args.begin(), args.end(), stack.get());
+    try
+    {
+        return execute(&fn, stack.get());
+    }
+    catch (...)
+    {
+        frames.clear();
+        throw;
+    }
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define VM_THREADED 1
+#endif
+
+VMValue VirtualMachine::execute(const VMFunction *fn, VMValue *base)
+{
+    const VMInstruction *const code = program.code.data();
+    const VMValue *const constants = program.constants.data();
+    VMValue *const stackEnd = stack.get() + stackSize;
+    VMValue *const g = globals.data();
+    const size_t entryDepth = frames.size();
+    const VMInstruction *pc = code + fn->entry;
+
+#define R(x) base[x]
+
+#ifdef VM_THREADED
+#define VM_LABEL(name) &&op_##name,
+    static void *const labels[] = {VSHARP_VM_OPCODES(VM_LABEL)};
+#undef VM_LABEL
+#define VM_CASE(name) op_##name:
+#define DISPATCH() goto *labels[static_cast<uint8_t>(pc->op)]
+#else
+#define VM_CASE(name) case VMOp::name:
+#define DISPATCH() continue
+#endif
+#define NEXT() \
+    ++pc;      \
+    DISPATCH()
+#define BINARY(name, expr)              \
+    VM_CASE(name)                       \
+    {                                   \
+        const VMValue b = R(pc->b);     \
+        const VMValue c = R(pc->c);     \
+        expr;                           \
+        NEXT();                         \
+    }
+
+// Hand `result` to the caller, or out of execute() when the entry function returns.
+#define RETURN()                              \
+    if (frames.size() == entryDepth)          \
+        return result;                        \
+    {                                         \
+        const Frame &frame = frames.back();   \
+        pc = frame.resume;                    \
+        base = frame.base;                    \
+        fn = frame.function;                  \
+        R(frame.result) = result;             \
+        frames.pop_back();                    \
+    }                                         \
+    DISPATCH()
+
+    VMValue result{0};
+
+#ifdef VM_THREADED
+    DISPATCH();
+#else
+    for (;;)
+        switch (pc->op)
+#endif
+    {
+        VM_CASE(LoadK)
+        R(pc->a) = constants[pc->immediate()];
+        NEXT();
+        VM_CASE(Move)
+        R(pc->a) = R(pc->b);
+        NEXT();
+        VM_CASE(LoadG)
+        R(pc->a) = g[pc->immediate()];
+        NEXT();
+        VM_CASE(StoreG)
+        g[pc->immediate()] = R(pc->a);
+        NEXT();
+
+        // Integer arithmetic wraps, as it does in two's complement hardware.
+        BINARY(Add, R(pc->a).u = b.u + c.u)
+        BINARY(Sub, R(pc->a).u = b.u - c.u)
+        BINARY(Mul, R(pc->a).u = b.u * c.u)
+        BINARY(DivS, {
+            if (c.i == 0)
+                throw std::runtime_error("division by zero in '" + fn->name + "'");
+            R(pc->a).i = c.i == -1 ? static_cast<int64_t>(0 - b.u) : b.i / c.i;
+        })
+        BINARY(DivU, {
+            if (c.u == 0)
+                throw std::runtime_error("division by zero in '" + fn->name + "'");
+            R(pc->a).u = b.u / c.u;
+        })
+        BINARY(RemS, {
+            if (c.i == 0)
+                throw std::runtime_error("division by zero in '" + fn->name + "'");
+            R(pc->a).i = c.i == -1 ? 0 : b.i % c.i;
+        })
+        BINARY(RemU, {
+            if (c.u == 0)
+                throw std::runtime_error("division by zero in '" + fn->name + "'");
+            R(pc->a).u = b.u % c.u;
+        })
+        BINARY(Or, R(pc->a).u = b.u | c.u)
+        BINARY(And, R(pc->a).u = b.u & c.u)
+        BINARY(Eq, R(pc->a).u = b.u == c.u)
+        BINARY(Ne, R(pc->a).u = b.u != c.u)
+        BINARY(LtS, R(pc->a).u = b.i < c.i)
+        BINARY(LeS, R(pc->a).u = b.i <= c.i)
+        BINARY(GtS, R(pc->a).u = b.i > c.i)
+        BINARY(GeS, R(pc->a).u = b.i >= c.i)
+        BINARY(LtU, R(pc->a).u = b.u < c.u)
+        BINARY(LeU, R(pc->a).u = b.u <= c.u)
+        BINARY(GtU, R(pc->a).u = b.u > c.u)
+        BINARY(GeU, R(pc->a).u = b.u >= c.u)
+        BINARY(FAdd, R(pc->a).f = b.f + c.f)
+        BINARY(FSub, R(pc->a).f = b.f - c.f)
+        BINARY(FMul, R(pc->a).f = b.f * c.f)
+        BINARY(FDiv, R(pc->a).f = b.f / c.f)
+        BINARY(FEq, R(pc->a).u = b.f == c.f)
+        BINARY(FNe, R(pc->a).u = b.f != c.f)
+        BINARY(FLt, R(pc->a).u = b.f < c.f)
+        BINARY(FLe, R(pc->a).u = b.f <= c.f)
+        BINARY(FGt, R(pc->a).u = b.f > c.f)
+        BINARY(FGe, R(pc->a).u = b.f >= c.f)
+
+        VM_CASE(Sext8)
+        R(pc->a).i = static_cast<int8_t>(R(pc->b).u);
+        NEXT();
+        VM_CASE(Sext16)
+        R(pc->a).i = static_cast<int16_t>(R(pc->b).u);
+        NEXT();
+        VM_CASE(Sext32)
+        R(pc->a).i = static_cast<int32_t>(R(pc->b).u);
+        NEXT();
+        VM_CASE(Zext8)
+        R(pc->a).u = static_cast<uint8_t>(R(pc->b).u);
+        NEXT();
+        VM_CASE(Zext16)
+        R(pc->a).u = static_cast<uint16_t>(R(pc->b).u);
+        NEXT();
+        VM_CASE(Zext32)
+        R(pc->a).u = static_cast<uint32_t>(R(pc->b).u);
+        NEXT();
+        VM_CASE(Round32)
+        R(pc->a).f = static_cast<float>(R(pc->b).f);
+        NEXT();
+
+        VM_CASE(Jump)
+        pc = code + pc->immediate();
+        DISPATCH();
+        VM_CASE(JumpIfFalse)
+        pc = R(pc->a).u ? pc + 1 : code + pc->immediate();
+        DISPATCH();
+
+        VM_CASE(Call)
+        {
+            const VMFunction *callee = &program.functions[pc->immediate()];
+            VMValue *next = base + fn->frameSize;
+            if (frames.size() - entryDepth + 1 >= maxDepth || next + callee->frameSize > stackEnd)
+                throw std::runtime_error("stack overflow in '" + callee->name + "'");
+            const VMInstruction *args = pc + 1;
+            for (uint16_t i = 0; i < callee->paramCount; i += 3, ++args)
+            {
+                next[i] = R(args->a);
+                if (i + 1 < callee->paramCount)
+                    next[i + 1] = R(args->b);
+                if (i + 2 < callee->paramCount)
+                    next[i + 2] = R(args->c);
+            }
+            frames.push_back(Frame{args, base, fn, pc->a});
+            fn = callee;
+            base = next;
+            pc = code + callee->entry;
+            DISPATCH();
+        }
+        VM_CASE(Args)
+        throw std::runtime_error("malformed bytecode in '" + fn->name + "'");
+
+        VM_CASE(Ret)
+        result.u = 0;
+        RETURN();
+        VM_CASE(RetValue)
+        result = R(pc->a);
+        RETURN();
+        VM_CASE(Trap)
+        throw std::runtime_error("'" + fn->name + "' ended without returning a value");
+    }
+
+    return result;
+
+#undef R
+#undef VM_CASE
+#undef DISPATCH
+#undef NEXT
+#undef BINARY
+#undef RETURN
+}
+
+#ifdef VM_THREADED
+#pragma GCC diagnostic pop
+#undef VM_THREADED
+#endif
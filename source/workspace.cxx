@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <thread>
+#include <navigation.hxx>
+#include <parser.hxx>
+#include <resolver.hxx>
+#include <source.hxx>
+#include <workspace.hxx>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    char lower(char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+
+    bool isUpper(char c) { return std::isupper(static_cast<unsigned char>(c)) != 0; }
+
+    /**
+     * A bit per letter, digit and '_' in a lowercased key; everything else
+     * shares one. A name can only match a pattern whose bits it has.
+     */
+    uint64_t charMask(std::string_view key)
+    {
+        uint64_t mask = 0;
+        for (char c : key)
+        {
+            if (c >= 'a' && c <= 'z')
+                mask |= uint64_t{1} << (c - 'a');
+            else if (c >= '0' && c <= '9')
+                mask |= uint64_t{1} << (26 + c - '0');
+            else if (c == '_')
+                mask |= uint64_t{1} << 36;
+            else
+                mask |= uint64_t{1} << 37;
+        }
+        return mask;
+    }
+
+    /**
+     * Score the leftmost match of a lowercased pattern in a name, or -1 if the
+     * name does not contain its characters in order.
+     */
+    int score(std::string_view pattern, std::string_view key, std::string_view name)
+    {
+        int total = 0;
+        size_t at = 0;
+        for (size_t i = 0; i < pattern.size(); ++i)
+        {
+            size_t found = key.find(pattern[i], at);
+            if (found == std::string_view::npos)
+                return -1;
+            total += 1;
+            if (found == 0)
+                total += 10;
+            else if (name[found - 1] == '_' || (isUpper(name[found]) && !isUpper(name[found - 1])))
+                total += 6;
+            if (i > 0 && found == at)
+                total += 4;
+            total -= static_cast<int>(std::min<size_t>(found - at, 3));
+            at = found + 1;
+        }
+        return total;
+    }
+
+    bool readFile(const fs::path &path, std::string &out)
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+            return false;
+        out.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        return static_cast<bool>(in.read(out.data(), static_cast<std::streamsize>(out.size())));
+    }
+
+    void put32(std::string &out, uint32_t value)
+    {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i)
+            bytes[i] = static_cast<char>(value >> (8 * i));
+        out.append(bytes, 4);
+    }
+
+    bool get32(std::string_view &in, uint32_t &value)
+    {
+        if (in.size() < 4)
+            return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i)
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+        in.remove_prefix(4);
+        return true;
+    }
+
+    bool getString(std::string_view &in, std::string &value)
+    {
+        uint32_t size;
+        if (!get32(in, size) || in.size() < size)
+            return false;
+        value.assign(in.data(), size);
+        in.remove_prefix(size);
+        return true;
+    }
+
+    /**
+     * Cache entry: the number of symbols, then per symbol its kind byte,
+     * little-endian 32-bit line, character, end line and end character, and
+     * the sizes and bytes of its name and container. The references follow:
+     * the size and bytes of the key, a declaration byte, then line, character
+     * and end character.
+     */
+    std::string encode(const FileIndex &index)
+    {
+        std::string out;
+        put32(out, static_cast<uint32_t>(index.symbols.size()));
+        for (const auto &s : index.symbols)
+        {
+            out += static_cast<char>(s.kind);
+            for (uint32_t value : {s.line, s.character, s.endLine, s.endCharacter})
+                put32(out, value);
+            put32(out, static_cast<uint32_t>(s.name.size()));
+            out += s.name;
+            put32(out, static_cast<uint32_t>(s.container.size()));
+            out += s.container;
+        }
+        for (const auto &[key, r] : index.references)
+        {
+            put32(out, static_cast<uint32_t>(key.size()));
+            out += key;
+            out += static_cast<char>(r.declaration);
+            for (uint32_t value : {r.line, r.character, r.endCharacter})
+                put32(out, value);
+        }
+        return out;
+    }
+
+    bool decode(std::string_view in, FileIndex &index)
+    {
+        index.symbols.clear();
+        index.references.clear();
+        uint32_t count;
+        bool ok = get32(in, count);
+        for (uint32_t i = 0; ok && i < count; ++i)
+        {
+            WorkspaceSymbol &s = index.symbols.emplace_back();
+            ok = !in.empty();
+            if (!ok)
+                break;
+            s.kind = static_cast<SymbolKind>(in[0]);
+            in.remove_prefix(1);
+            ok = get32(in, s.line) && get32(in, s.character) && get32(in, s.endLine) && get32(in, s.endCharacter) &&
+                 getString(in, s.name) && getString(in, s.container);
+        }
+        while (ok && !in.empty())
+        {
+            auto &[key, r] = index.references.emplace_back();
+            ok = getString(in, key) && !in.empty();
+            if (!ok)
+                break;
+            r.declaration = in[0] != 0;
+            in.remove_prefix(1);
+            ok = get32(in, r.line) && get32(in, r.character) && get32(in, r.endCharacter);
+        }
+        if (!ok)
+        {
+            index.symbols.clear();
+            index.references.clear();
+        }
+        return ok;
+    }
+
+    /**
+     * Declarations and references of one file: from the cache if it has an
+     * entry for the file's content, else parsed and stored there. `parsed`
+     * tells which. False if the file cannot be read.
+     */
+    bool load(const fs::path &path, ArtifactCache *cache, FileIndex &result, bool &parsed, std::string &text, std::string &entry)
+    {
+        parsed = false;
+        if (!readFile(path, text))
+            return false;
+
+        uint64_t key = 0;
+        if (cache)
+        {
+            key = ArtifactCache::key(text, "vssym", WORKSPACE_SYMBOLS_VERSION);
+            if (auto hit = cache->lookup(key, "vssym"); hit && readFile(*hit, entry) && decode(entry, result))
+                return true;
+        }
+        try
+        {
+            result = indexFile(text);
+        }
+        catch (const std::exception &)
+        {
+            // Half-edited files are indexed again once they change.
+            result = FileIndex();
+        }
+        parsed = true;
+        if (cache)
+        {
+            try
+            {
+                cache->store(key, "vssym", encode(result), false);
+            }
+            catch (const std::exception &)
+            {
+                // An unwritable cache only costs the next start a parse.
+            }
+        }
+        return true;
+    }
+
+    bool within(const fs::path &path, const fs::path &root)
+    {
+        fs::path relative = path.lexically_relative(root.lexically_normal());
+        return !relative.empty() && *relative.begin() != "..";
+    }
+
+    struct Collector
+    {
+        const std::string &text;
+        const LineTable &lines;
+        std::vector<WorkspaceSymbol> symbols;
+
+        void add(const ASTNode *node, const std::string &name, SymbolKind kind, const ClassDeclNode *owner)
+        {
+            WorkspaceSymbol &s = symbols.emplace_back();
+            s.name = name;
+            s.container = owner ? owner->name : std::string();
+            s.kind = kind;
+            uint32_t end = std::max(node->span.begin, node->span.end);
+            s.line = lines.resolve(node->span.begin).line - 1;
+            s.character = lines.utf16Column(text, node->span.begin);
+            s.endLine = lines.resolve(end).line - 1;
+            s.endCharacter = lines.utf16Column(text, end);
+        }
+
+        /** Declarations in a program or class body; locals are not indexed. */
+        void collect(const ASTNode *block, const ClassDeclNode *owner)
+        {
+            for (const auto &child : static_cast<const BlockNode *>(block)->children)
+            {
+                switch (child->type)
+                {
+                case ASTNodeType::ClassDecl:
+                {
+                    auto *cls = static_cast<const ClassDeclNode *>(child.get());
+                    add(cls, cls->name, SymbolKind::Class, owner);
+                    if (cls->body)
+                        collect(cls->body.get(), cls);
+                    break;
+                }
+                case ASTNodeType::FunctionDecl:
+                {
+                    auto *fn = static_cast<const FunctionDeclNode *>(child.get());
+                    add(fn, fn->name, owner ? SymbolKind::Method : SymbolKind::Function, owner);
+                    break;
+                }
+                case ASTNodeType::VarDecl:
+                {
+                    auto *var = static_cast<const VarDeclNode *>(child.get());
+                    if (owner)
+                        add(var, var->name, var->isConst ? SymbolKind::Constant : SymbolKind::Field, owner);
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+        }
+    };
+}
+
+FileIndex indexFile(const std::string &text)
+{
+    Lexer lexer(text, "");
+    Parser parser(lexer);
+    ASTNodePtr root = parser.parserProgram();
+    std::vector<Diagnostic> ignored;
+    resolveNames(root.get(), ignored);
+    DocumentIndex document(std::move(lexer.Source), std::move(root));
+
+    FileIndex index;
+    Collector collector{document.text, document.lines, {}};
+    if (document.root && document.root->type == ASTNodeType::Block)
+        collector.collect(document.root.get(), nullptr);
+    index.symbols = std::move(collector.symbols);
+
+    for (const NameUse &name : document.names())
+    {
+        std::string key = document.key(name);
+        if (key.empty())
+            continue;
+        WorkspaceReference r;
+        r.line = document.lines.resolve(name.begin).line - 1;
+        r.character = document.lines.utf16Column(document.text, name.begin);
+        r.endCharacter = document.lines.utf16Column(document.text, name.end);
+        r.declaration = name.declaration;
+        index.references.emplace_back(std::move(key), r);
+    }
+    return index;
+}
+
+void WorkspaceIndex::build(const std::vector<fs::path> &roots, ArtifactCache *cache, unsigned threads, const std::atomic<bool> *stop)
+{
+    this->roots = roots;
+    files.clear();
+    symbols.clear();
+    references.clear();
+    keys.clear();
+    masks.clear();
+    for (const auto &root : roots)
+    {
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code typeEc;
+            if (it->path().extension() == ".vs" && it->is_regular_file(typeEc))
+                files.push_back(it->path());
+        }
+    }
+    // Roots may overlap.
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    std::vector<FileIndex> results(files.size());
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> parsedFiles{0};
+    auto work = [&]
+    {
+        std::string text;
+        std::string entry;
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < files.size();)
+        {
+            if (stop && stop->load(std::memory_order_relaxed))
+                return;
+            bool parsedFile;
+            if (load(files[i], cache, results[i], parsedFile, text, entry) && parsedFile)
+                parsedFiles.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, files.size() + 1));
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i)
+        workers.emplace_back(work);
+    work();
+    for (auto &worker : workers)
+        worker.join();
+    if (cache)
+        cache->evict();
+    parsed = parsedFiles.load();
+
+    size_t total = 0;
+    for (const auto &result : results)
+        total += result.references.size();
+    references.reserve(total);
+
+    for (size_t i = 0; i < results.size(); ++i)
+        add(static_cast<uint32_t>(i), results[i]);
+}
+
+void WorkspaceIndex::update(const std::vector<fs::path> &changed, ArtifactCache *cache)
+{
+    parsed = 0;
+    std::string text;
+    std::string entry;
+    for (const auto &path : changed)
+    {
+        fs::path normal = path.lexically_normal();
+        if (normal.extension() != ".vs" || std::none_of(roots.begin(), roots.end(), [&](const fs::path &root) { return within(normal, root); }))
+            continue;
+        auto known = std::find_if(files.begin(), files.end(), [&](const fs::path &file) { return file.lexically_normal() == normal; });
+        auto file = static_cast<uint32_t>(known - files.begin());
+        if (known != files.end())
+            remove(file);
+
+        FileIndex result;
+        bool parsedFile = false;
+        std::error_code ec;
+        if (!fs::is_regular_file(normal, ec) || !load(normal, cache, result, parsedFile, text, entry))
+            continue;
+        if (known == files.end())
+            files.push_back(normal);
+        parsed += parsedFile;
+        add(file, result);
+    }
+    if (cache)
+        cache->evict();
+}
+
+void WorkspaceIndex::add(uint32_t file, FileIndex &index)
+{
+    for (auto &symbol : index.symbols)
+    {
+        symbol.file = file;
+        std::string key = symbol.name;
+        std::transform(key.begin(), key.end(), key.begin(), lower);
+        masks.push_back(charMask(key));
+        keys.push_back(std::move(key));
+        symbols.push_back(std::move(symbol));
+    }
+    for (auto &[key, reference] : index.references)
+    {
+        reference.file = file;
+        references[std::move(key)].push_back(reference);
+    }
+}
+
+void WorkspaceIndex::remove(uint32_t file)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < symbols.size(); ++i)
+    {
+        if (symbols[i].file == file)
+            continue;
+        if (kept != i)
+        {
+            symbols[kept] = std::move(symbols[i]);
+            keys[kept] = std::move(keys[i]);
+            masks[kept] = masks[i];
+        }
+        ++kept;
+    }
+    symbols.resize(kept);
+    keys.resize(kept);
+    masks.resize(kept);
+
+    for (auto it = references.begin(); it != references.end();)
+    {
+        auto &uses = it->second;
+        uses.erase(std::remove_if(uses.begin(), uses.end(), [&](const WorkspaceReference &r) { return r.file == file; }), uses.end());
+        it = uses.empty() ? references.erase(it) : std::next(it);
+    }
+}
+
+std::vector<const WorkspaceSymbol *> WorkspaceIndex::query(std::string_view pattern, size_t limit) const
+{
+    std::string lowered(pattern);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), lower);
+    uint64_t required = charMask(lowered);
+
+    struct Match
+    {
+        int score;
+        uint32_t symbol;
+    };
+    std::vector<Match> matches;
+    for (size_t i = 0; i < symbols.size(); ++i)
+    {
+        if ((masks[i] & required) != required)
+            continue;
+        int s = score(lowered, keys[i], symbols[i].name);
+        if (s >= 0)
+            matches.push_back({s, static_cast<uint32_t>(i)});
+    }
+
+    auto better = [&](const Match &a, const Match &b)
+    {
+        if (a.score != b.score)
+            return a.score > b.score;
+        const std::string &x = symbols[a.symbol].name;
+        const std::string &y = symbols[b.symbol].name;
+        if (x.size() != y.size())
+            return x.size() < y.size();
+        return x != y ? x < y : a.symbol < b.symbol;
+    };
+    size_t count = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(count), matches.end(), better);
+
+    std::vector<const WorkspaceSymbol *> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        result.push_back(&symbols[matches[i].symbol]);
+    return result;
+}
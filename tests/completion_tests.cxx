@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/completion.hxx"
+#include "../source/include/parser.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static ASTNodePtr parse(const std::string &source)
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    return parser.parserProgram();
+}
+
+static bool contains(const std::vector<std::string> &names, const std::string &name)
+{
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+struct Offered
+{
+    std::vector<std::string> names;
+    bool incomplete;
+};
+
+/**
+ * Complete at the first '|' of a program, which is removed before parsing.
+ */
+static Offered completeAt(std::string source, size_t limit = 50)
+{
+    size_t cursor = source.find('|');
+    source.erase(cursor, 1);
+    ASTNodePtr root = parse(source);
+    SymbolIndex index(root.get());
+    CompletionQuery query = completionQuery(std::string_view(source).substr(0, cursor), static_cast<uint32_t>(cursor));
+    query.limit = limit;
+
+    Completions completions = index.complete(query);
+    Offered offered{{}, completions.incomplete};
+    for (const Symbol *symbol : completions.items)
+        offered.names.push_back(symbol->name);
+    return offered;
+}
+
+static void TestTrie()
+{
+    SymbolTrie trie;
+    trie.insert("total", 0);
+    trie.insert("Total", 1);
+    trie.insert("toad", 2);
+    trie.insert("tea", 3);
+
+    std::vector<uint32_t> values;
+    trie.collect("TO", values);
+    expect(values.size() == 3, 0, "case-insensitive prefix");
+    expect(values[0] == 2, 0, "keys in order");
+
+    values.clear();
+    trie.collect("x", values);
+    expect(values.empty(), 1, "no match");
+
+    values.clear();
+    trie.collect("", values);
+    expect(values.size() == 4, 2, "empty prefix matches everything");
+    std::cout << "[PASS] TestTrie\n";
+}
+
+static void TestQuery()
+{
+    CompletionQuery query = completionQuery("    return Math.ad", 18);
+    expect(query.prefix == "ad", 0, "prefix");
+    expect(query.qualifier == "Math", 0, "qualifier");
+
+    query = completionQuery("var x: int64 = ", 15);
+    expect(query.prefix.empty() && query.qualifier.empty(), 1, "nothing typed");
+    std::cout << "[PASS] TestQuery\n";
+}
+
+static void TestScopes()
+{
+    const std::string program = R"(var total: int64 = 1
+f(int64[count]) int64 {
+    var tally: int64 = count
+    return t|
+}
+g(int64[tick]) int64 {
+    return tick
+}
+var tail: int64 = 2)";
+
+    auto names = completeAt(program).names;
+    expect(contains(names, "tally"), 0, "local");
+    expect(contains(names, "total"), 0, "global declared before");
+    expect(!contains(names, "tail"), 1, "global declared after is not visible");
+    expect(!contains(names, "tick"), 1, "parameter of another function");
+    expect(contains(names, "true"), 2, "keywords");
+    expect(names[0] == "tally", 3, "locals rank first, got " + names[0]);
+    expect(names.back() == "typedef" || names.back() == "true", 3, "keywords rank last");
+
+    names = completeAt(program.substr(0, program.find("return t|")) + "return c|\n}").names;
+    expect(contains(names, "count") && contains(names, "class") && contains(names, "const"), 4, "parameter and keywords");
+    expect(names[0] == "count", 4, "parameter first");
+    std::cout << "[PASS] TestScopes\n";
+}
+
+static void TestMembers()
+{
+    // '#' marks the other place completion is asked at; it is removed.
+    const std::string program = R"(class Math {
+    public static add(int64[a, b]) int64 {
+        return a + s#
+    }
+    private static square(int64[a]) int64 {
+        return a * a
+    }
+    static var scale : int64 = 2
+}
+var x: int64 = Math.#add(1, 2))";
+
+    std::string inside = program;
+    inside.replace(inside.find('#'), 1, "|");
+    inside.erase(inside.find('#'), 1);
+    auto names = completeAt(inside).names;
+    expect(contains(names, "square") && contains(names, "scale"), 0, "members inside the class");
+    expect(contains(names, "static") && contains(names, "string"), 0, "keywords inside the class");
+
+    std::string outside = program;
+    outside.erase(outside.find('#'), 1);
+    outside.replace(outside.find('#'), 1, "|");
+    names = completeAt(outside).names;
+    expect(names.size() == 1 && names[0] == "add", 1, "only public members outside the class");
+    std::cout << "[PASS] TestMembers\n";
+}
+
+static void TestRankingAndLimit()
+{
+    std::string program = "var Value: int64 = 1\n";
+    for (int i = 0; i < 30; ++i)
+        program += "var value" + std::to_string(i) + ": int64 = 1\n";
+    program += "var x: int64 = Val|";
+
+    Offered offered = completeAt(program, 10);
+    expect(offered.names.size() == 10, 0, "capped");
+    expect(offered.incomplete, 0, "more matched than were sent");
+    expect(offered.names[0] == "Value", 1, "exact case first");
+    expect(offered.names[1] == "value0", 2, "then shorter names");
+
+    offered = completeAt(program, 100);
+    expect(offered.names.size() == 31 && !offered.incomplete, 3, "complete under the limit");
+
+    auto names = completeAt("f(int64[x]) int64 {\n    return 1\n}\nf(int64[x, y]) int64 {\n    return f|\n}").names;
+    expect(std::count(names.begin(), names.end(), "f") == 1, 4, "overloads offered once");
+    std::cout << "[PASS] TestRankingAndLimit\n";
+}
+
+int main()
+{
+    TestTrie();
+    TestQuery();
+    TestScopes();
+    TestMembers();
+    TestRankingAndLimit();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}
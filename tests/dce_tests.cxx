@@ -0,0 +1,230 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/dce.hxx"
+#include "../source/include/fold.hxx"
+#include "../source/include/parser.hxx"
+#include "../source/include/resolver.hxx"
+#include "../source/include/source.hxx"
+#include "../source/include/visitor.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+struct Eliminated
+{
+    ASTNodePtr ast;
+    std::vector<std::string> messages;
+    size_t removed = 0;
+    size_t before = 0; /**< Nodes in the tree when the pass started */
+};
+
+/**
+ * Parse, resolve, check, fold and eliminate dead code, keeping the warnings.
+ */
+static void run(const std::string &source, Eliminated &out)
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    out.ast = parser.parserProgram();
+
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(out.ast.get(), diagnostics);
+    TypeTable types;
+    checkTypes(out.ast.get(), types, diagnostics);
+    if (diagnostics.empty())
+        foldConstants(out.ast, types, diagnostics);
+    if (diagnostics.empty())
+    {
+        out.before = countNodes(out.ast.get());
+        out.removed = eliminateDeadCode(out.ast, &diagnostics);
+    }
+
+    SourceManager sources;
+    sources.addFile("test.vs", source);
+    for (const auto &d : diagnostics)
+        out.messages.push_back(sources.format(d));
+}
+
+static const BlockNode *bodyOf(const ASTNode *node)
+{
+    if (const auto *fn = nodeAs<FunctionDeclNode>(node))
+        return static_cast<const BlockNode *>(fn->body.get());
+    return static_cast<const BlockNode *>(nodeAs<ClassDeclNode>(node)->body.get());
+}
+
+static void TestUnreachableStatements()
+{
+    Eliminated e;
+    run(R"(f(int64[a]) int64 {
+    return a
+    a + 1
+    return 2
+}
+g(int64[a]) int64 {
+    if a > 1 {
+        return 1
+    } else {
+        return 2
+    }
+    return 3
+})",
+        e);
+
+    std::vector<std::string> expected = {
+        "test.vs:3:5: warning: unreachable code removed",
+        "test.vs:12:5: warning: unreachable code removed",
+    };
+    expect(e.messages == expected, 0, "diagnostics mismatch: got " + std::to_string(e.messages.size()) + (e.messages.empty() ? "" : ", first: " + e.messages[0]));
+
+    const auto *program = static_cast<const BlockNode *>(e.ast.get());
+    expect(bodyOf(program->children[0].get())->children.size() == 1, 1, "f must keep only its first return");
+    expect(bodyOf(program->children[1].get())->children.size() == 1, 1, "g must keep only the if");
+    expect(e.removed == 7, 2, "expected 7 removed nodes, got " + std::to_string(e.removed));
+    std::cout << "[PASS] TestUnreachableStatements\n";
+}
+
+static void TestConstantConditions()
+{
+    Eliminated e;
+    run(R"(const debug : boolean = false
+h(int64[a]) int64 {
+    if debug {
+        return 0
+    }
+    if 1 < 2 {
+        return a + 1
+    } else {
+        return 5
+    }
+    return a
+})",
+        e);
+
+    std::vector<std::string> expected = {
+        "test.vs:3:8: warning: condition is always false",
+        "test.vs:6:8: warning: condition is always true",
+        "test.vs:11:5: warning: unreachable code removed",
+    };
+    expect(e.messages == expected, 0, "diagnostics mismatch: got " + std::to_string(e.messages.size()) + (e.messages.empty() ? "" : ", first: " + e.messages[0]));
+
+    const auto *program = static_cast<const BlockNode *>(e.ast.get());
+    const auto *body = bodyOf(program->children[1].get());
+    expect(body->children.size() == 1, 1, "the taken branch must be spliced into the function body");
+    const auto *ret = nodeAs<ReturnExprNode>(body->children[0].get());
+    expect(ret && nodeAs<BinaryExprNode>(ret->expr.get()), 1, "the spliced statement must be 'return a + 1'");
+    expect(ret->parent == nullptr, 2, "spliced statements take the parent of the if they replace");
+    std::cout << "[PASS] TestConstantConditions\n";
+}
+
+static void TestUnusedPrivateMembers()
+{
+    Eliminated e;
+    run(R"(public class Counter {
+    var total : int64 = 0
+    var base : int64 = 10
+    var step : int64 = base
+    public static next() int64 {
+        return total + 1
+    }
+    private peek() int64 {
+        return step
+    }
+    twice() int64 {
+        return 2
+    }
+    Counter() void {
+        total = 1
+    }
+    public var shown : int64 = 0
+})",
+        e);
+
+    std::vector<std::string> expected = {
+        "test.vs:3:5: warning: unused private field 'base' removed",
+        "test.vs:4:5: warning: unused private field 'step' removed",
+        "test.vs:8:5: warning: unused private function 'peek' removed",
+    };
+    expect(e.messages == expected, 0, "diagnostics mismatch: got " + std::to_string(e.messages.size()) + (e.messages.empty() ? "" : ", first: " + e.messages[0]));
+
+    const auto *program = static_cast<const BlockNode *>(e.ast.get());
+    const auto *body = bodyOf(program->children[0].get());
+    std::vector<std::string> kept;
+    for (const auto &child : body->children)
+    {
+        if (const auto *var = nodeAs<VarDeclNode>(child.get()))
+            kept.push_back(var->name);
+        else if (const auto *fn = nodeAs<FunctionDeclNode>(child.get()))
+            kept.push_back(fn->name);
+    }
+    std::vector<std::string> expectedKept = {"total", "next", "twice", "Counter", "shown"};
+    expect(kept == expectedKept, 1, "used, public, unmarked method and constructor members must be kept");
+    for (const auto &child : body->children)
+        expect(child->parent == program->children[0].get(), 2, "members must keep their class as parent");
+    // base and step are a declaration and a value each, peek a declaration, a block, a return and a name.
+    expect(e.removed == 8, 3, "removed members must be counted, got " + std::to_string(e.removed));
+    expect(e.before - countNodes(e.ast.get()) == e.removed, 3, "the count must match the tree");
+    std::cout << "[PASS] TestUnusedPrivateMembers\n";
+}
+
+static void TestFieldsWithEffectsAreKept()
+{
+    Eliminated e;
+    run(R"(class Counter {
+    public static var count : int64 = 0
+    private static var dummy : int64 = Counter.bump()
+    private static var reset : int64 = count = 5
+    private static var copy : int64 = count + 1
+    public static bump() int64 {
+        count = count + 1
+        return count
+    }
+})",
+        e);
+
+    std::vector<std::string> expected = {
+        "test.vs:5:5: warning: unused private field 'copy' removed",
+    };
+    expect(e.messages == expected, 0, "diagnostics mismatch: got " + std::to_string(e.messages.size()) + (e.messages.empty() ? "" : ", first: " + e.messages[0]));
+
+    const auto *program = static_cast<const BlockNode *>(e.ast.get());
+    std::vector<std::string> kept;
+    for (const auto &child : bodyOf(program->children[0].get())->children)
+        if (const auto *var = nodeAs<VarDeclNode>(child.get()))
+            kept.push_back(var->name);
+    expect(kept == std::vector<std::string>{"count", "dummy", "reset"}, 1, "initializers that call or assign must still run");
+    std::cout << "[PASS] TestFieldsWithEffectsAreKept\n";
+}
+
+static void TestWarningsAreOptional()
+{
+    Lexer lexer("f() int64 {\n    return 1\n    return 2\n}", "test.vs");
+    Parser parser(lexer);
+    ASTNodePtr ast = parser.parserProgram();
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(ast.get(), diagnostics);
+    expect(diagnostics.empty(), 0, "program must resolve");
+    expect(eliminateDeadCode(ast) == 2, 0, "the second return and its value must be removed");
+    expect(eliminateDeadCode(ast) == 0, 1, "a second run must find nothing");
+    std::cout << "[PASS] TestWarningsAreOptional\n";
+}
+
+int main()
+{
+    TestUnreachableStatements();
+    TestConstantConditions();
+    TestUnusedPrivateMembers();
+    TestFieldsWithEffectsAreKept();
+    TestWarningsAreOptional();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/fold.hxx"
+#include "../source/include/parser.hxx"
+#include "../source/include/resolver.hxx"
+#include "../source/include/source.hxx"
+#include "../source/include/visitor.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+struct Folded
+{
+    ASTNodePtr ast;
+    TypeTable types;
+    std::vector<std::string> messages;
+    size_t replaced = 0;
+};
+
+/**
+ * Parse, resolve, check and fold a program.
+ */
+static void run(const std::string &source, Folded &out, const EvalLimits &limits = {})
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    out.ast = parser.parserProgram();
+
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(out.ast.get(), diagnostics);
+    checkTypes(out.ast.get(), out.types, diagnostics);
+    if (diagnostics.empty())
+        out.replaced = foldConstants(out.ast, out.types, diagnostics, limits);
+
+    SourceManager sources;
+    sources.addFile("test.vs", source);
+    for (const auto &d : diagnostics)
+        out.messages.push_back(sources.format(d));
+}
+
+/**
+ * Initializer of the i-th top-level declaration.
+ */
+static const LiteralNode *initializer(const Folded &f, size_t i)
+{
+    const auto *program = static_cast<const BlockNode *>(f.ast.get());
+    return nodeAs<LiteralNode>(nodeAs<VarDeclNode>(program->children[i].get())->value.get());
+}
+
+static void TestIntegerWidths()
+{
+    Folded f;
+    run(R"(var a : int64 = 1 + 2 * 3
+var b : int8 = 100 + 27
+var c : uint8 = 200 + 55
+var d : int16 = 0 - 32767 - 1
+var e : int32 = 7 / 2 + 7 % 2
+var f : uint64 = 18446744073709551615u - 1
+var g : boolean = 3 < 4)",
+        f);
+    expect(f.messages.empty(), 0, f.messages.empty() ? "" : f.messages[0]);
+
+    expect(initializer(f, 0) && std::get<int64_t>(initializer(f, 0)->value) == 7, 0, "1 + 2 * 3");
+    expect(initializer(f, 1) && std::get<int8_t>(initializer(f, 1)->value) == 127, 1, "int8 max");
+    expect(initializer(f, 1)->literalType == Type::Int8, 1, "result must carry its width");
+    expect(initializer(f, 2) && std::get<uint8_t>(initializer(f, 2)->value) == 255, 1, "uint8 max");
+    expect(initializer(f, 3) && std::get<int16_t>(initializer(f, 3)->value) == -32768, 1, "int16 min");
+    expect(initializer(f, 4) && std::get<int32_t>(initializer(f, 4)->value) == 4, 2, "division truncates");
+    expect(initializer(f, 5) && std::get<uint64_t>(initializer(f, 5)->value) == 18446744073709551614ULL, 2, "uint64 near max");
+    expect(initializer(f, 6) && std::get<bool>(initializer(f, 6)->value), 2, "comparison");
+    std::cout << "[PASS] TestIntegerWidths\n";
+}
+
+static void TestOverflowIsReported()
+{
+    Folded f;
+    run(R"(var a : int8 = 100 + 28
+var b : uint8 = 1 - 2
+var c : int64 = 4611686018427387904 * 2
+var d : int32 = 1 / 0
+var e : int16 = 300 * 200)",
+        f);
+
+    std::vector<std::string> expected = {
+        "test.vs:1:16: error: constant expression overflows int8",
+        "test.vs:2:17: error: constant expression overflows uint8",
+        "test.vs:3:17: error: constant expression overflows int64",
+        "test.vs:4:17: error: division by zero in constant expression",
+        "test.vs:5:17: error: constant expression overflows int16",
+    };
+    expect(f.messages == expected, 0, "diagnostics mismatch: got " + std::to_string(f.messages.size()) + (f.messages.empty() ? "" : ", first: " + f.messages[0]));
+    expect(!initializer(f, 0), 1, "overflowing expressions must stay unfolded");
+    std::cout << "[PASS] TestOverflowIsReported\n";
+}
+
+static void TestFloatSemantics()
+{
+    Folded f;
+    run(R"(var a : float32 = 0.1 + 0.2
+var b : float64 = 0.1 + 0.2
+var c : float64 = 1.0 / 0.0
+var d : float32 = 3.14 * 2)",
+        f);
+    expect(f.messages.empty(), 0, f.messages.empty() ? "" : f.messages[0]);
+
+    float a = std::get<float>(initializer(f, 0)->value);
+    float expectedA = 0.1f + 0.2f;
+    expect(std::memcmp(&a, &expectedA, sizeof(float)) == 0, 0, "float32 must round in single precision");
+    expect(std::get<double>(initializer(f, 1)->value) == 0.1 + 0.2, 0, "float64 addition");
+    expect(std::isinf(std::get<double>(initializer(f, 2)->value)), 1, "IEEE division by zero is infinity");
+    expect(std::get<float>(initializer(f, 3)->value) == 3.14f * 2.0f, 1, "3.14 * 2 in float32");
+    std::cout << "[PASS] TestFloatSemantics\n";
+}
+
+static void TestConstPropagation()
+{
+    Folded f;
+    run(R"(public class Math {
+    public static area(float64[r]) float64 {
+        return pi * r * r
+    }
+    public static const pi: float64 = 3.14
+    public static const tau: float64 = pi * 2
+    static var calls : int64 = 0
+    public static count() int64 {
+        return calls + 1
+    }
+})",
+        f);
+    expect(f.messages.empty(), 0, f.messages.empty() ? "" : f.messages[0]);
+
+    const auto *program = static_cast<const BlockNode *>(f.ast.get());
+    const auto *body = static_cast<const BlockNode *>(nodeAs<ClassDeclNode>(program->children[0].get())->body.get());
+    const auto *area = nodeAs<FunctionDeclNode>(body->children[0].get());
+    const auto *ret = nodeAs<ReturnExprNode>(static_cast<const BlockNode *>(area->body.get())->children[0].get());
+    const auto *product = nodeAs<BinaryExprNode>(nodeAs<BinaryExprNode>(ret->expr.get())->left.get());
+    const auto *pi = nodeAs<LiteralNode>(product->left.get());
+    expect(pi && std::get<double>(pi->value) == 3.14, 1, "pi must be propagated before its declaration");
+
+    const auto *tau = nodeAs<LiteralNode>(nodeAs<VarDeclNode>(body->children[2].get())->value.get());
+    expect(tau && std::get<double>(tau->value) == 6.28, 1, "pi * 2 must fold through the constant");
+
+    const auto *count = nodeAs<FunctionDeclNode>(body->children[4].get());
+    const auto *sum = nodeAs<ReturnExprNode>(static_cast<const BlockNode *>(count->body.get())->children[0].get())->expr.get();
+    expect(nodeAs<BinaryExprNode>(sum) != nullptr, 2, "variables must not be propagated");
+    expect(f.replaced == 3, 2, "expected 3 replacements, got " + std::to_string(f.replaced));
+
+    Folded outside;
+    run("public class Math {\n    public static const pi: float64 = 3.14\n}\nconst tau: float64 = Math.pi * 2\n", outside);
+    expect(outside.messages.empty() && initializer(outside, 1) && std::get<double>(initializer(outside, 1)->value) == 6.28, 3,
+           "Math.pi must be propagated outside its class");
+    std::cout << "[PASS] TestConstPropagation\n";
+}
+
+static void TestPureCallsAreEvaluated()
+{
+    Folded f;
+    run(R"(public class Math {
+    public static add(int64[a, b]) int64 {
+        return a + b
+    }
+}
+fib(int64[n]) int64 {
+    if n < 2 {
+        return n
+    }
+    return fib(n - 1) + fib(n - 2)
+}
+sum(int64[n]) int64 {
+    var s : int64 = 0
+    if n > 0 {
+        s = n + sum(n - 1)
+    }
+    return s
+}
+inc8(int8[a]) int8 {
+    return a + 1
+}
+var counter : int64 = 0
+bump(int64[a]) int64 {
+    counter = counter + a
+    return counter
+}
+const three : int64 = Math.add(1, 2)
+const big : int64 = fib(80)
+var table : int64 = sum(100) + three
+var bumped : int64 = bump(1)
+var wraps : int8 = inc8(127)
+use() int64 {
+    return fib(10)
+})",
+        f);
+    expect(f.messages.empty(), 0, f.messages.empty() ? "" : f.messages[0]);
+
+    expect(initializer(f, 6) && std::get<int64_t>(initializer(f, 6)->value) == 3, 0, "qualified static call");
+    expect(initializer(f, 7) && std::get<int64_t>(initializer(f, 7)->value) == 23416728348467685, 1, "fib(80) needs memoization to fit the budget");
+    expect(initializer(f, 8) && std::get<int64_t>(initializer(f, 8)->value) == 5053, 2, "globals are a constant context; locals and assignment evaluate");
+    expect(!initializer(f, 9), 3, "a function that writes a global is not pure");
+    expect(!initializer(f, 10), 4, "a call that overflows a variable is left to run");
+
+    const auto *program = static_cast<const BlockNode *>(f.ast.get());
+    const auto *use = nodeAs<FunctionDeclNode>(program->children[11].get());
+    const auto *ret = nodeAs<ReturnExprNode>(static_cast<const BlockNode *>(use->body.get())->children[0].get());
+    expect(nodeAs<FunctionCallNode>(ret->expr.get()) != nullptr, 5, "function bodies are not a constant context");
+    std::cout << "[PASS] TestPureCallsAreEvaluated\n";
+}
+
+static void TestCallBudgets()
+{
+    std::string source = R"(down(int64[n]) int64 {
+    if n == 0 {
+        return 0
+    }
+    return down(n - 1) + 1
+}
+const shallow : int64 = down(10)
+const deep : int64 = down(100))";
+
+    Folded f;
+    run(source, f, EvalLimits{100000, 50});
+    expect(initializer(f, 1) && std::get<int64_t>(initializer(f, 1)->value) == 10, 0, "within budget");
+    expect(!initializer(f, 2), 0, "past the recursion budget the call stays");
+    expect(f.messages.size() == 1 && f.messages[0] == "test.vs:8:22: warning: call to 'down' exceeds the compile-time recursion budget; it is evaluated at run time",
+           1, f.messages.empty() ? "expected a warning" : f.messages[0]);
+
+    Folded g;
+    run(source, g, EvalLimits{200, 1000});
+    expect(initializer(g, 1) && !initializer(g, 2), 2, "past the step budget the call stays");
+    expect(g.messages.size() == 1 && g.messages[0].find("step budget") != std::string::npos, 2, "step budget warning");
+    std::cout << "[PASS] TestCallBudgets\n";
+}
+
+static void TestTrapsInConstantCalls()
+{
+    Folded f;
+    run(R"(fact(int64[n]) int64 {
+    if n <= 1 {
+        return 1
+    }
+    return n * fact(n - 1)
+}
+ratio(int32[a, b]) int32 {
+    return a / b
+}
+const small : int64 = fact(20)
+const big : int64 = fact(25)
+const again : int64 = fact(25)
+const zero : int32 = ratio(1, 0)
+var wraps : int64 = fact(25))",
+        f);
+
+    std::vector<std::string> expected = {
+        "test.vs:11:21: error: constant expression overflows int64",
+        "test.vs:12:23: error: constant expression overflows int64",
+        "test.vs:13:22: error: division by zero in constant expression",
+    };
+    expect(f.messages == expected, 0, "diagnostics mismatch: got " + std::to_string(f.messages.size()) + (f.messages.empty() ? "" : ", first: " + f.messages[0]));
+    expect(initializer(f, 2) && std::get<int64_t>(initializer(f, 2)->value) == 2432902008176640000, 1, "fact(20) fits");
+    expect(!initializer(f, 3) && !initializer(f, 6), 2, "calls that trap stay; only constants must fold");
+    std::cout << "[PASS] TestTrapsInConstantCalls\n";
+}
+
+int main()
+{
+    TestIntegerWidths();
+    TestOverflowIsReported();
+    TestFloatSemantics();
+    TestConstPropagation();
+    TestPureCallsAreEvaluated();
+    TestCallBudgets();
+    TestTrapsInConstantCalls();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
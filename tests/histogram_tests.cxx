@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../source/include/histogram.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static void TestBuckets()
+{
+    for (uint64_t v = 0; v < 64; ++v)
+        expect(Histogram::bucketOf(v) == v && Histogram::highestIn(v) == v, 0, "small values are exact");
+    expect(Histogram::bucketOf(64) == Histogram::bucketOf(65) && Histogram::bucketOf(66) == 65, 1, "pairs above 64");
+    expect(Histogram::bucketOf(UINT64_MAX) == Histogram::Buckets - 1 && Histogram::highestIn(Histogram::Buckets - 1) == UINT64_MAX, 2,
+           "the last bucket ends the range");
+
+    // Every value lies in its bucket, buckets are contiguous, and none is
+    // wider than 1/32 of the values in it.
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 100000; ++i)
+    {
+        uint64_t v = random() >> (random() % 64);
+        size_t bucket = Histogram::bucketOf(v);
+        uint64_t low = bucket ? Histogram::highestIn(bucket - 1) + 1 : 0;
+        uint64_t high = Histogram::highestIn(bucket);
+        expect(low <= v && v <= high, 3, "value " + std::to_string(v) + " outside its bucket");
+        expect(high - low <= low / 32, 4, "bucket too wide at " + std::to_string(v));
+    }
+    std::cout << "[PASS] TestBuckets\n";
+}
+
+static void TestPercentiles()
+{
+    Histogram empty;
+    expect(empty.count() == 0 && empty.percentile(99) == 0 && empty.mean() == 0.0, 0, "empty");
+
+    // Latencies from 1 us to 10 ms, skewed low like real ones.
+    std::mt19937_64 random(42);
+    std::lognormal_distribution<double> latency(12.0, 1.0);
+    std::vector<uint64_t> values;
+    Histogram h;
+    for (int i = 0; i < 100000; ++i)
+    {
+        auto v = static_cast<uint64_t>(std::clamp(latency(random), 1e3, 1e7));
+        values.push_back(v);
+        h.record(v);
+    }
+    std::sort(values.begin(), values.end());
+    expect(h.count() == values.size() && h.max() == values.back(), 1, "count and max");
+
+    for (double p : {50.0, 95.0, 99.0, 99.9})
+    {
+        uint64_t exact = values[static_cast<size_t>(p / 100.0 * static_cast<double>(values.size())) - 1];
+        uint64_t reported = h.percentile(p);
+        expect(reported >= exact && reported - exact <= exact / 32 + 1, 2,
+               "p" + std::to_string(p) + ": " + std::to_string(reported) + " vs " + std::to_string(exact));
+    }
+    expect(h.percentile(100) == values.back() && h.percentile(0) <= values.front() + values.front() / 32, 3, "extremes");
+
+    Histogram one;
+    one.record(1000000);
+    expect(one.percentile(50) == 1000000 && one.mean() == 1e6, 4, "capped at the largest value");
+    std::cout << "[PASS] TestPercentiles\n";
+}
+
+static void TestConcurrentRecording()
+{
+    Histogram h;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&h, t] {
+            for (uint64_t i = 0; i < 50000; ++i)
+                h.record(i % 1000 + static_cast<uint64_t>(t));
+        });
+    for (auto &thread : threads)
+        thread.join();
+    expect(h.count() == 200000, 0, "no lost counts");
+    expect(h.max() == 1002, 1, "max");
+    std::cout << "[PASS] TestConcurrentRecording\n";
+}
+
+int main()
+{
+    TestBuckets();
+    TestPercentiles();
+    TestConcurrentRecording();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../source/include/fold.hxx"
+#include "../source/include/ir.hxx"
+#include "../source/include/parser.hxx"
+#include "../source/include/resolver.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+struct Lowered
+{
+    ASTNodePtr ast;
+    TypeTable types;
+    IRModule ir;
+};
+
+static void lower(const std::string &source, Lowered &out)
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    out.ast = parser.parserProgram();
+
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(out.ast.get(), diagnostics);
+    checkTypes(out.ast.get(), out.types, diagnostics);
+    foldConstants(out.ast, out.types, diagnostics);
+    if (!diagnostics.empty())
+        fail(0, "program must compile: " + diagnostics[0].message);
+    out.ir = lowerToIR(out.ast.get(), out.types);
+}
+
+static const IRFunction *function(const IRModule &module, const std::string &name)
+{
+    for (const auto &fn : module.functions)
+        if (fn.name == name)
+            return &fn;
+    return nullptr;
+}
+
+static void TestPhiAtJoin()
+{
+    Lowered l;
+    lower(R"(abs(int64[a]) int64 {
+    var r : int64 = a
+    if a < 0 {
+        r = 0 - a
+    }
+    return r
+})",
+          l);
+
+    std::ostringstream text;
+    printIR(l.ir, l.types, text);
+    std::string expected = R"(function @abs(int64) int64 {
+bb0:
+    %0 = param 0 : int64
+    %1 = const 0 : int64
+    %2 = lt %0, %1 : boolean
+    condbr %2, bb1, bb2
+bb1:
+    %4 = const 0 : int64
+    %5 = sub %4, %0 : int64
+    br bb2
+bb2:
+    %7 = phi [bb1: %5], [bb0: %0] : int64
+    ret %7
+}
+)";
+    expect(text.str() == expected, 0, "unexpected IR:\n" + text.str());
+
+    const IRFunction &fn = l.ir.functions[0];
+    expect(fn.successors(0) == std::vector<BlockId>{1, 2}, 1, "entry branches to the then block and the join");
+    expect(fn.successors(1) == std::vector<BlockId>{2}, 1, "then block falls through to the join");
+    expect(fn.successors(2).empty(), 1, "return has no successors");
+    std::cout << "[PASS] TestPhiAtJoin\n";
+}
+
+static void TestBlocksAreContiguous()
+{
+    Lowered l;
+    lower(R"(classify(int32[x]) int32 {
+    var r : int32 = 0
+    if x > 10 {
+        if x > 100 {
+            r = 2
+        } else {
+            r = 1
+        }
+    } else {
+        return 0 - 1
+    }
+    return r
+})",
+          l);
+
+    const IRFunction &fn = *function(l.ir, "classify");
+    uint32_t next = 0;
+    for (const auto &block : fn.blocks)
+    {
+        expect(block.first == next && block.end > block.first, 0, "blocks must tile the instruction array in order");
+        next = block.end;
+        Opcode last = fn.instructions[block.end - 1].op;
+        expect(last == Opcode::Br || last == Opcode::CondBr || last == Opcode::Ret, 1, "every block ends in a terminator");
+    }
+    expect(next == fn.instructions.size(), 0, "every instruction belongs to a block");
+
+    // Only the inner if merges two values of r; the else of the outer if returns.
+    size_t phis = 0;
+    for (const auto &inst : fn.instructions)
+        if (inst.op == Opcode::Phi)
+        {
+            ++phis;
+            expect(inst.operandCount == 4 && inst.type == TypeTable::primitive(Type::Int32), 2, "phi of two int32 values");
+        }
+    expect(phis == 1, 2, "expected exactly one phi, got " + std::to_string(phis));
+    expect(sizeof(IRInstruction) == 16, 3, "instructions must stay 16 bytes");
+    std::cout << "[PASS] TestBlocksAreContiguous\n";
+}
+
+static void TestGlobalsAndInit()
+{
+    Lowered l;
+    lower(R"(var total : int64 = 5
+public class Counter {
+    public static var count : int64
+    public static next() int64 {
+        count = count + total
+        return count
+    }
+})",
+          l);
+
+    expect(l.ir.globals.size() == 2 && l.ir.globals[1].name == "Counter.count", 0, "fields are qualified globals");
+    const IRFunction *init = function(l.ir, IRModule::InitFunction);
+    expect(init && init->instructions.size() == 5, 1, "init stores both initial values");
+    expect(init->instructions[3].op == Opcode::Store && init->instructions[3].immediate == 1, 1, "uninitialized field stores zero");
+
+    const IRFunction *next = function(l.ir, "Counter.next");
+    expect(next != nullptr, 2, "methods are qualified");
+    size_t loads = 0, stores = 0;
+    for (const auto &inst : next->instructions)
+    {
+        loads += inst.op == Opcode::Load;
+        stores += inst.op == Opcode::Store;
+    }
+    expect(loads == 3 && stores == 1, 2, "globals are read and written through memory");
+    std::cout << "[PASS] TestGlobalsAndInit\n";
+}
+
+static void TestOverloadNames()
+{
+    Lowered l;
+    lower(R"(f(int64[a]) int64 {
+    return a
+}
+f(int64[a, b]) int64 {
+    return a + b
+}
+g() int64 {
+    return f(1) + f(1, 2)
+})",
+          l);
+    expect(function(l.ir, "f(int64)") && function(l.ir, "f(int64,int64)"), 0, "overloads are named by their parameter types");
+    expect(function(l.ir, "g") != nullptr, 1, "other functions keep their name");
+
+    // The resolver reports these; lowering must not emit two functions of one name.
+    Lexer lexer("f() int64 {\n    return 1\n}\nf() int64 {\n    return 2\n}\n", "test.vs");
+    Parser parser(lexer);
+    ASTNodePtr twice = parser.parserProgram();
+    TypeTable types;
+    std::string message;
+    try
+    {
+        lowerToIR(twice.get(), types);
+    }
+    catch (const std::runtime_error &e)
+    {
+        message = e.what();
+    }
+    expect(message == "duplicate function 'f()'", 2, "duplicates are rejected, got '" + message + "'");
+    std::cout << "[PASS] TestOverloadNames\n";
+}
+
+int main()
+{
+    TestPhiAtJoin();
+    TestBlocksAreContiguous();
+    TestGlobalsAndInit();
+    TestOverloadNames();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/jsonscan.hxx"
+#include "../source/include/nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static void TestEnvelope()
+{
+    const std::string body = R"( { "params" : {"textDocument": {"uri": "file:///a.vs", "version": 3}, "list": [1, {"x": "}"}, "]"]},
+        "jsonrpc": "2.0", "id": "req-1", "method": "textDocument/hover" } )";
+
+    std::string method;
+    std::string_view id, params;
+    JsonScanner scanner(body);
+    bool ok = scanner.object([&](std::string_view key) {
+        if (key == "method")
+            scanner.string(method);
+        else if (key == "id")
+            id = scanner.raw();
+        else if (key == "params")
+            params = scanner.raw();
+    });
+    expect(ok && scanner.ok(), 0, "well-formed");
+    expect(method == "textDocument/hover", 1, "method");
+    expect(id == "\"req-1\"", 2, "raw id");
+    expect(json::parse(params) == json::parse(body)["params"], 3, "raw params span the whole value");
+
+    std::string uri;
+    int64_t version = 0;
+    JsonScanner nested(params);
+    nested.object([&](std::string_view key) {
+        if (key == "textDocument")
+            nested.object([&](std::string_view field) {
+                if (field == "uri")
+                    nested.string(uri);
+                else if (field == "version")
+                    nested.integer(version);
+            });
+    });
+    expect(nested.ok() && uri == "file:///a.vs" && version == 3, 4, "nested members, others skipped");
+    std::cout << "[PASS] TestEnvelope\n";
+}
+
+static void TestStrings()
+{
+    // Escapes, a surrogate pair, and an unpaired surrogate.
+    const std::string body = R"(["a\"b\\c\/\n\t", "\u00e9\u20AC\ud83d\ude00", "\ud800x", ""])";
+    std::vector<std::string> values;
+    JsonScanner scanner(body);
+    std::string value;
+    bool ok = scanner.array([&] {
+        scanner.string(value);
+        values.push_back(value);
+    });
+    expect(ok, 0, "array of strings");
+    expect(values.size() == 4, 1, "four strings");
+    expect(values[0] == "a\"b\\c/\n\t", 2, "simple escapes");
+    expect(values[1] == "é€😀", 3, "\\u escapes to UTF-8");
+    expect(values[2] == "\xEF\xBF\xBD" "x", 4, "unpaired surrogate replaced");
+    expect(values[3].empty(), 5, "empty string");
+
+    std::string key;
+    JsonScanner escapedKey(R"({"te\u0078t": 1})");
+    escapedKey.object([&](std::string_view name) { key = name; });
+    expect(escapedKey.ok() && key == "text", 6, "escaped key");
+    std::cout << "[PASS] TestStrings\n";
+}
+
+static void TestMalformed()
+{
+    for (const char *body : {"", "{", "{\"a\" 1}", "{\"a\": }", "{\"a\": 1,}", "{\"a\": \"open}", "{\"a\": [1, 2}"})
+    {
+        JsonScanner scanner(body);
+        scanner.object([&](std::string_view) {});
+        expect(!scanner.ok(), 0, std::string("rejected: ") + body);
+    }
+
+    JsonScanner scanner(R"({"n": "x"})");
+    int64_t n = 0;
+    scanner.object([&](std::string_view) { scanner.integer(n); });
+    expect(!scanner.ok(), 1, "type mismatch");
+    std::cout << "[PASS] TestMalformed\n";
+}
+
+int main()
+{
+    TestEnvelope();
+    TestStrings();
+    TestMalformed();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}
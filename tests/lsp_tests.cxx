@@ -0,0 +1,616 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../source/include/lsp.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static std::string frame(const json &message)
+{
+    std::string body = message.dump();
+    return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static json request(int id, const std::string &method, json params = json::object())
+{
+    return {{"jsonrpc", "2.0"}, {"id", id}, {"method", method}, {"params", std::move(params)}};
+}
+
+static json notification(const std::string &method, json params)
+{
+    return {{"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}};
+}
+
+/**
+ * Split the server's output back into messages, in the order they were written.
+ */
+static std::vector<json> responses(const std::string &output)
+{
+    std::vector<json> messages;
+    size_t at = 0;
+    while ((at = output.find("Content-Length: ", at)) != std::string::npos)
+    {
+        size_t length = std::stoul(output.substr(at + 16));
+        size_t body = output.find("\r\n\r\n", at) + 4;
+        messages.push_back(json::parse(output.substr(body, length)));
+        at = body + length;
+    }
+    return messages;
+}
+
+static const json *responseTo(const std::vector<json> &messages, int id)
+{
+    for (const auto &message : messages)
+        if (message.value("id", -1) == id)
+            return &message;
+    return nullptr;
+}
+
+/**
+ * A handler that runs until it is cancelled, or gives up after a few seconds.
+ */
+static json waitForCancel(const json &, const CancellationToken &token)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!token.cancelled() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return "finished";
+}
+
+/**
+ * Input the test writes while the server runs, as a client would.
+ */
+class LiveSource : public ByteSource
+{
+public:
+    void send(const std::string &data)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending += data;
+        ready.notify_one();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        ready.notify_one();
+    }
+
+    size_t read(char *out, size_t size) override
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&] { return closed || !pending.empty(); });
+        size_t n = std::min(size, pending.size());
+        std::copy_n(pending.data(), n, out);
+        pending.erase(0, n);
+        return n;
+    }
+
+private:
+    std::string pending;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable ready;
+};
+
+class LiveSink : public ByteSink
+{
+public:
+    bool write(const std::string_view *pieces, size_t count) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i)
+            data.append(pieces[i]);
+        return true;
+    }
+
+    /** The diagnostics published so far, once there are at least `count`, or after a few seconds. */
+    std::vector<json> published(size_t count)
+    {
+        std::vector<json> found;
+        waitFor([&](const std::vector<json> &messages) {
+            found.clear();
+            for (const auto &message : messages)
+                if (message.value("method", "") == "textDocument/publishDiagnostics")
+                    found.push_back(message["params"]);
+            return found.size() >= count;
+        });
+        return found;
+    }
+
+    /** The response to a request, once it is written, or null after a few seconds. */
+    json response(int id)
+    {
+        json found;
+        waitFor([&](const std::vector<json> &messages) {
+            const json *message = responseTo(messages, id);
+            found = message ? *message : json();
+            return message != nullptr;
+        });
+        return found;
+    }
+
+private:
+    template <typename Done>
+    void waitFor(Done done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (true)
+        {
+            std::vector<json> messages;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                messages = responses(data);
+            }
+            if (done(messages) || std::chrono::steady_clock::now() > deadline)
+                return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::string data;
+    std::mutex mutex;
+};
+
+static void TestRequests()
+{
+    std::stringstream in;
+    in << frame(request(1, "initialize"))
+       << frame(request(2, "textDocument/completion"))
+       << frame(request(3, "no/such/method"))
+       << frame(request(4, "shutdown"))
+       << frame(notification("exit", json::object()));
+    std::stringstream out;
+    LSPServer server(in, out, 2);
+    server.runLSP();
+
+    auto messages = responses(out.str());
+    expect(messages.size() == 4, 0, "one response per request");
+    const json *init = responseTo(messages, 1);
+    expect(init && (*init)["result"]["capabilities"]["textDocumentSync"]["change"] == 2, 0, "incremental sync");
+    const json *completion = responseTo(messages, 2);
+    expect(completion && !(*completion)["result"]["items"].empty(), 1, "completion items");
+    const json *unknown = responseTo(messages, 3);
+    expect(unknown && (*unknown)["error"]["code"] == -32601, 2, "unknown method");
+    const json *shutdown = responseTo(messages, 4);
+    expect(shutdown && shutdown->contains("result") && (*shutdown)["result"].is_null(), 3, "shutdown");
+    std::cout << "[PASS] TestRequests\n";
+}
+
+static void TestCompletion()
+{
+    const std::string uri = "file:///a.vs";
+    std::stringstream in;
+    in << frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", uri}, {"version", 1}, {"text", "var total: int64 = 1\nvar x: int64 = to"}}}}))
+       << frame(request(1, "textDocument/completion", {{"textDocument", {{"uri", uri}}}, {"position", {{"line", 1}, {"character", 17}}}}))
+       << frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", "file:///broken.vs"}, {"version", 1}, {"text", "var x: int64 = (tr"}}}}))
+       << frame(request(2, "textDocument/completion", {{"textDocument", {{"uri", "file:///broken.vs"}}}, {"position", {{"line", 0}, {"character", 18}}}}));
+    std::stringstream out;
+    LSPServer server(in, out, 1);
+    server.runLSP();
+
+    auto messages = responses(out.str());
+    const json *completion = responseTo(messages, 1);
+    expect(completion && (*completion)["result"]["isIncomplete"] == false, 0, "all matches sent");
+    const json &items = (*completion)["result"]["items"];
+    expect(items.size() == 1 && items[0]["label"] == "total" && items[0]["kind"] == 6, 0, "declared variable matching the prefix");
+
+    const json *broken = responseTo(messages, 2);
+    expect(broken && (*broken)["result"]["items"].size() == 1 && (*broken)["result"]["items"][0]["label"] == "true", 1, "keywords while the text does not parse");
+    std::cout << "[PASS] TestCompletion\n";
+}
+
+static void TestDocumentText()
+{
+    // didOpen and didChange text is unescaped from the raw message, and
+    // members may come in any order.
+    const std::string uri = "file:///a.vs";
+    std::string change = R"({"jsonrpc":"2.0","method":"textDocument/didChange","params":{"contentChanges":[)"
+                         R"({"text":"var cafe: int64 = 1\nvar s: string = \"\u00e9\"\nvar t: int64 = caf","range":{"end":{"character":0,"line":0},"start":{"line":0,"character":0}}}],)"
+                         R"("textDocument":{"version":2,"uri":"file:///a.vs"}}})";
+    std::stringstream in;
+    in << frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", uri}, {"version", 1}, {"text", ""}}}}))
+       << "Content-Length: " << change.size() << "\r\n\r\n"
+       << change
+       << frame(notification("test/echo", {{"uri", uri}}))
+       << frame(request(1, "textDocument/completion", {{"textDocument", {{"uri", uri}}}, {"position", {{"line", 2}, {"character", 18}}}}));
+    std::stringstream out;
+    LSPServer server(in, out, 1);
+    std::string echoed;
+    server.onNotification("test/echo", [&](std::string_view params) { echoed = params; });
+    server.runLSP();
+
+    expect(json::parse(echoed) == json{{"uri", uri}}, 0, "notification handlers get the raw params");
+    auto messages = responses(out.str());
+    const json *completion = responseTo(messages, 1);
+    expect(completion && !completion->contains("error"), 1, "request after the change ran");
+    const json &items = (*completion)["result"]["items"];
+    expect(!items.empty() && items[0]["label"] == "cafe", 2, "unescaped text was inserted, got " + items.dump());
+    std::cout << "[PASS] TestDocumentText\n";
+}
+
+static void TestEndOfInput()
+{
+    // No exit notification: the server must stop at the end of the input.
+    std::stringstream in;
+    in << frame(request(1, "shutdown"));
+    std::stringstream out;
+    LSPServer server(in, out, 1);
+    server.runLSP();
+    expect(responses(out.str()).size() == 1, 0, "queued request answered before stopping");
+    std::cout << "[PASS] TestEndOfInput\n";
+}
+
+static void TestCancelRequest()
+{
+    std::stringstream in;
+    in << frame(request(7, "test/slow"))
+       << frame(notification("$/cancelRequest", {{"id", 7}}))
+       << frame(request(8, "test/slow"));
+    in << frame(notification("$/cancelRequest", {{"id", 8}}));
+    std::stringstream out;
+    LSPServer server(in, out, 1);
+    server.onRequest("test/slow", waitForCancel);
+    server.runLSP();
+
+    auto messages = responses(out.str());
+    expect(messages.size() == 2, 0, "each request answered once");
+    for (int id : {7, 8})
+    {
+        const json *response = responseTo(messages, id);
+        expect(response && (*response)["error"]["code"] == -32800, 1, "request " + std::to_string(id) + " cancelled");
+    }
+    std::cout << "[PASS] TestCancelRequest\n";
+}
+
+static void TestStaleRequests()
+{
+    const std::string uri = "file:///a.vs";
+    std::stringstream in;
+    in << frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", uri}, {"version", 1}, {"text", "int x;\n"}}}}))
+       << frame(request(1, "test/slow", {{"textDocument", {{"uri", uri}}}}))
+       << frame(request(2, "test/slow", {{"textDocument", {{"uri", "file:///other.vs"}}}}))
+       << frame(notification("textDocument/didChange", {{"textDocument", {{"uri", uri}, {"version", 2}}}, {"contentChanges", {{{"text", "int y;\n"}}}}}))
+       << frame(notification("$/cancelRequest", {{"id", 2}}));
+    std::stringstream out;
+    LSPServer server(in, out, 2);
+    server.onRequest("test/slow", waitForCancel);
+    server.runLSP();
+
+    auto messages = responses(out.str());
+    const json *stale = responseTo(messages, 1);
+    expect(stale && (*stale)["error"]["code"] == -32801, 0, "superseded by the newer version");
+    const json *other = responseTo(messages, 2);
+    expect(other && (*other)["error"]["code"] == -32800, 1, "other documents are left alone");
+    std::cout << "[PASS] TestStaleRequests\n";
+}
+
+static void TestLanesAreIndependent()
+{
+    // The background request only finishes once an interactive request has
+    // run, so they must not share a thread.
+    std::atomic<bool> answered{false};
+    std::stringstream in;
+    in << frame(request(1, "test/analyze"))
+       << frame(request(2, "test/quick"));
+    std::stringstream out;
+    LSPServer server(in, out, 1);
+    server.onRequest(
+        "test/analyze", [&](const json &, const CancellationToken &) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!answered && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return json(answered.load());
+        },
+        Lane::Background);
+    server.onRequest("test/quick", [&](const json &, const CancellationToken &) {
+        answered = true;
+        return json("done");
+    });
+    server.runLSP();
+
+    auto messages = responses(out.str());
+    expect(messages.size() == 2, 0, "both answered");
+    expect(messages[0]["id"] == 2, 1, "interactive request answered first");
+    expect(messages[1]["result"] == true, 2, "background request ran alongside it");
+    std::cout << "[PASS] TestLanesAreIndependent\n";
+}
+
+static void TestDiagnostics()
+{
+    const std::string uri = "file:///a.vs";
+    auto change = [&](int version, const std::string &text) {
+        return frame(notification("textDocument/didChange", {{"textDocument", {{"uri", uri}, {"version", version}}}, {"contentChanges", {{{"text", text}}}}}));
+    };
+    auto source = std::make_unique<LiveSource>();
+    auto sink = std::make_unique<LiveSink>();
+    LiveSource &client = *source;
+    LiveSink &output = *sink;
+    LSPServer server(std::move(source), std::move(sink), 1);
+    server.setDiagnosticsDelay(std::chrono::milliseconds(50));
+    std::thread serving([&] { server.runLSP(); });
+
+    // A clean document has nothing to publish. A burst of edits is analyzed once.
+    std::string burst = frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", uri}, {"version", 1}, {"text", "var x: int64 = 1\n"}}}}));
+    for (int version = 2; version <= 5; ++version)
+        burst += change(version, "var x: int64 = " + std::to_string(version) + "\nvar");
+    burst += change(6, "var x: int64 = 1\nvar = 2\n");
+    client.send(burst);
+    auto published = output.published(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    published = output.published(1);
+    expect(published.size() == 1, 0, "one analysis per burst, got " + std::to_string(published.size()));
+    expect(published[0]["uri"] == uri && published[0]["version"] == 6, 1, "latest version");
+    const json &diagnostics = published[0]["diagnostics"];
+    expect(diagnostics.size() == 1 && diagnostics[0]["severity"] == 1, 2, "one parse error");
+    expect(diagnostics[0]["range"] == json{{"start", {{"line", 1}, {"character", 4}}}, {"end", {{"line", 1}, {"character", 5}}}}, 3,
+           "range of the offending token, got " + diagnostics[0]["range"].dump());
+
+    // Same diagnostics: nothing is sent.
+    client.send(change(7, "var x: int64 = 1\nvar = 2\n\n"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    expect(output.published(2).size() == 1, 4, "unchanged diagnostics are not republished");
+
+    client.send(change(8, "var x: int64 = y\n"));
+    published = output.published(2);
+    expect(published.size() == 2 && published[1]["version"] == 8, 5, "changed diagnostics are published");
+    expect(published[1]["diagnostics"].size() == 1 && published[1]["diagnostics"][0]["range"]["start"]["line"] == 0, 6, "name error");
+
+    client.send(frame(notification("textDocument/didClose", {{"textDocument", {{"uri", uri}}}})));
+    published = output.published(3);
+    expect(published.size() == 3 && published[2]["diagnostics"].empty(), 7, "closing clears the diagnostics");
+
+    client.send(frame(notification("exit", json::object())));
+    client.close();
+    serving.join();
+    std::cout << "[PASS] TestDiagnostics\n";
+}
+
+static void TestWorkspaceSymbols()
+{
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "vsharp lsp workspace";
+    fs::remove_all(root);
+    fs::create_directories(root / "src");
+    std::ofstream(root / "src" / "shapes.vs") << "class Shape {\n    var area: int64 = 0\n}\nsquare(int64[x]) int64 {\n    return x * x\n}\n";
+
+    auto source = std::make_unique<LiveSource>();
+    auto sink = std::make_unique<LiveSink>();
+    LiveSource &client = *source;
+    LiveSink &output = *sink;
+    LSPServer server(std::move(source), std::move(sink), 1);
+    std::thread serving([&] { server.runLSP(); });
+
+    std::string rootUri = "file://" + root.generic_string();
+    for (size_t space; (space = rootUri.find(' ')) != std::string::npos;)
+        rootUri.replace(space, 1, "%20");
+    client.send(frame(request(1, "initialize", {{"rootUri", rootUri}, {"initializationOptions", {{"cacheDir", (root / "cache").string()}}}})) +
+                frame(request(2, "workspace/symbol", {{"query", "sq"}})) +
+                frame(request(3, "workspace/symbol", {{"query", "area"}})));
+    json init = output.response(1);
+    expect(init["result"]["capabilities"]["workspaceSymbolProvider"] == true, 0, "advertised");
+
+    json square = output.response(2)["result"];
+    expect(square.size() == 1 && square[0]["name"] == "square" && square[0]["kind"] == 12, 1, "function found, got " + square.dump());
+    expect(square[0]["location"]["uri"] == rootUri + "/src/shapes.vs", 2, "location URI, got " + square[0]["location"]["uri"].dump());
+    expect(square[0]["location"]["range"]["start"] == json{{"line", 3}, {"character", 0}}, 3, "location range");
+
+    json area = output.response(3)["result"];
+    expect(area.size() == 1 && area[0]["kind"] == 8 && area[0]["containerName"] == "Shape", 4, "field with its class");
+    expect(init["result"]["capabilities"]["textDocumentSync"]["save"].is_object(), 5, "saves are asked for");
+
+    // Changes on disk are indexed again in the background; ask until they show.
+    int id = 3;
+    auto query = [&](const std::string &pattern, size_t expected) {
+        json found;
+        for (auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5); std::chrono::steady_clock::now() < deadline;)
+        {
+            client.send(frame(request(++id, "workspace/symbol", {{"query", pattern}})));
+            found = output.response(id)["result"];
+            if (found.size() == expected)
+                break;
+        }
+        return found;
+    };
+    std::ofstream(root / "src" / "shapes.vs") << "class Shape {\n    var area: int64 = 0\n}\ncube(int64[x]) int64 {\n    return x * x * x\n}\n";
+    client.send(frame(notification("textDocument/didSave", {{"textDocument", {{"uri", rootUri + "/src/shapes.vs"}}}})));
+    json cube = query("cube", 1);
+    expect(cube.size() == 1 && cube[0]["location"]["range"]["start"]["line"] == 3, 6, "saved declaration, got " + cube.dump());
+    expect(query("square", 0).empty(), 6, "the old declaration is gone");
+
+    std::ofstream(root / "src" / "added.vs") << "triangle() int64 {\n    return 3\n}\n";
+    fs::remove(root / "src" / "shapes.vs");
+    client.send(frame(notification("workspace/didChangeWatchedFiles", {{"changes", {{{"uri", rootUri + "/src/added.vs"}, {"type", 1}},
+                                                                                  {{"uri", rootUri + "/src/shapes.vs"}, {"type", 3}}}}})));
+    expect(query("triangle", 1).size() == 1, 7, "created file indexed");
+    expect(query("area", 0).empty(), 8, "deleted file dropped");
+
+    client.send(frame(notification("exit", json::object())));
+    client.close();
+    serving.join();
+    fs::remove_all(root);
+    std::cout << "[PASS] TestWorkspaceSymbols\n";
+}
+
+static void TestSemanticTokens()
+{
+    const std::string uri = "file:///sem.vs";
+    auto source = std::make_unique<LiveSource>();
+    auto sink = std::make_unique<LiveSink>();
+    LiveSource &client = *source;
+    LiveSink &output = *sink;
+    LSPServer server(std::move(source), std::move(sink), 1);
+    std::thread serving([&] { server.runLSP(); });
+
+    json document = {{"uri", uri}};
+    client.send(frame(request(1, "initialize", json::object())) +
+                frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", uri}, {"version", 1}, {"text", "var x: int64 = 1\nvar y: int64 = x\n"}}}})) +
+                frame(request(2, "textDocument/semanticTokens/full", {{"textDocument", document}})));
+    json provider = output.response(1)["result"]["capabilities"]["semanticTokensProvider"];
+    expect(provider["legend"]["tokenTypes"].size() == std::size(semanticTokenTypes) && provider["full"]["delta"] == true, 0, "advertised");
+
+    json full = output.response(2)["result"];
+    const json &data = full["data"];
+    expect(data.size() == 40, 1, "eight tokens, got " + data.dump());
+    expect(data[6] == 4 && data[8] == static_cast<uint32_t>(SemanticType::Variable) && data[9] == SemanticModifier::Declaration, 2, "declared variable");
+    expect(data[38] == static_cast<uint32_t>(SemanticType::Variable) && data[39] == 0, 3, "use of the variable");
+
+    client.send(frame(notification("textDocument/didChange", {{"textDocument", {{"uri", uri}, {"version", 2}}}, {"contentChanges", {{{"text", "var x: int64 = 100\nvar y: int64 = x\n"}}}}})) +
+                frame(request(3, "textDocument/semanticTokens/full/delta", {{"textDocument", document}, {"previousResultId", full["resultId"]}})) +
+                frame(request(4, "textDocument/semanticTokens/full/delta", {{"textDocument", document}, {"previousResultId", "stale"}})));
+    json delta = output.response(3)["result"];
+    expect(delta["resultId"] != full["resultId"] && delta["edits"].size() == 1, 4, "one edit, got " + delta.dump());
+    expect(delta["edits"][0]["start"] == 15 && delta["edits"][0]["deleteCount"] == 5, 5, "only the literal changed");
+    expect(output.response(4)["result"].contains("data"), 6, "an unknown previous result gets the full array");
+
+    client.send(frame(notification("exit", json::object())));
+    client.close();
+    serving.join();
+    std::cout << "[PASS] TestSemanticTokens\n";
+}
+
+static void TestNavigation()
+{
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "vsharp_lsp_navigation";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    std::ofstream(root / "lib.vs") << "class Math {\n    public static add(int64[a, b]) int64 {\n        return a + b\n    }\n}\nvar three: int64 = Math.add(1, 2)\n";
+    // On disk, main.vs is older than the open document; only the latter counts.
+    std::ofstream(root / "main.vs") << "var x: int64 = Math.add(1, 2) + Math.add(3, 4)\n";
+
+    auto source = std::make_unique<LiveSource>();
+    auto sink = std::make_unique<LiveSink>();
+    LiveSource &client = *source;
+    LiveSink &output = *sink;
+    LSPServer server(std::move(source), std::move(sink), 1);
+    std::thread serving([&] { server.runLSP(); });
+
+    std::string rootUri = "file://" + root.generic_string();
+    std::string uri = rootUri + "/main.vs";
+    json document = {{"uri", uri}};
+    auto at = [&](int line, int character) { return json{{"textDocument", document}, {"position", {{"line", line}, {"character", character}}}}; };
+    json references = at(0, 26);
+    references["context"] = {{"includeDeclaration", false}};
+    json total = at(1, 21);
+    total["context"] = {{"includeDeclaration", true}};
+
+    client.send(frame(request(1, "initialize", {{"rootUri", rootUri}})) +
+                frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", uri}, {"version", 1}, {"text", "var total: int64 = Math.add(1, 2)\nvar other: int64 = total\n"}}}})) +
+                frame(request(2, "textDocument/definition", at(1, 21))) +
+                frame(request(3, "textDocument/definition", at(0, 26))) +
+                frame(request(4, "textDocument/references", total)) +
+                frame(request(5, "textDocument/references", references)) +
+                frame(request(6, "textDocument/hover", at(1, 22))) +
+                frame(request(7, "textDocument/hover", at(0, 28))));
+    json capabilities = output.response(1)["result"]["capabilities"];
+    expect(capabilities["definitionProvider"] == true && capabilities["referencesProvider"] == true && capabilities["hoverProvider"] == true, 0, "advertised");
+
+    json local = output.response(2)["result"];
+    expect(local["uri"] == uri && local["range"]["start"] == json{{"line", 0}, {"character", 4}}, 1, "declared in the document, got " + local.dump());
+    json elsewhere = output.response(3)["result"];
+    expect(elsewhere.size() == 1 && elsewhere[0]["uri"] == rootUri + "/lib.vs", 2, "declared in another file, got " + elsewhere.dump());
+    expect(elsewhere[0]["range"]["start"] == json{{"line", 1}, {"character", 18}}, 2, "at the method's name");
+
+    json totals = output.response(4)["result"];
+    expect(totals.size() == 2 && totals[0]["range"]["start"]["line"] == 0 && totals[1]["range"]["start"]["line"] == 1, 3, "declaration and use, got " + totals.dump());
+
+    json adds = output.response(5)["result"];
+    expect(adds.size() == 2, 4, "the open document's call and lib.vs's, got " + adds.dump());
+    expect(adds[0]["uri"] == uri && adds[1]["uri"] == rootUri + "/lib.vs" && adds[1]["range"]["start"]["line"] == 5, 5, "locations");
+
+    json hover = output.response(6)["result"];
+    expect(hover["contents"]["value"] == "```vsharp\nvar total: int64\n```", 6, "declaration, got " + hover.dump());
+    expect(hover["range"]["start"] == json{{"line", 1}, {"character", 19}}, 6, "range of the name");
+    expect(output.response(7)["result"].is_null(), 7, "nothing to say about a literal");
+
+    client.send(frame(notification("exit", json::object())));
+    client.close();
+    serving.join();
+    fs::remove_all(root);
+    std::cout << "[PASS] TestNavigation\n";
+}
+
+static void TestStats()
+{
+    auto source = std::make_unique<LiveSource>();
+    auto sink = std::make_unique<LiveSink>();
+    LiveSource &client = *source;
+    LiveSink &output = *sink;
+    LSPServer server(std::move(source), std::move(sink), 1);
+    std::ostringstream log;
+    server.setStatsLog(&log);
+    std::thread serving([&] { server.runLSP(); });
+
+    std::string uri = "file:///stats.vs";
+    json position = {{"textDocument", {{"uri", uri}}}, {"position", {{"line", 0}, {"character", 4}}}};
+    client.send(frame(request(1, "initialize")) +
+                frame(notification("textDocument/didOpen", {{"textDocument", {{"uri", uri}, {"version", 1}, {"text", "var total: int64 = 1\n"}}}})) +
+                frame(request(2, "textDocument/hover", position)) +
+                frame(request(3, "textDocument/hover", position)) +
+                frame(request(4, "no/such/method")));
+    output.response(2);
+    output.response(3);
+    output.response(4);
+    client.send(frame(request(5, "vsharp/stats")));
+    json report = output.response(5)["result"];
+    json methods = report["methods"];
+
+    json hover = methods["textDocument/hover"];
+    expect(hover["count"] == 2, 0, "two hovers, got " + report.dump());
+    expect(hover["latencyUs"]["p50"] <= hover["latencyUs"]["p99"] && hover["latencyUs"]["p99"] <= hover["latencyUs"]["max"], 1, "percentiles in order");
+    expect(hover["bytesIn"] > 0 && hover["bytesOut"] > 0, 2, "bytes in and out");
+    expect(hover.contains("queueWaitUs") && hover["queueWaitUs"]["max"] <= hover["latencyUs"]["max"], 3, "requests wait in a queue");
+
+    json opened = methods["textDocument/didOpen"];
+    expect(opened["count"] == 1 && opened["bytesIn"] > 0 && opened["bytesOut"] == 0, 4, "notifications answer nothing");
+    expect(!opened.contains("queueWaitUs"), 4, "nor wait in a queue");
+    expect(!methods.contains("no/such/method"), 5, "only methods the server has");
+    expect(methods["vsharp/stats"]["count"] == 0 && methods["vsharp/stats"]["bytesIn"] > 0, 5, "the request itself is read but not answered yet");
+    expect(report["uptimeMs"].is_number(), 6, "uptime");
+
+    client.send(frame(notification("exit", json::object())));
+    client.close();
+    serving.join();
+    json logged = json::parse(log.str(), nullptr, false);
+    expect(!logged.is_discarded() && logged["methods"]["vsharp/stats"]["count"] == 1, 7, "logged on shutdown, got " + log.str());
+    std::cout << "[PASS] TestStats\n";
+}
+
+int main()
+{
+    TestRequests();
+    TestCompletion();
+    TestDocumentText();
+    TestEndOfInput();
+    TestCancelRequest();
+    TestStaleRequests();
+    TestLanesAreIndependent();
+    TestDiagnostics();
+    TestWorkspaceSymbols();
+    TestSemanticTokens();
+    TestNavigation();
+    TestStats();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}
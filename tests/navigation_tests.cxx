@@ -0,0 +1,159 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/navigation.hxx"
+#include "../source/include/visitor.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static const std::string program = R"(class Math {
+    public static add(int64[a, b]) int64 {
+        return a + b
+    }
+    static var scale : int64 = 2
+}
+var total: int64 = Math.add(1, 2)
+var other: int64 = total
+)";
+
+/** Offset of the n-th occurrence of a word. */
+static uint32_t offsetOf(const std::string &text, const std::string &word, int n = 0)
+{
+    size_t at = text.find(word);
+    while (n-- > 0)
+        at = text.find(word, at + 1);
+    return static_cast<uint32_t>(at);
+}
+
+static void TestInnermostNode()
+{
+    DocumentIndex doc(program);
+    expect(doc.root != nullptr, 0, "parses");
+    expect(doc.nodes.size() <= 2 * countNodes(doc.root.get()), 0, "two interval starts per node at most");
+
+    uint32_t sum = offsetOf(program, "a + b");
+    expect(nodeAs<IdentifierNode>(doc.nodes.at(sum)) != nullptr, 1, "identifier");
+    expect(doc.nodes.at(sum + 1)->type == ASTNodeType::BinaryExpr, 2, "between operands");
+    expect(doc.nodes.at(sum + 2)->type == ASTNodeType::BinaryExpr, 2, "operator");
+    expect(nodeAs<IdentifierNode>(doc.nodes.at(sum + 4))->name == "b", 3, "right operand");
+
+    uint32_t call = offsetOf(program, "Math.add");
+    expect(doc.nodes.at(call)->type == ASTNodeType::FunctionCall, 4, "call");
+    expect(doc.nodes.at(offsetOf(program, "1, 2"))->type == ASTNodeType::Literal, 5, "argument");
+    expect(doc.nodes.at(offsetOf(program, "scale"))->type == ASTNodeType::VarDecl, 6, "declaration");
+    expect(doc.nodes.at(static_cast<uint32_t>(program.size())) == nullptr, 7, "past the end");
+    std::cout << "[PASS] TestInnermostNode\n";
+}
+
+static void TestDefinitions()
+{
+    DocumentIndex doc(program);
+    struct Case
+    {
+        uint32_t cursor;
+        uint32_t declared; /**< Where the name it refers to is declared */
+    };
+    const Case cases[] = {
+        {offsetOf(program, "a + b"), offsetOf(program, "a, b")},
+        {offsetOf(program, "b\n"), offsetOf(program, "b]")},
+        {offsetOf(program, "Math", 1), offsetOf(program, "Math")},
+        {offsetOf(program, "add", 1) + 1, offsetOf(program, "add")},
+        {offsetOf(program, "total", 1) + 5, offsetOf(program, "total")}, // Just after the word
+        {offsetOf(program, "scale") + 2, offsetOf(program, "scale")},
+    };
+    for (size_t i = 0; i < std::size(cases); ++i)
+    {
+        auto name = doc.nameAt(cases[i].cursor);
+        expect(name.has_value() && name->binding.decl, i, "a resolved name at the cursor");
+        auto declared = doc.declaration(name->binding);
+        expect(declared && declared->begin == cases[i].declared, i, "declared at " + std::to_string(cases[i].declared));
+    }
+    expect(!doc.nameAt(offsetOf(program, "return")), 10, "keywords name nothing");
+    expect(!doc.nameAt(offsetOf(program, "2\n")), 11, "literals name nothing");
+
+    DocumentIndex broken("class {");
+    expect(!broken.root && !broken.nameAt(1), 12, "no tree, no names");
+    std::cout << "[PASS] TestDefinitions\n";
+}
+
+static void TestReferencesAndKeys()
+{
+    DocumentIndex doc(program);
+    auto total = doc.nameAt(offsetOf(program, "total"));
+    auto refs = doc.references(total->binding);
+    expect(refs.size() == 2 && refs[0].declaration && !refs[1].declaration, 0, "declaration and use");
+    expect(refs[1].begin == offsetOf(program, "total", 1), 1, "use");
+    expect(doc.key(*total) == "total", 2, "top-level key");
+
+    auto a = doc.nameAt(offsetOf(program, "a + b"));
+    expect(doc.references(a->binding).size() == 2, 3, "parameter and its use");
+    expect(doc.references(doc.nameAt(offsetOf(program, "b\n"))->binding).size() == 2, 3, "parameters are told apart");
+    expect(doc.key(*a).empty(), 4, "parameters are local");
+
+    auto add = doc.nameAt(offsetOf(program, "add", 1));
+    expect(doc.key(*add) == "Math.add", 5, "member key, got " + doc.key(*add));
+    expect(doc.references(add->binding).size() == 2, 5, "method and call");
+    expect(doc.key(*doc.nameAt(offsetOf(program, "Math", 1))) == "Math", 6, "class key");
+
+    DocumentIndex unresolved("var x: int64 = Shapes.area(2)\n");
+    auto area = unresolved.nameAt(offsetOf(unresolved.text, "area"));
+    expect(area && !area->binding.decl && unresolved.key(*area) == "Shapes.area", 7, "unresolved names keep their text");
+
+    DocumentIndex fields("class A {\n    public static var k : int64 = 1\n}\nvar x: int64 = A.k + B.k\n");
+    auto k = fields.nameAt(offsetOf(fields.text, "k", 1));
+    expect(k && fields.key(*k) == "A.k" && fields.declaration(k->binding)->begin == offsetOf(fields.text, "k"), 8, "qualified field");
+    auto owner = fields.nameAt(offsetOf(fields.text, "A.k"));
+    expect(owner && owner->end == owner->begin + 1 && fields.key(*owner) == "A", 9, "the class part of a qualified field");
+    auto other = fields.nameAt(offsetOf(fields.text, "k", 2));
+    expect(other && fields.key(*other) == "B.k", 10, "unresolved fields keep their text");
+    std::cout << "[PASS] TestReferencesAndKeys\n";
+}
+
+static void TestDescribe()
+{
+    DocumentIndex doc("class Math {\n    public static mix(int64[a, b], float64[t]) float64 {\n        return t\n    }\n"
+                      "    const limit : int64 = 2\n}\nvar total: int64 = 1\n");
+    auto describeAt = [&](const std::string &word) { return describe(doc.nameAt(offsetOf(doc.text, word))->binding); };
+    expect(describeAt("Math") == "class Math", 0, "class");
+    expect(describeAt("mix") == "static Math.mix(int64[a, b], float64[t]) float64", 1, "method, got " + describeAt("mix"));
+    expect(describeAt("t\n") == "t: float64", 2, "parameter");
+    expect(describeAt("limit") == "const Math.limit: int64", 3, "member constant, got " + describeAt("limit"));
+    expect(describeAt("total") == "var total: int64", 4, "variable");
+    expect(describe(Binding{}).empty(), 5, "unresolved");
+    std::cout << "[PASS] TestDescribe\n";
+}
+
+static void TestUtf16Offsets()
+{
+    std::string text = "var s = \"\xF0\x9F\x98\x80\" x\n\xC3\xA9y\n";
+    LineTable lines(text);
+    expect(lines.utf16Offset(text, 0, 4) == 4, 0, "ASCII");
+    expect(lines.utf16Offset(text, 0, 12) == 14, 1, "after a surrogate pair");
+    expect(lines.utf16Offset(text, 0, 99) == 16, 2, "clamped to the line break");
+    expect(lines.utf16Offset(text, 1, 1) == 19, 3, "after a two-byte character");
+    expect(lines.utf16Offset(text, 7, 0) == text.size(), 4, "past the last line");
+    for (uint32_t offset : {0u, 9u, 13u, 19u})
+        expect(lines.utf16Offset(text, lines.resolve(offset).line - 1, lines.utf16Column(text, offset)) == offset, 5, "round trip");
+    std::cout << "[PASS] TestUtf16Offsets\n";
+}
+
+int main()
+{
+    TestInnermostNode();
+    TestDefinitions();
+    TestReferencesAndKeys();
+    TestDescribe();
+    TestUtf16Offsets();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}
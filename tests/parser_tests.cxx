@@ -0,0 +1,215 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/parser.hxx"
+#include "../source/include/source.hxx"
+#include "../source/include/structural.hxx"
+#include "../source/include/visitor.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static ASTNodePtr parse(const std::string &source, uint16_t fileId = 0)
+{
+    Lexer lexer(source, "test.vs");
+    lexer.FileId = fileId;
+    Parser parser(lexer);
+    return parser.parserProgram();
+}
+
+static std::string_view spanText(const std::string &source, const ASTNode *node)
+{
+    return std::string_view(source).substr(node->span.begin, node->span.end - node->span.begin);
+}
+
+static void TestNodeSpansCoverTheirSource()
+{
+    std::string source = R"(class test {
+    public static add(int64[a, b]) int64 {
+        return a + b * 3
+    }
+    static var f : int64 = 0
+})";
+    ASTNodePtr ast = parse(source);
+    const auto *program = static_cast<const BlockNode *>(ast.get());
+    expect(spanText(source, program) == source, 0, "program span must cover the file");
+
+    const auto *cls = nodeAs<ClassDeclNode>(program->children[0].get());
+    expect(cls != nullptr, 1, "expected class");
+    expect(spanText(source, cls) == source, 1, "class span mismatch");
+    expect(spanText(source, cls->body.get()).front() == '{' && spanText(source, cls->body.get()).back() == '}', 1, "class body span must include braces");
+
+    const auto *members = static_cast<const BlockNode *>(cls->body.get());
+    const auto *fn = nodeAs<FunctionDeclNode>(members->children[0].get());
+    expect(spanText(source, fn).substr(0, 17) == "public static add", 2, "function span must start at its access modifier");
+    expect(spanText(source, fn).back() == '}', 2, "function span must end at its closing brace");
+
+    const auto *ret = nodeAs<ReturnExprNode>(static_cast<const BlockNode *>(fn->body.get())->children[0].get());
+    expect(spanText(source, ret) == "return a + b * 3", 3, "return span mismatch");
+    const auto *sum = nodeAs<BinaryExprNode>(ret->expr.get());
+    expect(spanText(source, sum) == "a + b * 3", 3, "binary span mismatch");
+    expect(spanText(source, sum->right.get()) == "b * 3", 3, "nested binary span mismatch");
+    expect(spanText(source, sum->left.get()) == "a", 3, "identifier span mismatch");
+
+    const auto *var = nodeAs<VarDeclNode>(members->children[1].get());
+    expect(spanText(source, var) == "static var f : int64 = 0", 4, "var span mismatch");
+    std::cout << "[PASS] TestNodeSpansCoverTheirSource\n";
+}
+
+static void TestSpansNestInsideParents()
+{
+    std::string source = R"(pick(int64 x, boolean flag) int64 {
+    if flag {
+        return x
+    } else if x == 2 {
+        x = x * 2 - 1
+    } else {
+        return 0
+    }
+})";
+    struct Checker : ASTVisitor<Checker>
+    {
+        std::vector<const ASTNode *> stack;
+        size_t violations = 0;
+        bool preVisit(const ASTNode *node)
+        {
+            if (node->span.begin > node->span.end)
+                ++violations;
+            if (!stack.empty() && (node->span.begin < stack.back()->span.begin || node->span.end > stack.back()->span.end))
+                ++violations;
+            stack.push_back(node);
+            return true;
+        }
+        void postVisit(const ASTNode *) { stack.pop_back(); }
+    } checker;
+    ASTNodePtr ast = parse(source);
+    checker.traverse(ast.get());
+    expect(checker.violations == 0, 0, "child spans must lie within their parent");
+    std::cout << "[PASS] TestSpansNestInsideParents\n";
+}
+
+static void TestSpansResolveToLineAndColumn()
+{
+    std::string source = "var a: int64 = 1\n\n  var b: int64 = a\n";
+    SourceManager sources;
+    sources.addFile("first.vs", "");
+    uint16_t id = sources.addFile("test.vs", source);
+    ASTNodePtr ast = parse(source, id);
+
+    const auto *program = static_cast<const BlockNode *>(ast.get());
+    const auto *b = program->children[1].get();
+    expect(b->span.file == id, 0, "span must carry the file ID");
+    LineColumn lc = sources.resolve(b->span);
+    expect(lc.line == 3 && lc.column == 3, 0, "expected 3:3, got " + std::to_string(lc.line) + ":" + std::to_string(lc.column));
+    expect(sources.describe(b->span) == "test.vs:3:3", 0, "describe mismatch");
+    uint16_t binary = sources.addFile("tree.vsast");
+    expect(sources.describe(SourceSpan{b->span.begin, b->span.end, binary}) == "tree.vsast", 0, "files without text have no positions");
+
+    LineTable table(source);
+    expect(table.lineCount() == 4, 1, "line count mismatch");
+    expect(table.resolve(0).line == 1 && table.resolve(0).column == 1, 1, "start of file");
+    expect(table.resolve(17).line == 2, 1, "empty line");
+    std::cout << "[PASS] TestSpansResolveToLineAndColumn\n";
+}
+
+static void TestStructuralHashIgnoresLayout()
+{
+    ASTNodePtr a = parse("class test {\n    public static add(int64[a, b]) int64 {\n        return a + b * 3\n    }\n}");
+    ASTNodePtr b = parse("class test { public static add(int64[a, b]) int64 { return a + b * 3 } }");
+    ASTNodePtr c = parse("class test { public static add(int64[a, b]) int64 { return a + b * 4 } }");
+
+    expect(structuralHash(a.get()) == structuralHash(b.get()), 0, "reformatting must not change the hash");
+    expect(structurallyEqual(a.get(), b.get()), 0, "reformatted trees must compare equal");
+    expect(structuralHash(a.get()) != structuralHash(c.get()), 1, "a changed literal must change the hash");
+    expect(!structurallyEqual(a.get(), c.get()), 1, "a changed literal must compare unequal");
+
+    StructuralHashes hashes;
+    uint64_t root = computeStructuralHashes(a.get(), hashes);
+    expect(root == structuralHash(a.get()), 2, "recorded and direct root hashes differ");
+    expect(hashes.size() == countNodes(a.get()), 2, "every node must be hashed");
+    std::cout << "[PASS] TestStructuralHashIgnoresLayout\n";
+}
+
+static void TestExprTableSharesDuplicates()
+{
+    ASTNodePtr ast = parse("var x: int64 = a * b + 1\nvar y: int64 = a * b + 1\nvar z: int64 = a * b + 2\n");
+    ExprTable table;
+    size_t visited = table.internAll(ast.get());
+    expect(visited == 15, 0, "expected 15 expression nodes, got " + std::to_string(visited));
+
+    const auto *program = static_cast<const BlockNode *>(ast.get());
+    auto valueOf = [&](size_t i)
+    { return nodeAs<VarDeclNode>(program->children[i].get())->value.get(); };
+    const auto *x = nodeAs<BinaryExprNode>(valueOf(0));
+    const auto *z = nodeAs<BinaryExprNode>(valueOf(2));
+
+    expect(table.idOf(valueOf(0)) == table.idOf(valueOf(1)), 1, "identical expressions must share an ID");
+    expect(table.idOf(valueOf(0)) != table.idOf(valueOf(2)), 1, "different expressions must not share an ID");
+    expect(table.idOf(x->left.get()) == table.idOf(z->left.get()), 1, "shared subexpressions must share an ID");
+    expect(table.canonical(table.idOf(valueOf(1))) == valueOf(0), 1, "the first occurrence is canonical");
+    expect(table.occurrences(table.idOf(x->left.get())) == 3, 1, "a * b occurs three times");
+    // Classes: a, b, a * b, 1, a * b + 1, 2, a * b + 2.
+    expect(table.size() == 7, 2, "expected 7 classes, got " + std::to_string(table.size()));
+    expect(table.duplicates() == 8, 2, "expected 8 duplicates, got " + std::to_string(table.duplicates()));
+    expect(table.idOf(program) == UINT32_MAX, 2, "declarations are not interned");
+    std::cout << "[PASS] TestExprTableSharesDuplicates\n";
+}
+
+static void TestDiffDeclarations()
+{
+    ASTNodePtr before = parse(R"(class Math {
+    public static add(int64[a, b]) int64 { return a + b }
+    public static sub(int64[a, b]) int64 { return a - b }
+    static var f : int64 = 0
+})");
+    ASTNodePtr after = parse(R"(class Math {
+    public static add(int64[a, b]) int64 {
+        return a + b
+    }
+    public static sub(int64[a, b]) int64 { return b - a }
+    public static mul(int64[a, b]) int64 { return a * b }
+})");
+
+    auto diff = diffDeclarations(before.get(), after.get());
+    auto find = [&](const std::string &name) -> const DeclDiff *
+    {
+        for (const auto &d : diff)
+            if (d.name == name)
+                return &d;
+        return nullptr;
+    };
+
+    expect(diff.size() == 5, 0, "expected 5 entries, got " + std::to_string(diff.size()));
+    const DeclDiff *add = find("Math.add(int64,int64)");
+    expect(add && add->change == DeclChange::Unchanged, 1, "reformatted add must be unchanged");
+    const DeclDiff *sub = find("Math.sub(int64,int64)");
+    expect(sub && sub->change == DeclChange::Changed, 1, "edited sub must be changed");
+    const DeclDiff *mul = find("Math.mul(int64,int64)");
+    expect(mul && mul->change == DeclChange::Added && !mul->oldDecl, 1, "mul must be added");
+    const DeclDiff *f = find("Math.f");
+    expect(f && f->change == DeclChange::Removed && !f->newDecl, 1, "f must be removed");
+    const DeclDiff *cls = find("Math");
+    expect(cls && cls->change == DeclChange::Changed, 1, "the class must be changed");
+    std::cout << "[PASS] TestDiffDeclarations\n";
+}
+
+int main()
+{
+    TestNodeSpansCoverTheirSource();
+    TestSpansNestInsideParents();
+    TestSpansResolveToLineAndColumn();
+    TestStructuralHashIgnoresLayout();
+    TestExprTableSharesDuplicates();
+    TestDiffDeclarations();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../source/include/dce.hxx"
+#include "../source/include/fold.hxx"
+#include "../source/include/memstats.hxx"
+#include "../source/include/parser.hxx"
+#include "../source/include/passes.hxx"
+#include "../source/include/resolver.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+/**
+ * The compiler's front end as a pipeline over a source string.
+ */
+static void addFrontEnd(PassManager &pipeline, const std::string &source)
+{
+    pipeline.add("parse", [source](CompileUnit &unit) -> size_t {
+        Lexer lexer(source, "test.vs");
+        Parser parser(lexer);
+        unit.ast = parser.parserProgram();
+        return 1;
+    }, false);
+    pipeline.add("resolve", [](CompileUnit &unit) -> size_t {
+        resolveNames(unit.ast.get(), unit.diagnostics);
+        return 0;
+    });
+    pipeline.add("typecheck", [](CompileUnit &unit) -> size_t {
+        checkTypes(unit.ast.get(), unit.types, unit.diagnostics);
+        return 0;
+    });
+}
+
+static void TestStatisticsAndNodeCounts()
+{
+    PassManager pipeline;
+    addFrontEnd(pipeline, "f(int64[a]) int64 {\n    return a * (2 + 3)\n    return 1\n}");
+    pipeline.add("fold", [](CompileUnit &unit) { return foldConstants(unit.ast, unit.types, unit.diagnostics); });
+    pipeline.add("dce", [](CompileUnit &unit) { return eliminateDeadCode(unit.ast); });
+    pipeline.countNodes(true);
+
+    CompileUnit unit;
+    expect(pipeline.run(unit), 0, "pipeline must succeed");
+    const auto &stats = pipeline.stats();
+    expect(stats.size() == 5, 0, "one entry per pass");
+    for (const auto &s : stats)
+        expect(s.ran && !s.skipped && s.seconds >= 0, 1, s.name + " must have run");
+
+    expect(stats[0].nodesBefore == 0 && stats[0].nodesAfter > 0, 2, "parse creates the tree");
+    expect(allocStats().counted && stats[0].allocations > 0, 2, "parsing allocates");
+    expect(stats[3].changes == 1 && stats[3].nodesAfter == stats[3].nodesBefore - 2, 3, "2 + 3 folds to one literal");
+    expect(stats[4].changes == 2 && stats[4].nodesAfter == stats[4].nodesBefore - 2, 3, "the unreachable return is removed");
+    expect(unit.generation == 3, 4, "parse, fold and dce changed the tree, got generation " + std::to_string(unit.generation));
+
+    std::ostringstream report;
+    pipeline.printReport(report);
+    expect(report.str().find("typecheck") != std::string::npos && report.str().find("Total") != std::string::npos, 5, "report must list passes and a total");
+    expect(report.str().find("Peak RSS") != std::string::npos, 5, "report must show resident set growth");
+    std::cout << "[PASS] TestStatisticsAndNodeCounts\n";
+}
+
+static void TestUnchangedInputsAreSkipped()
+{
+    PassManager pipeline;
+    addFrontEnd(pipeline, "var a : int64 = 1 + 2\nvar b : int64 = a");
+    size_t foldRuns = 0;
+    auto fold = [&](CompileUnit &unit) {
+        ++foldRuns;
+        return foldConstants(unit.ast, unit.types, unit.diagnostics);
+    };
+    pipeline.add("fold", fold);
+    pipeline.add("dce", [](CompileUnit &unit) { return eliminateDeadCode(unit.ast); });
+    // Nothing after the first fold changes the tree, so repeating passes costs nothing.
+    pipeline.add("fold", fold);
+    pipeline.add("resolve", [](CompileUnit &unit) -> size_t {
+        resolveNames(unit.ast.get(), unit.diagnostics);
+        return 0;
+    });
+
+    CompileUnit unit;
+    expect(pipeline.run(unit), 0, "pipeline must succeed");
+    const auto &stats = pipeline.stats();
+    expect(stats[3].ran && stats[3].changes == 1, 1, "the first fold replaces 1 + 2");
+    expect(stats[5].skipped && !stats[5].ran, 1, "the second fold must be skipped");
+    expect(foldRuns == 1, 1, "a skipped pass must not be called");
+    expect(stats[6].ran, 2, "resolve must rerun because fold changed the tree");
+    std::cout << "[PASS] TestUnchangedInputsAreSkipped\n";
+}
+
+static void TestStopsOnErrors()
+{
+    PassManager pipeline;
+    addFrontEnd(pipeline, "var a : int64 = b");
+    bool typechecked = false;
+    pipeline.add("after", [&](CompileUnit &) -> size_t {
+        typechecked = true;
+        return 0;
+    });
+
+    CompileUnit unit;
+    expect(!pipeline.run(unit), 0, "an unresolved name must stop the pipeline");
+    expect(unit.hasErrors() && unit.diagnostics.size() == 1, 0, "one resolver error");
+    expect(pipeline.stats().size() == 2 && !typechecked, 1, "no pass may run after the failing one");
+
+    CompileUnit warned;
+    warned.diagnostics.push_back(Diagnostic{Severity::Warning, SourceSpan{}, "note"});
+    expect(!warned.hasErrors(), 2, "warnings are not errors");
+    std::cout << "[PASS] TestStopsOnErrors\n";
+}
+
+int main()
+{
+    TestStatisticsAndNodeCounts();
+    TestUnchangedInputsAreSkipped();
+    TestStopsOnErrors();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/parser.hxx"
+#include "../source/include/resolver.hxx"
+#include "../source/include/source.hxx"
+#include "../source/include/types.hxx"
+#include "../source/include/visitor.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static ASTNodePtr parse(const std::string &source)
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    return parser.parserProgram();
+}
+
+/**
+ * Collect every identifier of a tree in source order.
+ */
+static std::vector<const IdentifierNode *> identifiers(const ASTNode *root)
+{
+    struct Collector : ASTVisitor<Collector>
+    {
+        std::vector<const IdentifierNode *> found;
+        void visitIdentifier(const IdentifierNode *id) { found.push_back(id); }
+    } collector;
+    collector.traverse(root);
+    return collector.found;
+}
+
+static void TestSymbolTableScopes()
+{
+    SymbolTable table;
+    BlockNode a, b;
+
+    table.push();
+    expect(table.declare("x", Binding{&a, -1}) == nullptr, 0, "first declaration must succeed");
+    expect(table.declare("x", Binding{&b, -1}) != nullptr, 0, "redeclaration must return the existing binding");
+    expect(table.lookup("x")->decl == &a, 0, "redeclaration must not replace the binding");
+
+    table.push();
+    table.declare("x", Binding{&b, 2});
+    expect(table.lookup("x")->decl == &b && table.lookup("x")->param == 2, 1, "inner scope must shadow");
+    table.pop();
+    expect(table.lookup("x")->decl == &a, 1, "popping must restore the outer binding");
+    expect(table.lookup("y") == nullptr, 1, "unknown names must not be found");
+
+    // Grow well past the initial capacity, then check every name is still found.
+    std::vector<std::string> names;
+    for (int i = 0; i < 5000; ++i)
+        names.push_back("name" + std::to_string(i));
+    table.push();
+    for (const auto &name : names)
+        expect(table.declare(name, Binding{&b, -1}) == nullptr, 2, "distinct names must not collide: " + name);
+    for (const auto &name : names)
+        expect(table.lookup(name) && table.lookup(name)->decl == &b, 2, "lost " + name);
+    table.pop();
+    expect(table.lookup("name10") == nullptr, 2, "popped names must be gone");
+    expect(table.depth() == 1, 2, "depth mismatch");
+    table.pop();
+    std::cout << "[PASS] TestSymbolTableScopes\n";
+}
+
+static void TestResolveBindsDeclarations()
+{
+    ASTNodePtr ast = parse(R"(class Math {
+    public static add(int64[a, b]) int64 {
+        var t: int64 = a * scale
+        return t + b
+    }
+    static var scale : int64 = 2
+}
+var total: int64 = 1
+var next: int64 = total + 1)");
+
+    std::vector<Diagnostic> diagnostics;
+    size_t bound = resolveNames(ast.get(), diagnostics);
+    expect(diagnostics.empty(), 0, diagnostics.empty() ? "" : diagnostics[0].message);
+
+    auto ids = identifiers(ast.get());
+    expect(ids.size() == 5 && bound == 5, 0, "expected 5 bound identifiers");
+
+    const auto *program = static_cast<const BlockNode *>(ast.get());
+    const auto *cls = nodeAs<ClassDeclNode>(program->children[0].get());
+    const auto *body = static_cast<const BlockNode *>(cls->body.get());
+    const auto *add = nodeAs<FunctionDeclNode>(body->children[0].get());
+    const auto *addBody = static_cast<const BlockNode *>(add->body.get());
+
+    expect(ids[0]->name == "a" && ids[0]->binding.decl == add && ids[0]->binding.param == 0, 1, "a must bind to parameter 0");
+    expect(ids[1]->name == "scale" && ids[1]->binding.decl == body->children[1].get(), 1, "fields must be visible before their declaration");
+    expect(ids[2]->name == "t" && ids[2]->binding.decl == addBody->children[0].get(), 1, "t must bind to the local");
+    expect(ids[3]->name == "b" && ids[3]->binding.param == 1, 1, "b must bind to parameter 1");
+    expect(ids[4]->name == "total" && ids[4]->binding.decl == program->children[1].get(), 1, "total must bind to the global");
+    std::cout << "[PASS] TestResolveBindsDeclarations\n";
+}
+
+static void TestResolveReportsErrors()
+{
+    std::string source = "var a: int64 = b\nvar a: int64 = 1\nconst c: int64 = 1\nc = 2\nvar d: int64 = d\n";
+    ASTNodePtr ast = parse(source);
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(ast.get(), diagnostics);
+
+    SourceManager sources;
+    sources.addFile("test.vs", source);
+    std::vector<std::string> messages;
+    for (const auto &d : diagnostics)
+        messages.push_back(sources.format(d));
+
+    expect(messages.size() == 4, 0, "expected 4 diagnostics, got " + std::to_string(messages.size()));
+    expect(messages[0] == "test.vs:1:16: error: use of undeclared identifier 'b'", 1, messages[0]);
+    expect(messages[1] == "test.vs:2:1: error: redefinition of 'a'", 1, messages[1]);
+    expect(messages[2] == "test.vs:4:1: error: cannot assign to constant 'c'", 1, messages[2]);
+    expect(messages[3] == "test.vs:5:16: error: use of undeclared identifier 'd'", 1, messages[3]);
+
+    // Overloads share a name; scopes end with their block.
+    ast = parse("class test {\n    test(int64[c, d]) int64 {\n        return c + d\n    }\n    public static test(int64[c]) int64 {\n        return c\n    }\n}\nvar e: int64 = c\n");
+    diagnostics.clear();
+    resolveNames(ast.get(), diagnostics);
+    expect(diagnostics.size() == 1 && diagnostics[0].message == "use of undeclared identifier 'c'", 2, "only the out-of-scope c must be reported");
+
+    // Overloads must differ in their parameter types, not only in their parameter names.
+    std::string overloads = "f(int64[a]) int64 {\n    return a\n}\nf(float64[a]) int64 {\n    return 1\n}\nf(int64[b]) int64 {\n    return b\n}\n";
+    ast = parse(overloads);
+    diagnostics.clear();
+    resolveNames(ast.get(), diagnostics);
+    expect(diagnostics.size() == 1 && diagnostics[0].message == "redefinition of 'f'", 3, "same parameter types redefine");
+    expect(diagnostics[0].span.begin == overloads.find("f(int64[b]"), 3, "reported at the second declaration");
+    std::cout << "[PASS] TestResolveReportsErrors\n";
+}
+
+static void TestResolveCalls()
+{
+    ASTNodePtr ast = parse(R"(class Math {
+    public static add(int64[a, b]) int64 {
+        return a + b + twice(a)
+    }
+    private static twice(int64[a]) int64 {
+        return a * 2
+    }
+}
+var x: int64 = 1
+f(int64[a]) int64 {
+    return a
+}
+f(int64[a, b]) int64 {
+    return Math.add(a, b)
+}
+g() int64 {
+    return f(1, 2) + Math.twice(1) + Math.sub(1) + Shape.area() + x(1) + f()
+})");
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(ast.get(), diagnostics);
+
+    std::vector<std::string> messages;
+    for (const auto &d : diagnostics)
+        messages.push_back(d.message);
+    std::vector<std::string> expected = {
+        "'twice' is private to 'Math'",
+        "no function 'sub' in class 'Math'",
+        "use of undeclared class 'Shape'",
+        "'x' is not a function",
+        "no overload of 'f' takes 0 arguments",
+    };
+    expect(messages == expected, 0, "unexpected call diagnostics, got " + std::to_string(messages.size()));
+
+    struct Calls : ASTVisitor<Calls>
+    {
+        std::vector<const FunctionCallNode *> found;
+        void visitFunctionCall(const FunctionCallNode *call) { found.push_back(call); }
+    } calls;
+    calls.traverse(ast.get());
+    const auto *twice = calls.found[0];
+    expect(twice->callee == "twice" && nodeAs<FunctionDeclNode>(twice->binding.decl)->access == AccessType::Private, 1, "members call private functions unqualified");
+    const auto *overload = calls.found[2];
+    expect(overload->callee == "f" && nodeAs<FunctionDeclNode>(overload->binding.decl)->params.size() == 2, 2, "overloads are picked by arity");
+    std::cout << "[PASS] TestResolveCalls\n";
+}
+
+static void TestResolveQualifiedFields()
+{
+    ASTNodePtr ast = parse(R"(class A {
+    public static var k : int64 = 1
+    private static var hidden : int64 = 2
+    public static get() int64 {
+        return A.hidden
+    }
+}
+g() int64 {
+    return A.k + A.hidden + A.missing + B.k + A.get()
+})");
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(ast.get(), diagnostics);
+
+    std::vector<std::string> messages;
+    for (const auto &d : diagnostics)
+        messages.push_back(d.message);
+    std::vector<std::string> expected = {
+        "'hidden' is private to 'A'",
+        "no field 'missing' in class 'A'",
+        "use of undeclared class 'B'",
+    };
+    expect(messages == expected, 0, "unexpected field diagnostics, got " + std::to_string(messages.size()));
+
+    auto ids = identifiers(ast.get());
+    expect(ids[0]->name == "A.hidden" && nodeAs<VarDeclNode>(ids[0]->binding.decl), 1, "members read private fields qualified");
+    expect(ids[1]->name == "A.k" && nodeAs<VarDeclNode>(ids[1]->binding.decl)->name == "k", 2, "public fields are read from outside");
+    expect(!ids[2]->binding.decl, 3, "private fields are not bound from outside");
+    std::cout << "[PASS] TestResolveQualifiedFields\n";
+}
+
+/**
+ * Resolve and type check a program whose calls are all to `f`, and return
+ * the float64 overloads' share of them, in order, with the messages.
+ */
+static std::vector<bool> callsToFloat(const std::string &source, std::vector<std::string> &messages)
+{
+    ASTNodePtr ast = parse(source);
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(ast.get(), diagnostics);
+    TypeTable types;
+    checkTypes(ast.get(), types, diagnostics, 1);
+    for (const auto &d : diagnostics)
+        messages.push_back(d.message);
+
+    struct Calls : ASTVisitor<Calls>
+    {
+        std::vector<bool> toFloat;
+        void visitFunctionCall(const FunctionCallNode *call)
+        {
+            const auto *fn = nodeAs<FunctionDeclNode>(call->binding.decl);
+            toFloat.push_back(fn && fn->params[0].first == Type::Float64);
+        }
+    } calls;
+    calls.traverse(ast.get());
+    return calls.toFloat;
+}
+
+static void TestOverloadsByType()
+{
+    // Declaration order must not matter.
+    for (bool floatFirst : {true, false})
+    {
+        std::string intOverload = "f(int64[a]) int64 {\n    return 1\n}\n";
+        std::string floatOverload = "f(float64[a]) int64 {\n    return 2\n}\n";
+        std::string source = (floatFirst ? floatOverload + intOverload : intOverload + floatOverload) +
+                             "g(int64[i], float64[x]) int64 {\n    return f(1) + f(1.5) + f(i) + f(x)\n}\n";
+        std::vector<std::string> messages;
+        auto toFloat = callsToFloat(source, messages);
+        expect(messages.empty(), 0, "overloads by type resolve, got " + (messages.empty() ? std::string() : messages[0]));
+        expect(toFloat == std::vector<bool>{false, true, false, true}, 1, "each call takes the overload of its argument type");
+    }
+
+    std::vector<std::string> messages;
+    callsToFloat(R"(f(int64[a], float64[b]) int64 {
+    return 1
+}
+f(float64[a], int64[b]) int64 {
+    return 2
+}
+g(int32[s]) int64 {
+    return f(1, 2) + f(1.5, 2) + f(s, 1)
+})",
+                 messages);
+    std::vector<std::string> expected = {
+        "call to 'f' is ambiguous",
+        "no overload of 'f' takes (int32, untyped integer)",
+    };
+    expect(messages == expected, 2, "ambiguous and unmatched calls are errors, got " + std::to_string(messages.size()));
+    std::cout << "[PASS] TestOverloadsByType\n";
+}
+
+int main()
+{
+    TestSymbolTableScopes();
+    TestResolveBindsDeclarations();
+    TestResolveReportsErrors();
+    TestResolveCalls();
+    TestResolveQualifiedFields();
+    TestOverloadsByType();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include "../source/include/rope.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static void TestEditsMatchString()
+{
+    std::mt19937 rng(42);
+    std::string model;
+    for (int i = 0; i < 3000; ++i)
+        model += "line " + std::to_string(i) + "\n";
+    Rope rope(model);
+
+    const std::string pieces[] = {"", "x", "\n", "hello\nworld", std::string(3000, 'y'), "a\nb\nc\n"};
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        size_t offset = rng() % (model.size() + 1);
+        size_t length = rng() % 4 == 0 ? rng() % 4000 : rng() % 8;
+        length = std::min(length, model.size() - offset);
+        const std::string &text = pieces[rng() % 6];
+        model.replace(offset, length, text);
+        rope.replace(offset, length, text);
+        expect(rope.size() == model.size(), 0, "size diverged at edit " + std::to_string(i));
+        if (i % 250 == 0)
+            expect(rope.text() == model, 0, "text diverged at edit " + std::to_string(i));
+    }
+    expect(rope.text() == model, 0, "final text differs");
+    expect(rope.lineCount() == static_cast<size_t>(std::count(model.begin(), model.end(), '\n')) + 1, 1, "line count");
+    expect(rope.substr(100, 50) == model.substr(100, 50), 2, "substr");
+    expect(rope.substr(model.size() - 3, 100) == model.substr(model.size() - 3), 2, "substr past the end is clamped");
+
+    size_t line = 0;
+    for (size_t at = 0; at < model.size(); ++at)
+        if (model[at] == '\n' && ++line % 97 == 0)
+            expect(rope.lineStart(line) == at + 1, 3, "line start of line " + std::to_string(line));
+    std::cout << "[PASS] TestEditsMatchString\n";
+}
+
+static void TestUtf16Columns()
+{
+    // "é" is one UTF-16 unit in two bytes; "😀" is two units in four bytes.
+    Rope rope("ab\né😀x\r\nlast");
+    expect(rope.lineCount() == 3, 0, "three lines");
+    expect(rope.offsetAt(0, 1) == 1, 0, "ASCII column");
+    expect(rope.offsetAt(1, 0) == 3, 1, "start of the second line");
+    expect(rope.offsetAt(1, 1) == 5, 1, "after the two-byte character");
+    expect(rope.offsetAt(1, 3) == 9, 1, "after the surrogate pair");
+    expect(rope.offsetAt(1, 4) == 10, 1, "past x stops at the CR");
+    expect(rope.offsetAt(1, 99) == 10, 2, "columns clamp to the line break");
+    expect(rope.offsetAt(2, 2) == 14, 2, "third line");
+    expect(rope.offsetAt(9, 0) == rope.size(), 2, "lines past the end clamp to the end");
+
+    rope.replace(rope.offsetAt(1, 1), rope.offsetAt(1, 3) - rope.offsetAt(1, 1), "!");
+    expect(rope.text() == "ab\né!x\r\nlast", 3, "edit by LSP range");
+    std::cout << "[PASS] TestUtf16Columns\n";
+}
+
+static void TestLargeFileEdits()
+{
+    std::string source;
+    for (int i = 0; i < 50000; ++i)
+        source += "    var value" + std::to_string(i) + " : int64 = " + std::to_string(i) + " * 2\n";
+    Rope rope(source);
+    expect(rope.lineCount() == 50001, 0, "50k lines");
+
+    std::mt19937 rng(7);
+    const int edits = 20000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < edits; ++i)
+    {
+        size_t offset = rope.offsetAt(rng() % 50000, rng() % 30);
+        if (i % 2)
+            rope.insert(offset, "x");
+        else
+            rope.erase(offset, 1);
+    }
+    double perEdit = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / edits;
+    // Far above the expected few microseconds, so only a complexity regression fails.
+    expect(perEdit < 1000, 1, "edits must stay sub-millisecond, took " + std::to_string(perEdit) + "us");
+    std::cout << "[PASS] TestLargeFileEdits (" << perEdit << "us per edit)\n";
+}
+
+int main()
+{
+    TestEditsMatchString();
+    TestUtf16Columns();
+    TestLargeFileEdits();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
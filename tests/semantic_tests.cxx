@@ -0,0 +1,150 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/parser.hxx"
+#include "../source/include/resolver.hxx"
+#include "../source/include/semantic.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+/** A decoded token, with absolute position. */
+struct Decoded
+{
+    uint32_t line, column, length;
+    SemanticType type;
+    uint32_t modifiers;
+};
+
+static std::vector<Decoded> decode(const std::vector<uint32_t> &data)
+{
+    std::vector<Decoded> tokens;
+    uint32_t line = 0, column = 0;
+    for (size_t i = 0; i + 5 <= data.size(); i += 5)
+    {
+        column = data[i] ? data[i + 1] : column + data[i + 1];
+        line += data[i];
+        tokens.push_back({line, column, data[i + 2], static_cast<SemanticType>(data[i + 3]), data[i + 4]});
+    }
+    return tokens;
+}
+
+static std::vector<uint32_t> highlight(const std::string &text)
+{
+    Lexer lexer(text, "test.vs");
+    Parser parser(lexer);
+    ASTNodePtr root = parser.parserProgram();
+    std::vector<Diagnostic> diags;
+    resolveNames(root.get(), diags);
+    return encodeSemanticTokens(text, root.get());
+}
+
+static const Decoded *at(const std::vector<Decoded> &tokens, uint32_t line, uint32_t column)
+{
+    for (const auto &token : tokens)
+        if (token.line == line && token.column == column)
+            return &token;
+    return nullptr;
+}
+
+static const std::string program = R"(class Math {
+    public static add(int64[a, b]) int64 {
+        return a + b
+    }
+    static var scale : int64 = 2
+}
+var total: int64 = Math.add(1, 2)
+const limit: int64 = total
+)";
+
+static void TestClassification()
+{
+    auto tokens = decode(highlight(program));
+    struct Case
+    {
+        uint32_t line, column, length;
+        SemanticType type;
+        uint32_t modifiers;
+    };
+    using namespace SemanticModifier;
+    const Case cases[] = {
+        {0, 0, 5, SemanticType::Keyword, 0},
+        {0, 6, 4, SemanticType::Class, Declaration},
+        {1, 18, 3, SemanticType::Method, Declaration | Static},
+        {1, 22, 5, SemanticType::Type, 0},
+        {1, 28, 1, SemanticType::Parameter, Declaration},
+        {2, 15, 1, SemanticType::Parameter, 0},
+        {4, 15, 5, SemanticType::Property, Declaration | Static},
+        {4, 31, 1, SemanticType::Number, 0},
+        {6, 4, 5, SemanticType::Variable, Declaration},
+        {6, 19, 4, SemanticType::Class, 0},
+        {6, 24, 3, SemanticType::Method, Static},
+        {7, 6, 5, SemanticType::Variable, Declaration | Readonly},
+        {7, 21, 5, SemanticType::Variable, 0},
+    };
+    for (size_t i = 0; i < std::size(cases); ++i)
+    {
+        const Case &c = cases[i];
+        const Decoded *token = at(tokens, c.line, c.column);
+        expect(token != nullptr, i, "token at " + std::to_string(c.line) + ":" + std::to_string(c.column));
+        expect(token->length == c.length, i, "length");
+        expect(token->type == c.type, i, "type " + std::string(semanticTokenTypes[static_cast<uint32_t>(token->type)]));
+        expect(token->modifiers == c.modifiers, i, "modifiers " + std::to_string(token->modifiers));
+    }
+    expect(at(tokens, 1, 27) == nullptr, 20, "punctuation is not highlighted");
+    std::cout << "[PASS] TestClassification\n";
+}
+
+static void TestLexicalFallback()
+{
+    auto tokens = decode(encodeSemanticTokens("var s: string = \"\xF0\x9F\x98\x80\" // note\nclass {", nullptr));
+    expect(tokens.size() == 6, 0, "every token but punctuation, got " + std::to_string(tokens.size()));
+    expect(tokens[1].type == SemanticType::Variable && tokens[1].modifiers == 0, 1, "unresolved identifiers are variables");
+    expect(tokens[2].type == SemanticType::Type, 2, "type keyword");
+    expect(tokens[3].type == SemanticType::String && tokens[3].length == 4, 3, "string length in UTF-16 units");
+    expect(tokens[4].type == SemanticType::Comment && tokens[4].column == 21, 4, "columns after a surrogate pair");
+    expect(tokens[5].line == 1 && tokens[5].type == SemanticType::Keyword, 5, "next line");
+    expect(encodeSemanticTokens("", nullptr).empty(), 6, "empty source");
+    std::cout << "[PASS] TestLexicalFallback\n";
+}
+
+static void TestDiff()
+{
+    auto before = highlight(program);
+    std::string changed = program;
+    changed.replace(changed.find("1, 2"), 1, "100");
+    auto after = highlight(changed);
+
+    auto edit = diffSemanticTokens(before, after);
+    expect(edit.start % 5 == 0 && edit.deleteCount % 5 == 0, 0, "edits cover whole tokens");
+    expect(edit.deleteCount == 10 && edit.data.size() == 10, 1, "only the literal and the token after it change");
+
+    std::vector<uint32_t> applied = before;
+    applied.erase(applied.begin() + edit.start, applied.begin() + edit.start + edit.deleteCount);
+    applied.insert(applied.begin() + edit.start, edit.data.begin(), edit.data.end());
+    expect(applied == after, 2, "applying the edit gives the new encoding");
+
+    auto none = diffSemanticTokens(after, after);
+    expect(none.deleteCount == 0 && none.data.empty(), 3, "no change");
+    auto all = diffSemanticTokens({}, after);
+    expect(all.start == 0 && all.data == after, 4, "from nothing");
+    std::cout << "[PASS] TestDiff\n";
+}
+
+int main()
+{
+    TestClassification();
+    TestLexicalFallback();
+    TestDiff();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}
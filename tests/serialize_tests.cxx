@@ -0,0 +1,229 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../source/include/parser.hxx"
+#include "../source/include/serialize.hxx"
+#include "../source/include/visitor.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static ASTNodePtr parse(const std::string &source)
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    return parser.parserProgram();
+}
+
+static std::string dump(const ASTNode *node)
+{
+    std::ostringstream captured;
+    std::streambuf *old = std::cout.rdbuf(captured.rdbuf());
+    printAST(node);
+    std::cout.rdbuf(old);
+    return captured.str();
+}
+
+static const std::vector<std::string> programs = {
+    R"(class test {
+
+    test(int64[c, d]) int64 {
+
+        return c + d * 3
+    }
+
+    public static test(int64[c, d]) int64 {
+
+        return c + d * 3
+    }
+
+    static var f : int64 = 0
+})",
+    R"(pick(int64 x, boolean flag) int64 {
+    if flag {
+        return x
+    } else if x == 2 {
+        return 7u
+    } else {
+        x = x * 2 - 1
+        return x
+    }
+})",
+    R"(var s: string = "Hello, \"World\""
+const b: byte = '\n'
+const t: boolean = true
+var f: float64 = 3.14159
+var big: int64 = 2147483647)",
+    R"(class Counter {
+    public static next() int64 {
+        return tick(1, 2) + 1
+    }
+}
+main() int64 {
+    Counter.next()
+    return Counter.next()
+})",
+};
+
+static void TestRoundTripPrintsIdentically()
+{
+    for (size_t i = 0; i < programs.size(); ++i)
+    {
+        ASTNodePtr ast = parse(programs[i]);
+        ASTNodePtr loaded = deserializeAST(serializeAST(ast.get()));
+        expect(dump(ast.get()) == dump(loaded.get()), i, "printAST output differs after round trip");
+    }
+    std::cout << "[PASS] TestRoundTripPrintsIdentically\n";
+}
+
+static void TestRoundTripIsStable()
+{
+    for (size_t i = 0; i < programs.size(); ++i)
+    {
+        ASTNodePtr ast = parse(programs[i]);
+        std::string first = serializeAST(ast.get());
+        std::string second = serializeAST(deserializeAST(first).get());
+        expect(first == second, i, "re-serialized bytes differ");
+    }
+    std::cout << "[PASS] TestRoundTripIsStable\n";
+}
+
+static void TestSpansSurviveRoundTrip()
+{
+    struct SpanCollector : ASTVisitor<SpanCollector>
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> spans;
+        bool preVisit(const ASTNode *node)
+        {
+            spans.emplace_back(node->span.begin, node->span.end);
+            return true;
+        }
+    };
+
+    for (size_t i = 0; i < programs.size(); ++i)
+    {
+        ASTNodePtr ast = parse(programs[i]);
+        ASTNodePtr loaded = deserializeAST(serializeAST(ast.get()));
+        SpanCollector a, b;
+        a.traverse(ast.get());
+        b.traverse(loaded.get());
+        expect(a.spans == b.spans, i, "spans differ after round trip");
+    }
+    std::cout << "[PASS] TestSpansSurviveRoundTrip\n";
+}
+
+static void TestLiteralAlternatives()
+{
+    BlockNode block;
+    block.children.push_back(std::make_unique<LiteralNode>(Type::Int8, int8_t(-128)));
+    block.children.push_back(std::make_unique<LiteralNode>(Type::Int64, int64_t(INT64_MIN)));
+    block.children.push_back(std::make_unique<LiteralNode>(Type::Uint64, uint64_t(UINT64_MAX)));
+    block.children.push_back(std::make_unique<LiteralNode>(Type::Float32, 1.5f));
+    block.children.push_back(std::make_unique<LiteralNode>(Type::Float64, -0.0));
+
+    ASTNodePtr loaded = deserializeAST(serializeAST(&block));
+    const auto &children = static_cast<const BlockNode *>(loaded.get())->children;
+    expect(children.size() == block.children.size(), 0, "child count mismatch");
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        const auto *a = static_cast<const LiteralNode *>(block.children[i].get());
+        const auto *b = static_cast<const LiteralNode *>(children[i].get());
+        expect(a->literalType == b->literalType, i, "literal type mismatch");
+        expect(a->value.index() == b->value.index(), i, "literal kind mismatch");
+    }
+    expect(std::get<int64_t>(static_cast<const LiteralNode *>(children[1].get())->value) == INT64_MIN, 1, "int64 min lost");
+    expect(std::get<uint64_t>(static_cast<const LiteralNode *>(children[2].get())->value) == UINT64_MAX, 2, "uint64 max lost");
+    expect(std::signbit(std::get<double>(static_cast<const LiteralNode *>(children[4].get())->value)), 4, "negative zero lost");
+    std::cout << "[PASS] TestLiteralAlternatives\n";
+}
+
+static void TestFileRoundTrip()
+{
+    std::string path = "serialize_tests.vsast";
+    ASTNodePtr ast = parse(programs[0]);
+    writeASTFile(path, ast.get());
+    ASTNodePtr loaded = loadASTFile(path);
+    std::remove(path.c_str());
+    expect(dump(ast.get()) == dump(loaded.get()), 0, "mapped file round trip differs");
+
+    const auto *cls = static_cast<const BlockNode *>(loaded.get())->children[0].get();
+    const auto *body = static_cast<const BlockNode *>(static_cast<const ClassDeclNode *>(cls)->body.get());
+    expect(body->children[0]->parent == cls, 0, "class members must point back to their class");
+    std::cout << "[PASS] TestFileRoundTrip\n";
+}
+
+static void TestRejectsCorruptData()
+{
+    std::string bytes = serializeAST(parse(programs[1]).get());
+    std::vector<std::string> broken = {
+        "",
+        "NOPE",
+        bytes.substr(0, bytes.size() / 2),
+        bytes + "x",
+    };
+    for (size_t i = 0; i < broken.size(); ++i)
+    {
+        bool threw = false;
+        try
+        {
+            deserializeAST(broken[i]);
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        expect(threw, i, "corrupt input was accepted");
+    }
+    std::cout << "[PASS] TestRejectsCorruptData\n";
+}
+
+/** `return return ... return` nested `depth` deep. */
+static ASTNodePtr nested(uint32_t depth)
+{
+    ASTNodePtr node;
+    for (uint32_t i = 0; i < depth; ++i)
+        node = std::make_unique<ReturnExprNode>(std::move(node));
+    return node;
+}
+
+static void TestRejectsDeepNesting()
+{
+    expect(deserializeAST(serializeAST(nested(VSAST_MAX_DEPTH).get())) != nullptr, 0, "the deepest allowed tree loads");
+    std::string message;
+    try
+    {
+        deserializeAST(serializeAST(nested(VSAST_MAX_DEPTH + 1).get()));
+    }
+    catch (const std::runtime_error &e)
+    {
+        message = e.what();
+    }
+    expect(message.rfind("Invalid AST file", 0) == 0, 1, "rejected as a format error, got '" + message + "'");
+    std::cout << "[PASS] TestRejectsDeepNesting\n";
+}
+
+int main()
+{
+    TestRoundTripPrintsIdentically();
+    TestRoundTripIsStable();
+    TestSpansSurviveRoundTrip();
+    TestLiteralAlternatives();
+    TestFileRoundTrip();
+    TestRejectsCorruptData();
+    TestRejectsDeepNesting();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
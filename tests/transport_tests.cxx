@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../source/include/transport.hxx"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+/**
+ * Hands out a string a few bytes at a time, as a pipe might.
+ */
+class ChunkedSource : public ByteSource
+{
+public:
+    ChunkedSource(std::string data, size_t maxChunk) : data(std::move(data)), maxChunk(maxChunk) {}
+
+    size_t read(char *out, size_t size) override
+    {
+        size_t n = std::min({size, maxChunk == 0 ? 1 + rng() % 4096 : maxChunk, data.size() - at});
+        std::copy_n(data.data() + at, n, out);
+        at += n;
+        return n;
+    }
+
+private:
+    std::string data;
+    size_t maxChunk; /**< 0 for random sizes */
+    size_t at = 0;
+    std::mt19937 rng{7};
+};
+
+class RecordingSink : public ByteSink
+{
+public:
+    bool write(const std::string_view *pieces, size_t count) override
+    {
+        ++calls;
+        for (size_t i = 0; i < count; ++i)
+            data.append(pieces[i]);
+        return true;
+    }
+
+    std::string data;
+    size_t calls = 0;
+};
+
+static std::string frame(const std::string &body)
+{
+    return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static std::vector<std::string> readAll(ByteSource &source, size_t capacity = 64)
+{
+    MessageReader reader(source, capacity);
+    std::vector<std::string> bodies;
+    std::string_view body;
+    while (reader.next(body))
+        bodies.emplace_back(body);
+    return bodies;
+}
+
+static void TestFraming()
+{
+    std::string large(5 << 20, 'x');
+    std::string input = frame("{\"id\":1}") +
+                        "Content-Type: application/vscode-jsonrpc; charset=utf-8\r\ncontent-length:  2\r\n\r\n{}" +
+                        "X-Unknown: 1\r\n\r\n" + // No length: skipped
+                        frame(large) +
+                        frame("") +
+                        frame("{\"id\":2}");
+    const std::vector<std::string> expected = {"{\"id\":1}", "{}", large, "", "{\"id\":2}"};
+
+    size_t test = 0;
+    for (size_t chunk : {size_t{1}, size_t{7}, size_t{0}, size_t{1} << 20})
+    {
+        // Reading a byte at a time is slow; leave the large body out.
+        std::string text = input;
+        std::vector<std::string> want = expected;
+        if (chunk == 1)
+        {
+            text.erase(text.find(frame(large)), frame(large).size());
+            want.erase(want.begin() + 2);
+        }
+        ChunkedSource source(text, chunk);
+        auto bodies = readAll(source);
+        expect(bodies == want, test++, "bodies with reads of at most " + std::to_string(chunk) + " bytes");
+    }
+    std::cout << "[PASS] TestFraming\n";
+}
+
+static void TestTruncatedInput()
+{
+    const std::pair<std::string, size_t> inputs[] = {
+        {"Content-Length: 10\r\n\r\n{\"a\"", 0},
+        {"Content-Len", 0},
+        {frame("{}") + "Content-Length: 5\r\n", 1},
+    };
+    for (const auto &[input, complete] : inputs)
+    {
+        ChunkedSource source(input, 3);
+        expect(readAll(source).size() == complete, 0, "a partial message is not returned");
+    }
+
+    std::istringstream stream(frame("{\"id\":3}") + frame("[]"));
+    StreamSource source(stream);
+    auto bodies = readAll(source);
+    expect(bodies.size() == 2 && bodies[1] == "[]", 1, "stream source");
+    std::cout << "[PASS] TestTruncatedInput\n";
+}
+
+static void TestWriter()
+{
+    RecordingSink sink;
+    MessageWriter writer(sink);
+    std::deque<std::string> batch = {"{\"id\":1}", "", std::string(100000, 'y')};
+    expect(writer.write(batch), 0, "written");
+    expect(sink.calls == 1, 0, "one write per batch");
+    expect(sink.data == frame(batch[0]) + frame(batch[1]) + frame(batch[2]), 1, "framed bodies");
+
+    std::ostringstream out;
+    StreamSink streamSink(out);
+    MessageWriter streamWriter(streamSink);
+    streamWriter.write({"[]"});
+    expect(out.str() == frame("[]"), 2, "stream sink");
+    std::cout << "[PASS] TestWriter\n";
+}
+
+static void TestPipe()
+{
+#if !defined(_WIN32)
+    // More pieces than one writev takes, and more bytes than the pipe holds,
+    // so writes are split and come back short.
+    int fds[2];
+    expect(::pipe(fds) == 0, 0, "pipe");
+    std::deque<std::string> batch;
+    for (int i = 0; i < 3000; ++i)
+        batch.push_back("{\"id\":" + std::to_string(i) + "}");
+    batch.push_back(std::string(1 << 20, 'z'));
+
+    std::thread producer([&] {
+        FileSink sink(fds[1]);
+        MessageWriter writer(sink);
+        writer.write(batch);
+        ::close(fds[1]);
+    });
+    FileSource source(fds[0]);
+    auto bodies = readAll(source, 4096);
+    producer.join();
+    ::close(fds[0]);
+
+    expect(bodies.size() == batch.size(), 1, "every message arrived");
+    expect(std::equal(bodies.begin(), bodies.end(), batch.begin()), 2, "in order and intact");
+#endif
+    std::cout << "[PASS] TestPipe\n";
+}
+
+int main()
+{
+    TestFraming();
+    TestTruncatedInput();
+    TestWriter();
+    TestPipe();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/parser.hxx"
+#include "../source/include/resolver.hxx"
+#include "../source/include/source.hxx"
+#include "../source/include/types.hxx"
+#include "../source/include/visitor.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static ASTNodePtr parse(const std::string &source)
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    return parser.parserProgram();
+}
+
+/**
+ * Resolve and type check a program, returning the formatted diagnostics.
+ */
+static std::vector<std::string> check(const std::string &source, ASTNodePtr &ast, TypeTable &types, unsigned threads = 0)
+{
+    ast = parse(source);
+    std::vector<Diagnostic> diagnostics;
+    resolveNames(ast.get(), diagnostics);
+    checkTypes(ast.get(), types, diagnostics, threads);
+
+    SourceManager sources;
+    sources.addFile("test.vs", source);
+    std::vector<std::string> messages;
+    for (const auto &d : diagnostics)
+        messages.push_back(sources.format(d));
+    return messages;
+}
+
+static void TestTypeTableInterning()
+{
+    TypeTable types;
+    TypeId i64 = TypeTable::primitive(Type::Int64);
+    TypeId f = types.function({i64, i64}, i64);
+    TypeId g = types.function({i64, i64}, i64);
+    TypeId h = types.function({i64}, i64);
+    expect(f == g, 0, "equal signatures must intern to one ID");
+    expect(f != h, 0, "different signatures must not");
+    expect(types.name(f) == "(int64, int64) int64", 0, "function name: " + types.name(f));
+
+    ClassDeclNode a("A", AccessType::Public, nullptr), b("B", AccessType::Public, nullptr);
+    expect(types.classType(&a) == types.classType(&a) && types.classType(&a) != types.classType(&b), 1, "classes are identified by declaration");
+    expect(types.name(types.classType(&b)) == "B", 1, "class name");
+    expect(types.name(TypeTable::primitive(Type::Float32)) == "float32", 1, "primitive name");
+    std::cout << "[PASS] TestTypeTableInterning\n";
+}
+
+static void TestLiteralsTakeTheirContextType()
+{
+    ASTNodePtr ast;
+    TypeTable types;
+    auto messages = check(R"(class Math {
+    public static scale(int8[a]) int8 {
+        return a * 3 + 1
+    }
+    static var pi : float32 = 3.14
+    static var big : uint64 = 1 + 2 * 3
+})",
+                          ast, types);
+    expect(messages.empty(), 0, messages.empty() ? "" : messages[0]);
+
+    const auto *program = static_cast<const BlockNode *>(ast.get());
+    const auto *body = static_cast<const BlockNode *>(nodeAs<ClassDeclNode>(program->children[0].get())->body.get());
+    const auto *fn = nodeAs<FunctionDeclNode>(body->children[0].get());
+    const auto *ret = nodeAs<ReturnExprNode>(static_cast<const BlockNode *>(fn->body.get())->children[0].get());
+    const auto *sum = nodeAs<BinaryExprNode>(ret->expr.get());
+    TypeId i8 = TypeTable::primitive(Type::Int8);
+    expect(sum->typeId == i8 && sum->right->typeId == i8, 1, "literal 1 must become int8");
+    expect(nodeAs<BinaryExprNode>(sum->left.get())->right->typeId == i8, 1, "literal 3 must become int8");
+    expect(fn->typeId == types.function({i8}, i8), 1, "function type mismatch");
+
+    const auto *pi = nodeAs<VarDeclNode>(body->children[1].get());
+    expect(pi->value->typeId == TypeTable::primitive(Type::Float32), 2, "3.14 must become float32");
+    const auto *big = nodeAs<VarDeclNode>(body->children[2].get());
+    const auto *product = nodeAs<BinaryExprNode>(nodeAs<BinaryExprNode>(big->value.get())->right.get());
+    expect(product->left->typeId == TypeTable::primitive(Type::Uint64), 2, "nested untyped literals must settle too");
+    std::cout << "[PASS] TestLiteralsTakeTheirContextType\n";
+}
+
+static void TestTypeErrors()
+{
+    ASTNodePtr ast;
+    TypeTable types;
+    auto messages = check(R"(var small : int8 = 300
+var flag : boolean = true
+var n : int64 = flag + 1
+f(int32[a], int64[b]) int64 {
+    if a {
+        return a + b
+    }
+    return 2.5
+}
+g(boolean[p]) void {
+    return 1
+})",
+                          ast, types);
+
+    std::vector<std::string> expected = {
+        "test.vs:1:20: error: constant 300 overflows int8",
+        "test.vs:3:24: error: cannot use untyped integer as boolean",
+        "test.vs:5:8: error: cannot use int32 as boolean",
+        "test.vs:6:16: error: invalid operands to '+': int32 and int64",
+        "test.vs:8:12: error: cannot use untyped float as int64",
+        "test.vs:11:5: error: function returning void cannot return a value",
+    };
+    expect(messages.size() == expected.size(), 0, "expected " + std::to_string(expected.size()) + " diagnostics, got " + std::to_string(messages.size()));
+    for (size_t i = 0; i < expected.size(); ++i)
+        expect(messages[i] == expected[i], 1, messages[i]);
+    std::cout << "[PASS] TestTypeErrors\n";
+}
+
+static void TestParallelMatchesSequential()
+{
+    std::string source;
+    for (int i = 0; i < 500; ++i)
+    {
+        std::string n = std::to_string(i);
+        source += "f" + n + "(int64[a], int32[b]) int64 {\n    var t : int64 = a * " + n + "\n";
+        source += i % 7 == 0 ? "    return t + b\n}\n" : "    return t + a\n}\n";
+    }
+
+    ASTNodePtr first, second;
+    TypeTable one, many;
+    auto sequential = check(source, first, one, 1);
+    auto parallel = check(source, second, many, 4);
+    expect(sequential.size() == 72, 0, "expected 72 errors, got " + std::to_string(sequential.size()));
+    expect(sequential == parallel, 0, "parallel diagnostics must match sequential ones in order");
+    expect(one.size() == many.size(), 0, "both runs must intern the same types");
+    std::cout << "[PASS] TestParallelMatchesSequential\n";
+}
+
+int main()
+{
+    TestTypeTableInterning();
+    TestLiteralsTakeTheirContextType();
+    TestTypeErrors();
+    TestParallelMatchesSequential();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
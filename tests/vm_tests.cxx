@@ -0,0 +1,181 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/dce.hxx"
+#include "../source/include/fold.hxx"
+#include "../source/include/ir.hxx"
+#include "../source/include/parser.hxx"
+#include "../source/include/resolver.hxx"
+#include "../source/include/vm.hxx"
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static BytecodeProgram compile(const std::string &source)
+{
+    Lexer lexer(source, "test.vs");
+    Parser parser(lexer);
+    ASTNodePtr ast = parser.parserProgram();
+
+    std::vector<Diagnostic> diagnostics;
+    TypeTable types;
+    resolveNames(ast.get(), diagnostics);
+    checkTypes(ast.get(), types, diagnostics);
+    foldConstants(ast, types, diagnostics);
+    eliminateDeadCode(ast);
+    if (!diagnostics.empty())
+        fail(0, "program must compile: " + diagnostics[0].message);
+    return compileBytecode(lowerToIR(ast.get(), types), types);
+}
+
+static VMValue run(VirtualMachine &vm, const BytecodeProgram &program, const std::string &name, std::vector<VMValue> args = {})
+{
+    auto fn = program.find(name);
+    if (!fn)
+        fail(0, "no function " + name);
+    return vm.call(*fn, args);
+}
+
+static VMValue i64(int64_t v) { return VMValue{v}; }
+
+static void TestCallsAndStatics()
+{
+    BytecodeProgram program = compile(R"(var base : int64 = 100
+public class Counter {
+    public static var count : int64 = 10
+    public static next() int64 {
+        count = count + 1
+        return count
+    }
+}
+fib(int64[n]) int64 {
+    if n < 2 {
+        return n
+    }
+    return fib(n - 1) + fib(n - 2)
+}
+twice(int64[a]) int64 {
+    return a * 2
+}
+twice(int64[a, b]) int64 {
+    return (a + b) * 2
+}
+main() int64 {
+    Counter.next()
+    return base + Counter.next() + twice(1) + twice(1, 2)
+}
+peek() int64 {
+    return Counter.count * 2
+})");
+
+    VirtualMachine vm(program);
+    vm.initialize();
+    expect(run(vm, program, "fib", {i64(20)}).i == 6765, 0, "fib(20)");
+    expect(run(vm, program, "main").i == 100 + 12 + 2 + 6, 1, "static field state, qualified calls and overloads");
+    expect(run(vm, program, "Counter.next").i == 13, 2, "globals persist between calls");
+    vm.initialize();
+    expect(run(vm, program, "Counter.next").i == 11, 2, "initialize resets globals");
+    expect(run(vm, program, "peek").i == 22, 2, "static fields are read from outside their class");
+    expect(sizeof(VMInstruction) == 8, 3, "instructions must stay 8 bytes");
+    std::cout << "[PASS] TestCallsAndStatics\n";
+}
+
+static void TestWidths()
+{
+    BytecodeProgram program = compile(R"(add8(int8[a, b]) int8 {
+    return a + b
+}
+sub8(uint8[a, b]) uint8 {
+    return a - b
+}
+mul32(int32[a, b]) int32 {
+    return a * b
+}
+div16(int16[a, b]) int16 {
+    return a / b
+}
+below(uint64[a, b]) boolean {
+    return a < b
+}
+addf(float32[a, b]) float32 {
+    return a + b
+}
+half(float64[a]) float64 {
+    if a > 1.5 {
+        return a / 2.0
+    }
+    return a
+})");
+
+    VirtualMachine vm(program);
+    expect(run(vm, program, "add8", {i64(127), i64(1)}).i == -128, 0, "int8 wraps");
+    VMValue r = run(vm, program, "sub8", {i64(0), i64(1)});
+    expect(r.u == 255, 1, "uint8 wraps to 255, got " + std::to_string(r.u));
+    expect(run(vm, program, "mul32", {i64(65536), i64(65536)}).i == 0, 2, "int32 multiplication wraps");
+    expect(run(vm, program, "div16", {i64(-32768), i64(-1)}).i == -32768, 2, "int16 division overflow wraps");
+
+    VMValue big;
+    big.u = UINT64_MAX;
+    expect(run(vm, program, "below", {i64(1), big}).u == 1, 3, "uint64 compares unsigned");
+    expect(run(vm, program, "below", {big, i64(1)}).u == 0, 3, "uint64 compares unsigned");
+
+    VMValue a, b;
+    a.f = 0.1f;
+    b.f = 0.2f;
+    expect(run(vm, program, "addf", {a, b}).f == static_cast<float>(a.f + b.f), 4, "float32 results are rounded");
+    VMValue h;
+    h.f = 5.0;
+    expect(run(vm, program, "half", {h}).f == 2.5, 5, "float64 arithmetic");
+    std::cout << "[PASS] TestWidths\n";
+}
+
+static void TestRuntimeErrors()
+{
+    BytecodeProgram program = compile(R"(divide(int64[a, b]) int64 {
+    return a / b
+}
+down(int64[n]) int64 {
+    return down(n + 1)
+}
+positive(int64[a]) int64 {
+    if a > 0 {
+        return 1
+    }
+})");
+
+    VirtualMachine vm(program, 1 << 16, 1000);
+    auto throws = [&](const std::string &name, std::vector<VMValue> args, const std::string &text) {
+        try
+        {
+            run(vm, program, name, std::move(args));
+        }
+        catch (const std::runtime_error &e)
+        {
+            return std::string(e.what()).find(text) != std::string::npos;
+        }
+        return false;
+    };
+    expect(throws("divide", {i64(1), i64(0)}, "division by zero"), 0, "division by zero must throw");
+    expect(throws("down", {i64(0)}, "stack overflow"), 1, "unbounded recursion must overflow");
+    expect(throws("positive", {i64(0)}, "without returning"), 2, "falling off a non-void function must throw");
+    expect(run(vm, program, "divide", {i64(7), i64(2)}).i == 3, 3, "the VM is usable after an error");
+    std::cout << "[PASS] TestRuntimeErrors\n";
+}
+
+int main()
+{
+    TestCallsAndStatics();
+    TestWidths();
+    TestRuntimeErrors();
+    std::cout << "\nALL TESTS PASSED\n";
+    return 0;
+}
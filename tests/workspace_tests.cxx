@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../source/include/workspace.hxx"
+
+namespace fs = std::filesystem;
+
+static void fail(size_t i, const std::string &msg)
+{
+    std::cerr << "[FAIL] test[" << i << "] " << msg << "\n";
+    std::exit(1);
+}
+
+static void expect(bool cond, size_t i, const std::string &msg)
+{
+    if (!cond)
+        fail(i, msg);
+}
+
+static void writeFile(const fs::path &path, const std::string &text)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+static std::vector<std::string> names(const std::vector<const WorkspaceSymbol *> &symbols)
+{
+    std::vector<std::string> result;
+    for (const auto *symbol : symbols)
+        result.push_back(symbol->name);
+    return result;
+}
+
+static const std::string mathFile = R"(class Math {
+    public static add(int64[a, b]) int64 {
+        return a + b
+    }
+    static var scale : int64 = 2
+}
+var total: int64 = 1
+square(int64[x]) int64 {
+    var local: int64 = x
+    return local * x
+})";
+
+static void TestDeclarations()
+{
+    auto symbols = indexFile(mathFile).symbols;
+    expect(symbols.size() == 4, 0, "class, method, field and function; got " + std::to_string(symbols.size()));
+    expect(symbols[0].name == "Math" && symbols[0].kind == SymbolKind::Class && symbols[0].container.empty(), 1, "class");
+    expect(symbols[1].name == "add" && symbols[1].kind == SymbolKind::Method && symbols[1].container == "Math", 2, "method");
+    expect(symbols[1].line == 1 && symbols[1].character == 4, 2, "method position");
+    expect(symbols[2].name == "scale" && symbols[2].kind == SymbolKind::Field, 3, "field");
+    expect(symbols[3].name == "square" && symbols[3].kind == SymbolKind::Function && symbols[3].line == 7, 4, "function");
+    std::cout << "[PASS] TestDeclarations\n";
+}
+
+static void TestCachedRebuild()
+{
+    fs::path root = fs::temp_directory_path() / "vsharp_workspace_tests";
+    fs::remove_all(root);
+    writeFile(root / "src" / "math.vs", mathFile);
+    writeFile(root / "src" / "nested" / "shapes.vs", "class Shape {\n    var area: int64 = 0\n}\n");
+    writeFile(root / "broken.vs", "class {");
+    writeFile(root / "notes.txt", "class Ignored {}");
+
+    ArtifactCache cache(root / "cache", 1 << 20);
+    WorkspaceIndex index;
+    index.build({root / "src", root, root / "missing"}, &cache, 2);
+    expect(index.files.size() == 3, 0, "every .vs file once");
+    expect(index.parsed == 3, 0, "a cold cache parses everything");
+    expect(index.symbols.size() == 6, 1, "declarations of the files that parse");
+
+    WorkspaceIndex again;
+    again.build({root}, &cache, 2);
+    expect(again.parsed == 0, 2, "an unchanged workspace is read from the cache");
+    expect(again.symbols.size() == index.symbols.size(), 2, "same declarations");
+    const auto *area = again.query("area", 1)[0];
+    expect(area->container == "Shape" && area->line == 1 && again.files[area->file].filename() == "shapes.vs", 3, "cached symbols keep their location");
+
+    writeFile(root / "src" / "nested" / "shapes.vs", "class Shape {\n    var area: int64 = 0\n    var sides: int64 = 0\n}\n");
+    WorkspaceIndex changed;
+    changed.build({root}, &cache, 2);
+    expect(changed.parsed == 1, 4, "only the changed file is parsed");
+    expect(names(changed.query("sides")) == std::vector<std::string>{"sides"}, 4, "new declaration");
+
+    fs::remove_all(root);
+    std::cout << "[PASS] TestCachedRebuild\n";
+}
+
+static void TestFuzzyQuery()
+{
+    WorkspaceIndex index;
+    index.build({}, nullptr);
+    expect(index.query("").empty(), 0, "empty index");
+
+    fs::path root = fs::temp_directory_path() / "vsharp_workspace_fuzzy";
+    fs::remove_all(root);
+    writeFile(root / "a.vs", R"(class HashMap {
+    var size: int64 = 0
+}
+hashString(int64[x]) int64 {
+    return x
+}
+hmm(int64[x]) int64 {
+    return x
+}
+rehash(int64[x]) int64 {
+    return x
+}
+)");
+    index.build({root}, nullptr, 1);
+    fs::remove_all(root);
+
+    auto found = names(index.query("hm"));
+    expect(found.size() == 2, 1, "subsequence matches only");
+    expect(found[0] == "hmm", 2, "a contiguous prefix ranks first, got " + found[0]);
+    expect(found[1] == "HashMap", 2, "word starts rank next");
+
+    found = names(index.query("HASH"));
+    expect(found.size() == 3 && found.back() == "rehash", 3, "case is ignored and prefixes beat inner matches");
+    expect(names(index.query("hash", 2)).size() == 2, 4, "limit");
+    expect(index.query("zz").empty(), 5, "no match");
+    expect(index.query("").size() == 5, 6, "an empty pattern matches everything");
+    std::cout << "[PASS] TestFuzzyQuery\n";
+}
+
+static void TestReferenceMap()
+{
+    fs::path root = fs::temp_directory_path() / "vsharp_workspace_references";
+    fs::remove_all(root);
+    writeFile(root / "math.vs", mathFile + "\nvar twice: int64 = square(total) + Math.add(total, 1)\n");
+    writeFile(root / "other.vs", "var x: int64 = Math.add(1, 2)\nvar total: int64 = x\n");
+
+    ArtifactCache cache(root / "cache", 1 << 20);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        WorkspaceIndex index;
+        index.build({root}, &cache, 2);
+        expect(index.parsed == (pass == 0 ? 2u : 0u), 0, "the second build reads the cache");
+
+        const auto &add = index.references["Math.add"];
+        expect(add.size() == 3, 1, "declaration and two calls, got " + std::to_string(add.size()));
+        expect(add[0].declaration && add[0].line == 1 && add[0].character == 18 && add[0].endCharacter == 21, 2, "declaration");
+        expect(!add[1].declaration && index.files[add[2].file].filename() == "other.vs", 3, "calls in both files");
+
+        const auto &total = index.references["total"];
+        expect(total.size() == 4, 4, "two declarations and two uses, got " + std::to_string(total.size()));
+        expect(index.references["Math"].size() == 3, 5, "the class and the calls through it");
+        expect(index.references.count("x") == 1 && index.references.count("a") == 0 && index.references.count("local") == 0, 6,
+               "top-level names only");
+    }
+    fs::remove_all(root);
+    std::cout << "[PASS] TestReferenceMap\n";
+}
+
+static void TestUpdate()
+{
+    fs::path root = fs::temp_directory_path() / "vsharp_workspace_update";
+    fs::remove_all(root);
+    writeFile(root / "math.vs", mathFile);
+    writeFile(root / "other.vs", "var x: int64 = Math.add(1, 2)\n");
+
+    ArtifactCache cache(root / "cache", 1 << 20);
+    WorkspaceIndex index;
+    index.build({root}, &cache, 1);
+    expect(index.references["Math.add"].size() == 2, 0, "declaration and call");
+
+    writeFile(root / "other.vs", "var x: int64 = Math.add(1, 2) + Math.add(3, 4)\nvar renamed: int64 = x\n");
+    writeFile(root / "added.vs", "class Added {\n    var size: int64 = 0\n}\n");
+    index.update({root / "other.vs", root / "added.vs", root / "notes.txt", root.parent_path() / "outside.vs"}, &cache);
+    expect(index.parsed == 2 && index.files.size() == 3, 1, "changed and new files are parsed");
+    expect(index.references["Math.add"].size() == 3, 2, "the file's old references are replaced");
+    expect(index.references.count("renamed") == 1 && names(index.query("Added")) == std::vector<std::string>{"Added"}, 3, "new declarations");
+    expect(index.query("square").size() == 1, 4, "unchanged files are kept");
+
+    writeFile(root / "other.vs", "var x: int64 = Math.add(1, 2)\n");
+    index.update({root / "other.vs"}, &cache);
+    expect(index.parsed == 0 && index.references["Math.add"].size() == 2, 5, "content seen before comes from the cache");
+
+    fs::remove(root / "math.vs");
+    index.update({root / "math.vs"}, &cache);
+    expect(index.query("square").empty() && index.references["Math.add"].size() == 1, 6, "a deleted file contributes nothing");
+    expect(index.references.count("total") == 0, 6, "names only it used are gone");
+
+    fs::remove_all(root);
+    std::cout << "[PASS] TestUpdate\n";
+}
+
+static void TestCacheKeepsOtherFiles()
+{
+    fs::path root = fs::temp_directory_path() / "vsharp_workspace_cache";
+    fs::remove_all(root);
+    writeFile(root / "notes.txt", std::string(4096, 'n'));
+    writeFile(root / "big.bin", std::string(4096, 'b'));
+    writeFile(root / "0123456789ABCDEF.vssym", "not an entry");
+
+    ArtifactCache cache(root, 1);
+    cache.store(ArtifactCache::key("a", "vssym", 1), "vssym", "first");
+    cache.store(ArtifactCache::key("b", "vssym", 1), "vssym", "second");
+    expect(fs::exists(root / "notes.txt") && fs::exists(root / "big.bin") && fs::exists(root / "0123456789ABCDEF.vssym"), 0,
+           "files that are not entries are never evicted");
+    expect(!cache.lookup(ArtifactCache::key("a", "vssym", 1), "vssym"), 1, "entries over the cap are");
+    fs::remove_all(root);
+    std::cout << "[PASS] TestCacheKeepsOtherFiles\n";
+}
+
+int main()
+{
+    TestDeclarations();
+    TestCachedRebuild();
+    TestFuzzyQuery();
+    TestReferenceMap();
+    TestUpdate();
+    TestCacheKeepsOtherFiles();
+    std::cout << "ALL TESTS PASSED\n";
+    return 0;
+}